@@ -536,6 +536,11 @@ static bool MakeUserDirs()
 	if (!do_mkdir(path))
 		return false;
 
+	if (GetConfigPath(path, sizeof(path), "obs-studio/effect_cache") <= 0)
+		return false;
+	if (!do_mkdir(path))
+		return false;
+
 	return true;
 }
 
@@ -1305,6 +1310,9 @@ static bool StartupOBS(const char *locale, profiler_name_store_t *store)
 {
 	char path[512];
 
+	if (GetConfigPath(path, sizeof(path), "obs-studio/effect_cache") > 0)
+		gs_effect_cache_set_path(path);
+
 	if (GetConfigPath(path, sizeof(path), "obs-studio/plugin_config") <= 0)
 		return false;
 
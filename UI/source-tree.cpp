@@ -11,6 +11,7 @@
 #include <obs.h>
 
 #include <string>
+#include <algorithm>
 
 #include <QLabel>
 #include <QLineEdit>
@@ -19,6 +20,8 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QMouseEvent>
+#include <QResizeEvent>
+#include <QSet>
 
 #include <QStylePainter>
 #include <QStyleOptionFocusRect>
@@ -150,9 +153,6 @@ void SourceTreeItem::paintEvent(QPaintEvent *event)
 void SourceTreeItem::DisconnectSignals()
 {
 	sceneRemoveSignal.Disconnect();
-	itemRemoveSignal.Disconnect();
-	selectSignal.Disconnect();
-	deselectSignal.Disconnect();
 	visibleSignal.Disconnect();
 	lockedSignal.Disconnect();
 	renameSignal.Disconnect();
@@ -174,19 +174,10 @@ void SourceTreeItem::ReconnectSignals()
 
 	/* --------------------------------------------------------- */
 
-	auto removeItem = [](void *data, calldata_t *cd) {
+	auto removeScene = [](void *data, calldata_t *) {
 		SourceTreeItem *this_ =
 			reinterpret_cast<SourceTreeItem *>(data);
-		obs_sceneitem_t *curItem =
-			(obs_sceneitem_t *)calldata_ptr(cd, "item");
-
-		if (curItem == this_->sceneitem) {
-			QMetaObject::invokeMethod(this_->tree, "Remove",
-						  Q_ARG(OBSSceneItem, curItem));
-			curItem = nullptr;
-		}
-		if (!curItem)
-			QMetaObject::invokeMethod(this_, "Clear");
+		QMetaObject::invokeMethod(this_, "Clear");
 	};
 
 	auto itemVisible = [](void *data, calldata_t *cd) {
@@ -213,50 +204,15 @@ void SourceTreeItem::ReconnectSignals()
 						  Q_ARG(bool, locked));
 	};
 
-	auto itemSelect = [](void *data, calldata_t *cd) {
-		SourceTreeItem *this_ =
-			reinterpret_cast<SourceTreeItem *>(data);
-		obs_sceneitem_t *curItem =
-			(obs_sceneitem_t *)calldata_ptr(cd, "item");
-
-		if (curItem == this_->sceneitem)
-			QMetaObject::invokeMethod(this_, "Select");
-	};
-
-	auto itemDeselect = [](void *data, calldata_t *cd) {
-		SourceTreeItem *this_ =
-			reinterpret_cast<SourceTreeItem *>(data);
-		obs_sceneitem_t *curItem =
-			(obs_sceneitem_t *)calldata_ptr(cd, "item");
-
-		if (curItem == this_->sceneitem)
-			QMetaObject::invokeMethod(this_, "Deselect");
-	};
-
-	auto reorderGroup = [](void *data, calldata_t *) {
-		SourceTreeItem *this_ =
-			reinterpret_cast<SourceTreeItem *>(data);
-		QMetaObject::invokeMethod(this_->tree, "ReorderItems");
-	};
-
+	/* item removal, selection and group reordering are handled by the
+	 * model, since rows outside of the viewport have no widget */
 	obs_scene_t *scene = obs_sceneitem_get_scene(sceneitem);
 	obs_source_t *sceneSource = obs_scene_get_source(scene);
 	signal_handler_t *signal = obs_source_get_signal_handler(sceneSource);
 
-	sceneRemoveSignal.Connect(signal, "remove", removeItem, this);
-	itemRemoveSignal.Connect(signal, "item_remove", removeItem, this);
+	sceneRemoveSignal.Connect(signal, "remove", removeScene, this);
 	visibleSignal.Connect(signal, "item_visible", itemVisible, this);
 	lockedSignal.Connect(signal, "item_locked", itemLocked, this);
-	selectSignal.Connect(signal, "item_select", itemSelect, this);
-	deselectSignal.Connect(signal, "item_deselect", itemDeselect, this);
-
-	if (obs_sceneitem_is_group(sceneitem)) {
-		obs_source_t *source = obs_sceneitem_get_source(sceneitem);
-		signal = obs_source_get_signal_handler(source);
-
-		groupReorderSignal.Connect(signal, "reorder", reorderGroup,
-					   this);
-	}
 
 	/* --------------------------------------------------------- */
 
@@ -526,18 +482,6 @@ void SourceTreeItem::ExpandClicked(bool checked)
 		tree->GetStm()->CollapseGroup(sceneitem);
 }
 
-void SourceTreeItem::Select()
-{
-	tree->SelectItem(sceneitem, true);
-	OBSBasic::Get()->UpdateContextBar();
-}
-
-void SourceTreeItem::Deselect()
-{
-	tree->SelectItem(sceneitem, false);
-	OBSBasic::Get()->UpdateContextBar();
-}
-
 /* ========================================================================= */
 
 void SourceTreeModel::OBSFrontendEvent(enum obs_frontend_event event, void *ptr)
@@ -555,8 +499,85 @@ void SourceTreeModel::OBSFrontendEvent(enum obs_frontend_event event, void *ptr)
 	}
 }
 
+void SourceTreeModel::ItemRemoved(void *data, calldata_t *cd)
+{
+	SourceTreeModel *stm = reinterpret_cast<SourceTreeModel *>(data);
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(cd, "item");
+
+	QMetaObject::invokeMethod(stm->st, "Remove",
+				  Q_ARG(OBSSceneItem, OBSSceneItem(item)));
+}
+
+void SourceTreeModel::ItemSelected(void *data, calldata_t *cd)
+{
+	SourceTreeModel *stm = reinterpret_cast<SourceTreeModel *>(data);
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(cd, "item");
+
+	QMetaObject::invokeMethod(stm->st, "ItemSelected",
+				  Q_ARG(OBSSceneItem, OBSSceneItem(item)),
+				  Q_ARG(bool, true));
+}
+
+void SourceTreeModel::ItemDeselected(void *data, calldata_t *cd)
+{
+	SourceTreeModel *stm = reinterpret_cast<SourceTreeModel *>(data);
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(cd, "item");
+
+	QMetaObject::invokeMethod(stm->st, "ItemSelected",
+				  Q_ARG(OBSSceneItem, OBSSceneItem(item)),
+				  Q_ARG(bool, false));
+}
+
+void SourceTreeModel::GroupReordered(void *data, calldata_t *)
+{
+	SourceTreeModel *stm = reinterpret_cast<SourceTreeModel *>(data);
+	QMetaObject::invokeMethod(stm->st, "ReorderItems");
+}
+
+void SourceTreeModel::ConnectScene(obs_scene_t *scene)
+{
+	obs_source_t *source = obs_scene_get_source(scene);
+	signal_handler_t *signal = obs_source_get_signal_handler(source);
+
+	sceneSignals.emplace_back(signal, "item_remove", ItemRemoved, this);
+	sceneSignals.emplace_back(signal, "item_select", ItemSelected, this);
+	sceneSignals.emplace_back(signal, "item_deselect", ItemDeselected,
+				  this);
+}
+
+void SourceTreeModel::ConnectSceneSignals()
+{
+	sceneSignals.clear();
+
+	OBSScene scene = GetCurrentScene();
+	if (!scene)
+		return;
+
+	auto connectGroup = [](obs_scene_t *, obs_sceneitem_t *item,
+			       void *param) {
+		SourceTreeModel *stm =
+			reinterpret_cast<SourceTreeModel *>(param);
+
+		if (obs_sceneitem_is_group(item)) {
+			obs_source_t *source = obs_sceneitem_get_source(item);
+			signal_handler_t *signal =
+				obs_source_get_signal_handler(source);
+
+			stm->ConnectScene(obs_sceneitem_group_get_scene(item));
+			stm->sceneSignals.emplace_back(signal, "reorder",
+						       GroupReordered, stm);
+		}
+		return true;
+	};
+
+	ConnectScene(scene);
+	obs_scene_enum_items(scene, connectGroup, this);
+}
+
 void SourceTreeModel::Clear()
 {
+	sceneSignals.clear();
+
 	beginResetModel();
 	items.clear();
 	endResetModel();
@@ -597,9 +618,15 @@ void SourceTreeModel::SceneChanged()
 	endResetModel();
 
 	UpdateGroupState(false);
+	ConnectSceneSignals();
 	st->ResetWidgets();
 
-	for (int i = 0; i < items.count(); i++) {
+	SyncSelection(0, items.count() - 1);
+}
+
+void SourceTreeModel::SyncSelection(int first, int last)
+{
+	for (int i = first; i <= last; i++) {
 		bool select = obs_sceneitem_selected(items[i]);
 		QModelIndex index = createIndex(i, 0);
 
@@ -618,7 +645,6 @@ static inline void MoveItem(QVector<OBSSceneItem> &items, int oldIdx,
 	items.insert(newIdx, item);
 }
 
-/* reorders list optimally with model reorder funcs */
 void SourceTreeModel::ReorderItems()
 {
 	OBSScene scene = GetCurrentScene();
@@ -626,12 +652,67 @@ void SourceTreeModel::ReorderItems()
 	QVector<OBSSceneItem> newitems;
 	obs_scene_enum_items(scene, enumItem, &newitems);
 
-	/* if item list has changed size, do full reset */
-	if (newitems.count() != items.count()) {
-		SceneChanged();
-		return;
+	ApplyItems(newitems);
+}
+
+/* updates the list incrementally with model remove/insert/move funcs, so rows
+ * that did not change keep their widget and selection state */
+void SourceTreeModel::ApplyItems(const QVector<OBSSceneItem> &newitems)
+{
+	QSet<obs_sceneitem_t *> newSet;
+	bool changed = false;
+
+	for (obs_sceneitem_t *item : newitems)
+		newSet.insert(item);
+
+	/* remove items that are gone, one contiguous range at a time */
+	for (int i = items.count() - 1; i >= 0; i--) {
+		if (newSet.contains(items[i]))
+			continue;
+
+		int last = i;
+		while (i > 0 && !newSet.contains(items[i - 1]))
+			i--;
+
+		beginRemoveRows(QModelIndex(), i, last);
+		items.remove(i, last - i + 1);
+		endRemoveRows();
+		changed = true;
+	}
+
+	QSet<obs_sceneitem_t *> oldSet;
+	for (obs_sceneitem_t *item : items)
+		oldSet.insert(item);
+
+	/* insert new items after the item that precedes them */
+	for (int i = 0; i < newitems.count(); i++) {
+		if (oldSet.contains(newitems[i]))
+			continue;
+
+		int last = i;
+		while (last + 1 < newitems.count() &&
+		       !oldSet.contains(newitems[last + 1]))
+			last++;
+
+		int row = i ? items.indexOf(newitems[i - 1]) + 1 : 0;
+		int count = last - i + 1;
+
+		beginInsertRows(QModelIndex(), row, row + count - 1);
+		for (int j = 0; j < count; j++)
+			items.insert(row + j, newitems[i + j]);
+		endInsertRows();
+
+		SyncSelection(row, row + count - 1);
+		changed = true;
+		i = last;
 	}
 
+	if (changed) {
+		UpdateGroupState(true);
+		ConnectSceneSignals();
+	}
+
+	/* reorder remaining items optimally with model reorder funcs */
 	for (;;) {
 		int idx1Old = 0;
 		int idx1New = 0;
@@ -694,6 +775,8 @@ void SourceTreeModel::ReorderItems()
 		}
 		endMoveRows();
 	}
+
+	st->UpdateWidgets();
 }
 
 void SourceTreeModel::Add(obs_sceneitem_t *item)
@@ -704,8 +787,6 @@ void SourceTreeModel::Add(obs_sceneitem_t *item)
 		beginInsertRows(QModelIndex(), 0, 0);
 		items.insert(0, item);
 		endInsertRows();
-
-		st->UpdateWidget(createIndex(0, 0, nullptr), item);
 	}
 }
 
@@ -745,8 +826,10 @@ void SourceTreeModel::Remove(obs_sceneitem_t *item)
 	items.remove(idx, endIdx - startIdx + 1);
 	endRemoveRows();
 
-	if (is_group)
+	if (is_group) {
 		UpdateGroupState(true);
+		ConnectSceneSignals();
+	}
 }
 
 OBSSceneItem SourceTreeModel::Get(int idx)
@@ -830,8 +913,8 @@ void SourceTreeModel::AddGroup()
 	items.insert(0, group);
 	endInsertRows();
 
-	st->UpdateWidget(createIndex(0, 0, nullptr), group);
 	UpdateGroupState(true);
+	ConnectSceneSignals();
 
 	QMetaObject::invokeMethod(st, "Edit", Qt::QueuedConnection,
 				  Q_ARG(int, 0));
@@ -879,6 +962,7 @@ void SourceTreeModel::GroupSelectedItems(QModelIndexList &indices)
 	}
 
 	hasGroups = true;
+	ConnectSceneSignals();
 	st->UpdateWidgets(true);
 
 	obs_sceneitem_select(item, true);
@@ -984,6 +1068,7 @@ SourceTree::SourceTree(QWidget *parent_) : QListView(parent_)
 		"*[bgColor=\"8\"]{background-color:rgba(255,255,255,33%);}"));
 
 	setMouseTracking(true);
+	setUniformItemSizes(true);
 
 	UpdateNoSourcesMessage();
 	connect(App(), &OBSApp::StyleChanged, this,
@@ -993,49 +1078,50 @@ SourceTree::SourceTree(QWidget *parent_) : QListView(parent_)
 
 void SourceTree::UpdateIcons()
 {
-	SourceTreeModel *stm = GetStm();
-	stm->SceneChanged();
+	ResetWidgets();
 }
 
 void SourceTree::SetIconsVisible(bool visible)
 {
-	SourceTreeModel *stm = GetStm();
-
 	iconsVisible = visible;
-	stm->SceneChanged();
+	ResetWidgets();
 }
 
 void SourceTree::ResetWidgets()
 {
-	OBSScene scene = GetCurrentScene();
+	widgetRows.Clear(this);
 
+	/* widgets for the visible rows are created in updateGeometries()
+	 * once the rows have been laid out */
+	scheduleDelayedItemsLayout();
+}
+
+SourceTreeItem *SourceTree::CreateWidget(int row)
+{
 	SourceTreeModel *stm = GetStm();
-	stm->UpdateGroupState(false);
 
-	for (int i = 0; i < stm->items.count(); i++) {
-		QModelIndex index = stm->createIndex(i, 0, nullptr);
-		setIndexWidget(index, new SourceTreeItem(this, stm->items[i]));
-	}
+	SourceTreeItem *widget = new SourceTreeItem(this, stm->items[row]);
+	widgetRows.Set(this, row, widget);
+	return widget;
 }
 
-void SourceTree::UpdateWidget(const QModelIndex &idx, obs_sceneitem_t *item)
+void SourceTree::UpdateVisibleWidgets()
 {
-	setIndexWidget(idx, new SourceTreeItem(this, item));
+	auto editing = [](QWidget *widget) {
+		return reinterpret_cast<SourceTreeItem *>(widget)->IsEditing();
+	};
+	auto create = [this](int row) { CreateWidget(row); };
+
+	widgetRows.Update(this, editing, create);
 }
 
 void SourceTree::UpdateWidgets(bool force)
 {
-	SourceTreeModel *stm = GetStm();
-
-	for (int i = 0; i < stm->items.size(); i++) {
-		obs_sceneitem_t *item = stm->items[i];
-		SourceTreeItem *widget = GetItemWidget(i);
-
-		if (!widget) {
-			UpdateWidget(stm->createIndex(i, 0), item);
-		} else {
+	for (const QPersistentModelIndex &index : widgetRows.Rows()) {
+		SourceTreeItem *widget =
+			reinterpret_cast<SourceTreeItem *>(indexWidget(index));
+		if (index.isValid() && widget)
 			widget->Update(force);
-		}
 	}
 }
 
@@ -1059,6 +1145,12 @@ void SourceTree::SelectItem(obs_sceneitem_t *sceneitem, bool select)
 				      : QItemSelectionModel::Deselect);
 }
 
+void SourceTree::ItemSelected(OBSSceneItem item, bool select)
+{
+	SelectItem(item, select);
+	OBSBasic::Get()->UpdateContextBar();
+}
+
 Q_DECLARE_METATYPE(OBSSceneItem);
 
 void SourceTree::mouseDoubleClickEvent(QMouseEvent *event)
@@ -1410,8 +1502,11 @@ void SourceTree::Edit(int row)
 		return;
 
 	QModelIndex index = stm->createIndex(row, 0);
-	QWidget *widget = indexWidget(index);
-	SourceTreeItem *itemWidget = reinterpret_cast<SourceTreeItem *>(widget);
+	scrollTo(index);
+
+	SourceTreeItem *itemWidget = GetItemWidget(row);
+	if (!itemWidget)
+		itemWidget = CreateWidget(row);
 	if (itemWidget->IsEditing())
 		return;
 
@@ -1574,3 +1669,21 @@ void SourceTree::paintEvent(QPaintEvent *event)
 		QListView::paintEvent(event);
 	}
 }
+
+void SourceTree::resizeEvent(QResizeEvent *event)
+{
+	QListView::resizeEvent(event);
+	UpdateVisibleWidgets();
+}
+
+void SourceTree::scrollContentsBy(int dx, int dy)
+{
+	QListView::scrollContentsBy(dx, dy);
+	UpdateVisibleWidgets();
+}
+
+void SourceTree::updateGeometries()
+{
+	QListView::updateGeometries();
+	UpdateVisibleWidgets();
+}
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <vector>
 #include <QList>
 #include <QVector>
+#include <QPersistentModelIndex>
 #include <QPointer>
 #include <QListView>
 #include <QCheckBox>
@@ -11,6 +13,8 @@
 #include <obs.hpp>
 #include <obs-frontend-api.h>
 
+#include "visible-row-widgets.hpp"
+
 class QLabel;
 class QCheckBox;
 class QLineEdit;
@@ -68,10 +72,6 @@ private:
 	SourceTree *tree;
 	OBSSceneItem sceneitem;
 	OBSSignal sceneRemoveSignal;
-	OBSSignal itemRemoveSignal;
-	OBSSignal groupReorderSignal;
-	OBSSignal selectSignal;
-	OBSSignal deselectSignal;
 	OBSSignal visibleSignal;
 	OBSSignal lockedSignal;
 	OBSSignal renameSignal;
@@ -90,9 +90,6 @@ private slots:
 	void Renamed(const QString &name);
 
 	void ExpandClicked(bool checked);
-
-	void Select();
-	void Deselect();
 };
 
 class SourceTreeModel : public QAbstractListModel {
@@ -105,10 +102,23 @@ class SourceTreeModel : public QAbstractListModel {
 	QVector<OBSSceneItem> items;
 	bool hasGroups = false;
 
+	/* item remove/select/reorder signals of the current scene and its
+	 * groups, so rows without a widget still stay in sync */
+	std::vector<OBSSignal> sceneSignals;
+
 	static void OBSFrontendEvent(enum obs_frontend_event event, void *ptr);
+	static void ItemRemoved(void *data, calldata_t *cd);
+	static void ItemSelected(void *data, calldata_t *cd);
+	static void ItemDeselected(void *data, calldata_t *cd);
+	static void GroupReordered(void *data, calldata_t *cd);
+
+	void ConnectScene(obs_scene_t *scene);
+	void ConnectSceneSignals();
 	void Clear();
 	void SceneChanged();
 	void ReorderItems();
+	void ApplyItems(const QVector<OBSSceneItem> &newitems);
+	void SyncSelection(int first, int last);
 
 	void Add(obs_sceneitem_t *item);
 	void Remove(obs_sceneitem_t *item);
@@ -150,10 +160,15 @@ class SourceTree : public QListView {
 
 	bool iconsVisible = true;
 
+	/* rows that currently have an item widget; widgets only exist for
+	 * rows in (or near) the viewport and for rows being edited */
+	VisibleRowWidgets widgetRows;
+
 	void UpdateNoSourcesMessage();
 
 	void ResetWidgets();
-	void UpdateWidget(const QModelIndex &idx, obs_sceneitem_t *item);
+	void UpdateVisibleWidgets();
+	SourceTreeItem *CreateWidget(int row);
 	void UpdateWidgets(bool force = false);
 
 	inline SourceTreeModel *GetStm() const
@@ -162,6 +177,7 @@ class SourceTree : public QListView {
 	}
 
 public:
+	/* returns nullptr if the row is not currently shown */
 	inline SourceTreeItem *GetItemWidget(int idx)
 	{
 		QWidget *widget = indexWidget(GetStm()->createIndex(idx, 0));
@@ -188,8 +204,9 @@ public:
 
 public slots:
 	inline void ReorderItems() { GetStm()->ReorderItems(); }
-	inline void RefreshItems() { GetStm()->SceneChanged(); }
+	inline void RefreshItems() { GetStm()->ReorderItems(); }
 	void Remove(OBSSceneItem item);
+	void ItemSelected(OBSSceneItem item, bool select);
 	void GroupSelectedItems();
 	void UngroupSelectedGroups();
 	void AddGroup();
@@ -201,6 +218,9 @@ protected:
 	virtual void mouseMoveEvent(QMouseEvent *event) override;
 	virtual void leaveEvent(QEvent *event) override;
 	virtual void paintEvent(QPaintEvent *event) override;
+	virtual void resizeEvent(QResizeEvent *event) override;
+	virtual void scrollContentsBy(int dx, int dy) override;
+	virtual void updateGeometries() override;
 
 	virtual void
 	selectionChanged(const QItemSelection &selected,
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <QList>
+#include <QListView>
+#include <QPersistentModelIndex>
+
+/* rows above and below the viewport that keep their widget, so that small
+ * scrolls don't have to create new widgets */
+#define WIDGET_OVERSCAN_ROWS 8
+
+/* Item widgets of a list view that only has widgets for the rows in (or
+ * near) its viewport.  Header only, so that test/benchmark can measure it
+ * without the rest of the UI. */
+class VisibleRowWidgets {
+	QList<QPersistentModelIndex> rows;
+
+public:
+	inline const QList<QPersistentModelIndex> &Rows() const { return rows; }
+
+	inline void Set(QListView *view, int row, QWidget *widget)
+	{
+		QModelIndex index = view->model()->index(row, 0);
+		view->setIndexWidget(index, widget);
+		rows.append(index);
+	}
+
+	inline void Clear(QListView *view)
+	{
+		for (QPersistentModelIndex &index : rows) {
+			if (index.isValid())
+				view->setIndexWidget(index, nullptr);
+		}
+		rows.clear();
+	}
+
+	/* keep(widget) returns true for a widget that has to stay even when
+	 * its row is out of view, create(row) calls Set() for a row that is
+	 * in view and has no widget yet */
+	template<typename Keep, typename Create>
+	void Update(QListView *view, Keep keep, Create create)
+	{
+		int count = view->model()->rowCount(QModelIndex());
+		int first = 0;
+		int last = -1;
+
+		if (count) {
+			QRect rect = view->viewport()->rect();
+			QModelIndex top = view->indexAt(rect.topLeft());
+			QModelIndex bottom = view->indexAt(rect.bottomLeft());
+
+			/* not laid out yet */
+			if (!top.isValid())
+				return;
+
+			last = bottom.isValid() ? bottom.row() : count - 1;
+			last = std::min(last + WIDGET_OVERSCAN_ROWS, count - 1);
+			first = std::max(top.row() - WIDGET_OVERSCAN_ROWS, 0);
+		}
+
+		for (int i = rows.count() - 1; i >= 0; i--) {
+			QPersistentModelIndex &index = rows[i];
+			QWidget *widget = view->indexWidget(index);
+
+			if (index.isValid() && widget) {
+				int row = index.row();
+				if (row >= first && row <= last)
+					continue;
+				if (keep(widget))
+					continue;
+
+				view->setIndexWidget(index, nullptr);
+			}
+
+			rows.removeAt(i);
+		}
+
+		for (int i = first; i <= last; i++) {
+			QModelIndex index = view->model()->index(i, 0);
+			if (!view->indexWidget(index))
+				create(i);
+		}
+	}
+};
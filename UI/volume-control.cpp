@@ -26,16 +26,6 @@ void VolControl::OBSVolumeChanged(void *data, float db)
 	QMetaObject::invokeMethod(volControl, "VolumeChanged");
 }
 
-void VolControl::OBSVolumeLevel(void *data,
-				const float magnitude[MAX_AUDIO_CHANNELS],
-				const float peak[MAX_AUDIO_CHANNELS],
-				const float inputPeak[MAX_AUDIO_CHANNELS])
-{
-	VolControl *volControl = static_cast<VolControl *>(data);
-
-	volControl->volMeter->setLevels(magnitude, peak, inputPeak);
-}
-
 void VolControl::OBSVolumeMuted(void *data, calldata_t *calldata)
 {
 	VolControl *volControl = static_cast<VolControl *>(data);
@@ -247,7 +237,6 @@ VolControl::VolControl(OBSSource source_, bool showConfig, bool vertical)
 	mute->setChecked(muted);
 	mute->setAccessibleName(QTStr("VolControl.Mute").arg(sourceName));
 	obs_fader_add_callback(obs_fader, OBSVolumeChanged, this);
-	obs_volmeter_add_callback(obs_volmeter, OBSVolumeLevel, this);
 
 	signal_handler_connect(obs_source_get_signal_handler(source), "mute",
 			       OBSVolumeMuted, this);
@@ -284,7 +273,6 @@ void VolControl::EnableSlider(bool enable)
 VolControl::~VolControl()
 {
 	obs_fader_remove_callback(obs_fader, OBSVolumeChanged, this);
-	obs_volmeter_remove_callback(obs_volmeter, OBSVolumeLevel, this);
 
 	signal_handler_disconnect(obs_source_get_signal_handler(source), "mute",
 				  OBSVolumeMuted, this);
@@ -301,6 +289,7 @@ QColor VolumeMeter::getBackgroundNominalColor() const
 void VolumeMeter::setBackgroundNominalColor(QColor c)
 {
 	backgroundNominalColor = std::move(c);
+	backgroundCacheDirty = true;
 }
 
 QColor VolumeMeter::getBackgroundWarningColor() const
@@ -311,6 +300,7 @@ QColor VolumeMeter::getBackgroundWarningColor() const
 void VolumeMeter::setBackgroundWarningColor(QColor c)
 {
 	backgroundWarningColor = std::move(c);
+	backgroundCacheDirty = true;
 }
 
 QColor VolumeMeter::getBackgroundErrorColor() const
@@ -321,6 +311,7 @@ QColor VolumeMeter::getBackgroundErrorColor() const
 void VolumeMeter::setBackgroundErrorColor(QColor c)
 {
 	backgroundErrorColor = std::move(c);
+	backgroundCacheDirty = true;
 }
 
 QColor VolumeMeter::getForegroundNominalColor() const
@@ -381,6 +372,7 @@ QColor VolumeMeter::getMajorTickColor() const
 void VolumeMeter::setMajorTickColor(QColor c)
 {
 	majorTickColor = std::move(c);
+	backgroundCacheDirty = true;
 }
 
 QColor VolumeMeter::getMinorTickColor() const
@@ -391,6 +383,7 @@ QColor VolumeMeter::getMinorTickColor() const
 void VolumeMeter::setMinorTickColor(QColor c)
 {
 	minorTickColor = std::move(c);
+	backgroundCacheDirty = true;
 }
 
 qreal VolumeMeter::getMinimumLevel() const
@@ -401,6 +394,7 @@ qreal VolumeMeter::getMinimumLevel() const
 void VolumeMeter::setMinimumLevel(qreal v)
 {
 	minimumLevel = v;
+	backgroundCacheDirty = true;
 }
 
 qreal VolumeMeter::getWarningLevel() const
@@ -411,6 +405,7 @@ qreal VolumeMeter::getWarningLevel() const
 void VolumeMeter::setWarningLevel(qreal v)
 {
 	warningLevel = v;
+	backgroundCacheDirty = true;
 }
 
 qreal VolumeMeter::getErrorLevel() const
@@ -421,6 +416,7 @@ qreal VolumeMeter::getErrorLevel() const
 void VolumeMeter::setErrorLevel(qreal v)
 {
 	errorLevel = v;
+	backgroundCacheDirty = true;
 }
 
 qreal VolumeMeter::getClipLevel() const
@@ -578,24 +574,36 @@ VolumeMeter::~VolumeMeter()
 	delete tickPaintCache;
 }
 
-void VolumeMeter::setLevels(const float magnitude[MAX_AUDIO_CHANNELS],
-			    const float peak[MAX_AUDIO_CHANNELS],
-			    const float inputPeak[MAX_AUDIO_CHANNELS])
+// Called once per UI tick with the levels libobs accumulated since the
+// last tick (fetched for all meters at once by VolumeMeterTimer), and
+// advances the ballistics.  Returns true if the meter changed visibly and
+// needs to be repainted.
+bool VolumeMeter::pollLevels(uint64_t ts, const obs_volmeter_levels &levels)
 {
-	uint64_t ts = os_gettime_ns();
-	QMutexLocker locker(&dataMutex);
+	if (levels.ts) {
+		QMutexLocker locker(&dataMutex);
 
-	currentLastUpdateTime = ts;
-	for (int channelNr = 0; channelNr < MAX_AUDIO_CHANNELS; channelNr++) {
-		currentMagnitude[channelNr] = magnitude[channelNr];
-		currentPeak[channelNr] = peak[channelNr];
-		currentInputPeak[channelNr] = inputPeak[channelNr];
+		currentLastUpdateTime = ts;
+		for (int channelNr = 0; channelNr < MAX_AUDIO_CHANNELS;
+		     channelNr++) {
+			currentMagnitude[channelNr] =
+				levels.magnitude[channelNr];
+			currentPeak[channelNr] = levels.peak[channelNr];
+			currentInputPeak[channelNr] =
+				levels.input_peak[channelNr];
+		}
 	}
 
-	// In case there are more updates then redraws we must make sure
-	// that the ballistics of peak and hold are recalculated.
-	locker.unlock();
-	calculateBallistics(ts);
+	qreal timeSinceLastRedraw = (ts - lastRedrawTime) * 0.000000001;
+
+	handleChannelCofigurationChange();
+	calculateBallistics(ts, timeSinceLastRedraw);
+	idle = detectIdle(ts);
+	lastRedrawTime = ts;
+
+	PaintState state;
+	getPaintState(state);
+	return !(state == paintedState);
 }
 
 inline void VolumeMeter::resetLevels()
@@ -634,6 +642,23 @@ inline void VolumeMeter::handleChannelCofigurationChange()
 	}
 }
 
+bool VolumeMeter::PaintState::operator==(const PaintState &other) const
+{
+	if (channels != other.channels || length != other.length ||
+	    idle != other.idle || clipping != other.clipping)
+		return false;
+
+	for (int channelNr = 0; channelNr < channels; channelNr++) {
+		if (magnitude[channelNr] != other.magnitude[channelNr] ||
+		    peak[channelNr] != other.peak[channelNr] ||
+		    peakHold[channelNr] != other.peakHold[channelNr] ||
+		    inputPeakHold[channelNr] != other.inputPeakHold[channelNr])
+			return false;
+	}
+
+	return true;
+}
+
 inline bool VolumeMeter::detectIdle(uint64_t ts)
 {
 	double timeSinceLastUpdate = (ts - currentLastUpdateTime) * 0.000000001;
@@ -730,22 +755,84 @@ inline void VolumeMeter::calculateBallistics(uint64_t ts,
 					      timeSinceLastRedraw);
 }
 
+inline int VolumeMeter::channelForMeter(int channelNr) const
+{
+	return (displayNrAudioChannels == 1 && channels > 2) ? 2 : channelNr;
+}
+
+inline int VolumeMeter::levelPosition(float level, int length) const
+{
+	// Same rounding as the paint functions, levels outside of the meter
+	// are all drawn the same.
+	if (!(level > minimumLevel))
+		return -1;
+	if (level >= 0.0f)
+		return length;
+
+	qreal scale = length / minimumLevel;
+	return int(length - (level * scale));
+}
+
+inline int VolumeMeter::inputLevelIndex(float peakHold) const
+{
+	if (peakHold < minimumInputLevel)
+		return 0;
+	else if (peakHold < warningLevel)
+		return 1;
+	else if (peakHold < errorLevel)
+		return 2;
+	else if (peakHold <= clipLevel)
+		return 3;
+	else
+		return 4;
+}
+
+void VolumeMeter::getPaintState(PaintState &state)
+{
+	QMutexLocker locker(&dataMutex);
+
+	state.channels = displayNrAudioChannels;
+	state.length = vertical ? height() - 10 : width() - 5;
+	state.idle = idle;
+	state.clipping = clipping;
+
+	for (int channelNr = 0; channelNr < displayNrAudioChannels;
+	     channelNr++) {
+		int channelNrFixed = channelForMeter(channelNr);
+
+		state.magnitude[channelNr] = levelPosition(
+			displayMagnitude[channelNrFixed], state.length);
+		state.peak[channelNr] = levelPosition(
+			displayPeak[channelNrFixed], state.length);
+		state.peakHold[channelNr] = levelPosition(
+			displayPeakHold[channelNrFixed], state.length);
+		state.inputPeakHold[channelNr] = inputLevelIndex(
+			displayInputPeakHold[channelNrFixed]);
+	}
+}
+
 void VolumeMeter::paintInputMeter(QPainter &painter, int x, int y, int width,
 				  int height, float peakHold)
 {
 	QMutexLocker locker(&dataMutex);
 	QColor color;
 
-	if (peakHold < minimumInputLevel)
+	switch (inputLevelIndex(peakHold)) {
+	case 0:
 		color = backgroundNominalColor;
-	else if (peakHold < warningLevel)
+		break;
+	case 1:
 		color = foregroundNominalColor;
-	else if (peakHold < errorLevel)
+		break;
+	case 2:
 		color = foregroundWarningColor;
-	else if (peakHold <= clipLevel)
+		break;
+	case 3:
 		color = foregroundErrorColor;
-	else
+		break;
+	default:
 		color = clipColor;
+	}
 
 	painter.fillRect(x, y, width, height, color);
 }
@@ -816,6 +903,24 @@ void VolumeMeter::ClipEnding()
 	clipping = false;
 }
 
+void VolumeMeter::paintHMeterBackground(QPainter &painter, int x, int y,
+					int width, int height)
+{
+	qreal scale = width / minimumLevel;
+
+	int minimumPosition = x + 0;
+	int maximumPosition = x + width;
+	int warningPosition = int(x + width - (warningLevel * scale));
+	int errorPosition = int(x + width - (errorLevel * scale));
+
+	painter.fillRect(minimumPosition, y, warningPosition - minimumPosition,
+			 height, backgroundNominalColor);
+	painter.fillRect(warningPosition, y, errorPosition - warningPosition,
+			 height, backgroundWarningColor);
+	painter.fillRect(errorPosition, y, maximumPosition - errorPosition,
+			 height, backgroundErrorColor);
+}
+
 void VolumeMeter::paintHMeter(QPainter &painter, int x, int y, int width,
 			      int height, float magnitude, float peak,
 			      float peakHold)
@@ -840,34 +945,20 @@ void VolumeMeter::paintHMeter(QPainter &painter, int x, int y, int width,
 		peakPosition = maximumPosition;
 	}
 
+	// The unlit bars are part of the background cache, only the lit
+	// part up to the peak is painted here.
 	if (peakPosition < minimumPosition) {
-		painter.fillRect(minimumPosition, y, nominalLength, height,
-				 backgroundNominalColor);
-		painter.fillRect(warningPosition, y, warningLength, height,
-				 backgroundWarningColor);
-		painter.fillRect(errorPosition, y, errorLength, height,
-				 backgroundErrorColor);
+		; // Peak below minimum, no drawing.
 	} else if (peakPosition < warningPosition) {
 		painter.fillRect(minimumPosition, y,
 				 peakPosition - minimumPosition, height,
 				 foregroundNominalColor);
-		painter.fillRect(peakPosition, y,
-				 warningPosition - peakPosition, height,
-				 backgroundNominalColor);
-		painter.fillRect(warningPosition, y, warningLength, height,
-				 backgroundWarningColor);
-		painter.fillRect(errorPosition, y, errorLength, height,
-				 backgroundErrorColor);
 	} else if (peakPosition < errorPosition) {
 		painter.fillRect(minimumPosition, y, nominalLength, height,
 				 foregroundNominalColor);
 		painter.fillRect(warningPosition, y,
 				 peakPosition - warningPosition, height,
 				 foregroundWarningColor);
-		painter.fillRect(peakPosition, y, errorPosition - peakPosition,
-				 height, backgroundWarningColor);
-		painter.fillRect(errorPosition, y, errorLength, height,
-				 backgroundErrorColor);
 	} else if (peakPosition < maximumPosition) {
 		painter.fillRect(minimumPosition, y, nominalLength, height,
 				 foregroundNominalColor);
@@ -875,9 +966,6 @@ void VolumeMeter::paintHMeter(QPainter &painter, int x, int y, int width,
 				 foregroundWarningColor);
 		painter.fillRect(errorPosition, y, peakPosition - errorPosition,
 				 height, foregroundErrorColor);
-		painter.fillRect(peakPosition, y,
-				 maximumPosition - peakPosition, height,
-				 backgroundErrorColor);
 	} else if (int(magnitude) != 0) {
 		if (!clipping) {
 			QTimer::singleShot(CLIP_FLASH_DURATION_MS, this,
@@ -888,6 +976,10 @@ void VolumeMeter::paintHMeter(QPainter &painter, int x, int y, int width,
 		int end = errorLength + warningLength + nominalLength;
 		painter.fillRect(minimumPosition, y, end, height,
 				 QBrush(foregroundErrorColor));
+	} else {
+		int end = errorLength + warningLength + nominalLength;
+		painter.fillRect(minimumPosition, y, end, height,
+				 palette().color(QPalette::ColorRole::Window));
 	}
 
 	if (peakHoldPosition - 3 < minimumPosition)
@@ -907,6 +999,26 @@ void VolumeMeter::paintHMeter(QPainter &painter, int x, int y, int width,
 				 magnitudeColor);
 }
 
+void VolumeMeter::paintVMeterBackground(QPainter &painter, int x, int y,
+					int width, int height)
+{
+	qreal scale = height / minimumLevel;
+
+	int minimumPosition = y + 0;
+	int maximumPosition = y + height;
+	int warningPosition = int(y + height - (warningLevel * scale));
+	int errorPosition = int(y + height - (errorLevel * scale));
+
+	painter.fillRect(x, minimumPosition, width,
+			 warningPosition - minimumPosition,
+			 backgroundNominalColor);
+	painter.fillRect(x, warningPosition, width,
+			 errorPosition - warningPosition,
+			 backgroundWarningColor);
+	painter.fillRect(x, errorPosition, width,
+			 maximumPosition - errorPosition, backgroundErrorColor);
+}
+
 void VolumeMeter::paintVMeter(QPainter &painter, int x, int y, int width,
 			      int height, float magnitude, float peak,
 			      float peakHold)
@@ -931,35 +1043,20 @@ void VolumeMeter::paintVMeter(QPainter &painter, int x, int y, int width,
 		peakPosition = maximumPosition;
 	}
 
+	// The unlit bars are part of the background cache, only the lit
+	// part up to the peak is painted here.
 	if (peakPosition < minimumPosition) {
-		painter.fillRect(x, minimumPosition, width, nominalLength,
-				 backgroundNominalColor);
-		painter.fillRect(x, warningPosition, width, warningLength,
-				 backgroundWarningColor);
-		painter.fillRect(x, errorPosition, width, errorLength,
-				 backgroundErrorColor);
+		; // Peak below minimum, no drawing.
 	} else if (peakPosition < warningPosition) {
 		painter.fillRect(x, minimumPosition, width,
 				 peakPosition - minimumPosition,
 				 foregroundNominalColor);
-		painter.fillRect(x, peakPosition, width,
-				 warningPosition - peakPosition,
-				 backgroundNominalColor);
-		painter.fillRect(x, warningPosition, width, warningLength,
-				 backgroundWarningColor);
-		painter.fillRect(x, errorPosition, width, errorLength,
-				 backgroundErrorColor);
 	} else if (peakPosition < errorPosition) {
 		painter.fillRect(x, minimumPosition, width, nominalLength,
 				 foregroundNominalColor);
 		painter.fillRect(x, warningPosition, width,
 				 peakPosition - warningPosition,
 				 foregroundWarningColor);
-		painter.fillRect(x, peakPosition, width,
-				 errorPosition - peakPosition,
-				 backgroundWarningColor);
-		painter.fillRect(x, errorPosition, width, errorLength,
-				 backgroundErrorColor);
 	} else if (peakPosition < maximumPosition) {
 		painter.fillRect(x, minimumPosition, width, nominalLength,
 				 foregroundNominalColor);
@@ -968,9 +1065,6 @@ void VolumeMeter::paintVMeter(QPainter &painter, int x, int y, int width,
 		painter.fillRect(x, errorPosition, width,
 				 peakPosition - errorPosition,
 				 foregroundErrorColor);
-		painter.fillRect(x, peakPosition, width,
-				 maximumPosition - peakPosition,
-				 backgroundErrorColor);
 	} else {
 		if (!clipping) {
 			QTimer::singleShot(CLIP_FLASH_DURATION_MS, this,
@@ -1000,18 +1094,16 @@ void VolumeMeter::paintVMeter(QPainter &painter, int x, int y, int width,
 				 magnitudeColor);
 }
 
-void VolumeMeter::paintEvent(QPaintEvent *event)
+void VolumeMeter::updateBackgroundCache()
 {
-	uint64_t ts = os_gettime_ns();
-	qreal timeSinceLastRedraw = (ts - lastRedrawTime) * 0.000000001;
+	int width = size().width();
+	int height = size().height();
+	qreal pixelRatio = devicePixelRatioF();
+	QSize cacheSize = size() * pixelRatio;
 
-	const QRect rect = event->region().boundingRect();
-	int width = rect.width();
-	int height = rect.height();
-
-	handleChannelCofigurationChange();
-	calculateBallistics(ts, timeSinceLastRedraw);
-	bool idle = detectIdle(ts);
+	if (!backgroundCacheDirty && backgroundCache.size() == cacheSize &&
+	    backgroundCacheChannels == displayNrAudioChannels)
+		return;
 
 	// Draw the ticks in a off-screen buffer when the widget changes size.
 	QSize tickPaintCacheSize;
@@ -1019,7 +1111,7 @@ void VolumeMeter::paintEvent(QPaintEvent *event)
 		tickPaintCacheSize = QSize(14, height);
 	else
 		tickPaintCacheSize = QSize(width, 9);
-	if (tickPaintCache == nullptr ||
+	if (backgroundCacheDirty || tickPaintCache == nullptr ||
 	    tickPaintCache->size() != tickPaintCacheSize) {
 		delete tickPaintCache;
 		tickPaintCache = new QPixmap(tickPaintCacheSize);
@@ -1041,12 +1133,16 @@ void VolumeMeter::paintEvent(QPaintEvent *event)
 		tickPainter.end();
 	}
 
-	// Actual painting of the widget starts here.
-	QPainter painter(this);
+	backgroundCache = QPixmap(cacheSize);
+	backgroundCache.setDevicePixelRatio(pixelRatio);
+	backgroundCacheDirty = false;
+	backgroundCacheChannels = displayNrAudioChannels;
+
+	QPainter painter(&backgroundCache);
 
 	// Paint window background color (as widget is opaque)
 	QColor background = palette().color(QPalette::ColorRole::Window);
-	painter.fillRect(rect, background);
+	painter.fillRect(0, 0, width, height, background);
 
 	if (vertical) {
 		// Invert the Y axis to ease the math
@@ -1060,11 +1156,37 @@ void VolumeMeter::paintEvent(QPaintEvent *event)
 
 	for (int channelNr = 0; channelNr < displayNrAudioChannels;
 	     channelNr++) {
+		if (vertical)
+			paintVMeterBackground(painter, channelNr * 4, 8, 3,
+					      height - 10);
+		else
+			paintHMeterBackground(painter, 5, channelNr * 4,
+					      width - 5, 3);
+	}
+}
+
+void VolumeMeter::paintEvent(QPaintEvent *)
+{
+	int width = size().width();
+	int height = size().height();
+
+	handleChannelCofigurationChange();
+	updateBackgroundCache();
 
-		int channelNrFixed =
-			(displayNrAudioChannels == 1 && channels > 2)
-				? 2
-				: channelNr;
+	// Actual painting of the widget starts here.
+	QPainter painter(this);
+	painter.drawPixmap(0, 0, backgroundCache);
+
+	if (vertical) {
+		// Invert the Y axis to ease the math
+		painter.translate(0, height);
+		painter.scale(1, -1);
+	}
+
+	for (int channelNr = 0; channelNr < displayNrAudioChannels;
+	     channelNr++) {
+
+		int channelNrFixed = channelForMeter(channelNr);
 
 		if (vertical)
 			paintVMeter(painter, channelNr * 4, 8, 3, height - 10,
@@ -1091,7 +1213,16 @@ void VolumeMeter::paintEvent(QPaintEvent *event)
 					displayInputPeakHold[channelNrFixed]);
 	}
 
-	lastRedrawTime = ts;
+	getPaintState(paintedState);
+}
+
+void VolumeMeter::changeEvent(QEvent *event)
+{
+	if (event->type() == QEvent::PaletteChange ||
+	    event->type() == QEvent::StyleChange)
+		backgroundCacheDirty = true;
+
+	QWidget::changeEvent(event);
 }
 
 void VolumeMeterTimer::AddVolControl(VolumeMeter *meter)
@@ -1106,6 +1237,18 @@ void VolumeMeterTimer::RemoveVolControl(VolumeMeter *meter)
 
 void VolumeMeterTimer::timerEvent(QTimerEvent *)
 {
-	for (VolumeMeter *meter : volumeMeters)
-		meter->update();
+	uint64_t ts = os_gettime_ns();
+	size_t count = volumeMeters.count();
+
+	levels.resize(count);
+	for (size_t i = 0; i < count; i++)
+		levels[i].volmeter = volumeMeters[(int)i]->getVolmeter();
+
+	obs_volmeters_get_levels(levels.data(), count);
+
+	for (size_t i = 0; i < count; i++) {
+		VolumeMeter *meter = volumeMeters[(int)i];
+		if (meter->pollLevels(ts, levels[i]))
+			meter->update();
+	}
 }
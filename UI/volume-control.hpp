@@ -7,6 +7,7 @@
 #include <QTimer>
 #include <QMutex>
 #include <QList>
+#include <vector>
 
 class QPushButton;
 class VolumeMeterTimer;
@@ -69,6 +70,21 @@ private:
 	static QWeakPointer<VolumeMeterTimer> updateTimer;
 	QSharedPointer<VolumeMeterTimer> updateTimerRef;
 
+	// Pixel positions of what was last painted, so that the meter is
+	// only repainted when something visibly changed.
+	struct PaintState {
+		int channels = -1;
+		int length = 0;
+		bool idle = false;
+		bool clipping = false;
+		int magnitude[MAX_AUDIO_CHANNELS];
+		int peak[MAX_AUDIO_CHANNELS];
+		int peakHold[MAX_AUDIO_CHANNELS];
+		int inputPeakHold[MAX_AUDIO_CHANNELS];
+
+		bool operator==(const PaintState &other) const;
+	};
+
 	inline void resetLevels();
 	inline void handleChannelCofigurationChange();
 	inline bool detectIdle(uint64_t ts);
@@ -77,12 +93,22 @@ private:
 	inline void calculateBallisticsForChannel(int channelNr, uint64_t ts,
 						  qreal timeSinceLastRedraw);
 
+	inline int channelForMeter(int channelNr) const;
+	inline int levelPosition(float level, int length) const;
+	inline int inputLevelIndex(float peakHold) const;
+	void getPaintState(PaintState &state);
+
+	void updateBackgroundCache();
 	void paintInputMeter(QPainter &painter, int x, int y, int width,
 			     int height, float peakHold);
+	void paintHMeterBackground(QPainter &painter, int x, int y, int width,
+				   int height);
 	void paintHMeter(QPainter &painter, int x, int y, int width, int height,
 			 float magnitude, float peak, float peakHold);
 	void paintHTicks(QPainter &painter, int x, int y, int width,
 			 int height);
+	void paintVMeterBackground(QPainter &painter, int x, int y, int width,
+				   int height);
 	void paintVMeter(QPainter &painter, int x, int y, int width, int height,
 			 float magnitude, float peak, float peakHold);
 	void paintVTicks(QPainter &painter, int x, int y, int height);
@@ -95,6 +121,13 @@ private:
 	float currentInputPeak[MAX_AUDIO_CHANNELS];
 
 	QPixmap *tickPaintCache = nullptr;
+	// Window color, ticks and unlit meter bars; rebuilt when the size,
+	// channel count, colors or levels change.
+	QPixmap backgroundCache;
+	bool backgroundCacheDirty = true;
+	int backgroundCacheChannels = 0;
+	PaintState paintedState;
+	bool idle = false;
 	int displayNrAudioChannels = 0;
 	float displayMagnitude[MAX_AUDIO_CHANNELS];
 	float displayPeak[MAX_AUDIO_CHANNELS];
@@ -135,9 +168,8 @@ public:
 			     bool vertical = false);
 	~VolumeMeter();
 
-	void setLevels(const float magnitude[MAX_AUDIO_CHANNELS],
-		       const float peak[MAX_AUDIO_CHANNELS],
-		       const float inputPeak[MAX_AUDIO_CHANNELS]);
+	inline obs_volmeter_t *getVolmeter() const { return obs_volmeter; }
+	bool pollLevels(uint64_t ts, const obs_volmeter_levels &levels);
 
 	QColor getBackgroundNominalColor() const;
 	void setBackgroundNominalColor(QColor c);
@@ -183,6 +215,7 @@ public:
 
 protected:
 	void paintEvent(QPaintEvent *event) override;
+	void changeEvent(QEvent *event) override;
 };
 
 class VolumeMeterTimer : public QTimer {
@@ -197,6 +230,9 @@ public:
 protected:
 	void timerEvent(QTimerEvent *event) override;
 	QList<VolumeMeter *> volumeMeters;
+
+	/* reused on every tick, one entry per meter */
+	std::vector<obs_volmeter_levels> levels;
 };
 
 class QLabel;
@@ -221,10 +257,6 @@ private:
 	bool vertical;
 
 	static void OBSVolumeChanged(void *param, float db);
-	static void OBSVolumeLevel(void *data,
-				   const float magnitude[MAX_AUDIO_CHANNELS],
-				   const float peak[MAX_AUDIO_CHANNELS],
-				   const float inputPeak[MAX_AUDIO_CHANNELS]);
 	static void OBSVolumeMuted(void *data, calldata_t *calldata);
 
 	void EmitConfigClicked();
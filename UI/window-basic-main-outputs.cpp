@@ -199,6 +199,24 @@ static bool CreateAACEncoder(OBSEncoder &res, string &id, int bitrate,
 
 /* ------------------------------------------------------------------------ */
 
+/* past DelaySpillMB in memory, the delayed stream is kept on disk */
+static void SetDelaySpill(obs_output_t *output, config_t *config)
+{
+	uint64_t spillMB = config_get_uint(config, "Output", "DelaySpillMB");
+	char path[512];
+
+	if (!spillMB ||
+	    GetConfigPath(path, sizeof(path), "obs-studio/delay_spill") <= 0 ||
+	    os_mkdirs(path) == MKDIR_ERROR) {
+		obs_output_set_delay_spill(output, nullptr, 0);
+		return;
+	}
+
+	obs_output_set_delay_spill(output, path, spillMB * 1024 * 1024);
+}
+
+/* ------------------------------------------------------------------------ */
+
 inline BasicOutputHandler::BasicOutputHandler(OBSBasic *main_) : main(main_)
 {
 	if (main->vcamEnabled) {
@@ -869,6 +887,7 @@ bool SimpleOutput::StartStreaming(obs_service_t *service)
 
 	obs_output_set_delay(streamOutput, useDelay ? delaySec : 0,
 			     preserveDelay ? OBS_OUTPUT_DELAY_PRESERVE : 0);
+	SetDelaySpill(streamOutput, main->Config());
 
 	obs_output_set_reconnect_settings(streamOutput, maxRetries, retryDelay);
 
@@ -1656,6 +1675,7 @@ bool AdvancedOutput::StartStreaming(obs_service_t *service)
 
 	obs_output_set_delay(streamOutput, useDelay ? delaySec : 0,
 			     preserveDelay ? OBS_OUTPUT_DELAY_PRESERVE : 0);
+	SetDelaySpill(streamOutput, main->Config());
 
 	obs_output_set_reconnect_settings(streamOutput, maxRetries, retryDelay);
 
@@ -1354,6 +1354,7 @@ bool OBSBasic::InitBasicConfigDefaults()
 	config_set_default_bool(basicConfig, "Output", "DelayEnable", false);
 	config_set_default_uint(basicConfig, "Output", "DelaySec", 20);
 	config_set_default_bool(basicConfig, "Output", "DelayPreserve", true);
+	config_set_default_uint(basicConfig, "Output", "DelaySpillMB", 0);
 
 	config_set_default_bool(basicConfig, "Output", "Reconnect", true);
 	config_set_default_uint(basicConfig, "Output", "RetryDelay", 10);
@@ -1688,6 +1689,7 @@ void OBSBasic::OBSInit()
 	obs_log_loaded_modules();
 	blog(LOG_INFO, "---------------------------------");
 	obs_post_load_modules();
+	UpdateMediaDecodeThreads();
 
 #ifdef BROWSER_AVAILABLE
 	cef = obs_browser_init_panel();
@@ -1794,6 +1796,7 @@ void OBSBasic::OBSInit()
 	auto addDisplay = [this](OBSQTDisplay *window) {
 		obs_display_add_draw_callback(window->GetDisplay(),
 					      OBSBasic::RenderMain, this);
+		obs_display_set_skip_when_late(window->GetDisplay(), true);
 
 		struct obs_video_info ovi;
 		if (obs_get_video_info(&ovi))
@@ -5565,6 +5568,18 @@ void OBSBasic::StartStreaming()
 		StartReplayBuffer();
 }
 
+void OBSBasic::UpdateMediaDecodeThreads()
+{
+	calldata_t cd = {0};
+	calldata_set_int(&cd, "threads",
+			 config_get_int(App()->GlobalConfig(), "General",
+					"MediaDecodeThreads"));
+
+	proc_handler_t *ph = obs_get_proc_handler();
+	proc_handler_call(ph, "ffmpeg_set_decode_threads", &cd);
+	calldata_free(&cd);
+}
+
 #ifdef _WIN32
 static inline void UpdateProcessPriority()
 {
@@ -7756,10 +7771,12 @@ static void ConfirmColor(SourceTree *sources, const QColor &color,
 	for (int x = 0; x < selectedItems.count(); x++) {
 		SourceTreeItem *treeItem =
 			sources->GetItemWidget(selectedItems[x].row());
-		treeItem->setStyleSheet("background: " +
-					color.name(QColor::HexArgb));
-		treeItem->style()->unpolish(treeItem);
-		treeItem->style()->polish(treeItem);
+		if (treeItem) {
+			treeItem->setStyleSheet("background: " +
+						color.name(QColor::HexArgb));
+			treeItem->style()->unpolish(treeItem);
+			treeItem->style()->polish(treeItem);
+		}
 
 		OBSSceneItem sceneItem = sources->Get(selectedItems[x].row());
 		obs_data_t *privData =
@@ -7787,10 +7804,12 @@ void OBSBasic::ColorChange()
 		for (int x = 0; x < selectedItems.count(); x++) {
 			SourceTreeItem *treeItem = ui->sources->GetItemWidget(
 				selectedItems[x].row());
-			treeItem->setStyleSheet("");
-			treeItem->setProperty("bgColor", preset);
-			treeItem->style()->unpolish(treeItem);
-			treeItem->style()->polish(treeItem);
+			if (treeItem) {
+				treeItem->setStyleSheet("");
+				treeItem->setProperty("bgColor", preset);
+				treeItem->style()->unpolish(treeItem);
+				treeItem->style()->polish(treeItem);
+			}
 
 			OBSSceneItem sceneItem =
 				ui->sources->Get(selectedItems[x].row());
@@ -7817,7 +7836,9 @@ void OBSBasic::ColorChange()
 
 		if (preset == 1) {
 			OBSSceneItem curSceneItem = GetCurrentSceneItem();
-			SourceTreeItem *curTreeItem =
+			/* the row widget can be deleted while the dialog is
+			 * open if the row is scrolled out of view */
+			QPointer<SourceTreeItem> curTreeItem =
 				GetItemWidgetFromSceneItem(curSceneItem);
 			obs_data_t *curPrivData =
 				obs_sceneitem_get_private_settings(
@@ -7825,10 +7846,12 @@ void OBSBasic::ColorChange()
 
 			int oldPreset =
 				obs_data_get_int(curPrivData, "color-preset");
-			const QString oldSheet = curTreeItem->styleSheet();
+			const QString oldSheet =
+				curTreeItem ? curTreeItem->styleSheet()
+					    : QString();
 
 			auto liveChangeColor = [=](const QColor &color) {
-				if (color.isValid()) {
+				if (curTreeItem && color.isValid()) {
 					curTreeItem->setStyleSheet(
 						"background: " +
 						color.name(QColor::HexArgb));
@@ -7843,6 +7866,9 @@ void OBSBasic::ColorChange()
 			};
 
 			auto rejected = [=]() {
+				if (!curTreeItem)
+					return;
+
 				if (oldPreset == 1) {
 					curTreeItem->setStyleSheet(oldSheet);
 					curTreeItem->setProperty("bgColor", 0);
@@ -7887,10 +7913,14 @@ void OBSBasic::ColorChange()
 				SourceTreeItem *treeItem =
 					ui->sources->GetItemWidget(
 						selectedItems[x].row());
-				treeItem->setStyleSheet("background: none");
-				treeItem->setProperty("bgColor", preset);
-				treeItem->style()->unpolish(treeItem);
-				treeItem->style()->polish(treeItem);
+				if (treeItem) {
+					treeItem->setStyleSheet(
+						"background: none");
+					treeItem->setProperty("bgColor",
+							      preset);
+					treeItem->style()->unpolish(treeItem);
+					treeItem->style()->polish(treeItem);
+				}
 
 				OBSSceneItem sceneItem = ui->sources->Get(
 					selectedItems[x].row());
@@ -7909,18 +7939,15 @@ void OBSBasic::ColorChange()
 SourceTreeItem *OBSBasic::GetItemWidgetFromSceneItem(obs_sceneitem_t *sceneItem)
 {
 	int i = 0;
-	SourceTreeItem *treeItem = ui->sources->GetItemWidget(i);
 	OBSSceneItem item = ui->sources->Get(i);
 	int64_t id = obs_sceneitem_get_id(sceneItem);
-	while (treeItem && obs_sceneitem_get_id(item) != id) {
+	while (item && obs_sceneitem_get_id(item) != id) {
 		i++;
-		treeItem = ui->sources->GetItemWidget(i);
 		item = ui->sources->Get(i);
 	}
-	if (treeItem)
-		return treeItem;
 
-	return nullptr;
+	/* rows outside of the viewport have no widget */
+	return item ? ui->sources->GetItemWidget(i) : nullptr;
 }
 
 void OBSBasic::on_autoConfigure_triggered()
@@ -770,6 +770,7 @@ public:
 
 	void AddVCamButton();
 	void ResetOutputs();
+	void UpdateMediaDecodeThreads();
 
 	void ResetAudioDevice(const char *sourceId, const char *deviceId,
 			      const char *deviceDesc, int channel);
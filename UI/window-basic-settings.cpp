@@ -548,6 +548,7 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	HookWidget(ui->streamDelayEnable,    CHECK_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->streamDelaySec,       SCROLL_CHANGED, ADV_CHANGED);
 	HookWidget(ui->streamDelayPreserve,  CHECK_CHANGED,  ADV_CHANGED);
+	HookWidget(ui->streamDelaySpillMB,   SCROLL_CHANGED, ADV_CHANGED);
 	HookWidget(ui->reconnectEnable,      CHECK_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->reconnectRetryDelay,  SCROLL_CHANGED, ADV_CHANGED);
 	HookWidget(ui->reconnectMaxRetries,  SCROLL_CHANGED, ADV_CHANGED);
@@ -558,6 +559,7 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	HookWidget(ui->hotkeyFocusType,      COMBO_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->autoRemux,            CHECK_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->dynBitrate,           CHECK_CHANGED,  ADV_CHANGED);
+	HookWidget(ui->mediaDecodeThreads,   SCROLL_CHANGED, ADV_CHANGED);
 	/* clang-format on */
 
 #define ADD_HOTKEY_FOCUS_TYPE(s)      \
@@ -629,7 +631,6 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	delete ui->enableNewSocketLoop;
 	delete ui->enableLowLatencyMode;
 	delete ui->browserHWAccel;
-	delete ui->sourcesGroup;
 #if defined(__APPLE__) || HAVE_PULSEAUDIO
 	delete ui->disableAudioDucking;
 #endif
@@ -643,7 +644,6 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	ui->enableNewSocketLoop = nullptr;
 	ui->enableLowLatencyMode = nullptr;
 	ui->browserHWAccel = nullptr;
-	ui->sourcesGroup = nullptr;
 #if defined(__APPLE__) || HAVE_PULSEAUDIO
 	ui->disableAudioDucking = nullptr;
 #endif
@@ -2399,6 +2399,8 @@ void OBSBasicSettings::LoadAdvancedSettings()
 	int delaySec = config_get_int(main->Config(), "Output", "DelaySec");
 	bool preserveDelay =
 		config_get_bool(main->Config(), "Output", "DelayPreserve");
+	int delaySpillMB =
+		config_get_int(main->Config(), "Output", "DelaySpillMB");
 	bool reconnect = config_get_bool(main->Config(), "Output", "Reconnect");
 	int retryDelay = config_get_int(main->Config(), "Output", "RetryDelay");
 	int maxRetries = config_get_int(main->Config(), "Output", "MaxRetries");
@@ -2445,6 +2447,7 @@ void OBSBasicSettings::LoadAdvancedSettings()
 
 	ui->streamDelaySec->setValue(delaySec);
 	ui->streamDelayPreserve->setChecked(preserveDelay);
+	ui->streamDelaySpillMB->setValue(delaySpillMB);
 	ui->streamDelayEnable->setChecked(enableDelay);
 	ui->autoRemux->setChecked(autoRemux);
 	ui->dynBitrate->setChecked(dynBitrate);
@@ -2496,6 +2499,10 @@ void OBSBasicSettings::LoadAdvancedSettings()
 	prevBrowserAccel = ui->browserHWAccel->isChecked();
 #endif
 
+	int mediaDecodeThreads = (int)config_get_int(
+		App()->GlobalConfig(), "General", "MediaDecodeThreads");
+	ui->mediaDecodeThreads->setValue(mediaDecodeThreads);
+
 	SetComboByValue(ui->hotkeyFocusType, hotkeyFocusType);
 
 	loading = false;
@@ -3116,6 +3123,13 @@ void OBSBasicSettings::SaveAdvancedSettings()
 			browserHWAccel);
 #endif
 
+	if (WidgetChanged(ui->mediaDecodeThreads)) {
+		config_set_int(App()->GlobalConfig(), "General",
+			       "MediaDecodeThreads",
+			       ui->mediaDecodeThreads->value());
+		main->UpdateMediaDecodeThreads();
+	}
+
 	if (WidgetChanged(ui->hotkeyFocusType)) {
 		QString str = GetComboData(ui->hotkeyFocusType);
 		config_set_string(App()->GlobalConfig(), "General",
@@ -3159,6 +3173,7 @@ void OBSBasicSettings::SaveAdvancedSettings()
 	SaveCheckBox(ui->streamDelayEnable, "Output", "DelayEnable");
 	SaveSpinBox(ui->streamDelaySec, "Output", "DelaySec");
 	SaveCheckBox(ui->streamDelayPreserve, "Output", "DelayPreserve");
+	SaveSpinBox(ui->streamDelaySpillMB, "Output", "DelaySpillMB");
 	SaveCheckBox(ui->reconnectEnable, "Output", "Reconnect");
 	SaveSpinBox(ui->reconnectRetryDelay, "Output", "RetryDelay");
 	SaveSpinBox(ui->reconnectMaxRetries, "Output", "MaxRetries");
@@ -3573,8 +3588,8 @@ void OBSBasicSettings::SaveSettings()
 	if (videoChanged || advancedChanged)
 		main->ResetVideo();
 
-	config_save_safe(main->Config(), "tmp", nullptr);
-	config_save_safe(GetGlobalConfig(), "tmp", nullptr);
+	config_save_safe_deferred(main->Config(), "tmp", nullptr);
+	config_save_safe_deferred(GetGlobalConfig(), "tmp", nullptr);
 	main->SaveProject();
 
 	if (Changed()) {
@@ -218,7 +218,7 @@ void OBSBasicStats::closeEvent(QCloseEvent *event)
 	if (isVisible()) {
 		config_set_string(main->Config(), "Stats", "geometry",
 				  saveGeometry().toBase64().constData());
-		config_save_safe(main->Config(), "tmp", nullptr);
+		config_save_safe_deferred(main->Config(), "tmp", nullptr);
 	}
 
 	QWidget::closeEvent(event);
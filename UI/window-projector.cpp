@@ -59,6 +59,15 @@ OBSProjector::OBSProjector(QWidget *widget, obs_source_t *source_, int monitor,
 			GetDisplay(),
 			isMultiview ? OBSRenderMultiview : OBSRender, this);
 		obs_display_set_background_color(GetDisplay(), 0x000000);
+		obs_display_set_skip_when_late(GetDisplay(), true);
+
+		/* these always show the same source, so they only have to
+		 * render when it changed */
+		if (type == ProjectorType::Source ||
+		    type == ProjectorType::Scene) {
+			obs_display_set_source(GetDisplay(), source);
+			obs_display_set_on_demand(GetDisplay(), true);
+		}
 	};
 
 	connect(this, &OBSQTDisplay::DisplayCreated, addDrawCallback);
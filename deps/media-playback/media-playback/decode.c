@@ -17,6 +17,9 @@
 #include "decode.h"
 #include "media.h"
 
+#include <util/platform.h>
+#include <util/profiler.h>
+
 #if LIBAVCODEC_VERSION_INT > AV_VERSION_INT(58, 4, 100)
 #define USE_NEW_HARDWARE_CODEC_METHOD
 #endif
@@ -72,6 +75,135 @@ static void init_hw_decoder(struct mp_decode *d, AVCodecContext *c)
 }
 #endif
 
+/* ------------------------------------------------------------------------- */
+/* decode thread budget: the threads available for software video decoding
+ * are split evenly between all open video decoders rather than each of them
+ * using every core.  A decoder's thread count is fixed once it's opened, so
+ * a decoder opening next to others only gets what they left over (but always
+ * at least one thread), and every decoder reopens itself with its fair share
+ * the next time it's flushed (seeks and loops) after the set of decoders or
+ * the budget changed. */
+
+static volatile long thread_budget = 0;
+static volatile long threads_in_use = 0;
+static volatile long budget_users = 0;
+static volatile long budget_generation = 0;
+
+#define MIN_DECODE_THREADS 2
+#define MAX_DECODE_THREADS 16
+
+void mp_decode_set_thread_budget(int threads)
+{
+	os_atomic_set_long(&thread_budget, threads > 0 ? threads : 0);
+	os_atomic_inc_long(&budget_generation);
+}
+
+int mp_decode_get_thread_budget(void)
+{
+	long budget = os_atomic_load_long(&thread_budget);
+	return budget ? (int)budget : os_get_logical_cores();
+}
+
+static inline bool codec_supports_threads(enum AVCodecID id)
+{
+	return id != AV_CODEC_ID_PNG && id != AV_CODEC_ID_TIFF &&
+	       id != AV_CODEC_ID_JPEG2000 && id != AV_CODEC_ID_MPEG4 &&
+	       id != AV_CODEC_ID_WEBP;
+}
+
+static inline long get_fair_share(long users)
+{
+	long share = mp_decode_get_thread_budget() / (users ? users : 1);
+
+	if (share < MIN_DECODE_THREADS)
+		share = MIN_DECODE_THREADS;
+	else if (share > MAX_DECODE_THREADS)
+		share = MAX_DECODE_THREADS;
+	return share;
+}
+
+static void add_threads_in_use(long threads)
+{
+	long in_use;
+
+	do {
+		in_use = os_atomic_load_long(&threads_in_use);
+	} while (!os_atomic_compare_swap_long(&threads_in_use, in_use,
+					      in_use + threads));
+}
+
+static int reserve_threads(long share)
+{
+	long budget = mp_decode_get_thread_budget();
+	long in_use;
+	long threads;
+
+	do {
+		in_use = os_atomic_load_long(&threads_in_use);
+		threads = budget - in_use;
+		if (threads > share)
+			threads = share;
+		if (threads < 1)
+			threads = 1;
+	} while (!os_atomic_compare_swap_long(&threads_in_use, in_use,
+					      in_use + threads));
+
+	return (int)threads;
+}
+
+static void release_thread_budget(struct mp_decode *d)
+{
+	if (!d->budget_threads)
+		return;
+
+	add_threads_in_use(-d->budget_threads);
+	os_atomic_dec_long(&budget_users);
+	os_atomic_inc_long(&budget_generation);
+	d->budget_threads = 0;
+}
+
+static void set_thread_config(struct mp_decode *d, AVCodecContext *c)
+{
+	int caps = d->codec->capabilities;
+	bool frame = (caps & AV_CODEC_CAP_FRAME_THREADS) != 0;
+	bool slice = (caps & AV_CODEC_CAP_SLICE_THREADS) != 0;
+	long users;
+	int threads;
+
+	if (c->thread_count != 1 || !codec_supports_threads(c->codec_id))
+		return;
+
+	if (d->audio) {
+		c->thread_count = 0;
+		return;
+	}
+
+	if (d->hw || (!frame && !slice))
+		return;
+
+	users = os_atomic_inc_long(&budget_users);
+	d->budget_generation = os_atomic_inc_long(&budget_generation);
+	threads = reserve_threads(get_fair_share(users));
+	d->budget_threads = threads;
+
+	/* frame threading scales better but adds a frame of latency per
+	 * thread, which live inputs can't hide behind buffering */
+	if (frame && (slice ? d->m->is_local_file : true))
+		c->thread_type = FF_THREAD_FRAME;
+	else
+		c->thread_type = FF_THREAD_SLICE;
+	c->thread_count = threads;
+
+	blog(LOG_INFO,
+	     "MP: Decoding '%s' with %d %s thread(s) "
+	     "(%ld video decoder(s) sharing %d threads)",
+	     d->m->path, threads,
+	     c->thread_type == FF_THREAD_FRAME ? "frame" : "slice", users,
+	     mp_decode_get_thread_budget());
+}
+
+/* ------------------------------------------------------------------------- */
+
 static int mp_open_codec(struct mp_decode *d, bool hw)
 {
 	AVCodecContext *c;
@@ -98,23 +230,23 @@ static int mp_open_codec(struct mp_decode *d, bool hw)
 		init_hw_decoder(d, c);
 #endif
 
-	if (c->thread_count == 1 && c->codec_id != AV_CODEC_ID_PNG &&
-	    c->codec_id != AV_CODEC_ID_TIFF &&
-	    c->codec_id != AV_CODEC_ID_JPEG2000 &&
-	    c->codec_id != AV_CODEC_ID_MPEG4 && c->codec_id != AV_CODEC_ID_WEBP)
-		c->thread_count = 0;
+	set_thread_config(d, c);
 
 	ret = avcodec_open2(c, d->codec, NULL);
 	if (ret < 0)
 		goto fail;
 
 	d->decoder = c;
+	d->stats.thread_count = c->thread_count;
+	d->stats.frame_threading = c->active_thread_type == FF_THREAD_FRAME;
 	return ret;
 
 fail:
-	avcodec_close(c);
+	release_thread_budget(d);
 #if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(57, 40, 101)
-	av_free(d->decoder);
+	avcodec_free_context(&c);
+#else
+	avcodec_close(c);
 #endif
 	return ret;
 }
@@ -129,6 +261,10 @@ bool mp_decode_init(mp_media_t *m, enum AVMediaType type, bool hw)
 	memset(d, 0, sizeof(*d));
 	d->m = m;
 	d->audio = type == AVMEDIA_TYPE_AUDIO;
+	d->profile_name = profile_store_name(obs_get_profiler_name_store(),
+					     "mp_decode_%s(%s)",
+					     d->audio ? "audio" : "video",
+					     m->path);
 
 	ret = av_find_best_stream(m->fmt, type, -1, -1, NULL, 0);
 	if (ret < 0)
@@ -210,6 +346,7 @@ void mp_decode_clear_packets(struct mp_decode *d)
 
 void mp_decode_free(struct mp_decode *d)
 {
+	mp_decode_free_cache(d);
 	mp_decode_clear_packets(d);
 	circlebuf_free(&d->packets);
 
@@ -235,6 +372,8 @@ void mp_decode_free(struct mp_decode *d)
 	}
 #endif
 
+	release_thread_budget(d);
+
 	memset(d, 0, sizeof(*d));
 }
 
@@ -315,6 +454,10 @@ static int decode_packet(struct mp_decode *d, int *got_frame)
 			return ret;
 		}
 
+		/* cached frames hold references to the previous buffers,
+		 * so have the transfer allocate new ones instead */
+		av_frame_unref(d->sw_frame);
+
 		int err = av_hwframe_transfer_data(d->sw_frame, d->hw_frame, 0);
 		if (err != 0) {
 			ret = 0;
@@ -327,17 +470,101 @@ static int decode_packet(struct mp_decode *d, int *got_frame)
 	return ret;
 }
 
+static inline size_t get_frame_data_size(const AVFrame *f)
+{
+	size_t size = 0;
+
+	for (size_t i = 0; i < AV_NUM_DATA_POINTERS && f->buf[i]; i++)
+		size += f->buf[i]->size;
+	for (int i = 0; i < f->nb_extended_buf; i++)
+		size += f->extended_buf[i]->size;
+
+	return size;
+}
+
+static void cache_frame(struct mp_decode *d)
+{
+	struct mp_media *m = d->m;
+	struct mp_cache_frame cf;
+
+	/* frames still in hardware surfaces would pin the decoder's pool */
+	if (d->frame != d->sw_frame) {
+		mp_media_cache_abandon(m, "hardware frames");
+		return;
+	}
+
+	m->cache_size += get_frame_data_size(d->frame);
+	if (m->cache_size > m->cache_limit) {
+		mp_media_cache_abandon(m, "size limit reached");
+		return;
+	}
+
+	cf.frame = av_frame_clone(d->frame);
+	cf.frame_pts = d->frame_pts;
+	cf.next_pts = d->next_pts;
+
+	if (!cf.frame) {
+		mp_media_cache_abandon(m, "out of memory");
+		return;
+	}
+
+	da_push_back(d->cache, &cf);
+}
+
+static bool next_cached_frame(struct mp_decode *d)
+{
+	struct mp_cache_frame *cf;
+
+	d->frame_ready = false;
+
+	if (d->cache_pos == d->cache.num) {
+		d->eof = true;
+		return true;
+	}
+
+	cf = d->cache.array + d->cache_pos++;
+	d->frame = cf->frame;
+	d->frame_pts = cf->frame_pts;
+	d->next_pts = cf->next_pts;
+	d->frame_ready = true;
+	return true;
+}
+
+static void update_stats(struct mp_decode *d, uint64_t decode_ns,
+			 uint32_t queue_depth)
+{
+	struct mp_decode_stats *stats = &d->stats;
+
+	pthread_mutex_lock(&d->m->mutex);
+	stats->frames++;
+	stats->total_decode_ns += decode_ns;
+	if (decode_ns > stats->max_decode_ns)
+		stats->max_decode_ns = decode_ns;
+	stats->queue_depth = queue_depth;
+	if (queue_depth > stats->max_queue_depth)
+		stats->max_queue_depth = queue_depth;
+	pthread_mutex_unlock(&d->m->mutex);
+}
+
 bool mp_decode_next(struct mp_decode *d)
 {
 	bool eof = d->m->eof;
+	uint32_t queue_depth;
+	uint64_t decode_ns = 0;
+	uint64_t start;
 	int got_frame;
 	int ret;
 
+	if (d->m->cache_replaying)
+		return next_cached_frame(d);
+
 	d->frame_ready = false;
 
 	if (!eof && !d->packets.size)
 		return true;
 
+	queue_depth = (uint32_t)(d->packets.size / sizeof(AVPacket));
+
 	while (!d->frame_ready) {
 		if (!d->packet_pending) {
 			if (!d->packets.size) {
@@ -355,10 +582,16 @@ bool mp_decode_next(struct mp_decode *d)
 			}
 		}
 
+		profile_start(d->profile_name);
+		start = os_gettime_ns();
 		ret = decode_packet(d, &got_frame);
+		decode_ns += os_gettime_ns() - start;
+		profile_end(d->profile_name);
 
 		if (!got_frame && ret == 0) {
 			d->eof = true;
+			if (d->m->cache_recording)
+				d->cache_done = true;
 			return true;
 		}
 		if (ret < 0) {
@@ -422,16 +655,86 @@ bool mp_decode_next(struct mp_decode *d)
 
 		d->last_duration = duration;
 		d->next_pts = d->frame_pts + duration;
+
+		if (d->m->cache_recording)
+			cache_frame(d);
+
+		update_stats(d, decode_ns, queue_depth);
 	}
 
 	return true;
 }
 
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(57, 40, 101)
+/* reopens a flushed software decoder if the decoders that were opened or
+ * closed since it was sized changed its fair share of the budget */
+static void rebalance_threads(struct mp_decode *d)
+{
+	long generation = os_atomic_load_long(&budget_generation);
+	AVCodecContext *old = d->decoder;
+	int old_threads = d->budget_threads;
+	long available;
+	long share;
+
+	if (!old_threads || d->budget_generation == generation)
+		return;
+
+	d->budget_generation = generation;
+
+	share = get_fair_share(os_atomic_load_long(&budget_users));
+	available = mp_decode_get_thread_budget() -
+		    os_atomic_load_long(&threads_in_use) + old_threads;
+	if (share > available)
+		share = available > 1 ? available : 1;
+	if (share == old_threads)
+		return;
+
+	release_thread_budget(d);
+	d->decoder = NULL;
+
+	if (mp_open_codec(d, false) < 0) {
+		blog(LOG_WARNING,
+		     "MP: Failed to reopen video decoder for '%s', "
+		     "keeping %d thread(s)",
+		     d->m->path, old_threads);
+		add_threads_in_use(old_threads);
+		os_atomic_inc_long(&budget_users);
+		d->budget_threads = old_threads;
+		d->decoder = old;
+		return;
+	}
+
+	if (d->codec->capabilities & CODEC_CAP_TRUNC)
+		d->decoder->flags |= CODEC_FLAG_TRUNC;
+	avcodec_free_context(&old);
+}
+#else
+#define rebalance_threads(d)
+#endif
+
 void mp_decode_flush(struct mp_decode *d)
 {
 	avcodec_flush_buffers(d->decoder);
+	rebalance_threads(d);
 	mp_decode_clear_packets(d);
 	d->eof = false;
 	d->frame_pts = 0;
 	d->frame_ready = false;
 }
+
+void mp_decode_free_cache(struct mp_decode *d)
+{
+	for (size_t i = 0; i < d->cache.num; i++)
+		av_frame_free(&d->cache.array[i].frame);
+	da_free(d->cache);
+
+	d->cache_pos = 0;
+	d->cache_done = false;
+}
+
+void mp_decode_rewind_cache(struct mp_decode *d)
+{
+	d->cache_pos = 0;
+	d->eof = false;
+	d->frame_ready = false;
+}
@@ -21,6 +21,7 @@ extern "C" {
 #endif
 
 #include <util/circlebuf.h>
+#include <util/darray.h>
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -46,6 +47,22 @@ extern "C" {
 
 struct mp_media;
 
+struct mp_cache_frame {
+	AVFrame *frame;
+	int64_t frame_pts;
+	int64_t next_pts;
+};
+
+struct mp_decode_stats {
+	uint64_t frames;
+	uint64_t total_decode_ns;
+	uint64_t max_decode_ns;
+	uint32_t queue_depth;
+	uint32_t max_queue_depth;
+	int thread_count;
+	bool frame_threading;
+};
+
 struct mp_decode {
 	struct mp_media *m;
 	AVStream *stream;
@@ -72,6 +89,15 @@ struct mp_decode {
 	AVPacket pkt;
 	bool packet_pending;
 	struct circlebuf packets;
+
+	DARRAY(struct mp_cache_frame) cache;
+	size_t cache_pos;
+	bool cache_done;
+
+	const char *profile_name;
+	int budget_threads;
+	long budget_generation;
+	struct mp_decode_stats stats;
 };
 
 extern bool mp_decode_init(struct mp_media *media, enum AVMediaType type,
@@ -84,6 +110,12 @@ extern void mp_decode_push_packet(struct mp_decode *decode, AVPacket *pkt);
 extern bool mp_decode_next(struct mp_decode *decode);
 extern void mp_decode_flush(struct mp_decode *decode);
 
+extern void mp_decode_set_thread_budget(int threads);
+extern int mp_decode_get_thread_budget(void);
+
+extern void mp_decode_free_cache(struct mp_decode *decode);
+extern void mp_decode_rewind_cache(struct mp_decode *decode);
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,6 +16,7 @@
 
 #include <obs.h>
 #include <util/platform.h>
+#include <util/profiler.h>
 
 #include <assert.h>
 
@@ -495,12 +496,82 @@ static void seek_to(mp_media_t *m, int64_t pos)
 		mp_decode_flush(&m->a);
 }
 
+/* ------------------------------------------------------------------------- */
+/* loop cache: the first full pass of a local file is kept in memory (up to
+ * cache_limit bytes) so later loops can replay it without demuxing or
+ * decoding anything */
+
+void mp_media_cache_abandon(mp_media_t *m, const char *reason)
+{
+	if (!m->cache_failed)
+		blog(LOG_INFO, "MP: Not caching '%s' for looping: %s", m->path,
+		     reason);
+
+	mp_decode_free_cache(&m->v);
+	mp_decode_free_cache(&m->a);
+	m->cache_size = 0;
+	m->cache_recording = false;
+	m->cache_failed = true;
+}
+
+static bool mp_media_cache_finish(mp_media_t *m)
+{
+	if (m->cache_complete)
+		return true;
+	if (!m->cache_recording)
+		return false;
+	if (m->has_video && !m->v.cache_done)
+		return false;
+	if (m->has_audio && !m->a.cache_done)
+		return false;
+
+	m->cache_recording = false;
+	m->cache_complete = true;
+
+	blog(LOG_INFO,
+	     "MP: Cached %d video and %d audio frames (%.1f MB) "
+	     "for looping '%s'",
+	     (int)m->v.cache.num, (int)m->a.cache.num,
+	     (double)m->cache_size / (1024.0 * 1024.0), m->path);
+	return true;
+}
+
+static void mp_media_cache_begin(mp_media_t *m)
+{
+	if (!m->cache_limit || !m->is_local_file || m->cache_failed)
+		return;
+
+	mp_decode_free_cache(&m->v);
+	mp_decode_free_cache(&m->a);
+	m->cache_size = 0;
+	m->cache_recording = true;
+}
+
+/* seeking leaves the cached pass: a partial recording is useless, and replay
+ * hands back over to the demuxer/decoders until the next loop */
+static void mp_media_cache_interrupt(mp_media_t *m)
+{
+	if (m->cache_replaying) {
+		m->cache_replaying = false;
+		m->eof = false;
+	} else if (m->cache_recording) {
+		mp_decode_free_cache(&m->v);
+		mp_decode_free_cache(&m->a);
+		m->cache_size = 0;
+		m->cache_recording = false;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
 static bool mp_media_reset(mp_media_t *m)
 {
 	bool stopping;
 	bool active;
+	bool replay = mp_media_cache_finish(m);
 
-	seek_to(m, m->fmt->start_time);
+	if (!replay)
+		seek_to(m, m->fmt->start_time);
 
 	int64_t next_ts = mp_media_get_base_pts(m);
 	int64_t offset = next_ts - m->next_pts_ns;
@@ -509,6 +580,15 @@ static bool mp_media_reset(mp_media_t *m)
 	m->base_ts += next_ts;
 	m->seek_next_ts = false;
 
+	if (replay) {
+		mp_decode_rewind_cache(&m->v);
+		mp_decode_rewind_cache(&m->a);
+		m->cache_replaying = true;
+		m->eof = true;
+	} else {
+		mp_media_cache_begin(m);
+	}
+
 	pthread_mutex_lock(&m->mutex);
 	stopping = m->stopping;
 	active = m->active;
@@ -723,6 +803,7 @@ static inline bool mp_media_thread(mp_media_t *m)
 
 		if (seek) {
 			m->seek_next_ts = true;
+			mp_media_cache_interrupt(m);
 			seek_to(m, seek_pos);
 			continue;
 		}
@@ -737,12 +818,21 @@ static inline bool mp_media_thread(mp_media_t *m)
 
 		/* frames are ready */
 		if (is_active && !timeout) {
+			bool success;
+
+			profile_start(m->profile_name);
+
 			if (m->has_video)
 				mp_media_next_video(m, false);
 			if (m->has_audio)
 				mp_media_next_audio(m);
 
-			if (!mp_media_prepare_frames(m))
+			success = mp_media_prepare_frames(m);
+
+			profile_end(m->profile_name);
+			profile_reenable_thread();
+
+			if (!success)
 				return false;
 			if (mp_media_eof(m))
 				continue;
@@ -782,6 +872,8 @@ static inline bool mp_media_init_internal(mp_media_t *m,
 	m->path = info->path ? bstrdup(info->path) : NULL;
 	m->format_name = info->format ? bstrdup(info->format) : NULL;
 	m->hw = info->hardware_decoding;
+	m->profile_name = profile_store_name(obs_get_profiler_name_store(),
+					     "mp_media_thread(%s)", m->path);
 
 	if (pthread_create(&m->thread, NULL, mp_media_thread_start, m) != 0) {
 		blog(LOG_WARNING, "MP: Could not create media thread");
@@ -806,6 +898,9 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	media->buffering = info->buffering;
 	media->speed = info->speed;
 	media->is_local_file = info->is_local_file;
+	media->cache_limit = info->loop_cache_mb > 0
+				     ? (size_t)info->loop_cache_mb * 1024 * 1024
+				     : 0;
 
 	if (!info->is_local_file || media->speed < 1 || media->speed > 200)
 		media->speed = 100;
@@ -844,6 +939,24 @@ static void mp_kill_thread(mp_media_t *m)
 	}
 }
 
+static void log_decode_stats(mp_media_t *m, struct mp_decode *d)
+{
+	const struct mp_decode_stats *stats = &d->stats;
+
+	if (!stats->frames)
+		return;
+
+	blog(LOG_INFO,
+	     "MP: '%s' %s decode: %llu frames, %.3f ms average, "
+	     "%.3f ms max, max queue depth %u packets",
+	     m->path, d->audio ? "audio" : "video",
+	     (unsigned long long)stats->frames,
+	     (double)stats->total_decode_ns / (double)stats->frames /
+		     1000000.0,
+	     (double)stats->max_decode_ns / 1000000.0,
+	     stats->max_queue_depth);
+}
+
 void mp_media_free(mp_media_t *media)
 {
 	if (!media)
@@ -851,6 +964,8 @@ void mp_media_free(mp_media_t *media)
 
 	mp_media_stop(media);
 	mp_kill_thread(media);
+	log_decode_stats(media, &media->v);
+	log_decode_stats(media, &media->a);
 	mp_decode_free(&media->v);
 	mp_decode_free(&media->a);
 	avformat_close_input(&media->fmt);
@@ -910,6 +1025,14 @@ int64_t mp_get_current_time(mp_media_t *m)
 	return mp_media_get_base_pts(m) * (int64_t)m->speed / 100000000LL;
 }
 
+void mp_media_get_decode_stats(mp_media_t *m, bool audio,
+			       struct mp_decode_stats *stats)
+{
+	pthread_mutex_lock(&m->mutex);
+	*stats = audio ? m->a.stats : m->v.stats;
+	pthread_mutex_unlock(&m->mutex);
+}
+
 void mp_media_seek_to(mp_media_t *m, int64_t pos)
 {
 	pthread_mutex_lock(&m->mutex);
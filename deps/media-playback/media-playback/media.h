@@ -95,6 +95,14 @@ struct mp_media {
 
 	bool thread_valid;
 	pthread_t thread;
+	const char *profile_name;
+
+	size_t cache_limit;
+	size_t cache_size;
+	bool cache_recording;
+	bool cache_replaying;
+	bool cache_complete;
+	bool cache_failed;
 
 	bool pause;
 	bool reset_ts;
@@ -118,6 +126,7 @@ struct mp_media_info {
 	const char *format;
 	int buffering;
 	int speed;
+	int loop_cache_mb;
 	enum video_range_type force_range;
 	bool hardware_decoding;
 	bool is_local_file;
@@ -133,6 +142,11 @@ extern void mp_media_play_pause(mp_media_t *media, bool pause);
 extern int64_t mp_get_current_time(mp_media_t *m);
 extern void mp_media_seek_to(mp_media_t *m, int64_t pos);
 
+extern void mp_media_get_decode_stats(mp_media_t *m, bool audio,
+				      struct mp_decode_stats *stats);
+
+extern void mp_media_cache_abandon(mp_media_t *m, const char *reason);
+
 /* #define DETAILED_DEBUG_INFO */
 
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 48, 101)
@@ -30,6 +30,12 @@ struct obs_script {
 	struct dstr path;
 	struct dstr file;
 	struct dstr desc;
+
+	/* set from the script's script_tick_thread global when it loads */
+	bool tick_thread;
+
+	/* protected by the tick stats mutex */
+	struct obs_script_tick_stats tick_stats;
 };
 
 struct script_callback;
@@ -37,6 +43,27 @@ typedef void (*defer_call_cb)(void *param);
 
 extern void defer_call_post(defer_call_cb call, void *cb);
 
+/* Script ticks and timers run in the graphics thread's tick unless the
+ * script opts into the script tick thread, which runs once per frame so a
+ * slow script doesn't delay rendering.  That thread catches up with a single
+ * call if it falls behind, passing the combined frame time. */
+typedef void (*script_tick_cb)(void *param, float seconds);
+
+extern void script_tick_add(script_tick_cb tick, void *param, bool threaded);
+extern void script_tick_remove(script_tick_cb tick, void *param,
+			       bool threaded);
+
+/* accounts a script tick or timer call */
+extern void script_tick_cost(obs_script_t *script, uint64_t start_ns);
+
+/* Graphics tasks queued by a script are cancelled when it unloads, as the
+ * script's state is gone by the time the graphics thread would run them. */
+typedef void (*script_task_cb)(void *param);
+
+extern void script_queue_graphics_task(obs_script_t *script,
+				       script_task_cb task, void *param);
+extern void script_cancel_graphics_tasks(obs_script_t *script);
+
 extern void script_log(obs_script_t *script, int level, const char *format,
 		       ...);
 extern void script_log_va(obs_script_t *script, int level, const char *format,
@@ -55,8 +55,39 @@ package.path = package.path .. \";\" .. script_path() .. \"/?.lua\"\n";
 
 static char *startup_script = NULL;
 
-static pthread_mutex_t tick_mutex = PTHREAD_MUTEX_INITIALIZER;
-static struct obs_lua_script *first_tick_script = NULL;
+struct lua_obs_timer;
+
+/* ticks and timers of scripts that set script_tick_thread run on the script
+ * tick thread, all others in the graphics thread's tick, each from their own
+ * lists so neither waits on the other */
+struct lua_tick_list {
+	pthread_mutex_t tick_mutex;
+	struct obs_lua_script *first_tick_script;
+
+	pthread_mutex_t timer_mutex;
+	struct lua_obs_timer *first_timer;
+};
+
+static struct lua_tick_list tick_lists[2];
+
+static inline struct lua_tick_list *get_tick_list(obs_script_t *script)
+{
+	return &tick_lists[script->tick_thread ? 1 : 0];
+}
+
+/* for the deferred calls, which can run before the script has finished
+ * loading and set tick_thread (it loads with its mutex held) */
+static bool lua_script_tick_thread(obs_script_t *script)
+{
+	struct obs_lua_script *data = (struct obs_lua_script *)script;
+	bool tick_thread;
+
+	pthread_mutex_lock(&data->mutex);
+	tick_thread = script->tick_thread;
+	pthread_mutex_unlock(&data->mutex);
+
+	return tick_thread;
+}
 
 pthread_mutex_t lua_source_def_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -141,20 +172,26 @@ static bool load_lua_script(struct obs_lua_script *data)
 		}
 	}
 
+	lua_getglobal(script, "script_tick_thread");
+	data->base.tick_thread = lua_toboolean(script, -1);
+	lua_pop(script, 1);
+
 	lua_getglobal(script, "script_tick");
 	if (lua_isfunction(script, -1)) {
-		pthread_mutex_lock(&tick_mutex);
+		struct lua_tick_list *list = get_tick_list(&data->base);
+
+		pthread_mutex_lock(&list->tick_mutex);
 
-		struct obs_lua_script *next = first_tick_script;
+		struct obs_lua_script *next = list->first_tick_script;
 		data->next_tick = next;
-		data->p_prev_next_tick = &first_tick_script;
+		data->p_prev_next_tick = &list->first_tick_script;
 		if (next)
 			next->p_prev_next_tick = &data->next_tick;
-		first_tick_script = data;
+		list->first_tick_script = data;
 
 		data->tick = luaL_ref(script, LUA_REGISTRYINDEX);
 
-		pthread_mutex_unlock(&tick_mutex);
+		pthread_mutex_unlock(&list->tick_mutex);
 	}
 
 	lua_getglobal(script, "script_properties");
@@ -242,21 +279,19 @@ struct lua_obs_timer {
 	uint64_t interval;
 };
 
-static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
-static struct lua_obs_timer *first_timer = NULL;
-
-static inline void lua_obs_timer_init(struct lua_obs_timer *timer)
+static inline void lua_obs_timer_init(struct lua_tick_list *list,
+				      struct lua_obs_timer *timer)
 {
-	pthread_mutex_lock(&timer_mutex);
+	pthread_mutex_lock(&list->timer_mutex);
 
-	struct lua_obs_timer *next = first_timer;
+	struct lua_obs_timer *next = list->first_timer;
 	timer->next = next;
-	timer->p_prev_next = &first_timer;
+	timer->p_prev_next = &list->first_timer;
 	if (next)
 		next->p_prev_next = &timer->next;
-	first_timer = timer;
+	list->first_timer = timer;
 
-	pthread_mutex_unlock(&timer_mutex);
+	pthread_mutex_unlock(&list->timer_mutex);
 }
 
 static inline void lua_obs_timer_remove(struct lua_obs_timer *timer)
@@ -300,7 +335,8 @@ static void defer_timer_init(void *p_cb)
 {
 	struct lua_obs_callback *cb = p_cb;
 	struct lua_obs_timer *timer = lua_obs_callback_extra_data(cb);
-	lua_obs_timer_init(timer);
+	bool tick_thread = lua_script_tick_thread(cb->base.script);
+	lua_obs_timer_init(&tick_lists[tick_thread ? 1 : 0], timer);
 }
 
 static int timer_add(lua_State *script)
@@ -378,16 +414,21 @@ static void obs_lua_tick_callback(void *priv, float seconds)
 	lua_State *script = cb->script;
 
 	if (cb->base.removed) {
-		obs_remove_tick_callback(obs_lua_tick_callback, cb);
+		bool *tick_thread = lua_obs_callback_extra_data(cb);
+		script_tick_remove(obs_lua_tick_callback, cb, *tick_thread);
 		return;
 	}
 
+	uint64_t start = os_gettime_ns();
+
 	lock_callback();
 
 	lua_pushnumber(script, (lua_Number)seconds);
 	call_func(obs_lua_tick_callback, 1, 0);
 
 	unlock_callback();
+
+	script_tick_cost(cb->base.script, start);
 }
 
 static int obs_lua_remove_tick_callback(lua_State *script)
@@ -401,9 +442,13 @@ static int obs_lua_remove_tick_callback(lua_State *script)
 	return 0;
 }
 
-static void defer_add_tick(void *cb)
+static void defer_add_tick(void *p_cb)
 {
-	obs_add_tick_callback(obs_lua_tick_callback, cb);
+	struct lua_obs_callback *cb = p_cb;
+	bool *tick_thread = lua_obs_callback_extra_data(cb);
+
+	*tick_thread = lua_script_tick_thread(cb->base.script);
+	script_tick_add(obs_lua_tick_callback, cb, *tick_thread);
 }
 
 static int obs_lua_add_tick_callback(lua_State *script)
@@ -411,13 +456,41 @@ static int obs_lua_add_tick_callback(lua_State *script)
 	if (!verify_args1(script, is_function))
 		return 0;
 
-	struct lua_obs_callback *cb = add_lua_obs_callback(script, 1);
+	struct lua_obs_callback *cb =
+		add_lua_obs_callback_extra(script, 1, sizeof(bool));
 	defer_call_post(defer_add_tick, cb);
 	return 0;
 }
 
 /* -------------------------------------------- */
 
+static void graphics_task(void *priv)
+{
+	struct lua_obs_callback *cb = priv;
+	lua_State *script = cb->script;
+
+	lock_callback();
+	if (!cb->base.removed) {
+		call_func(graphics_task, 0, 0);
+		remove_lua_obs_callback(cb);
+	}
+	unlock_callback();
+}
+
+/* lets a script that ticks on the script tick thread run a function on the
+ * graphics thread once, on the next frame */
+static int queue_graphics_task(lua_State *script)
+{
+	if (!verify_args1(script, is_function))
+		return 0;
+
+	struct lua_obs_callback *cb = add_lua_obs_callback(script, 1);
+	script_queue_graphics_task(cb->base.script, graphics_task, cb);
+	return 0;
+}
+
+/* -------------------------------------------- */
+
 static void calldata_signal_callback(void *priv, calldata_t *cd)
 {
 	struct lua_obs_callback *cb = priv;
@@ -1022,6 +1095,7 @@ static void add_hook_functions(lua_State *script)
 		 obs_lua_remove_main_render_callback);
 	add_func("obs_add_tick_callback", obs_lua_add_tick_callback);
 	add_func("obs_remove_tick_callback", obs_lua_remove_tick_callback);
+	add_func("queue_graphics_task", queue_graphics_task);
 	add_func("signal_handler_connect", obs_lua_signal_handler_connect);
 	add_func("signal_handler_disconnect",
 		 obs_lua_signal_handler_disconnect);
@@ -1044,6 +1118,7 @@ static void add_hook_functions(lua_State *script)
 
 static void lua_tick(void *param, float seconds)
 {
+	struct lua_tick_list *list = param;
 	struct obs_lua_script *data;
 	struct lua_obs_timer *timer;
 	uint64_t ts = obs_get_video_frame_time();
@@ -1051,10 +1126,11 @@ static void lua_tick(void *param, float seconds)
 	/* --------------------------------- */
 	/* process script_tick calls         */
 
-	pthread_mutex_lock(&tick_mutex);
-	data = first_tick_script;
+	pthread_mutex_lock(&list->tick_mutex);
+	data = list->first_tick_script;
 	while (data) {
 		lua_State *script = data->script;
+		uint64_t start = os_gettime_ns();
 		current_lua_script = data;
 
 		pthread_mutex_lock(&data->mutex);
@@ -1064,16 +1140,18 @@ static void lua_tick(void *param, float seconds)
 
 		pthread_mutex_unlock(&data->mutex);
 
+		script_tick_cost(&data->base, start);
+
 		data = data->next_tick;
 	}
 	current_lua_script = NULL;
-	pthread_mutex_unlock(&tick_mutex);
+	pthread_mutex_unlock(&list->tick_mutex);
 
 	/* --------------------------------- */
 	/* process timers                    */
 
-	pthread_mutex_lock(&timer_mutex);
-	timer = first_timer;
+	pthread_mutex_lock(&list->timer_mutex);
+	timer = list->first_timer;
 	while (timer) {
 		struct lua_obs_timer *next = timer->next;
 		struct lua_obs_callback *cb = lua_obs_timer_cb(timer);
@@ -1084,16 +1162,18 @@ static void lua_tick(void *param, float seconds)
 			uint64_t elapsed = ts - timer->last_ts;
 
 			if (elapsed >= timer->interval) {
+				uint64_t start = os_gettime_ns();
+
 				timer_call(&cb->base);
 				timer->last_ts += timer->interval;
+
+				script_tick_cost(cb->base.script, start);
 			}
 		}
 
 		timer = next;
 	}
-	pthread_mutex_unlock(&timer_mutex);
-
-	UNUSED_PARAMETER(param);
+	pthread_mutex_unlock(&list->timer_mutex);
 }
 
 /* -------------------------------------------- */
@@ -1168,14 +1248,16 @@ void obs_lua_script_unload(obs_script_t *s)
 	/* unhook tick function         */
 
 	if (data->p_prev_next_tick) {
-		pthread_mutex_lock(&tick_mutex);
+		struct lua_tick_list *list = get_tick_list(s);
+
+		pthread_mutex_lock(&list->tick_mutex);
 
 		struct obs_lua_script *next = data->next_tick;
 		if (next)
 			next->p_prev_next_tick = data->p_prev_next_tick;
 		*data->p_prev_next_tick = next;
 
-		pthread_mutex_unlock(&tick_mutex);
+		pthread_mutex_unlock(&list->tick_mutex);
 
 		data->p_prev_next_tick = NULL;
 		data->next_tick = NULL;
@@ -1206,6 +1288,7 @@ void obs_lua_script_unload(obs_script_t *s)
 	/* ---------------------------- */
 	/* close script                 */
 
+	script_cancel_graphics_tasks(s);
 	lua_close(script);
 	s->loaded = false;
 }
@@ -1304,8 +1387,10 @@ void obs_lua_load(void)
 	pthread_mutexattr_init(&attr);
 	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
 
-	pthread_mutex_init(&tick_mutex, NULL);
-	pthread_mutex_init(&timer_mutex, &attr);
+	for (size_t i = 0; i < 2; i++) {
+		pthread_mutex_init(&tick_lists[i].tick_mutex, NULL);
+		pthread_mutex_init(&tick_lists[i].timer_mutex, &attr);
+	}
 	pthread_mutex_init(&lua_source_def_mutex, NULL);
 
 	/* ---------------------------------------------- */
@@ -1340,15 +1425,19 @@ void obs_lua_load(void)
 
 	dstr_free(&dep_paths);
 
-	obs_add_tick_callback(lua_tick, NULL);
+	script_tick_add(lua_tick, &tick_lists[0], false);
+	script_tick_add(lua_tick, &tick_lists[1], true);
 }
 
 void obs_lua_unload(void)
 {
-	obs_remove_tick_callback(lua_tick, NULL);
+	script_tick_remove(lua_tick, &tick_lists[0], false);
+	script_tick_remove(lua_tick, &tick_lists[1], true);
 
 	bfree(startup_script);
-	pthread_mutex_destroy(&tick_mutex);
-	pthread_mutex_destroy(&timer_mutex);
+	for (size_t i = 0; i < 2; i++) {
+		pthread_mutex_destroy(&tick_lists[i].tick_mutex);
+		pthread_mutex_destroy(&tick_lists[i].timer_mutex);
+	}
 	pthread_mutex_destroy(&lua_source_def_mutex);
 }
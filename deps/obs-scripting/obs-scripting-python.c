@@ -54,8 +54,39 @@ static wchar_t home_path[1024] = {0};
 DARRAY(char *) python_paths;
 static bool python_loaded = false;
 
+struct python_obs_timer;
+
+struct python_tick_script {
+	struct obs_python_script *script;
+	PyObject *tick;
+};
+
+/* ticks, tick callbacks and timers of scripts that set script_tick_thread
+ * run on the script tick thread, all others in the graphics thread's tick,
+ * each from their own lists so neither waits on the other */
+struct python_tick_list {
+	/* protected by tick_mutex */
+	struct obs_python_script *first_tick_script;
+	DARRAY(struct python_obs_callback *) tick_callbacks;
+
+	pthread_mutex_t timer_mutex;
+	struct python_obs_timer *first_timer;
+
+	/* copies of the above that python_tick works from, so that tick_mutex
+	 * isn't held while python code runs */
+	DARRAY(struct python_tick_script) tick_scripts_copy;
+	DARRAY(struct python_obs_callback *) tick_callbacks_copy;
+};
+
+/* also protects the tick_thread flag of python scripts */
 static pthread_mutex_t tick_mutex = PTHREAD_MUTEX_INITIALIZER;
-static struct obs_python_script *first_tick_script = NULL;
+static struct python_tick_list tick_lists[2];
+
+/* called with tick_mutex held */
+static inline struct python_tick_list *get_tick_list(obs_script_t *script)
+{
+	return &tick_lists[script->tick_thread ? 1 : 0];
+}
 
 static PyObject *py_obspython = NULL;
 struct obs_python_script *cur_python_script = NULL;
@@ -255,16 +286,28 @@ static bool load_python_script(struct obs_python_script *data)
 		PyErr_Clear();
 	}
 
+	PyObject *py_tick_thread =
+		PyObject_GetAttrString(py_module, "script_tick_thread");
+	int tick_thread = py_tick_thread ? PyObject_IsTrue(py_tick_thread) : 0;
+	if (!py_tick_thread || tick_thread < 0)
+		PyErr_Clear();
+	Py_XDECREF(py_tick_thread);
+
+	pthread_mutex_lock(&tick_mutex);
+	data->base.tick_thread = tick_thread > 0;
+	pthread_mutex_unlock(&tick_mutex);
+
 	py_tick = PyObject_GetAttrString(py_module, "script_tick");
 	if (py_tick) {
 		pthread_mutex_lock(&tick_mutex);
 
-		struct obs_python_script *next = first_tick_script;
+		struct python_tick_list *list = get_tick_list(&data->base);
+		struct obs_python_script *next = list->first_tick_script;
 		data->next_tick = next;
-		data->p_prev_next_tick = &first_tick_script;
+		data->p_prev_next_tick = &list->first_tick_script;
 		if (next)
 			next->p_prev_next_tick = &data->next_tick;
-		first_tick_script = data;
+		list->first_tick_script = data;
 
 		data->tick = py_tick;
 		py_tick = NULL;
@@ -378,21 +421,19 @@ struct python_obs_timer {
 	uint64_t interval;
 };
 
-static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
-static struct python_obs_timer *first_timer = NULL;
-
-static inline void python_obs_timer_init(struct python_obs_timer *timer)
+static inline void python_obs_timer_init(struct python_tick_list *list,
+					 struct python_obs_timer *timer)
 {
-	pthread_mutex_lock(&timer_mutex);
+	pthread_mutex_lock(&list->timer_mutex);
 
-	struct python_obs_timer *next = first_timer;
+	struct python_obs_timer *next = list->first_timer;
 	timer->next = next;
-	timer->p_prev_next = &first_timer;
+	timer->p_prev_next = &list->first_timer;
 	if (next)
 		next->p_prev_next = &timer->next;
-	first_timer = timer;
+	list->first_timer = timer;
 
-	pthread_mutex_unlock(&timer_mutex);
+	pthread_mutex_unlock(&list->timer_mutex);
 }
 
 static inline void python_obs_timer_remove(struct python_obs_timer *timer)
@@ -444,7 +485,13 @@ static void defer_timer_init(void *p_cb)
 {
 	struct python_obs_callback *cb = p_cb;
 	struct python_obs_timer *timer = python_obs_callback_extra_data(cb);
-	python_obs_timer_init(timer);
+	struct python_tick_list *list;
+
+	pthread_mutex_lock(&tick_mutex);
+	list = get_tick_list(cb->base.script);
+	pthread_mutex_unlock(&tick_mutex);
+
+	python_obs_timer_init(list, timer);
 }
 
 static PyObject *timer_add(PyObject *self, PyObject *args)
@@ -471,24 +518,43 @@ static PyObject *timer_add(PyObject *self, PyObject *args)
 
 /* -------------------------------------------- */
 
-static void obs_python_tick_callback(void *priv, float seconds)
+/* called from python_tick with python locked */
+static bool tick_script_active(struct python_tick_list *list,
+			       struct obs_python_script *script)
 {
-	struct python_obs_callback *cb = priv;
+	struct obs_python_script *data;
 
-	if (cb->base.removed) {
-		obs_remove_tick_callback(obs_python_tick_callback, cb);
-		return;
+	pthread_mutex_lock(&tick_mutex);
+	for (data = list->first_tick_script; data; data = data->next_tick) {
+		if (data == script)
+			break;
 	}
+	pthread_mutex_unlock(&tick_mutex);
 
-	lock_callback(cb);
+	return !!data;
+}
+
+static void obs_python_tick_callback(struct python_obs_callback *cb,
+				     PyObject *args)
+{
+	struct obs_python_script *last_script = cur_python_script;
+	struct python_obs_callback *last_cb = cur_python_cb;
+	uint64_t start = os_gettime_ns();
+
+	cur_python_script = python_obs_callback_script(cb);
+	cur_python_cb = cb;
 
-	PyObject *args = Py_BuildValue("(f)", seconds);
 	PyObject *py_ret = PyObject_CallObject(cb->func, args);
 	py_error();
 	Py_XDECREF(py_ret);
-	Py_XDECREF(args);
 
-	unlock_callback();
+	cur_python_script = last_script;
+	cur_python_cb = last_cb;
+
+	/* the script may have been unloaded while python had the GIL, which
+	 * removes all of its callbacks */
+	if (!cb->base.removed)
+		script_tick_cost(cb->base.script, start);
 }
 
 static PyObject *obs_python_remove_tick_callback(PyObject *self, PyObject *args)
@@ -535,7 +601,51 @@ static PyObject *obs_python_add_tick_callback(PyObject *self, PyObject *args)
 		return python_none();
 
 	struct python_obs_callback *cb = add_python_obs_callback(script, py_cb);
-	obs_add_tick_callback(obs_python_tick_callback, cb);
+
+	pthread_mutex_lock(&tick_mutex);
+	da_push_back(get_tick_list(&script->base)->tick_callbacks, &cb);
+	pthread_mutex_unlock(&tick_mutex);
+	return python_none();
+}
+
+/* -------------------------------------------- */
+
+static void graphics_task(void *p_cb)
+{
+	struct python_obs_callback *cb = p_cb;
+
+	lock_callback(cb);
+	if (!cb->base.removed) {
+		PyObject *py_ret = PyObject_CallObject(cb->func, NULL);
+		py_error();
+		Py_XDECREF(py_ret);
+		remove_python_obs_callback(cb);
+	}
+	unlock_callback();
+}
+
+/* lets a script that ticks on the script tick thread run a function on the
+ * graphics thread once, on the next frame */
+static PyObject *queue_graphics_task(PyObject *self, PyObject *args)
+{
+	struct obs_python_script *script = cur_python_script;
+	PyObject *py_cb = NULL;
+
+	if (!script) {
+		PyErr_SetString(PyExc_RuntimeError,
+				"No active script, report this to Jim");
+		return NULL;
+	}
+
+	UNUSED_PARAMETER(self);
+
+	if (!parse_args(args, "O", &py_cb))
+		return python_none();
+	if (!py_cb || !PyCallable_Check(py_cb))
+		return python_none();
+
+	struct python_obs_callback *cb = add_python_obs_callback(script, py_cb);
+	script_queue_graphics_task(&script->base, graphics_task, cb);
 	return python_none();
 }
 
@@ -1236,6 +1346,7 @@ static void add_hook_functions(PyObject *module)
 		DEF_FUNC("obs_remove_tick_callback",
 			 obs_python_remove_tick_callback),
 		DEF_FUNC("obs_add_tick_callback", obs_python_add_tick_callback),
+		DEF_FUNC("queue_graphics_task", queue_graphics_task),
 		DEF_FUNC("signal_handler_disconnect",
 			 obs_python_signal_handler_disconnect),
 		DEF_FUNC("signal_handler_connect",
@@ -1376,6 +1487,7 @@ void obs_python_script_unload(obs_script_t *s)
 	unload_python_script(data);
 	unlock_python();
 
+	script_cancel_graphics_tasks(s);
 	s->loaded = false;
 }
 
@@ -1482,51 +1594,97 @@ void obs_python_script_save(obs_script_t *s)
 
 /* -------------------------------------------- */
 
+/* every python call of a frame is made under a single acquisition of the
+ * GIL */
 static void python_tick(void *param, float seconds)
 {
+	struct python_tick_list *list = param;
 	struct obs_python_script *data;
 	bool valid;
 	uint64_t ts = obs_get_video_frame_time();
 
 	pthread_mutex_lock(&tick_mutex);
-	valid = !!first_tick_script;
+	valid = !!list->first_tick_script || list->tick_callbacks.num;
 	pthread_mutex_unlock(&tick_mutex);
 
+	pthread_mutex_lock(&list->timer_mutex);
+	valid = valid || !!list->first_timer;
+	pthread_mutex_unlock(&list->timer_mutex);
+
+	if (!valid)
+		return;
+
+	lock_python();
+
 	/* --------------------------------- */
 	/* process script_tick calls         */
 
-	if (valid) {
-		lock_python();
+	PyObject *args = Py_BuildValue("(f)", seconds);
 
-		PyObject *args = Py_BuildValue("(f)", seconds);
+	/* python code can give up the GIL, and another thread holding it can
+	 * then wait for tick_mutex (script load/unload, adding callbacks), so
+	 * the lists are copied and tick_mutex is released before calling */
+	pthread_mutex_lock(&tick_mutex);
+	list->tick_scripts_copy.num = 0;
+	for (data = list->first_tick_script; data; data = data->next_tick) {
+		struct python_tick_script *entry =
+			da_push_back_new(list->tick_scripts_copy);
+		entry->script = data;
+		entry->tick = data->tick;
+		Py_XINCREF(entry->tick);
+	}
 
-		pthread_mutex_lock(&tick_mutex);
-		data = first_tick_script;
-		while (data) {
-			cur_python_script = data;
+	for (size_t i = list->tick_callbacks.num; i > 0; i--) {
+		if (list->tick_callbacks.array[i - 1]->base.removed)
+			da_erase(list->tick_callbacks, i - 1);
+	}
+	da_copy(list->tick_callbacks_copy, list->tick_callbacks);
+	pthread_mutex_unlock(&tick_mutex);
 
-			PyObject *py_ret =
-				PyObject_CallObject(data->tick, args);
-			Py_XDECREF(py_ret);
-			py_error();
+	for (size_t i = 0; i < list->tick_scripts_copy.num; i++) {
+		struct python_tick_script *entry =
+			list->tick_scripts_copy.array + i;
+		uint64_t start = os_gettime_ns();
 
-			data = data->next_tick;
+		/* may have been unloaded by a previous call */
+		if (!tick_script_active(list, entry->script)) {
+			Py_XDECREF(entry->tick);
+			continue;
 		}
 
-		cur_python_script = NULL;
+		cur_python_script = entry->script;
 
-		pthread_mutex_unlock(&tick_mutex);
+		PyObject *py_ret = PyObject_CallObject(entry->tick, args);
+		Py_XDECREF(py_ret);
+		py_error();
+		Py_XDECREF(entry->tick);
 
-		Py_XDECREF(args);
+		if (tick_script_active(list, entry->script))
+			script_tick_cost(&entry->script->base, start);
+	}
 
-		unlock_python();
+	cur_python_script = NULL;
+
+	/* --------------------------------- */
+	/* process tick callbacks            */
+
+	/* removed callbacks stay allocated until scripting shuts down, so
+	 * the flag can be checked even if a previous call removed them */
+	for (size_t i = list->tick_callbacks_copy.num; i > 0; i--) {
+		struct python_obs_callback *cb =
+			list->tick_callbacks_copy.array[i - 1];
+
+		if (!cb->base.removed)
+			obs_python_tick_callback(cb, args);
 	}
 
+	Py_XDECREF(args);
+
 	/* --------------------------------- */
 	/* process timers                    */
 
-	pthread_mutex_lock(&timer_mutex);
-	struct python_obs_timer *timer = first_timer;
+	pthread_mutex_lock(&list->timer_mutex);
+	struct python_obs_timer *timer = list->first_timer;
 	while (timer) {
 		struct python_obs_timer *next = timer->next;
 		struct python_obs_callback *cb = python_obs_timer_cb(timer);
@@ -1537,19 +1695,20 @@ static void python_tick(void *param, float seconds)
 			uint64_t elapsed = ts - timer->last_ts;
 
 			if (elapsed >= timer->interval) {
-				lock_python();
-				timer_call(&cb->base);
-				unlock_python();
+				uint64_t start = os_gettime_ns();
 
+				timer_call(&cb->base);
 				timer->last_ts += timer->interval;
+
+				script_tick_cost(cb->base.script, start);
 			}
 		}
 
 		timer = next;
 	}
-	pthread_mutex_unlock(&timer_mutex);
+	pthread_mutex_unlock(&list->timer_mutex);
 
-	UNUSED_PARAMETER(param);
+	unlock_python();
 }
 
 /* -------------------------------------------- */
@@ -1574,8 +1733,19 @@ void obs_python_load(void)
 	pthread_mutexattr_init(&attr);
 	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
 
-	pthread_mutex_init(&tick_mutex, NULL);
-	pthread_mutex_init(&timer_mutex, &attr);
+	/* tick callbacks may add other tick callbacks */
+	pthread_mutex_init(&tick_mutex, &attr);
+
+	for (size_t i = 0; i < 2; i++) {
+		struct python_tick_list *list = &tick_lists[i];
+
+		da_init(list->tick_callbacks);
+		da_init(list->tick_scripts_copy);
+		da_init(list->tick_callbacks_copy);
+		list->first_tick_script = NULL;
+		list->first_timer = NULL;
+		pthread_mutex_init(&list->timer_mutex, &attr);
+	}
 }
 
 extern void add_python_frontend_funcs(PyObject *module);
@@ -1692,8 +1862,10 @@ out:
 
 	python_loaded_at_all = success;
 
-	if (python_loaded)
-		obs_add_tick_callback(python_tick, NULL);
+	if (python_loaded) {
+		script_tick_add(python_tick, &tick_lists[0], false);
+		script_tick_add(python_tick, &tick_lists[1], true);
+	}
 
 	return python_loaded;
 }
@@ -1703,6 +1875,10 @@ void obs_python_unload(void)
 	if (!python_loaded_at_all)
 		return;
 
+	/* must not hold the GIL here, a tick may be waiting on it */
+	script_tick_remove(python_tick, &tick_lists[0], false);
+	script_tick_remove(python_tick, &tick_lists[1], true);
+
 	if (python_loaded && Py_IsInitialized()) {
 		PyGILState_Ensure();
 
@@ -1712,14 +1888,20 @@ void obs_python_unload(void)
 
 	/* ---------------------- */
 
-	obs_remove_tick_callback(python_tick, NULL);
+	for (size_t i = 0; i < 2; i++) {
+		struct python_tick_list *list = &tick_lists[i];
+
+		da_free(list->tick_callbacks);
+		da_free(list->tick_scripts_copy);
+		da_free(list->tick_callbacks_copy);
+		pthread_mutex_destroy(&list->timer_mutex);
+	}
 
 	for (size_t i = 0; i < python_paths.num; i++)
 		bfree(python_paths.array[i]);
 	da_free(python_paths);
 
 	pthread_mutex_destroy(&tick_mutex);
-	pthread_mutex_destroy(&timer_mutex);
 	dstr_free(&cur_py_log_chunk);
 
 	python_loaded_at_all = false;
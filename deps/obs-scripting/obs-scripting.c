@@ -15,11 +15,14 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <inttypes.h>
 #include <obs.h>
 #include <util/dstr.h>
 #include <util/platform.h>
 #include <util/threading.h>
 #include <util/circlebuf.h>
+#include <util/darray.h>
+#include <util/profiler.h>
 
 #include "obs-scripting-internal.h"
 #include "obs-scripting-callback.h"
@@ -120,6 +123,266 @@ void defer_call_post(defer_call_cb call, void *cb)
 
 /* -------------------------------------------- */
 
+struct script_tick_info {
+	script_tick_cb tick;
+	void *param;
+};
+
+static pthread_mutex_t tick_mutex;
+static DARRAY(struct script_tick_info) tick_callbacks;
+static pthread_t tick_thread;
+static os_event_t *tick_event;
+
+static pthread_mutex_t tick_frame_mutex;
+static pthread_mutex_t tick_stats_mutex;
+static float tick_pending_seconds = 0.0f;
+static uint32_t tick_pending_frames = 0;
+static bool tick_exit = false;
+static uint64_t tick_late_frames = 0;
+
+static const char *script_tick_name = "script_tick";
+
+static void *script_tick_thread(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	os_set_thread_name("obs-scripting: tick");
+
+	while (os_event_wait(tick_event) == 0) {
+		uint32_t frames;
+		float seconds;
+
+		pthread_mutex_lock(&tick_frame_mutex);
+		if (tick_exit) {
+			pthread_mutex_unlock(&tick_frame_mutex);
+			break;
+		}
+
+		frames = tick_pending_frames;
+		seconds = tick_pending_seconds;
+		tick_pending_frames = 0;
+		tick_pending_seconds = 0.0f;
+		pthread_mutex_unlock(&tick_frame_mutex);
+
+		if (!frames)
+			continue;
+		tick_late_frames += frames - 1;
+
+		profile_start(script_tick_name);
+
+		pthread_mutex_lock(&tick_mutex);
+		for (size_t i = tick_callbacks.num; i > 0; i--) {
+			struct script_tick_info *info =
+				tick_callbacks.array + (i - 1);
+			info->tick(info->param, seconds);
+		}
+		pthread_mutex_unlock(&tick_mutex);
+
+		profile_end(script_tick_name);
+	}
+
+	return NULL;
+}
+
+static void scripting_tick(void *param, float seconds)
+{
+	pthread_mutex_lock(&tick_frame_mutex);
+	tick_pending_seconds += seconds;
+	tick_pending_frames++;
+	pthread_mutex_unlock(&tick_frame_mutex);
+
+	os_event_signal(tick_event);
+
+	UNUSED_PARAMETER(param);
+}
+
+void script_tick_add(script_tick_cb tick, void *param, bool threaded)
+{
+	struct script_tick_info info = {tick, param};
+
+	if (!threaded) {
+		obs_add_tick_callback(tick, param);
+		return;
+	}
+
+	pthread_mutex_lock(&tick_mutex);
+	da_insert(tick_callbacks, 0, &info);
+	pthread_mutex_unlock(&tick_mutex);
+}
+
+void script_tick_remove(script_tick_cb tick, void *param, bool threaded)
+{
+	struct script_tick_info info = {tick, param};
+
+	if (!threaded) {
+		obs_remove_tick_callback(tick, param);
+		return;
+	}
+
+	pthread_mutex_lock(&tick_mutex);
+	da_erase_item(tick_callbacks, &info);
+	pthread_mutex_unlock(&tick_mutex);
+}
+
+void script_tick_cost(obs_script_t *script, uint64_t start_ns)
+{
+	struct obs_script_tick_stats *stats = &script->tick_stats;
+	uint64_t elapsed = os_gettime_ns() - start_ns;
+
+	pthread_mutex_lock(&tick_stats_mutex);
+	stats->calls++;
+	stats->total_ns += elapsed;
+	if (elapsed > stats->max_ns)
+		stats->max_ns = elapsed;
+	if (elapsed > obs_get_frame_interval_ns())
+		stats->slow_calls++;
+	pthread_mutex_unlock(&tick_stats_mutex);
+}
+
+static bool script_tick_init(void)
+{
+	pthread_mutexattr_t attr;
+
+	da_init(tick_callbacks);
+
+	if (pthread_mutexattr_init(&attr) != 0)
+		return false;
+	if (pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0)
+		return false;
+	if (pthread_mutex_init(&tick_mutex, &attr) != 0)
+		return false;
+	if (pthread_mutex_init(&tick_frame_mutex, NULL) != 0)
+		goto fail_frame_mutex;
+	if (pthread_mutex_init(&tick_stats_mutex, NULL) != 0)
+		goto fail_stats_mutex;
+	if (os_event_init(&tick_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail_event;
+	if (pthread_create(&tick_thread, NULL, script_tick_thread, NULL) != 0)
+		goto fail_thread;
+
+	obs_add_tick_callback(scripting_tick, NULL);
+	return true;
+
+fail_thread:
+	os_event_destroy(tick_event);
+fail_event:
+	pthread_mutex_destroy(&tick_stats_mutex);
+fail_stats_mutex:
+	pthread_mutex_destroy(&tick_frame_mutex);
+fail_frame_mutex:
+	pthread_mutex_destroy(&tick_mutex);
+	return false;
+}
+
+static void script_tick_free(void)
+{
+	obs_remove_tick_callback(scripting_tick, NULL);
+
+	pthread_mutex_lock(&tick_frame_mutex);
+	tick_exit = true;
+	pthread_mutex_unlock(&tick_frame_mutex);
+
+	os_event_signal(tick_event);
+	pthread_join(tick_thread, NULL);
+
+	blog(LOG_INFO, "[Scripting] Late script tick frames: %" PRIu64,
+	     tick_late_frames);
+
+	da_free(tick_callbacks);
+	os_event_destroy(tick_event);
+	pthread_mutex_destroy(&tick_stats_mutex);
+	pthread_mutex_destroy(&tick_frame_mutex);
+	pthread_mutex_destroy(&tick_mutex);
+}
+
+/* -------------------------------------------- */
+
+struct script_graphics_task {
+	obs_script_t *script;
+	script_task_cb task;
+	void *param;
+	bool cancelled;
+};
+
+static pthread_mutex_t graphics_task_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t graphics_task_run_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct script_graphics_task *) graphics_tasks;
+
+static void run_graphics_task(void *param)
+{
+	struct script_graphics_task *info = param;
+	bool found;
+	bool cancelled = true;
+
+	pthread_mutex_lock(&graphics_task_run_mutex);
+
+	/* not found if scripting was unloaded while it was queued */
+	pthread_mutex_lock(&graphics_task_mutex);
+	found = da_find(graphics_tasks, &info, 0) != DARRAY_INVALID;
+	if (found) {
+		cancelled = info->cancelled;
+		da_erase_item(graphics_tasks, &info);
+	}
+	pthread_mutex_unlock(&graphics_task_mutex);
+
+	if (!cancelled)
+		info->task(info->param);
+
+	pthread_mutex_unlock(&graphics_task_run_mutex);
+
+	if (found)
+		bfree(info);
+}
+
+void script_queue_graphics_task(obs_script_t *script, script_task_cb task,
+				void *param)
+{
+	struct script_graphics_task *info = bzalloc(sizeof(*info));
+	info->script = script;
+	info->task = task;
+	info->param = param;
+
+	pthread_mutex_lock(&graphics_task_mutex);
+	da_push_back(graphics_tasks, &info);
+	pthread_mutex_unlock(&graphics_task_mutex);
+
+	obs_queue_task(OBS_TASK_GRAPHICS, run_graphics_task, info, false);
+}
+
+/* Cancels the graphics tasks of a script (or of all scripts if NULL) and
+ * waits for one that is already running.  Waiting for the queue to drain
+ * instead would hang once the graphics thread has stopped, which is the case
+ * when scripting is unloaded on shutdown.  Must not be called with the
+ * script's lock (or the GIL) held, as a running task takes it. */
+void script_cancel_graphics_tasks(obs_script_t *script)
+{
+	pthread_mutex_lock(&graphics_task_mutex);
+	for (size_t i = 0; i < graphics_tasks.num; i++) {
+		struct script_graphics_task *info = graphics_tasks.array[i];
+		if (!script || info->script == script)
+			info->cancelled = true;
+	}
+	pthread_mutex_unlock(&graphics_task_mutex);
+
+	pthread_mutex_lock(&graphics_task_run_mutex);
+	pthread_mutex_unlock(&graphics_task_run_mutex);
+}
+
+static void script_graphics_tasks_free(void)
+{
+	pthread_mutex_lock(&graphics_task_run_mutex);
+	pthread_mutex_lock(&graphics_task_mutex);
+
+	for (size_t i = 0; i < graphics_tasks.num; i++)
+		bfree(graphics_tasks.array[i]);
+	da_free(graphics_tasks);
+
+	pthread_mutex_unlock(&graphics_task_mutex);
+	pthread_mutex_unlock(&graphics_task_run_mutex);
+}
+
+/* -------------------------------------------- */
+
 bool obs_scripting_load(void)
 {
 	circlebuf_init(&defer_call_queue);
@@ -144,6 +407,18 @@ bool obs_scripting_load(void)
 		return false;
 	}
 
+	if (!script_tick_init()) {
+		blog(LOG_WARNING, "[Scripting] Failed to start the script "
+				  "tick thread");
+		defer_call_exit = true;
+		os_sem_post(defer_call_semaphore);
+		pthread_join(defer_call_thread, NULL);
+		os_sem_destroy(defer_call_semaphore);
+		pthread_mutex_destroy(&defer_call_mutex);
+		pthread_mutex_destroy(&detach_mutex);
+		return false;
+	}
+
 #if COMPILE_LUA
 	obs_lua_load();
 #endif
@@ -166,6 +441,8 @@ void obs_scripting_unload(void)
 
 		/* ---------------------- */
 
+	script_graphics_tasks_free();
+
 #if COMPILE_LUA
 	obs_lua_unload();
 #endif
@@ -174,6 +451,8 @@ void obs_scripting_unload(void)
 	obs_python_unload();
 #endif
 
+	script_tick_free();
+
 	dstr_free(&file_filter);
 
 	/* ---------------------- */
@@ -385,6 +664,28 @@ void obs_script_update(obs_script_t *script, obs_data_t *settings)
 #endif
 }
 
+static void log_tick_stats(obs_script_t *script, bool reset)
+{
+	struct obs_script_tick_stats *stats = &script->tick_stats;
+
+	pthread_mutex_lock(&tick_stats_mutex);
+
+	if (stats->calls)
+		blog(LOG_INFO,
+		     "[Scripting] '%s' tick cost: %" PRIu64 " calls, "
+		     "avg %.3f ms, max %.3f ms, %" PRIu64 " longer than "
+		     "a frame",
+		     script->file.array, stats->calls,
+		     (double)stats->total_ns / (double)stats->calls /
+			     1000000.0,
+		     (double)stats->max_ns / 1000000.0, stats->slow_calls);
+
+	if (reset)
+		memset(stats, 0, sizeof(*stats));
+
+	pthread_mutex_unlock(&tick_stats_mutex);
+}
+
 bool obs_script_reload(obs_script_t *script)
 {
 	if (!scripting_loaded)
@@ -395,6 +696,7 @@ bool obs_script_reload(obs_script_t *script)
 #if COMPILE_LUA
 	if (script->type == OBS_SCRIPT_LANG_LUA) {
 		obs_lua_script_unload(script);
+		log_tick_stats(script, true);
 		clear_call_queue();
 		obs_lua_script_load(script);
 		goto out;
@@ -403,6 +705,7 @@ bool obs_script_reload(obs_script_t *script)
 #if COMPILE_PYTHON
 	if (script->type == OBS_SCRIPT_LANG_PYTHON) {
 		obs_python_script_unload(script);
+		log_tick_stats(script, true);
 		clear_call_queue();
 		obs_python_script_load(script);
 		goto out;
@@ -418,6 +721,17 @@ bool obs_script_loaded(const obs_script_t *script)
 	return ptr_valid(script) ? script->loaded : false;
 }
 
+void obs_script_get_tick_stats(const obs_script_t *script,
+			       struct obs_script_tick_stats *stats)
+{
+	if (!ptr_valid(script) || !ptr_valid(stats))
+		return;
+
+	pthread_mutex_lock(&tick_stats_mutex);
+	*stats = script->tick_stats;
+	pthread_mutex_unlock(&tick_stats_mutex);
+}
+
 void obs_script_destroy(obs_script_t *script)
 {
 	if (!script)
@@ -426,6 +740,7 @@ void obs_script_destroy(obs_script_t *script)
 #if COMPILE_LUA
 	if (script->type == OBS_SCRIPT_LANG_LUA) {
 		obs_lua_script_unload(script);
+		log_tick_stats(script, false);
 		obs_lua_script_destroy(script);
 		return;
 	}
@@ -433,6 +748,7 @@ void obs_script_destroy(obs_script_t *script)
 #if COMPILE_PYTHON
 	if (script->type == OBS_SCRIPT_LANG_PYTHON) {
 		obs_python_script_unload(script);
+		log_tick_stats(script, false);
 		obs_python_script_destroy(script);
 		return;
 	}
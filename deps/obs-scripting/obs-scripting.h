@@ -65,6 +65,20 @@ EXPORT void obs_script_update(obs_script_t *script, obs_data_t *settings);
 EXPORT bool obs_script_loaded(const obs_script_t *script);
 EXPORT bool obs_script_reload(obs_script_t *script);
 
+struct obs_script_tick_stats {
+	uint64_t calls;
+	uint64_t total_ns;
+	uint64_t max_ns;
+
+	/* calls that took longer than a frame */
+	uint64_t slow_calls;
+};
+
+/** Returns the time spent in the script's tick, timer and tick callback
+ * functions since it was last loaded */
+EXPORT void obs_script_get_tick_stats(const obs_script_t *script,
+				      struct obs_script_tick_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,31 +1,69 @@
 #include "obs-internal.h"
 #include "pulseaudio-wrapper.h"
 
-#define PULSE_DATA(voidptr) struct audio_monitor *data = voidptr;
+#define PULSE_DATA(voidptr) struct monitor_output *data = voidptr;
 #define blog(level, msg, ...) blog(level, "pulse-am: " msg, ##__VA_ARGS__)
 
+/* All monitored sources are mixed on the audio thread into a single stream
+ * on the monitoring device, rather than each source opening its own stream
+ * with its own resampler.  The stream is kept at a fixed latency target;
+ * anything beyond it is dropped instead of letting the latency grow. */
+#define MONITOR_LATENCY_MS 60
+
+/* audio a source has to buffer before it's mixed in, absorbs the jitter of
+ * sources that deliver audio from their own thread */
+#define SOURCE_PREBUFFER_FRAMES AUDIO_OUTPUT_FRAMES
+#define SOURCE_MAX_FRAMES (4 * AUDIO_OUTPUT_FRAMES)
+
 struct audio_monitor {
 	obs_source_t *source;
-	pa_stream *stream;
+	bool ignore;
+
+	/* protected by the bus mutex */
+	struct circlebuf buf[MAX_AUDIO_CHANNELS];
+	bool primed;
+};
+
+/* the stream on the monitoring device.  opening and closing it blocks on
+ * the pulseaudio mainloop, so that is done without the bus mutex and the
+ * finished output is swapped in under it */
+struct monitor_output {
+	char *device_id;
 	char *device;
+	pa_stream *stream;
 	pa_buffer_attr attr;
-	enum speaker_layout speakers;
 	pa_sample_format_t format;
 	uint_fast32_t samples_per_sec;
 	uint_fast32_t bytes_per_frame;
 	uint_fast8_t channels;
+	audio_resampler_t *resampler;
+	bool active;
 
-	uint_fast32_t packets;
-	uint_fast64_t frames;
+	size_t audio_channels;
 
-	struct circlebuf new_data;
-	audio_resampler_t *resampler;
-	size_t buffer_size;
-	size_t bytesRemaining;
-	size_t bytes_per_channel;
+	uint32_t latency_ms;
+	uint64_t mixed_frames;
+	uint64_t source_underruns;
+	uint64_t dropped_frames;
+	volatile long underruns;
+};
 
-	bool ignore;
-	pthread_mutex_t playback_mutex;
+struct monitor_bus {
+	/* serializes opening and closing the output; only a thread holding
+	 * it changes the output pointer */
+	pthread_mutex_t start_mutex;
+
+	/* protects the monitor list, the output pointer and the mix, and is
+	 * taken by the audio thread and the capture callbacks */
+	pthread_mutex_t mutex;
+	DARRAY(struct audio_monitor *) monitors;
+	struct monitor_output *output;
+	float mix[MAX_AUDIO_CHANNELS][AUDIO_OUTPUT_FRAMES];
+};
+
+static struct monitor_bus bus = {
+	.start_mutex = PTHREAD_MUTEX_INITIALIZER,
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
 };
 
 static enum speaker_layout
@@ -125,151 +163,6 @@ static pa_channel_map pulseaudio_channel_map(enum speaker_layout layout)
 	return ret;
 }
 
-static void process_byte(void *p, size_t frames, size_t channels, float vol)
-{
-	register char *cur = (char *)p;
-	register char *end = cur + frames * channels;
-
-	while (cur < end)
-		*(cur++) *= vol;
-}
-
-static void process_short(void *p, size_t frames, size_t channels, float vol)
-{
-	register short *cur = (short *)p;
-	register short *end = cur + frames * channels;
-
-	while (cur < end)
-		*(cur++) *= vol;
-}
-
-static void process_float(void *p, size_t frames, size_t channels, float vol)
-{
-	register float *cur = (float *)p;
-	register float *end = cur + frames * channels;
-
-	while (cur < end)
-		*(cur++) *= vol;
-}
-
-void process_volume(const struct audio_monitor *monitor, float vol,
-		    uint8_t *const *resample_data, uint32_t resample_frames)
-{
-	switch (monitor->bytes_per_channel) {
-	case 1:
-		process_byte(resample_data[0], resample_frames,
-			     monitor->channels, vol);
-		break;
-	case 2:
-		process_short(resample_data[0], resample_frames,
-			      monitor->channels, vol);
-		break;
-	default:
-		process_float(resample_data[0], resample_frames,
-			      monitor->channels, vol);
-		break;
-	}
-}
-
-static void do_stream_write(void *param)
-{
-	PULSE_DATA(param);
-	uint8_t *buffer = NULL;
-
-	while (data->new_data.size >= data->buffer_size &&
-	       data->bytesRemaining > 0) {
-		size_t bytesToFill = data->buffer_size;
-
-		if (bytesToFill > data->bytesRemaining)
-			bytesToFill = data->bytesRemaining;
-
-		pa_stream_begin_write(data->stream, (void **)&buffer,
-				      &bytesToFill);
-
-		circlebuf_pop_front(&data->new_data, buffer, bytesToFill);
-
-		pulseaudio_lock();
-		pa_stream_write(data->stream, buffer, bytesToFill, NULL, 0LL,
-				PA_SEEK_RELATIVE);
-		pulseaudio_unlock();
-
-		data->bytesRemaining -= bytesToFill;
-	}
-}
-
-static void on_audio_playback(void *param, obs_source_t *source,
-			      const struct audio_data *audio_data, bool muted)
-{
-	struct audio_monitor *monitor = param;
-	float vol = source->user_volume;
-	size_t bytes;
-
-	uint8_t *resample_data[MAX_AV_PLANES];
-	uint32_t resample_frames;
-	uint64_t ts_offset;
-	bool success;
-
-	if (pthread_mutex_trylock(&monitor->playback_mutex) != 0)
-		return;
-
-	if (os_atomic_load_long(&source->activate_refs) == 0)
-		goto unlock;
-
-	success = audio_resampler_resample(
-		monitor->resampler, resample_data, &resample_frames, &ts_offset,
-		(const uint8_t *const *)audio_data->data,
-		(uint32_t)audio_data->frames);
-
-	if (!success)
-		goto unlock;
-
-	bytes = monitor->bytes_per_frame * resample_frames;
-
-	if (muted) {
-		memset(resample_data[0], 0, bytes);
-	} else {
-		if (!close_float(vol, 1.0f, EPSILON)) {
-			process_volume(monitor, vol, resample_data,
-				       resample_frames);
-		}
-	}
-
-	circlebuf_push_back(&monitor->new_data, resample_data[0], bytes);
-	monitor->packets++;
-	monitor->frames += resample_frames;
-
-unlock:
-	pthread_mutex_unlock(&monitor->playback_mutex);
-	do_stream_write(param);
-}
-
-static void pulseaudio_stream_write(pa_stream *p, size_t nbytes, void *userdata)
-{
-	UNUSED_PARAMETER(p);
-	PULSE_DATA(userdata);
-
-	pthread_mutex_lock(&data->playback_mutex);
-	data->bytesRemaining += nbytes;
-	pthread_mutex_unlock(&data->playback_mutex);
-
-	pulseaudio_signal(0);
-}
-
-static void pulseaudio_underflow(pa_stream *p, void *userdata)
-{
-	UNUSED_PARAMETER(p);
-	PULSE_DATA(userdata);
-
-	pthread_mutex_lock(&data->playback_mutex);
-	if (obs_source_active(data->source))
-		data->attr.tlength = (data->attr.tlength * 3) / 2;
-
-	pa_stream_set_buffer_attr(data->stream, &data->attr, NULL, NULL);
-	pthread_mutex_unlock(&data->playback_mutex);
-
-	pulseaudio_signal(0);
-}
-
 static void pulseaudio_server_info(pa_context *c, const pa_server_info *i,
 				   void *userdata)
 {
@@ -328,79 +221,81 @@ skip:
 	pulseaudio_signal(0);
 }
 
-static void pulseaudio_stop_playback(struct audio_monitor *monitor)
+static void pulseaudio_underflow(pa_stream *p, void *userdata)
 {
-	if (monitor->stream) {
-		pa_stream_disconnect(monitor->stream);
-		pa_stream_unref(monitor->stream);
-		monitor->stream = NULL;
-	}
-
-	blog(LOG_INFO, "Stopped Monitoring in '%s'", monitor->device);
-	blog(LOG_INFO,
-	     "Got %" PRIuFAST32 " packets with %" PRIuFAST64 " frames",
-	     monitor->packets, monitor->frames);
+	UNUSED_PARAMETER(p);
+	PULSE_DATA(userdata);
 
-	monitor->packets = 0;
-	monitor->frames = 0;
+	os_atomic_inc_long(&data->underruns);
 }
 
-static bool audio_monitor_init(struct audio_monitor *monitor,
-			       obs_source_t *source)
+static void output_destroy(struct monitor_output *data)
 {
-	pthread_mutex_init_value(&monitor->playback_mutex);
+	if (!data)
+		return;
 
-	monitor->source = source;
+	if (data->stream) {
+		pulseaudio_lock();
+		pa_stream_disconnect(data->stream);
+		pa_stream_unref(data->stream);
+		pulseaudio_unlock();
+		data->stream = NULL;
 
-	const char *id = obs->audio.monitoring_device_id;
-	if (!id)
-		return false;
+		blog(LOG_INFO, "Stopped Monitoring in '%s'", data->device);
+		blog(LOG_INFO,
+		     "Mixed %" PRIu64 " frames, %ld underruns, "
+		     "%" PRIu64 " source underruns, %" PRIu64
+		     " dropped frames",
+		     data->mixed_frames, os_atomic_load_long(&data->underruns),
+		     data->source_underruns, data->dropped_frames);
+	}
 
-	if (source->info.output_flags & OBS_SOURCE_DO_NOT_SELF_MONITOR) {
-		obs_data_t *s = obs_source_get_settings(source);
-		const char *s_dev_id = obs_data_get_string(s, "device_id");
-		bool match = devices_match(s_dev_id, id);
-		obs_data_release(s);
+	if (data->active)
+		pulseaudio_unref();
 
-		if (match) {
-			monitor->ignore = true;
-			blog(LOG_INFO, "Prevented feedback-loop in '%s'",
-			     s_dev_id);
-			return true;
-		}
-	}
+	audio_resampler_destroy(data->resampler);
+	data->resampler = NULL;
+
+	bfree(data->device);
+	bfree(data->device_id);
+	bfree(data);
+}
 
+static bool output_start(struct monitor_output *data, const char *id)
+{
 	pulseaudio_init();
+	data->active = true;
+	data->device_id = bstrdup(id);
 
 	if (strcmp(id, "default") == 0)
-		get_default_id(&monitor->device);
+		get_default_id(&data->device);
 	else
-		monitor->device = bstrdup(id);
+		data->device = bstrdup(id);
 
-	if (!monitor->device)
+	if (!data->device)
 		return false;
 
-	if (pulseaudio_get_server_info(pulseaudio_server_info,
-				       (void *)monitor) < 0) {
+	if (pulseaudio_get_server_info(pulseaudio_server_info, (void *)data) <
+	    0) {
 		blog(LOG_ERROR, "Unable to get server info !");
 		return false;
 	}
 
-	if (pulseaudio_get_source_info(pulseaudio_source_info, monitor->device,
-				       (void *)monitor) < 0) {
+	if (pulseaudio_get_source_info(pulseaudio_source_info, data->device,
+				       (void *)data) < 0) {
 		blog(LOG_ERROR, "Unable to get source info !");
 		return false;
 	}
-	if (monitor->format == PA_SAMPLE_INVALID) {
+	if (data->format == PA_SAMPLE_INVALID) {
 		blog(LOG_ERROR,
 		     "An error occurred while getting the source info!");
 		return false;
 	}
 
 	pa_sample_spec spec;
-	spec.format = monitor->format;
-	spec.rate = (uint32_t)monitor->samples_per_sec;
-	spec.channels = monitor->channels;
+	spec.format = data->format;
+	spec.rate = (uint32_t)data->samples_per_sec;
+	spec.channels = data->channels;
 
 	if (!pa_sample_spec_valid(&spec)) {
 		blog(LOG_ERROR, "Sample spec is not valid");
@@ -409,67 +304,333 @@ static bool audio_monitor_init(struct audio_monitor *monitor,
 
 	const struct audio_output_info *info =
 		audio_output_get_info(obs->audio.audio);
+	enum speaker_layout speakers =
+		pulseaudio_channels_to_obs_speakers(data->channels);
 
 	struct resample_info from = {.samples_per_sec = info->samples_per_sec,
 				     .speakers = info->speakers,
 				     .format = AUDIO_FORMAT_FLOAT_PLANAR};
 	struct resample_info to = {
-		.samples_per_sec = (uint32_t)monitor->samples_per_sec,
-		.speakers =
-			pulseaudio_channels_to_obs_speakers(monitor->channels),
-		.format = pulseaudio_to_obs_audio_format(monitor->format)};
+		.samples_per_sec = (uint32_t)data->samples_per_sec,
+		.speakers = speakers,
+		.format = pulseaudio_to_obs_audio_format(data->format)};
 
-	monitor->resampler = audio_resampler_create(&to, &from);
-	if (!monitor->resampler) {
+	data->resampler = audio_resampler_create(&to, &from);
+	if (!data->resampler) {
 		blog(LOG_WARNING, "%s: %s", __FUNCTION__,
 		     "Failed to create resampler");
 		return false;
 	}
 
-	monitor->bytes_per_channel = get_audio_bytes_per_channel(
-		pulseaudio_to_obs_audio_format(monitor->format));
-	monitor->speakers = pulseaudio_channels_to_obs_speakers(spec.channels);
-	monitor->bytes_per_frame = pa_frame_size(&spec);
+	data->audio_channels = get_audio_channels(info->speakers);
+	data->bytes_per_frame = pa_frame_size(&spec);
 
-	pa_channel_map channel_map = pulseaudio_channel_map(monitor->speakers);
+	pa_channel_map channel_map = pulseaudio_channel_map(speakers);
 
-	monitor->stream = pulseaudio_stream_new(
-		obs_source_get_name(monitor->source), &spec, &channel_map);
-	if (!monitor->stream) {
+	data->stream = pulseaudio_stream_new("OBS Monitoring", &spec,
+					     &channel_map);
+	if (!data->stream) {
 		blog(LOG_ERROR, "Unable to create stream");
 		return false;
 	}
 
-	monitor->attr.fragsize = (uint32_t)-1;
-	monitor->attr.maxlength = (uint32_t)-1;
-	monitor->attr.minreq = (uint32_t)-1;
-	monitor->attr.prebuf = (uint32_t)-1;
-	monitor->attr.tlength = pa_usec_to_bytes(25000, &spec);
-
-	monitor->buffer_size =
-		monitor->bytes_per_frame * pa_usec_to_bytes(5000, &spec);
+	data->attr.fragsize = (uint32_t)-1;
+	data->attr.maxlength = (uint32_t)-1;
+	data->attr.minreq = (uint32_t)-1;
+	data->attr.prebuf = (uint32_t)-1;
+	data->attr.tlength =
+		(uint32_t)pa_usec_to_bytes(MONITOR_LATENCY_MS * 1000, &spec);
 
 	pa_stream_flags_t flags = PA_STREAM_INTERPOLATE_TIMING |
 				  PA_STREAM_AUTO_TIMING_UPDATE;
 
-	if (pthread_mutex_init(&monitor->playback_mutex, NULL) != 0) {
-		blog(LOG_WARNING, "%s: %s", __FUNCTION__,
-		     "Failed to init mutex");
-		return false;
-	}
-
 	int_fast32_t ret = pulseaudio_connect_playback(
-		monitor->stream, monitor->device, &monitor->attr, flags);
+		data->stream, data->device, &data->attr, flags);
 	if (ret < 0) {
-		pulseaudio_stop_playback(monitor);
 		blog(LOG_ERROR, "Unable to connect to stream");
 		return false;
 	}
 
-	blog(LOG_INFO, "Started Monitoring in '%s'", monitor->device);
+	pulseaudio_set_underflow_callback(data->stream, pulseaudio_underflow,
+					  (void *)data);
+
+	blog(LOG_INFO, "Started Monitoring in '%s', latency target %d ms",
+	     data->device, MONITOR_LATENCY_MS);
 	return true;
 }
 
+static struct monitor_output *output_create(const char *id)
+{
+	struct monitor_output *data = bzalloc(sizeof(*data));
+
+	if (!output_start(data, id)) {
+		output_destroy(data);
+		return NULL;
+	}
+
+	return data;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void on_audio_playback(void *param, obs_source_t *source,
+			      const struct audio_data *audio_data, bool muted)
+{
+	struct audio_monitor *monitor = param;
+	size_t frames = audio_data->frames;
+	float vol = source->user_volume;
+	float buf[AUDIO_OUTPUT_FRAMES];
+
+	if (os_atomic_load_long(&source->activate_refs) == 0)
+		return;
+
+	pthread_mutex_lock(&bus.mutex);
+
+	if (!bus.output)
+		goto unlock;
+
+	for (size_t ch = 0; ch < bus.output->audio_channels; ch++) {
+		const float *in = (const float *)audio_data->data[ch];
+		struct circlebuf *cb = &monitor->buf[ch];
+		size_t pos = 0;
+
+		while (pos < frames) {
+			size_t n = frames - pos;
+			if (n > AUDIO_OUTPUT_FRAMES)
+				n = AUDIO_OUTPUT_FRAMES;
+
+			if (muted || !in) {
+				memset(buf, 0, n * sizeof(float));
+			} else {
+				for (size_t i = 0; i < n; i++)
+					buf[i] = in[pos + i] * vol;
+			}
+
+			circlebuf_push_back(cb, buf, n * sizeof(float));
+			pos += n;
+		}
+
+		/* the source delivers faster than the audio thread mixes,
+		 * keep only the most recent audio */
+		if (cb->size > SOURCE_MAX_FRAMES * sizeof(float)) {
+			size_t excess = cb->size -
+					SOURCE_MAX_FRAMES * sizeof(float);
+			circlebuf_pop_front(cb, NULL, excess);
+
+			if (ch == 0)
+				bus.output->dropped_frames +=
+					excess / sizeof(float);
+		}
+	}
+
+unlock:
+	pthread_mutex_unlock(&bus.mutex);
+}
+
+static void mix_monitor(struct monitor_output *data,
+			struct audio_monitor *monitor)
+{
+	size_t size = monitor->buf[0].size;
+	size_t frames = size / sizeof(float);
+	float buf[AUDIO_OUTPUT_FRAMES];
+
+	if (!monitor->primed) {
+		if (frames < SOURCE_PREBUFFER_FRAMES)
+			return;
+		monitor->primed = true;
+	}
+
+	if (frames > AUDIO_OUTPUT_FRAMES) {
+		frames = AUDIO_OUTPUT_FRAMES;
+	} else if (frames < AUDIO_OUTPUT_FRAMES) {
+		/* ran dry, buffer up again before it is mixed back in */
+		monitor->primed = false;
+		data->source_underruns++;
+	}
+
+	for (size_t ch = 0; ch < data->audio_channels; ch++) {
+		float *mix = bus.mix[ch];
+
+		circlebuf_pop_front(&monitor->buf[ch], buf,
+				    frames * sizeof(float));
+		for (size_t i = 0; i < frames; i++)
+			mix[i] += buf[i];
+	}
+}
+
+static void write_mix(struct monitor_output *data)
+{
+	const uint8_t *in[MAX_AV_PLANES] = {0};
+	uint8_t *out[MAX_AV_PLANES];
+	uint32_t out_frames;
+	uint64_t ts_offset;
+	pa_usec_t latency;
+	int negative;
+
+	for (size_t ch = 0; ch < data->audio_channels; ch++)
+		in[ch] = (const uint8_t *)bus.mix[ch];
+
+	if (!audio_resampler_resample(data->resampler, out, &out_frames,
+				      &ts_offset, in, AUDIO_OUTPUT_FRAMES))
+		return;
+
+	size_t bytes = out_frames * data->bytes_per_frame;
+
+	pulseaudio_lock();
+
+	if (pa_stream_get_state(data->stream) != PA_STREAM_READY) {
+		pulseaudio_unlock();
+		return;
+	}
+
+	/* the device clock and the audio thread clock drift apart, once the
+	 * stream is filled up to the latency target anything else is dropped
+	 * instead of adding latency */
+	size_t writable = pa_stream_writable_size(data->stream);
+	if (writable == (size_t)-1)
+		writable = 0;
+	if (bytes > writable) {
+		data->dropped_frames +=
+			(bytes - writable) / data->bytes_per_frame;
+		bytes = writable - writable % data->bytes_per_frame;
+	}
+
+	if (bytes)
+		pa_stream_write(data->stream, out[0], bytes, NULL, 0LL,
+				PA_SEEK_RELATIVE);
+
+	if (pa_stream_get_latency(data->stream, &latency, &negative) == 0)
+		data->latency_ms = negative ? 0 : (uint32_t)(latency / 1000);
+
+	pulseaudio_unlock();
+
+	data->mixed_frames += AUDIO_OUTPUT_FRAMES;
+}
+
+void audio_monitoring_tick(void)
+{
+	pthread_mutex_lock(&bus.mutex);
+
+	if (!bus.output || !bus.monitors.num)
+		goto unlock;
+
+	memset(bus.mix, 0, sizeof(bus.mix));
+
+	for (size_t i = 0; i < bus.monitors.num; i++)
+		mix_monitor(bus.output, bus.monitors.array[i]);
+
+	write_mix(bus.output);
+
+unlock:
+	pthread_mutex_unlock(&bus.mutex);
+}
+
+bool obs_get_audio_monitoring_stats(struct obs_audio_monitoring_stats *stats)
+{
+	bool success;
+
+	pthread_mutex_lock(&bus.mutex);
+
+	success = bus.output != NULL;
+	if (success) {
+		struct monitor_output *out = bus.output;
+
+		stats->monitors = (uint32_t)bus.monitors.num;
+		stats->latency_target_ms = MONITOR_LATENCY_MS;
+		stats->latency_ms = out->latency_ms;
+		stats->mixed_frames = out->mixed_frames;
+		stats->underruns =
+			(uint64_t)os_atomic_load_long(&out->underruns);
+		stats->source_underruns = out->source_underruns;
+		stats->dropped_frames = out->dropped_frames;
+	}
+
+	pthread_mutex_unlock(&bus.mutex);
+	return success;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* opens the bus output for the first monitor, and reopens it if the
+ * monitoring device changed since.  the audio thread keeps mixing into the
+ * old output while the new one is opened */
+static bool bus_add_monitor(struct audio_monitor *monitor)
+{
+	const char *id = obs->audio.monitoring_device_id;
+	struct monitor_output *old = NULL;
+	struct monitor_output *out = NULL;
+	bool success;
+	bool replace;
+
+	pthread_mutex_lock(&bus.start_mutex);
+
+	replace = !bus.output || strcmp(bus.output->device_id, id) != 0;
+	if (replace)
+		out = output_create(id);
+
+	pthread_mutex_lock(&bus.mutex);
+	if (replace) {
+		old = bus.output;
+		bus.output = out;
+	}
+	success = bus.output != NULL;
+	if (success)
+		da_push_back(bus.monitors, &monitor);
+	pthread_mutex_unlock(&bus.mutex);
+
+	output_destroy(old);
+
+	pthread_mutex_unlock(&bus.start_mutex);
+	return success;
+}
+
+static void bus_remove_monitor(struct audio_monitor *monitor)
+{
+	struct monitor_output *old = NULL;
+
+	pthread_mutex_lock(&bus.start_mutex);
+	pthread_mutex_lock(&bus.mutex);
+
+	da_erase_item(bus.monitors, &monitor);
+	if (!bus.monitors.num) {
+		old = bus.output;
+		bus.output = NULL;
+		da_free(bus.monitors);
+	}
+
+	pthread_mutex_unlock(&bus.mutex);
+
+	output_destroy(old);
+
+	pthread_mutex_unlock(&bus.start_mutex);
+}
+
+static bool audio_monitor_init(struct audio_monitor *monitor,
+			       obs_source_t *source)
+{
+	monitor->source = source;
+
+	const char *id = obs->audio.monitoring_device_id;
+	if (!id)
+		return false;
+
+	if (source->info.output_flags & OBS_SOURCE_DO_NOT_SELF_MONITOR) {
+		obs_data_t *s = obs_source_get_settings(source);
+		const char *s_dev_id = obs_data_get_string(s, "device_id");
+		bool match = devices_match(s_dev_id, id);
+		obs_data_release(s);
+
+		if (match) {
+			monitor->ignore = true;
+			blog(LOG_INFO, "Prevented feedback-loop in '%s'",
+			     s_dev_id);
+			return true;
+		}
+	}
+
+	return bus_add_monitor(monitor);
+}
+
 static void audio_monitor_init_final(struct audio_monitor *monitor)
 {
 	if (monitor->ignore)
@@ -477,12 +638,6 @@ static void audio_monitor_init_final(struct audio_monitor *monitor)
 
 	obs_source_add_audio_capture_callback(monitor->source,
 					      on_audio_playback, monitor);
-
-	pulseaudio_write_callback(monitor->stream, pulseaudio_stream_write,
-				  (void *)monitor);
-
-	pulseaudio_set_underflow_callback(monitor->stream, pulseaudio_underflow,
-					  (void *)monitor);
 }
 
 static inline void audio_monitor_free(struct audio_monitor *monitor)
@@ -494,25 +649,21 @@ static inline void audio_monitor_free(struct audio_monitor *monitor)
 		obs_source_remove_audio_capture_callback(
 			monitor->source, on_audio_playback, monitor);
 
-	audio_resampler_destroy(monitor->resampler);
-	circlebuf_free(&monitor->new_data);
-
-	if (monitor->stream)
-		pulseaudio_stop_playback(monitor);
-	pulseaudio_unref();
+	bus_remove_monitor(monitor);
 
-	bfree(monitor->device);
+	for (size_t ch = 0; ch < MAX_AUDIO_CHANNELS; ch++)
+		circlebuf_free(&monitor->buf[ch]);
+	monitor->primed = false;
 }
 
 struct audio_monitor *audio_monitor_create(obs_source_t *source)
 {
-	struct audio_monitor monitor = {0};
-	struct audio_monitor *out;
+	struct audio_monitor *out = bzalloc(sizeof(*out));
 
-	if (!audio_monitor_init(&monitor, source))
-		goto fail;
-
-	out = bmemdup(&monitor, sizeof(monitor));
+	if (!audio_monitor_init(out, source)) {
+		bfree(out);
+		return NULL;
+	}
 
 	pthread_mutex_lock(&obs->audio.monitoring_mutex);
 	da_push_back(obs->audio.monitors, &out);
@@ -520,28 +671,17 @@ struct audio_monitor *audio_monitor_create(obs_source_t *source)
 
 	audio_monitor_init_final(out);
 	return out;
-
-fail:
-	audio_monitor_free(&monitor);
-	return NULL;
 }
 
 void audio_monitor_reset(struct audio_monitor *monitor)
 {
-	struct audio_monitor new_monitor = {0};
-	bool success;
-	audio_monitor_free(monitor);
+	obs_source_t *source = monitor->source;
 
-	pthread_mutex_lock(&monitor->playback_mutex);
-	success = audio_monitor_init(&new_monitor, monitor->source);
-	pthread_mutex_unlock(&monitor->playback_mutex);
+	audio_monitor_free(monitor);
+	memset(monitor, 0, sizeof(*monitor));
 
-	if (success) {
-		*monitor = new_monitor;
+	if (audio_monitor_init(monitor, source))
 		audio_monitor_init_final(monitor);
-	} else {
-		audio_monitor_free(&new_monitor);
-	}
 }
 
 void audio_monitor_destroy(struct audio_monitor *monitor)
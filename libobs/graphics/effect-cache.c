@@ -0,0 +1,465 @@
+/******************************************************************************
+    Copyright (C) 2021 by the OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "../util/array-serializer.h"
+#include "../util/file-serializer.h"
+#include "../util/platform.h"
+#include "../util/threading.h"
+#include "../util/hash.h"
+#include "../util/dstr.h"
+#include "effect-cache.h"
+
+#define EFFECT_CACHE_MAGIC 0x5846424F /* "OBFX" */
+#define EFFECT_CACHE_VERSION 1
+#define EFFECT_CACHE_MAX_STRING (16 * 1024 * 1024)
+#define EFFECT_CACHE_MAX_COUNT 4096
+
+extern const char *gs_preprocessor_name(void);
+extern void gs_effect_actually_destroy(gs_effect_t *effect);
+
+static pthread_mutex_t cache_path_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char *cache_path = NULL;
+
+void gs_effect_cache_set_path(const char *path)
+{
+	pthread_mutex_lock(&cache_path_mutex);
+	bfree(cache_path);
+	cache_path = (path && *path) ? bstrdup(path) : NULL;
+	pthread_mutex_unlock(&cache_path_mutex);
+}
+
+static bool get_cache_file(struct dstr *dst, uint64_t key)
+{
+	bool valid;
+
+	pthread_mutex_lock(&cache_path_mutex);
+	valid = !!cache_path;
+	if (valid)
+		dstr_printf(dst, "%s/%016llx.fxc", cache_path,
+			    (unsigned long long)key);
+	pthread_mutex_unlock(&cache_path_mutex);
+
+	return valid;
+}
+
+uint64_t effect_cache_key(const char *effect_string, const char *file)
+{
+	const char *preprocessor = gs_preprocessor_name();
+	const uint32_t version = EFFECT_CACHE_VERSION;
+	uint64_t hash = HASH_FNV1A64_INIT;
+
+	hash = hash_fnv1a64_update(hash, &version, sizeof(version));
+	if (preprocessor)
+		hash = hash_fnv1a64_update(hash, preprocessor,
+					   strlen(preprocessor) + 1);
+	if (file)
+		hash = hash_fnv1a64_update(hash, file, strlen(file) + 1);
+	return hash_fnv1a64_update(hash, effect_string, strlen(effect_string));
+}
+
+/* ------------------------------------------------------------------------- */
+/* writing                                                                   */
+
+static void write_str(struct serializer *s, const char *str)
+{
+	uint32_t len = str ? (uint32_t)strlen(str) : 0;
+
+	s_wl32(s, len);
+	if (len)
+		s_write(s, str, len);
+}
+
+static void write_param(struct serializer *s,
+			const struct gs_effect_param *param)
+{
+	write_str(s, param->name);
+	s_wl32(s, (uint32_t)param->type);
+	s_wl32(s, (uint32_t)param->default_val.num);
+	if (param->default_val.num)
+		s_write(s, param->default_val.array, param->default_val.num);
+
+	s_wl32(s, (uint32_t)param->annotations.num);
+	for (size_t i = 0; i < param->annotations.num; i++)
+		write_param(s, param->annotations.array + i);
+}
+
+static bool write_shader_params(struct serializer *s,
+				const struct darray *pass_params)
+{
+	const struct pass_shaderparam *params = pass_params->array;
+
+	s_wl32(s, (uint32_t)pass_params->num);
+	for (size_t i = 0; i < pass_params->num; i++) {
+		if (!params[i].eparam)
+			return false;
+		write_str(s, params[i].eparam->name);
+	}
+
+	return true;
+}
+
+static bool write_effect(struct serializer *s, uint64_t key,
+			 const struct effect_parser *ep,
+			 const gs_effect_t *effect)
+{
+	const struct cf_preprocessor *pp = &ep->cfp.pp;
+	size_t shader_idx = 0;
+
+	s_wl32(s, EFFECT_CACHE_MAGIC);
+	s_wl32(s, EFFECT_CACHE_VERSION);
+	s_wl64(s, key);
+
+	s_wl32(s, (uint32_t)pp->dependencies.num);
+	for (size_t i = 0; i < pp->dependencies.num; i++) {
+		const struct cf_lexer *dep = pp->dependencies.array + i;
+		const char *text = dep->base_lexer.text;
+
+		write_str(s, dep->file);
+		s_wl64(s, hash_fnv1a64(text, text ? strlen(text) : 0));
+	}
+
+	s_wl32(s, (uint32_t)effect->params.num);
+	for (size_t i = 0; i < effect->params.num; i++)
+		write_param(s, effect->params.array + i);
+
+	s_wl32(s, (uint32_t)effect->techniques.num);
+	for (size_t i = 0; i < effect->techniques.num; i++) {
+		const struct gs_effect_technique *tech =
+			effect->techniques.array + i;
+
+		write_str(s, tech->name);
+		s_wl32(s, (uint32_t)tech->passes.num);
+
+		for (size_t j = 0; j < tech->passes.num; j++) {
+			const struct gs_effect_pass *pass =
+				tech->passes.array + j;
+
+			if (shader_idx + 2 > ep->shader_texts.num)
+				return false;
+
+			write_str(s, pass->name);
+			write_str(s, ep->shader_texts.array[shader_idx++].array);
+			if (!write_shader_params(s,
+						 &pass->vertshader_params.da))
+				return false;
+			write_str(s, ep->shader_texts.array[shader_idx++].array);
+			if (!write_shader_params(s,
+						 &pass->pixelshader_params.da))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+void effect_cache_save(uint64_t key, const struct effect_parser *ep,
+		       const gs_effect_t *effect)
+{
+	struct array_output_data data;
+	struct serializer s;
+	struct serializer file;
+	struct dstr path = {0};
+
+	if (!get_cache_file(&path, key))
+		return;
+
+	array_output_serializer_init(&s, &data);
+
+	if (!write_effect(&s, key, ep, effect))
+		goto exit;
+
+	if (!file_output_serializer_init_safe(&file, path.array, "tmp")) {
+		blog(LOG_DEBUG, "effect cache: could not write '%s'",
+		     path.array);
+		goto exit;
+	}
+
+	s_write(&file, data.bytes.array, data.bytes.num);
+	file_output_serializer_free(&file);
+
+exit:
+	array_output_serializer_free(&data);
+	dstr_free(&path);
+}
+
+/* ------------------------------------------------------------------------- */
+/* reading                                                                   */
+
+struct cache_reader {
+	struct serializer s;
+	bool error;
+};
+
+static uint32_t read_u32(struct cache_reader *r)
+{
+	uint8_t b[4];
+
+	if (r->error || s_read(&r->s, b, sizeof(b)) != sizeof(b)) {
+		r->error = true;
+		return 0;
+	}
+
+	return (uint32_t)b[0] | ((uint32_t)b[1] << 8) |
+	       ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static uint64_t read_u64(struct cache_reader *r)
+{
+	uint64_t lo = read_u32(r);
+	uint64_t hi = read_u32(r);
+	return lo | (hi << 32);
+}
+
+static size_t read_count(struct cache_reader *r)
+{
+	uint32_t count = read_u32(r);
+
+	if (count > EFFECT_CACHE_MAX_COUNT) {
+		r->error = true;
+		return 0;
+	}
+
+	return count;
+}
+
+static bool read_bytes(struct cache_reader *r, void *data, size_t size)
+{
+	if (!r->error && size && s_read(&r->s, data, size) != size)
+		r->error = true;
+	return !r->error;
+}
+
+static char *read_str(struct cache_reader *r)
+{
+	uint32_t len = read_u32(r);
+	char *str;
+
+	if (r->error || len > EFFECT_CACHE_MAX_STRING) {
+		r->error = true;
+		return NULL;
+	}
+
+	str = bmalloc(len + 1);
+	if (!read_bytes(r, str, len)) {
+		bfree(str);
+		return NULL;
+	}
+
+	str[len] = 0;
+	return str;
+}
+
+static bool read_param(struct cache_reader *r, gs_effect_t *effect,
+		       struct gs_effect_param *param,
+		       enum effect_section section)
+{
+	size_t num;
+
+	param->name = read_str(r);
+	param->type = (enum gs_shader_param_type)read_u32(r);
+	param->section = section;
+	param->effect = effect;
+
+	num = read_u32(r);
+	if (r->error || num > EFFECT_CACHE_MAX_STRING)
+		return false;
+
+	da_resize(param->default_val, num);
+	if (!read_bytes(r, param->default_val.array, num))
+		return false;
+
+	num = read_count(r);
+	da_resize(param->annotations, num);
+	for (size_t i = 0; i < num; i++) {
+		if (!read_param(r, effect, param->annotations.array + i,
+				EFFECT_ANNOTATION))
+			return false;
+	}
+
+	return !r->error && param->name;
+}
+
+static bool deps_unchanged(struct cache_reader *r)
+{
+	size_t num = read_count(r);
+	bool unchanged = true;
+
+	for (size_t i = 0; i < num && !r->error; i++) {
+		char *dep_file = read_str(r);
+		uint64_t dep_hash = read_u64(r);
+		char *text;
+
+		if (r->error) {
+			bfree(dep_file);
+			break;
+		}
+
+		text = os_quick_read_utf8_file(dep_file);
+		if (!text ||
+		    hash_fnv1a64(text, strlen(text)) != dep_hash)
+			unchanged = false;
+
+		bfree(text);
+		bfree(dep_file);
+
+		if (!unchanged)
+			break;
+	}
+
+	return unchanged && !r->error;
+}
+
+static bool read_shader(struct cache_reader *r, gs_effect_t *effect,
+			const char *tech_name, size_t pass_idx,
+			enum gs_shader_type type, gs_shader_t **shader,
+			struct darray *pass_params)
+{
+	struct pass_shaderparam *params;
+	struct dstr location = {0};
+	char *shader_str = read_str(r);
+	size_t num;
+
+	if (!shader_str)
+		return false;
+
+	dstr_copy(&location, effect->effect_path);
+	dstr_catf(&location, " (%s shader, technique %s, pass %u)",
+		  type == GS_SHADER_VERTEX ? "Vertex" : "Pixel", tech_name,
+		  (unsigned)pass_idx);
+
+	if (type == GS_SHADER_VERTEX)
+		*shader = gs_vertexshader_create(shader_str, location.array,
+						 NULL);
+	else
+		*shader = gs_pixelshader_create(shader_str, location.array,
+						NULL);
+
+	dstr_free(&location);
+	bfree(shader_str);
+
+	num = read_count(r);
+	darray_resize(sizeof(struct pass_shaderparam), pass_params, num);
+	params = pass_params->array;
+
+	for (size_t i = 0; i < num; i++) {
+		char *name = read_str(r);
+		if (!name)
+			return false;
+
+		params[i].eparam = gs_effect_get_param_by_name(effect, name);
+		params[i].sparam =
+			*shader ? gs_shader_get_param_by_name(*shader, name)
+				: NULL;
+		bfree(name);
+
+		if (!params[i].eparam || !params[i].sparam)
+			return false;
+	}
+
+	return !r->error && *shader;
+}
+
+static bool read_effect(struct cache_reader *r, gs_effect_t *effect,
+			uint64_t key)
+{
+	size_t num;
+
+	if (read_u32(r) != EFFECT_CACHE_MAGIC ||
+	    read_u32(r) != EFFECT_CACHE_VERSION || read_u64(r) != key)
+		return false;
+	if (!deps_unchanged(r))
+		return false;
+
+	num = read_count(r);
+	da_resize(effect->params, num);
+	for (size_t i = 0; i < num; i++) {
+		struct gs_effect_param *param = effect->params.array + i;
+
+		if (!read_param(r, effect, param, EFFECT_PARAM))
+			return false;
+
+		if (strcmp(param->name, "ViewProj") == 0)
+			effect->view_proj = param;
+		else if (strcmp(param->name, "World") == 0)
+			effect->world = param;
+	}
+
+	num = read_count(r);
+	da_resize(effect->techniques, num);
+	for (size_t i = 0; i < num; i++) {
+		struct gs_effect_technique *tech = effect->techniques.array + i;
+		size_t num_passes;
+
+		tech->name = read_str(r);
+		tech->section = EFFECT_TECHNIQUE;
+		tech->effect = effect;
+		if (!tech->name)
+			return false;
+
+		num_passes = read_count(r);
+		da_resize(tech->passes, num_passes);
+
+		for (size_t j = 0; j < num_passes; j++) {
+			struct gs_effect_pass *pass = tech->passes.array + j;
+
+			pass->name = read_str(r);
+			pass->section = EFFECT_PASS;
+			if (r->error)
+				return false;
+
+			if (!read_shader(r, effect, tech->name, j,
+					 GS_SHADER_VERTEX, &pass->vertshader,
+					 &pass->vertshader_params.da))
+				return false;
+			if (!read_shader(r, effect, tech->name, j,
+					 GS_SHADER_PIXEL, &pass->pixelshader,
+					 &pass->pixelshader_params.da))
+				return false;
+		}
+	}
+
+	return !r->error;
+}
+
+gs_effect_t *effect_cache_load(uint64_t key, const char *file)
+{
+	struct cache_reader r = {0};
+	struct dstr path = {0};
+	gs_effect_t *effect = NULL;
+
+	if (!get_cache_file(&path, key))
+		return NULL;
+
+	if (!file_input_serializer_init(&r.s, path.array))
+		goto exit;
+
+	effect = bzalloc(sizeof(struct gs_effect));
+	effect->effect_path = bstrdup(file);
+
+	if (!read_effect(&r, effect, key)) {
+		blog(LOG_DEBUG, "effect cache: discarding stale entry '%s'",
+		     path.array);
+		gs_effect_actually_destroy(effect);
+		effect = NULL;
+	}
+
+	file_input_serializer_free(&r.s);
+
+exit:
+	dstr_free(&path);
+	return effect;
+}
@@ -0,0 +1,46 @@
+/******************************************************************************
+    Copyright (C) 2021 by the OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "effect.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Persistent effect cache.  Once an effect has been parsed, its compiled
+ * structure (parameters, default values, annotations, techniques and passes)
+ * and the shader text generated for each pass are written to disk, keyed by
+ * a hash of the effect text, its file name and the graphics preprocessor.
+ * Later loads rebuild the effect straight from that data and skip the
+ * lexer/effect parser entirely.  Included files are recorded along with
+ * their own content hash so that editing an include invalidates the entry.
+ */
+
+extern uint64_t effect_cache_key(const char *effect_string, const char *file);
+
+/* returns a fully built effect on a cache hit, NULL otherwise */
+extern gs_effect_t *effect_cache_load(uint64_t key, const char *file);
+
+extern void effect_cache_save(uint64_t key, const struct effect_parser *ep,
+			      const gs_effect_t *effect);
+
+#ifdef __cplusplus
+}
+#endif
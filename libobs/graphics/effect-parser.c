@@ -67,6 +67,8 @@ void ep_free(struct effect_parser *ep)
 		ep_sampler_free(ep->samplers.array + i);
 	for (i = 0; i < ep->techniques.num; i++)
 		ep_technique_free(ep->techniques.array + i);
+	for (i = 0; i < ep->shader_texts.num; i++)
+		dstr_free(ep->shader_texts.array + i);
 
 	ep->cur_pass = NULL;
 	cf_parser_free(&ep->cfp);
@@ -75,6 +77,7 @@ void ep_free(struct effect_parser *ep)
 	da_free(ep->funcs);
 	da_free(ep->samplers);
 	da_free(ep->techniques);
+	da_free(ep->shader_texts);
 }
 
 static inline struct ep_func *ep_getfunc(struct effect_parser *ep,
@@ -1991,7 +1994,9 @@ static inline bool ep_compile_pass_shader(struct effect_parser *ep,
 	dstr_free(&location);
 	dstr_array_free(used_params.array, used_params.num);
 	darray_free(&used_params);
-	dstr_free(&shader_str);
+
+	/* ownership of the shader string goes to the parser */
+	da_push_back(ep->shader_texts, &shader_str);
 
 	return success;
 }
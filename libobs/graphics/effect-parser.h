@@ -265,6 +265,10 @@ struct effect_parser {
 	DARRAY(struct ep_sampler) samplers;
 	DARRAY(struct ep_technique) techniques;
 
+	/* generated shader text for each pass (vertex, then pixel), in
+	 * technique/pass order; kept so the effect cache can store it */
+	DARRAY(struct dstr) shader_texts;
+
 	/* internal vars */
 	DARRAY(struct cf_lexer) files;
 	DARRAY(struct cf_token) tokens;
@@ -280,6 +284,7 @@ static inline void ep_init(struct effect_parser *ep)
 	da_init(ep->funcs);
 	da_init(ep->samplers);
 	da_init(ep->techniques);
+	da_init(ep->shader_texts);
 	da_init(ep->files);
 	da_init(ep->tokens);
 
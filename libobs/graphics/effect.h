@@ -163,6 +163,10 @@ struct gs_effect {
 
 	struct gs_effect *next;
 
+	/* in-memory lookup by path, see find_cached_effect */
+	uint64_t path_hash;
+	struct gs_effect *hash_next;
+
 	size_t loop_pass;
 	bool looping;
 };
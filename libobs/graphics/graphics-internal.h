@@ -326,6 +326,8 @@ struct blend_state {
 	enum gs_blend_type dest_a;
 };
 
+#define GS_EFFECT_TABLE_SIZE 256
+
 struct graphics_subsystem {
 	void *module;
 	gs_device_t *device;
@@ -351,6 +353,7 @@ struct graphics_subsystem {
 
 	pthread_mutex_t effect_mutex;
 	struct gs_effect *first_effect;
+	struct gs_effect *effect_table[GS_EFFECT_TABLE_SIZE];
 
 	pthread_mutex_t mutex;
 	volatile long ref;
@@ -20,12 +20,14 @@
 #include "../util/base.h"
 #include "../util/bmem.h"
 #include "../util/platform.h"
+#include "../util/hash.h"
 #include "graphics-internal.h"
 #include "vec2.h"
 #include "vec3.h"
 #include "quat.h"
 #include "axisang.h"
 #include "effect-parser.h"
+#include "effect-cache.h"
 #include "effect.h"
 
 static THREAD_LOCAL graphics_t *thread_graphics = NULL;
@@ -784,17 +786,42 @@ gs_effect_t *gs_get_effect(void)
 
 static inline struct gs_effect *find_cached_effect(const char *filename)
 {
-	struct gs_effect *effect = thread_graphics->first_effect;
+	uint64_t hash = hash_fnv1a64_str(filename);
+	struct gs_effect *effect;
 
+	pthread_mutex_lock(&thread_graphics->effect_mutex);
+
+	effect = thread_graphics->effect_table[hash % GS_EFFECT_TABLE_SIZE];
 	while (effect) {
-		if (strcmp(effect->effect_path, filename) == 0)
+		if (effect->path_hash == hash &&
+		    strcmp(effect->effect_path, filename) == 0)
 			break;
-		effect = effect->next;
+		effect = effect->hash_next;
 	}
 
+	pthread_mutex_unlock(&thread_graphics->effect_mutex);
 	return effect;
 }
 
+static void add_cached_effect(struct gs_effect *effect)
+{
+	struct gs_effect **bucket;
+
+	pthread_mutex_lock(&thread_graphics->effect_mutex);
+
+	effect->cached = true;
+	effect->next = thread_graphics->first_effect;
+	thread_graphics->first_effect = effect;
+
+	effect->path_hash = hash_fnv1a64_str(effect->effect_path);
+	bucket = &thread_graphics->effect_table[effect->path_hash %
+						GS_EFFECT_TABLE_SIZE];
+	effect->hash_next = *bucket;
+	*bucket = effect;
+
+	pthread_mutex_unlock(&thread_graphics->effect_mutex);
+}
+
 gs_effect_t *gs_effect_create_from_file(const char *file, char **error_string)
 {
 	char *file_string;
@@ -825,10 +852,19 @@ gs_effect_t *gs_effect_create(const char *effect_string, const char *filename,
 	if (!gs_valid_p("gs_effect_create", effect_string))
 		return NULL;
 
-	struct gs_effect *effect = bzalloc(sizeof(struct gs_effect));
+	uint64_t cache_key = effect_cache_key(effect_string, filename);
+	struct gs_effect *effect = effect_cache_load(cache_key, filename);
 	struct effect_parser parser;
 	bool success;
 
+	if (effect) {
+		effect->graphics = thread_graphics;
+		if (effect->effect_path)
+			add_cached_effect(effect);
+		return effect;
+	}
+
+	effect = bzalloc(sizeof(struct gs_effect));
 	effect->graphics = thread_graphics;
 	effect->effect_path = bstrdup(filename);
 
@@ -843,15 +879,10 @@ gs_effect_t *gs_effect_create(const char *effect_string, const char *filename,
 	}
 
 	if (effect) {
-		pthread_mutex_lock(&thread_graphics->effect_mutex);
-
-		if (effect->effect_path) {
-			effect->cached = true;
-			effect->next = thread_graphics->first_effect;
-			thread_graphics->first_effect = effect;
-		}
+		effect_cache_save(cache_key, &parser, effect);
 
-		pthread_mutex_unlock(&thread_graphics->effect_mutex);
+		if (effect->effect_path)
+			add_cached_effect(effect);
 	}
 
 	ep_free(&parser);
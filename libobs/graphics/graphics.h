@@ -542,6 +542,14 @@ EXPORT gs_effect_t *gs_get_effect(void);
 
 EXPORT gs_effect_t *gs_effect_create_from_file(const char *file,
 					       char **error_string);
+
+/**
+ * Sets the directory used to persist compiled effects between runs.  When
+ * set, parsed effects are stored there keyed by their content so that later
+ * loads can skip parsing.  Pass NULL to disable the on-disk cache.
+ */
+EXPORT void gs_effect_cache_set_path(const char *path);
+
 EXPORT gs_effect_t *gs_effect_create(const char *effect_string,
 				     const char *filename, char **error_string);
 
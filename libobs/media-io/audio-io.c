@@ -68,6 +68,7 @@ struct audio_output {
 
 	audio_input_callback_t input_cb;
 	void *input_param;
+	bool catch_up;
 	pthread_mutex_t input_mutex;
 	struct audio_mix mixes[MAX_AUDIO_MIXES];
 };
@@ -227,6 +228,13 @@ static void *audio_thread(void *param)
 
 			input_and_output(audio, audio_time, prev_time);
 			prev_time = audio_time;
+
+			/* the input fell behind on purpose, let it render its
+			 * next buffered tick without waiting for the clock */
+			while (audio->catch_up) {
+				audio->catch_up = false;
+				input_and_output(audio, audio_time, audio_time);
+			}
 		}
 
 		profile_end(audio_thread_name);
@@ -417,6 +425,12 @@ void audio_output_close(audio_t *audio)
 	bfree(audio);
 }
 
+void audio_output_request_catch_up(audio_t *audio)
+{
+	if (audio)
+		audio->catch_up = true;
+}
+
 const struct audio_output_info *audio_output_get_info(const audio_t *audio)
 {
 	return audio ? &audio->info : NULL;
@@ -229,6 +229,13 @@ EXPORT uint32_t audio_output_get_sample_rate(const audio_t *audio);
 EXPORT const struct audio_output_info *
 audio_output_get_info(const audio_t *audio);
 
+/**
+ * Makes the audio thread call the input callback once more right after the
+ * current call returns, without a new time range (start_ts == end_ts).  Only
+ * valid from within the input callback.
+ */
+EXPORT void audio_output_request_catch_up(audio_t *audio);
+
 #ifdef __cplusplus
 }
 #endif
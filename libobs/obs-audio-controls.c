@@ -78,8 +78,19 @@ struct obs_volmeter {
 
 	float magnitude[MAX_AUDIO_CHANNELS];
 	float peak[MAX_AUDIO_CHANNELS];
+
+	/* levels accumulated for obs_volmeter_get_levels, in dB, protected by
+	 * levels_mutex */
+	uint64_t levels_ts;
+	float levels_magnitude[MAX_AUDIO_CHANNELS];
+	float levels_peak[MAX_AUDIO_CHANNELS];
+	float levels_input_peak[MAX_AUDIO_CHANNELS];
 };
 
+/* shared by all volume meters, so that obs_volmeters_get_levels can take
+ * the levels of every meter with a single lock */
+static pthread_mutex_t levels_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static float cubic_def_to_db(const float def)
 {
 	if (def == 1.0f)
@@ -519,6 +530,17 @@ static void volmeter_process_audio_data(obs_volmeter_t *volmeter,
 	volmeter_process_magnitude(volmeter, data, nr_channels);
 }
 
+static void volmeter_reset_levels(struct obs_volmeter *volmeter)
+{
+	volmeter->levels_ts = 0;
+	for (int channel_nr = 0; channel_nr < MAX_AUDIO_CHANNELS;
+	     channel_nr++) {
+		volmeter->levels_magnitude[channel_nr] = -INFINITY;
+		volmeter->levels_peak[channel_nr] = -INFINITY;
+		volmeter->levels_input_peak[channel_nr] = -INFINITY;
+	}
+}
+
 static void volmeter_source_data_received(void *vptr, obs_source_t *source,
 					  const struct audio_data *data,
 					  bool muted)
@@ -549,6 +571,22 @@ static void volmeter_source_data_received(void *vptr, obs_source_t *source,
 
 	pthread_mutex_unlock(&volmeter->mutex);
 
+	/* keep the highest peaks until the levels are polled, so no peak is
+	 * lost between two polls */
+	pthread_mutex_lock(&levels_mutex);
+	for (int channel_nr = 0; channel_nr < MAX_AUDIO_CHANNELS;
+	     channel_nr++) {
+		volmeter->levels_magnitude[channel_nr] = magnitude[channel_nr];
+		if (peak[channel_nr] > volmeter->levels_peak[channel_nr])
+			volmeter->levels_peak[channel_nr] = peak[channel_nr];
+		if (input_peak[channel_nr] >
+		    volmeter->levels_input_peak[channel_nr])
+			volmeter->levels_input_peak[channel_nr] =
+				input_peak[channel_nr];
+	}
+	volmeter->levels_ts = os_gettime_ns();
+	pthread_mutex_unlock(&levels_mutex);
+
 	signal_levels_updated(volmeter, magnitude, peak, input_peak);
 
 	UNUSED_PARAMETER(source);
@@ -782,6 +820,7 @@ obs_volmeter_t *obs_volmeter_create(enum obs_fader_type type)
 		goto fail;
 
 	volmeter->type = type;
+	volmeter_reset_levels(volmeter);
 
 	obs_volmeter_set_update_interval(volmeter, 50);
 
@@ -911,6 +950,63 @@ int obs_volmeter_get_nr_channels(obs_volmeter_t *volmeter)
 	return CLAMP(source_nr_audio_channels, 1, obs_nr_audio_channels);
 }
 
+/* called with levels_mutex held */
+static uint64_t take_levels(struct obs_volmeter *volmeter,
+			    float magnitude[MAX_AUDIO_CHANNELS],
+			    float peak[MAX_AUDIO_CHANNELS],
+			    float input_peak[MAX_AUDIO_CHANNELS])
+{
+	uint64_t ts = volmeter->levels_ts;
+
+	if (ts) {
+		memcpy(magnitude, volmeter->levels_magnitude,
+		       sizeof(volmeter->levels_magnitude));
+		memcpy(peak, volmeter->levels_peak,
+		       sizeof(volmeter->levels_peak));
+		memcpy(input_peak, volmeter->levels_input_peak,
+		       sizeof(volmeter->levels_input_peak));
+		volmeter_reset_levels(volmeter);
+	}
+
+	return ts;
+}
+
+uint64_t obs_volmeter_get_levels(obs_volmeter_t *volmeter,
+				 float magnitude[MAX_AUDIO_CHANNELS],
+				 float peak[MAX_AUDIO_CHANNELS],
+				 float input_peak[MAX_AUDIO_CHANNELS])
+{
+	uint64_t ts;
+
+	if (!volmeter)
+		return 0;
+
+	pthread_mutex_lock(&levels_mutex);
+	ts = take_levels(volmeter, magnitude, peak, input_peak);
+	pthread_mutex_unlock(&levels_mutex);
+	return ts;
+}
+
+void obs_volmeters_get_levels(struct obs_volmeter_levels *levels,
+			      size_t count)
+{
+	if (!levels)
+		return;
+
+	pthread_mutex_lock(&levels_mutex);
+
+	for (size_t i = 0; i < count; i++) {
+		struct obs_volmeter_levels *cur = levels + i;
+
+		cur->ts = cur->volmeter ? take_levels(cur->volmeter,
+						      cur->magnitude, cur->peak,
+						      cur->input_peak)
+					: 0;
+	}
+
+	pthread_mutex_unlock(&levels_mutex);
+}
+
 void obs_volmeter_add_callback(obs_volmeter_t *volmeter,
 			       obs_volmeter_updated_t callback, void *param)
 {
@@ -265,6 +265,45 @@ EXPORT unsigned int obs_volmeter_get_update_interval(obs_volmeter_t *volmeter);
  */
 EXPORT int obs_volmeter_get_nr_channels(obs_volmeter_t *volmeter);
 
+/**
+ * @brief Get the levels received since the previous call
+ *
+ * Allows polling the meter once per display refresh instead of receiving a
+ * callback for every audio block.  The magnitude is the most recent one, the
+ * peaks are the highest ones since the previous call.  The arrays are left
+ * untouched if no audio was received since the previous call.
+ *
+ * @param volmeter pointer to the volume meter object
+ * @return time (os_gettime_ns) the last levels were received at, or 0 if
+ *         there are no new levels
+ */
+EXPORT uint64_t obs_volmeter_get_levels(obs_volmeter_t *volmeter,
+					float magnitude[MAX_AUDIO_CHANNELS],
+					float peak[MAX_AUDIO_CHANNELS],
+					float input_peak[MAX_AUDIO_CHANNELS]);
+
+struct obs_volmeter_levels {
+	obs_volmeter_t *volmeter;
+
+	/* set by obs_volmeters_get_levels, as by obs_volmeter_get_levels */
+	uint64_t ts;
+	float magnitude[MAX_AUDIO_CHANNELS];
+	float peak[MAX_AUDIO_CHANNELS];
+	float input_peak[MAX_AUDIO_CHANNELS];
+};
+
+/**
+ * @brief Get the levels of several volume meters at once
+ *
+ * Same as calling obs_volmeter_get_levels for the volmeter of each entry,
+ * but takes the lock shared by all volume meters only once.
+ *
+ * @param levels array of entries with the volmeter set
+ * @param count number of entries
+ */
+EXPORT void obs_volmeters_get_levels(struct obs_volmeter_levels *levels,
+				     size_t count);
+
 typedef void (*obs_volmeter_updated_t)(
 	void *param, const float magnitude[MAX_AUDIO_CHANNELS],
 	const float peak[MAX_AUDIO_CHANNELS],
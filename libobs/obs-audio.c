@@ -25,7 +25,6 @@ struct ts_info {
 };
 
 #define DEBUG_AUDIO 0
-#define MAX_BUFFERING_TICKS 45
 
 static void push_audio_tree(obs_source_t *parent, obs_source_t *source, void *p)
 {
@@ -230,6 +229,38 @@ static inline void discard_audio(struct obs_core_audio *audio,
 	source->audio_ts = ts->end;
 }
 
+static inline uint32_t ticks_to_ms(int ticks, size_t sample_rate)
+{
+	return (uint32_t)((size_t)ticks * AUDIO_OUTPUT_FRAMES * 1000 /
+			  sample_rate);
+}
+
+static void record_buffering_change(struct obs_core_audio *audio,
+				    size_t sample_rate, bool grew)
+{
+	struct obs_audio_buffering_change *change;
+
+	pthread_mutex_lock(&audio->buffering_mutex);
+
+	change = &audio->buffering_history[audio->buffering_history_pos];
+	change->timestamp = os_gettime_ns();
+	change->ticks = (uint32_t)audio->total_buffering_ticks;
+	change->ms = ticks_to_ms(audio->total_buffering_ticks, sample_rate);
+	change->grew = grew;
+
+	if (++audio->buffering_history_pos == OBS_AUDIO_BUFFERING_HISTORY)
+		audio->buffering_history_pos = 0;
+	if (audio->buffering_history_num < OBS_AUDIO_BUFFERING_HISTORY)
+		audio->buffering_history_num++;
+
+	pthread_mutex_unlock(&audio->buffering_mutex);
+}
+
+static inline int ticks_per_slot(size_t sample_rate)
+{
+	return (int)(sample_rate / AUDIO_OUTPUT_FRAMES);
+}
+
 static void add_audio_buffering(struct obs_core_audio *audio,
 				size_t sample_rate, struct ts_info *ts,
 				uint64_t min_ts, const char *buffering_name)
@@ -251,6 +282,9 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 	frames = ns_to_audio_frames(sample_rate, offset);
 	ticks = (int)((frames + AUDIO_OUTPUT_FRAMES - 1) / AUDIO_OUTPUT_FRAMES);
 
+	/* only written by the audio thread, but read by
+	 * obs_get_audio_buffering_info from others */
+	pthread_mutex_lock(&audio->buffering_mutex);
 	audio->total_buffering_ticks += ticks;
 
 	if (audio->total_buffering_ticks >= MAX_BUFFERING_TICKS) {
@@ -258,6 +292,7 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 		audio->total_buffering_ticks = MAX_BUFFERING_TICKS;
 		blog(LOG_WARNING, "Max audio buffering reached!");
 	}
+	pthread_mutex_unlock(&audio->buffering_mutex);
 
 	ms = ticks * AUDIO_OUTPUT_FRAMES * 1000 / sample_rate;
 	total_ms = audio->total_buffering_ticks * AUDIO_OUTPUT_FRAMES * 1000 /
@@ -268,6 +303,12 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 	     "audio buffering is now %d milliseconds"
 	     " (source: %s)\n",
 	     (int)ms, (int)total_ms, buffering_name);
+
+	/* give the lateness that caused this a full window before any of
+	 * the buffering can be given back */
+	audio->buffering_hold_ticks =
+		ticks_per_slot(sample_rate) * AUDIO_LATENESS_WINDOW_SLOTS;
+	record_buffering_change(audio, sample_rate, true);
 #if DEBUG_AUDIO == 1
 	blog(LOG_DEBUG,
 	     "min_ts (%" PRIu64 ") < start timestamp "
@@ -303,6 +344,88 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 	*ts = new_ts;
 }
 
+/* how many ticks of buffering the source needs right now: its newest audio
+ * has to be in before the tick that contains it gets mixed */
+static int source_late_ticks(struct obs_source *source, size_t sample_rate,
+			     uint64_t now_ts)
+{
+	size_t frames = source->audio_input_buf[0].size / sizeof(float);
+	uint64_t data_end;
+	uint64_t late;
+
+	if (source->info.audio_render || !source->audio_ts || !frames)
+		return 0;
+
+	data_end = source->audio_ts + audio_frames_to_ns(sample_rate, frames);
+	if (data_end >= now_ts)
+		return 0;
+
+	late = ns_to_audio_frames(sample_rate, now_ts - data_end);
+	return (int)((late + AUDIO_OUTPUT_FRAMES - 1) / AUDIO_OUTPUT_FRAMES);
+}
+
+static void remove_audio_buffering(struct obs_core_audio *audio,
+				   size_t sample_rate)
+{
+	pthread_mutex_lock(&audio->buffering_mutex);
+	audio->total_buffering_ticks--;
+	pthread_mutex_unlock(&audio->buffering_mutex);
+
+	/* the queued timestamps stay contiguous, so instead of dropping a
+	 * tick, the next one is rendered right away to catch up */
+	audio->catching_up = true;
+	audio_output_request_catch_up(audio->audio);
+
+	blog(LOG_INFO,
+	     "removing %d milliseconds of audio buffering, total "
+	     "audio buffering is now %d milliseconds",
+	     (int)ticks_to_ms(1, sample_rate),
+	     (int)ticks_to_ms(audio->total_buffering_ticks, sample_rate));
+
+	record_buffering_change(audio, sample_rate, false);
+}
+
+static void update_adaptive_buffering(struct obs_core_audio *audio,
+				      size_t sample_rate, int late_ticks)
+{
+	int slot_ticks = ticks_per_slot(sample_rate);
+	int *slot = &audio->lateness_window[audio->lateness_slot];
+	int peak = 0;
+
+	if (late_ticks > *slot)
+		*slot = late_ticks;
+
+	if (++audio->lateness_slot_ticks < slot_ticks)
+		return;
+
+	for (size_t i = 0; i < AUDIO_LATENESS_WINDOW_SLOTS; i++) {
+		if (audio->lateness_window[i] > peak)
+			peak = audio->lateness_window[i];
+	}
+
+	audio->lateness_slot_ticks = 0;
+	audio->lateness_slot =
+		(audio->lateness_slot + 1) % AUDIO_LATENESS_WINDOW_SLOTS;
+	audio->lateness_window[audio->lateness_slot] = 0;
+	pthread_mutex_lock(&audio->buffering_mutex);
+	audio->window_peak_ticks = peak;
+	pthread_mutex_unlock(&audio->buffering_mutex);
+
+	if (audio->buffering_hold_ticks > 0) {
+		audio->buffering_hold_ticks -= slot_ticks;
+		return;
+	}
+
+	if (!os_atomic_load_bool(&audio->adaptive_buffering) ||
+	    audio->buffering_wait_ticks)
+		return;
+
+	/* keep a spare tick above the worst lateness in the window, and only
+	 * give back one tick per slot */
+	if (audio->total_buffering_ticks > peak + 1)
+		remove_audio_buffering(audio, sample_rate);
+}
+
 static bool audio_buffer_insuffient(struct obs_source *source,
 				    size_t sample_rate, uint64_t min_ts)
 {
@@ -380,6 +503,8 @@ static inline void release_audio_sources(struct obs_core_audio *audio)
 		obs_source_release(audio->render_order.array[i]);
 }
 
+static const char *render_audio_name = "render_audio";
+static const char *mix_audio_name = "mix_audio";
 bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 		    uint64_t *out_ts, uint32_t mixers,
 		    struct audio_output_data *mixes)
@@ -390,13 +515,20 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 	size_t sample_rate = audio_output_get_sample_rate(audio->audio);
 	size_t channels = audio_output_get_channels(audio->audio);
 	struct ts_info ts = {start_ts_in, end_ts_in};
+	bool catching_up = audio->catching_up;
 	size_t audio_size;
 	uint64_t min_ts;
+	int late_ticks = 0;
 
 	da_resize(audio->render_order, 0);
 	da_resize(audio->root_nodes, 0);
 
-	circlebuf_push_back(&audio->buffered_timestamps, &ts, sizeof(ts));
+	/* a catch-up call renders the next buffered tick without a new one */
+	if (catching_up)
+		audio->catching_up = false;
+	else
+		circlebuf_push_back(&audio->buffered_timestamps, &ts,
+				    sizeof(ts));
 	circlebuf_peek_front(&audio->buffered_timestamps, &ts, sizeof(ts));
 	min_ts = ts.start;
 
@@ -432,11 +564,13 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 
 	/* ------------------------------------------------ */
 	/* render audio data */
+	profile_start(render_audio_name);
 	for (size_t i = 0; i < audio->render_order.num; i++) {
 		obs_source_t *source = audio->render_order.array[i];
 		obs_source_audio_render(source, mixers, channels, sample_rate,
 					audio_size);
 	}
+	profile_end(render_audio_name);
 
 	/* ------------------------------------------------ */
 	/* get minimum audio timestamp */
@@ -452,6 +586,7 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 
 	/* ------------------------------------------------ */
 	/* mix audio */
+	profile_start(mix_audio_name);
 	if (!audio->buffering_wait_ticks) {
 		for (size_t i = 0; i < audio->root_nodes.num; i++) {
 			obs_source_t *source = audio->root_nodes.array[i];
@@ -468,6 +603,9 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 			pthread_mutex_unlock(&source->audio_buf_mutex);
 		}
 	}
+	profile_end(mix_audio_name);
+
+	audio_monitoring_tick();
 
 	/* ------------------------------------------------ */
 	/* discard audio */
@@ -477,6 +615,13 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 	while (source) {
 		pthread_mutex_lock(&source->audio_buf_mutex);
 		discard_audio(audio, source, channels, sample_rate, &ts);
+
+		if (!catching_up) {
+			int ticks = source_late_ticks(source, sample_rate,
+						      end_ts_in);
+			if (ticks > late_ticks)
+				late_ticks = ticks;
+		}
 		pthread_mutex_unlock(&source->audio_buf_mutex);
 
 		source = (struct obs_source *)source->next_audio_source;
@@ -490,6 +635,9 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 
 	circlebuf_pop_front(&audio->buffered_timestamps, NULL, sizeof(ts));
 
+	if (!catching_up)
+		update_adaptive_buffering(audio, sample_rate, late_ticks);
+
 	*out_ts = ts.start;
 
 	if (audio->buffering_wait_ticks) {
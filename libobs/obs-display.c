@@ -16,9 +16,12 @@
 ******************************************************************************/
 
 #include "graphics/vec4.h"
+#include "util/profiler.h"
 #include "obs.h"
 #include "obs-internal.h"
 
+static volatile long display_count = 0;
+
 bool obs_display_init(struct obs_display *display,
 		      const struct gs_init_data *graphics_data)
 {
@@ -46,6 +49,10 @@ bool obs_display_init(struct obs_display *display,
 		return false;
 	}
 
+	display->profile_name = profile_store_name(
+		obs_get_profiler_name_store(), "obs_display(%ld)",
+		os_atomic_inc_long(&display_count));
+
 	display->enabled = true;
 	return true;
 }
@@ -82,6 +89,8 @@ void obs_display_free(obs_display_t *display)
 	pthread_mutex_destroy(&display->draw_callbacks_mutex);
 	pthread_mutex_destroy(&display->draw_info_mutex);
 	da_free(display->draw_callbacks);
+	obs_weak_source_release(display->source);
+	display->source = NULL;
 
 	if (display->swap) {
 		gs_swapchain_destroy(display->swap);
@@ -117,6 +126,7 @@ void obs_display_resize(obs_display_t *display, uint32_t cx, uint32_t cy)
 	display->cx = cx;
 	display->cy = cy;
 	display->size_changed = true;
+	display->redraw = true;
 
 	pthread_mutex_unlock(&display->draw_info_mutex);
 }
@@ -183,14 +193,17 @@ static inline void render_display_end()
 	gs_end_scene();
 }
 
-void render_display(struct obs_display *display)
+void render_display(struct obs_display *display, uint64_t ts)
 {
+	uint64_t start = os_gettime_ns();
+	uint64_t elapsed;
 	uint32_t cx, cy;
 	bool size_changed;
 
 	if (!display || !display->enabled)
 		return;
 
+	profile_start(display->profile_name);
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_DISPLAY, "obs_display");
 
 	/* -------------------------------------------- */
@@ -226,12 +239,189 @@ void render_display(struct obs_display *display)
 	GS_DEBUG_MARKER_END();
 
 	gs_present();
+
+	profile_end(display->profile_name);
+
+	/* the first render also creates the swap chain and such, don't let
+	 * it count for more than half a frame */
+	elapsed = os_gettime_ns() - start;
+	if (!display->rendered &&
+	    elapsed > obs->video.video_frame_interval_ns / 2)
+		elapsed = obs->video.video_frame_interval_ns / 2;
+
+	display->render_ns = display->rendered
+				     ? (display->render_ns * 7 + elapsed) / 8
+				     : elapsed;
+	display->last_render_ts = ts;
+	display->rendered = true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct content_check {
+	long serial;
+	bool dynamic;
+};
+
+static void check_content(struct content_check *check, obs_source_t *source)
+{
+	uint32_t flags = source->info.output_flags;
+
+	check->serial += os_atomic_load_long(&source->content_serial);
+
+	/* there is no way of knowing whether a synchronous source renders
+	 * something different each frame, so any that ticks is assumed to */
+	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION) {
+		if (source->transitioning_video)
+			check->dynamic = true;
+	} else if ((flags & OBS_SOURCE_VIDEO) != 0 &&
+		   (flags & (OBS_SOURCE_ASYNC | OBS_SOURCE_COMPOSITE)) == 0 &&
+		   source->info.video_tick) {
+		check->dynamic = true;
+	}
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++) {
+		obs_source_t *filter = source->filters.array[i];
+
+		check->serial += os_atomic_load_long(&filter->content_serial);
+		if (filter->enabled && filter->info.video_tick)
+			check->dynamic = true;
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+}
+
+static void check_content_tree(obs_source_t *parent, obs_source_t *child,
+			       void *param)
+{
+	check_content(param, child);
+	UNUSED_PARAMETER(parent);
+}
+
+/* returns true if the source's content may have changed since the last time
+ * this was called for the display */
+static bool display_source_changed(struct obs_display *display,
+				   obs_weak_source_t *weak)
+{
+	obs_source_t *source = obs_weak_source_get_source(weak);
+	struct content_check check = {0};
+
+	if (!source)
+		return false;
+
+	check_content(&check, source);
+	obs_source_enum_active_tree(source, check_content_tree, &check);
+	obs_source_release(source);
+
+	if (check.dynamic || check.serial != display->last_serial) {
+		display->last_serial = check.serial;
+		return true;
+	}
+
+	return false;
+}
+
+bool render_display_needed(struct obs_display *display, uint64_t ts)
+{
+	obs_weak_source_t *weak = NULL;
+	uint64_t min_interval;
+	bool on_demand;
+	bool changed;
+
+	if (!display->enabled)
+		return false;
+
+	pthread_mutex_lock(&display->draw_info_mutex);
+	min_interval = display->min_interval_ns;
+	on_demand = display->on_demand;
+	if (on_demand && display->source) {
+		weak = display->source;
+		obs_weak_source_addref(weak);
+	}
+	pthread_mutex_unlock(&display->draw_info_mutex);
+
+	/* allow half a frame of jitter so that a display limited to the
+	 * canvas frame rate, or an integer fraction of it, doesn't miss
+	 * frames */
+	if (display->rendered && min_interval) {
+		uint64_t half_frame = obs->video.video_frame_interval_ns / 2;
+
+		if (ts - display->last_render_ts + half_frame < min_interval)
+			return false;
+	}
+
+	changed = !on_demand || !display->rendered;
+	if (os_atomic_set_bool(&display->redraw, false))
+		changed = true;
+	if (weak) {
+		if (display_source_changed(display, weak))
+			changed = true;
+		obs_weak_source_release(weak);
+	}
+
+	return changed;
 }
 
 void obs_display_set_enabled(obs_display_t *display, bool enable)
 {
-	if (display)
+	if (display) {
 		display->enabled = enable;
+		display->redraw = true;
+	}
+}
+
+void obs_display_set_max_fps(obs_display_t *display, uint32_t fps)
+{
+	if (!display)
+		return;
+
+	pthread_mutex_lock(&display->draw_info_mutex);
+	display->min_interval_ns = fps ? 1000000000ULL / fps : 0;
+	pthread_mutex_unlock(&display->draw_info_mutex);
+}
+
+void obs_display_set_on_demand(obs_display_t *display, bool on_demand)
+{
+	if (!display)
+		return;
+
+	pthread_mutex_lock(&display->draw_info_mutex);
+	display->on_demand = on_demand;
+	display->redraw = true;
+	pthread_mutex_unlock(&display->draw_info_mutex);
+}
+
+void obs_display_set_source(obs_display_t *display, obs_source_t *source)
+{
+	obs_weak_source_t *prev;
+
+	if (!display)
+		return;
+
+	pthread_mutex_lock(&display->draw_info_mutex);
+	prev = display->source;
+	display->source = obs_source_get_weak_source(source);
+	display->redraw = true;
+	pthread_mutex_unlock(&display->draw_info_mutex);
+
+	obs_weak_source_release(prev);
+}
+
+void obs_display_set_skip_when_late(obs_display_t *display, bool skip)
+{
+	if (display)
+		os_atomic_set_bool(&display->skip_when_late, skip);
+}
+
+void obs_display_request_redraw(obs_display_t *display)
+{
+	if (display)
+		os_atomic_set_bool(&display->redraw, true);
+}
+
+uint64_t obs_display_get_skipped_frames(obs_display_t *display)
+{
+	return display ? display->skipped_frames : 0;
 }
 
 bool obs_display_enabled(obs_display_t *display)
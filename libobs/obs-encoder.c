@@ -23,7 +23,7 @@
 #define set_encoder_active(encoder, val) \
 	os_atomic_set_bool(&encoder->active, val)
 
-struct obs_encoder_info *find_encoder(const char *id)
+static struct obs_encoder_info *find_encoder_info(const char *id)
 {
 	for (size_t i = 0; i < obs->encoder_types.num; i++) {
 		struct obs_encoder_info *info = obs->encoder_types.array + i;
@@ -35,6 +35,23 @@ struct obs_encoder_info *find_encoder(const char *id)
 	return NULL;
 }
 
+struct obs_encoder_info *find_encoder(const char *id)
+{
+	struct obs_encoder_info *info;
+
+	pthread_mutex_lock(&obs->types_mutex);
+	info = find_encoder_info(id);
+	pthread_mutex_unlock(&obs->types_mutex);
+
+	if (!info && obs_load_pending_module(id)) {
+		pthread_mutex_lock(&obs->types_mutex);
+		info = find_encoder_info(id);
+		pthread_mutex_unlock(&obs->types_mutex);
+	}
+
+	return info;
+}
+
 const char *obs_encoder_get_display_name(const char *id)
 {
 	struct obs_encoder_info *ei = find_encoder(id);
@@ -190,10 +207,11 @@ static inline bool has_scaling(const struct obs_encoder *encoder)
 		video_height != encoder->scaled_height);
 }
 
+/* texture-based encoding is only available on the main mix */
 static inline bool gpu_encode_available(const struct obs_encoder *encoder)
 {
 	return (encoder->info.caps & OBS_ENCODER_CAP_PASS_TEXTURE) != 0 &&
-	       obs->video.using_nv12_tex;
+	       obs_nv12_tex_active() && encoder->media == obs_get_video();
 }
 
 static void add_connection(struct obs_encoder *encoder)
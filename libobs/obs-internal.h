@@ -80,6 +80,23 @@ static inline bool obs_object_valid(const void *obj, const char *f,
 /* ------------------------------------------------------------------------- */
 /* modules */
 
+enum obs_type_kind {
+	OBS_TYPE_SCENE,
+	OBS_TYPE_INPUT,
+	OBS_TYPE_FILTER,
+	OBS_TYPE_TRANSITION,
+	OBS_TYPE_OUTPUT,
+	OBS_TYPE_ENCODER,
+	OBS_TYPE_SERVICE,
+};
+
+struct obs_type_id {
+	enum obs_type_kind kind;
+	char *id;
+	char *unversioned_id;
+	uint32_t version;
+};
+
 struct obs_module {
 	char *mod_name;
 	const char *file;
@@ -101,10 +118,26 @@ struct obs_module {
 	const char *(*description)(void);
 	const char *(*author)(void);
 
+	/* load time breakdown, logged by obs_load_all_modules */
+	uint64_t open_time_ns;
+	uint64_t locale_time_ns;
+	uint64_t load_time_ns;
+
+	/* types registered by the module; used by lazy loading to defer
+	 * obs_module_load until one of them is requested.  protected by
+	 * obs->types_mutex */
+	DARRAY(struct obs_type_id) types;
+	bool load_pending;
+
 	struct obs_module *next;
 };
 
 extern void free_module(struct obs_module *mod);
+extern void obs_add_type_id(enum obs_type_kind kind, const char *id,
+			    const char *unversioned_id, uint32_t version);
+extern void obs_register_type(struct darray *array, size_t element_size,
+			      const void *info);
+extern bool obs_load_pending_module(const char *id);
 
 struct obs_module_path {
 	char *bin;
@@ -210,10 +243,30 @@ struct obs_display {
 	pthread_mutex_t draw_info_mutex;
 	DARRAY(struct draw_callback) draw_callbacks;
 
+	/* frame rate limit and on-demand rendering, protected by
+	 * draw_info_mutex */
+	uint64_t min_interval_ns;
+	bool on_demand;
+	obs_weak_source_t *source;
+
+	/* only touched by the graphics thread */
+	uint64_t last_render_ts;
+	uint64_t render_ns;
+	long last_serial;
+	bool rendered;
+	uint64_t skipped_frames;
+	uint32_t consecutive_skips;
+
+	volatile bool redraw;
+	volatile bool skip_when_late;
+	const char *profile_name;
+
 	struct obs_display *next;
 	struct obs_display **prev_next;
 };
 
+extern bool render_display_needed(struct obs_display *display, uint64_t ts);
+
 extern bool obs_display_init(struct obs_display *display,
 			     const struct gs_init_data *graphics_data);
 extern void obs_display_free(struct obs_display *display);
@@ -241,8 +294,17 @@ struct obs_task_info {
 	void *param;
 };
 
-struct obs_core_video {
-	graphics_t *graphics;
+/* a canvas: the view rendered at its own resolution and frame rate into its
+ * own video output.  the main mix renders the main view at the rate of the
+ * graphics thread, additional mixes are rendered on the graphics thread
+ * ticks closest to their own frame times, so sources are still ticked and
+ * their async frames uploaded once per tick no matter how many mixes show
+ * them */
+struct obs_core_video_mix {
+	struct obs_view *view;
+	video_t *video;
+	struct obs_video_info ovi;
+
 	gs_stagesurf_t *copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
 	gs_texture_t *render_texture;
 	gs_texture_t *output_texture;
@@ -252,6 +314,36 @@ struct obs_core_video {
 	bool texture_converted;
 	bool using_nv12_tex;
 	struct circlebuf vframe_info_buffer;
+	gs_stagesurf_t *mapped_surfaces[NUM_CHANNELS];
+	int cur_texture;
+	volatile long raw_active;
+	bool raw_was_active;
+	bool was_active;
+
+	bool gpu_conversion;
+	const char *conversion_techs[NUM_CHANNELS];
+	bool conversion_needed;
+	float conversion_width_i;
+
+	uint32_t output_width;
+	uint32_t output_height;
+	uint32_t base_width;
+	uint32_t base_height;
+	float color_matrix[16];
+	enum obs_scale_type scale_type;
+
+	/* only used by additional mixes */
+	uint64_t frame_interval_ns;
+	uint64_t next_frame_ts;
+};
+
+extern struct obs_core_video_mix *
+obs_create_video_mix(struct obs_view *view, struct obs_video_info *ovi,
+		     int *error);
+extern void obs_free_video_mix(struct obs_core_video_mix *mix);
+
+struct obs_core_video {
+	graphics_t *graphics;
 	struct circlebuf vframe_info_buffer_gpu;
 	gs_effect_t *default_effect;
 	gs_effect_t *default_rect_effect;
@@ -265,9 +357,6 @@ struct obs_core_video {
 	gs_effect_t *bilinear_lowres_effect;
 	gs_effect_t *premultiplied_alpha_effect;
 	gs_samplerstate_t *point_sampler;
-	gs_stagesurf_t *mapped_surfaces[NUM_CHANNELS];
-	int cur_texture;
-	long raw_active;
 	long gpu_encoder_active;
 	pthread_mutex_t gpu_encoder_mutex;
 	struct circlebuf gpu_encoder_queue;
@@ -279,28 +368,21 @@ struct obs_core_video {
 	bool gpu_encode_thread_initialized;
 	volatile bool gpu_encode_stop;
 
+	/* the main mix is always first, texture-based encoders can only be
+	 * used with the main mix */
+	struct obs_core_video_mix *main_mix;
+	pthread_mutex_t mixes_mutex;
+	DARRAY(struct obs_core_video_mix *) mixes;
+
 	uint64_t video_time;
 	uint64_t video_frame_interval_ns;
 	uint64_t video_avg_frame_time_ns;
 	double video_fps;
-	video_t *video;
 	pthread_t video_thread;
 	uint32_t total_frames;
 	uint32_t lagged_frames;
 	bool thread_initialized;
 
-	bool gpu_conversion;
-	const char *conversion_techs[NUM_CHANNELS];
-	bool conversion_needed;
-	float conversion_width_i;
-
-	uint32_t output_width;
-	uint32_t output_height;
-	uint32_t base_width;
-	uint32_t base_height;
-	float color_matrix[16];
-	enum obs_scale_type scale_type;
-
 	gs_texture_t *transparent_texture;
 
 	gs_effect_t *deinterlace_discard_effect;
@@ -312,14 +394,22 @@ struct obs_core_video {
 	gs_effect_t *deinterlace_yadif_effect;
 	gs_effect_t *deinterlace_yadif_2x_effect;
 
-	struct obs_video_info ovi;
-
 	pthread_mutex_t task_mutex;
 	struct circlebuf tasks;
+
+	pthread_mutex_t pacing_mutex;
+	uint64_t pacing_spin_ns;
+	bool pacing_realtime;
+	struct obs_video_pacing_stats pacing_stats;
 };
 
 struct audio_monitor;
 
+#define MAX_BUFFERING_TICKS 45
+
+/* one slot per second of audio */
+#define AUDIO_LATENESS_WINDOW_SLOTS 10
+
 struct obs_core_audio {
 	audio_t *audio;
 
@@ -331,6 +421,22 @@ struct obs_core_audio {
 	int buffering_wait_ticks;
 	int total_buffering_ticks;
 
+	/* adaptive buffering, only touched by the audio thread except for
+	 * the enable flag */
+	volatile bool adaptive_buffering;
+	bool catching_up;
+	int lateness_window[AUDIO_LATENESS_WINDOW_SLOTS];
+	size_t lateness_slot;
+	int lateness_slot_ticks;
+	int buffering_hold_ticks;
+
+	pthread_mutex_t buffering_mutex;
+	struct obs_audio_buffering_change
+		buffering_history[OBS_AUDIO_BUFFERING_HISTORY];
+	size_t buffering_history_pos;
+	size_t buffering_history_num;
+	int window_peak_ticks;
+
 	float user_volume;
 
 	pthread_mutex_t monitoring_mutex;
@@ -364,6 +470,8 @@ struct obs_core_data {
 
 	obs_data_t *private_data;
 
+	volatile bool parallel_source_loading;
+
 	volatile bool valid;
 };
 
@@ -422,6 +530,20 @@ struct obs_core {
 	char *locale;
 	char *module_config_path;
 	bool name_store_owned;
+
+	bool lazy_module_loading;
+	bool modules_post_loaded;
+	struct obs_module *loading_module;
+	pthread_t module_load_thread;
+	volatile bool module_load_thread_busy;
+
+	/* the type arrays are only grown under types_mutex, and never in
+	 * place, so info pointers stay valid until shutdown.  known_types
+	 * holds every registered type plus the types of modules whose load
+	 * is still pending, in registration order */
+	pthread_mutex_t types_mutex;
+	DARRAY(void *) retired_type_arrays;
+	DARRAY(struct obs_type_id) known_types;
 	profiler_name_store_t *name_store;
 
 	/* segmented into multiple sub-structures to keep things a bit more
@@ -445,9 +567,8 @@ struct obs_graphics_context {
 #ifdef _WIN32
 	bool gpu_was_active;
 #endif
-	bool raw_was_active;
-	bool was_active;
 	const char *video_thread_name;
+	bool realtime_active;
 };
 
 extern void *obs_graphics_thread(void *param);
@@ -559,8 +680,55 @@ struct async_frame {
 	struct obs_source_frame *frame;
 	long unused_count;
 	bool used;
+
+	/* set for frames borrowed from the source, which are never reused and
+	 * are handed back through release once libobs is done with them */
+	void (*release)(void *param);
+	void *param;
+};
+
+/* single-consumer ring of frame references.  obs_source_output_video can be
+ * called from several threads, so pushes are serialized by the async mutex,
+ * while the graphics thread peeks and pops without it */
+#define ASYNC_QUEUE_SIZE 32
+
+struct async_frame_queue {
+	struct obs_source_frame *frames[ASYNC_QUEUE_SIZE];
+	volatile long head;
+	volatile long tail;
 };
 
+static inline size_t async_queue_count(struct async_frame_queue *q)
+{
+	unsigned long tail = (unsigned long)os_atomic_load_long(&q->tail);
+	unsigned long head = (unsigned long)os_atomic_load_long(&q->head);
+	return (size_t)(tail - head);
+}
+
+/* consumer only, idx must be below async_queue_count */
+static inline struct obs_source_frame *
+async_queue_peek(struct async_frame_queue *q, size_t idx)
+{
+	return q->frames[((size_t)q->head + idx) & (ASYNC_QUEUE_SIZE - 1)];
+}
+
+/* consumer only */
+static inline void async_queue_pop(struct async_frame_queue *q)
+{
+	os_atomic_set_long(&q->head, q->head + 1);
+}
+
+/* producer only, with the async mutex held.  the caller makes sure the
+ * queue isn't full */
+static inline void async_queue_push(struct async_frame_queue *q,
+				    struct obs_source_frame *frame)
+{
+	long tail = q->tail;
+
+	q->frames[(size_t)tail & (ASYNC_QUEUE_SIZE - 1)] = frame;
+	os_atomic_set_long(&q->tail, tail + 1);
+}
+
 enum audio_action_type {
 	AUDIO_ACTION_VOL,
 	AUDIO_ACTION_MUTE,
@@ -603,6 +771,10 @@ struct obs_source {
 	/* signals to call the source update in the video thread */
 	long defer_update_count;
 
+	/* incremented whenever what the source renders may have changed,
+	 * lets on-demand displays skip redraws */
+	volatile long content_serial;
+
 	/* ensures show/hide are only called once */
 	volatile long show_refs;
 
@@ -681,7 +853,11 @@ struct obs_source {
 	bool async_decoupled;
 	struct obs_source_frame *async_preload_frame;
 	DARRAY(struct async_frame) async_cache;
-	DARRAY(struct obs_source_frame *) async_frames;
+	struct async_frame_queue async_frames;
+	DARRAY(struct obs_source_frame *) async_released;
+	DARRAY(struct async_frame) async_returned;
+	volatile bool async_flush;
+	struct obs_source_async_stats async_stats;
 	pthread_mutex_t async_mutex;
 	uint32_t async_width;
 	uint32_t async_height;
@@ -777,6 +953,10 @@ struct audio_monitor *audio_monitor_create(obs_source_t *source);
 void audio_monitor_reset(struct audio_monitor *monitor);
 extern void audio_monitor_destroy(struct audio_monitor *monitor);
 
+/* called on the audio thread after every tick, for monitoring backends that
+ * mix all monitored sources into a single stream */
+extern void audio_monitoring_tick(void);
+
 extern obs_source_t *obs_source_create_set_last_ver(const char *id,
 						    const char *name,
 						    obs_data_t *settings,
@@ -805,6 +985,11 @@ static inline void obs_source_dosignal(struct obs_source *source,
 				      &data);
 }
 
+static inline void obs_source_content_changed(struct obs_source *source)
+{
+	os_atomic_inc_long(&source->content_serial);
+}
+
 /* maximum timestamp variance in nanoseconds */
 #define MAX_TS_VAR 2000000000ULL
 
@@ -859,9 +1044,43 @@ extern bool set_async_texture_size(struct obs_source *source,
 extern void remove_async_frame(obs_source_t *source,
 			       struct obs_source_frame *frame);
 
+/* frames dropped by the graphics thread while matching timestamps are only
+ * handed back to the frame cache once it takes the async mutex again */
+static inline void defer_async_frame_release(obs_source_t *source,
+					     struct obs_source_frame *frame)
+{
+	if (frame) {
+		frame->prev_frame = false;
+		da_push_back(source->async_released, &frame);
+	}
+}
+
+static inline void lock_async(obs_source_t *source, bool producer)
+{
+	uint64_t start;
+
+	if (pthread_mutex_trylock(&source->async_mutex) == 0)
+		return;
+
+	start = os_gettime_ns();
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (producer) {
+		source->async_stats.producer_lock_waits++;
+		source->async_stats.producer_lock_wait_ns +=
+			os_gettime_ns() - start;
+	} else {
+		source->async_stats.consumer_lock_waits++;
+		source->async_stats.consumer_lock_wait_ns +=
+			os_gettime_ns() - start;
+	}
+}
+
 extern void set_deinterlace_texture_size(obs_source_t *source);
-extern void deinterlace_process_last_frame(obs_source_t *source,
-					   uint64_t sys_time);
+extern void deinterlace_get_closest_frames(obs_source_t *s,
+					  uint64_t sys_time,
+					  struct obs_source_frame **prev,
+					  struct obs_source_frame **cur);
 extern void deinterlace_update_async_video(obs_source_t *source);
 extern void deinterlace_render(obs_source_t *s);
 
@@ -878,6 +1097,19 @@ struct delay_data {
 	enum delay_msg msg;
 	uint64_t ts;
 	struct encoder_packet packet;
+
+	/* payload moved to the spill store, packet.data is NULL until read */
+	bool spilled;
+	uint32_t spill_segment;
+	uint64_t spill_offset;
+};
+
+struct delay_spill_segment {
+	FILE *file;
+	char *path;
+	uint32_t id;
+	uint64_t size;
+	size_t refs;
 };
 
 typedef void (*encoded_callback_t)(void *data, struct encoder_packet *packet);
@@ -990,6 +1222,21 @@ struct obs_output {
 	volatile bool delay_active;
 	volatile bool delay_capturing;
 
+	pthread_t delay_thread;
+	bool delay_thread_active;
+	volatile long delay_thread_gen;
+	os_event_t *delay_event;
+	struct obs_output_delay_stats delay_stats;
+	uint64_t delay_jitter_total_ns;
+
+	char *delay_spill_dir;
+	uint64_t delay_spill_max_memory;
+	bool delay_spill_enabled;
+	volatile bool delay_spill_failed;
+	size_t delay_spill_cursor;
+	uint32_t delay_spill_next_id;
+	DARRAY(struct delay_spill_segment) delay_spill_segments;
+
 	char *last_error_message;
 
 	float audio_data[MAX_AUDIO_CHANNELS][AUDIO_OUTPUT_FRAMES];
@@ -1006,6 +1253,8 @@ static inline void do_output_signal(struct obs_output *output,
 
 extern void process_delay(void *data, struct encoder_packet *packet);
 extern void obs_output_cleanup_delay(obs_output_t *output);
+extern void obs_output_start_delay_thread(obs_output_t *output);
+extern void obs_output_stop_delay_thread(obs_output_t *output);
 extern bool obs_output_delay_start(obs_output_t *output);
 extern void obs_output_delay_stop(obs_output_t *output);
 extern bool obs_output_actual_start(obs_output_t *output);
@@ -15,7 +15,10 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <sys/stat.h>
+
 #include "util/platform.h"
+#include "util/threading.h"
 #include "util/dstr.h"
 
 #include "obs-defs.h"
@@ -97,15 +100,12 @@ static inline char *get_module_name(const char *file)
 extern void reset_win32_symbol_paths(void);
 #endif
 
-int obs_open_module(obs_module_t **module, const char *path,
-		    const char *data_path)
+static int open_module_image(struct obs_module *mod, const char *path,
+			     const char *data_path)
 {
-	struct obs_module mod = {0};
+	uint64_t start_time = os_gettime_ns();
 	int errorcode;
 
-	if (!module || !path || !obs)
-		return MODULE_ERROR;
-
 #ifdef __APPLE__
 	/* HACK: Do not load obsolete obs-browser build on macOS; the
 	 * obs-browser plugin used to live in the Application Support
@@ -117,41 +117,73 @@ int obs_open_module(obs_module_t **module, const char *path,
 	}
 #endif
 
-	blog(LOG_DEBUG, "---------------------------------");
-
-	mod.module = os_dlopen(path);
-	if (!mod.module) {
+	mod->module = os_dlopen(path);
+	if (!mod->module) {
 		blog(LOG_WARNING, "Module '%s' not loaded", path);
 		return MODULE_FILE_NOT_FOUND;
 	}
 
-	errorcode = load_module_exports(&mod, path);
+	errorcode = load_module_exports(mod, path);
 	if (errorcode != MODULE_SUCCESS)
 		return errorcode;
 
-	mod.bin_path = bstrdup(path);
-	mod.file = strrchr(mod.bin_path, '/');
-	mod.file = (!mod.file) ? mod.bin_path : (mod.file + 1);
-	mod.mod_name = get_module_name(mod.file);
-	mod.data_path = bstrdup(data_path);
-	mod.next = obs->first_module;
+	mod->bin_path = bstrdup(path);
+	mod->file = strrchr(mod->bin_path, '/');
+	mod->file = (!mod->file) ? mod->bin_path : (mod->file + 1);
+	mod->mod_name = get_module_name(mod->file);
+	mod->data_path = bstrdup(data_path);
+
+	mod->open_time_ns = os_gettime_ns() - start_time;
+	return MODULE_SUCCESS;
+}
+
+static void load_module_locale(struct obs_module *mod)
+{
+	uint64_t start_time = os_gettime_ns();
+
+	mod->set_pointer(mod);
 
-	if (mod.file) {
-		blog(LOG_DEBUG, "Loading module: %s", mod.file);
+	if (mod->set_locale)
+		mod->set_locale(obs->locale);
+
+	mod->locale_time_ns = os_gettime_ns() - start_time;
+}
+
+int obs_open_module(obs_module_t **module, const char *path,
+		    const char *data_path)
+{
+	struct obs_module *mod;
+	int errorcode;
+
+	if (!module || !path || !obs)
+		return MODULE_ERROR;
+
+	blog(LOG_DEBUG, "---------------------------------");
+
+	mod = bzalloc(sizeof(*mod));
+	errorcode = open_module_image(mod, path, data_path);
+	if (errorcode != MODULE_SUCCESS) {
+		bfree(mod);
+		return errorcode;
 	}
 
-	*module = bmemdup(&mod, sizeof(mod));
-	obs->first_module = (*module);
-	mod.set_pointer(*module);
+	if (mod->file) {
+		blog(LOG_DEBUG, "Loading module: %s", mod->file);
+	}
 
-	if (mod.set_locale)
-		mod.set_locale(obs->locale);
+	mod->next = obs->first_module;
+	obs->first_module = mod;
+	*module = mod;
 
+	load_module_locale(mod);
 	return MODULE_SUCCESS;
 }
 
 bool obs_init_module(obs_module_t *module)
 {
+	struct obs_module *prev_loading;
+	uint64_t start_time;
+
 	if (!module || !obs)
 		return false;
 	if (module->loaded)
@@ -162,15 +194,210 @@ bool obs_init_module(obs_module_t *module)
 				   "obs_init_module(%s)", module->file);
 	profile_start(profile_name);
 
+	prev_loading = obs->loading_module;
+	obs->loading_module = module;
+	start_time = os_gettime_ns();
+
 	module->loaded = module->load();
 	if (!module->loaded)
 		blog(LOG_WARNING, "Failed to initialize module '%s'",
 		     module->file);
 
+	module->load_time_ns = os_gettime_ns() - start_time;
+	obs->loading_module = prev_loading;
+
 	profile_end(profile_name);
 	return module->loaded;
 }
 
+static inline bool has_type_id(const struct obs_type_id *types, size_t num,
+			       const char *id)
+{
+	for (size_t i = 0; i < num; i++) {
+		if (strcmp(types[i].id, id) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static inline void copy_type_id(struct obs_type_id *dst,
+				enum obs_type_kind kind, const char *id,
+				const char *unversioned_id, uint32_t version)
+{
+	dst->kind = kind;
+	dst->id = bstrdup(id);
+	dst->unversioned_id = bstrdup(unversioned_id ? unversioned_id : id);
+	dst->version = version;
+}
+
+static inline void free_type_id(struct obs_type_id *type)
+{
+	bfree(type->id);
+	bfree(type->unversioned_id);
+}
+
+void obs_add_type_id(enum obs_type_kind kind, const char *id,
+		     const char *unversioned_id, uint32_t version)
+{
+	struct obs_module *mod = obs->loading_module;
+
+	if (!id)
+		return;
+
+	pthread_mutex_lock(&obs->types_mutex);
+
+	/* types read from the manifest are registered again once a lazily
+	 * loaded module actually loads */
+	if (!has_type_id(obs->known_types.array, obs->known_types.num, id))
+		copy_type_id(da_push_back_new(obs->known_types), kind, id,
+			     unversioned_id, version);
+	if (mod && !has_type_id(mod->types.array, mod->types.num, id))
+		copy_type_id(da_push_back_new(mod->types), kind, id,
+			     unversioned_id, version);
+
+	pthread_mutex_unlock(&obs->types_mutex);
+}
+
+/* type info pointers are handed out and used without any lock held, and with
+ * lazy loading a module can register types while another thread walks the
+ * arrays, so an array that has to grow is copied and the old one is kept
+ * until shutdown instead of being reallocated in place */
+void obs_register_type(struct darray *array, size_t element_size,
+		       const void *info)
+{
+	pthread_mutex_lock(&obs->types_mutex);
+
+	if (array->num == array->capacity) {
+		size_t capacity = array->capacity ? array->capacity * 2 : 16;
+		void *new_array = bmalloc(element_size * capacity);
+
+		if (array->num)
+			memcpy(new_array, array->array,
+			       element_size * array->num);
+		if (array->array)
+			da_push_back(obs->retired_type_arrays, &array->array);
+
+		array->array = new_array;
+		array->capacity = capacity;
+	}
+
+	memcpy((uint8_t *)array->array + element_size * array->num, info,
+	       element_size);
+	array->num++;
+
+	pthread_mutex_unlock(&obs->types_mutex);
+}
+
+static struct obs_module *find_pending_module(const char *id)
+{
+	struct obs_module *found = NULL;
+
+	pthread_mutex_lock(&obs->types_mutex);
+
+	for (struct obs_module *mod = obs->first_module; !!mod;
+	     mod = mod->next) {
+		if (mod->load_pending &&
+		    has_type_id(mod->types.array, mod->types.num, id)) {
+			found = mod;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&obs->types_mutex);
+	return found;
+}
+
+/* only ever called on the thread that called obs_load_all_modules */
+static bool load_pending_module(const char *id)
+{
+	struct obs_module *mod = find_pending_module(id);
+
+	if (!mod)
+		return false;
+
+	blog(LOG_INFO, "Lazily loading module '%s'", mod->file);
+
+	pthread_mutex_lock(&obs->types_mutex);
+	mod->load_pending = false;
+	pthread_mutex_unlock(&obs->types_mutex);
+
+	obs_init_module(mod);
+
+	if (obs->modules_post_loaded && mod->loaded && mod->post_load)
+		mod->post_load();
+
+	return mod->loaded;
+}
+
+struct pending_module_load {
+	const char *id;
+	bool loaded;
+};
+
+static void load_pending_module_task(void *param)
+{
+	struct pending_module_load *load = param;
+	load->loaded = load_pending_module(load->id);
+}
+
+static void load_pending_module_async_task(void *param)
+{
+	load_pending_module(param);
+	bfree(param);
+}
+
+extern THREAD_LOCAL bool is_graphics_thread;
+
+/* Modules are only ever loaded on the thread that called
+ * obs_load_all_modules (normally the UI thread), never under a lock.  Other
+ * threads hand the load to it through a UI task and wait for it, unless that
+ * thread might be waiting on them, in which case the load is queued and the
+ * type is treated as unknown for this lookup. */
+bool obs_load_pending_module(const char *id)
+{
+	struct pending_module_load load = {id, false};
+
+	if (!obs || !id || !obs->lazy_module_loading)
+		return false;
+
+	/* registering a type checks whether it already exists, which must
+	 * not pull in other modules from inside a module's load */
+	if (pthread_equal(pthread_self(), obs->module_load_thread))
+		return !obs->loading_module && load_pending_module(id);
+
+	if (!find_pending_module(id))
+		return false;
+
+	if (!obs->ui_task_handler) {
+		blog(LOG_WARNING,
+		     "Type '%s' belongs to a module that has not been loaded "
+		     "yet, and there is no UI task handler to load it",
+		     id);
+		return false;
+	}
+
+	if (is_graphics_thread ||
+	    os_atomic_load_bool(&obs->module_load_thread_busy)) {
+		blog(LOG_WARNING,
+		     "Type '%s' was requested before its module was "
+		     "loaded, queuing the module load",
+		     id);
+		obs_queue_task(OBS_TASK_UI, load_pending_module_async_task,
+			       bstrdup(id), false);
+		return false;
+	}
+
+	obs_queue_task(OBS_TASK_UI, load_pending_module_task, &load, true);
+	return load.loaded;
+}
+
+void obs_set_lazy_module_loading(bool enable)
+{
+	if (obs)
+		obs->lazy_module_loading = enable;
+}
+
 void obs_log_loaded_modules(void)
 {
 	blog(LOG_INFO, "  Loaded Modules:");
@@ -269,44 +496,387 @@ void obs_add_module_path(const char *bin, const char *data)
 	da_push_back(obs->module_paths, &omp);
 }
 
-static void load_all_callback(void *param, const struct obs_module_info *info)
+/* ------------------------------------------------------------------------- */
+/* Module loading is split into two phases: opening the module images
+ * (dlopen, symbol resolution and locale parsing), which is done in parallel
+ * on a small worker pool, and calling obs_module_load, which is done on the
+ * calling thread in discovery order so type registration is deterministic.
+ *
+ * With lazy loading enabled, the type IDs each module registered during the
+ * previous run are read from a manifest.  Modules found in the manifest are
+ * opened but obs_module_load is deferred until one of their type IDs is
+ * requested.  Modules that register no types are always loaded eagerly. */
+
+#define MODULE_MANIFEST_FILE "module_manifest.json"
+#define MAX_MODULE_OPEN_THREADS 8
+
+struct module_open_job {
+	char *bin_path;
+	char *data_path;
+	struct obs_module *mod;
+	int code;
+};
+
+struct module_loader {
+	DARRAY(struct module_open_job) jobs;
+	volatile long next_job;
+#ifdef _WIN32
+	/* os_dlopen changes the process-wide DLL directory on windows */
+	pthread_mutex_t dlopen_mutex;
+#endif
+};
+
+static void collect_module_callback(void *param,
+				    const struct obs_module_info *info)
+{
+	struct module_loader *loader = param;
+	struct module_open_job *job = da_push_back_new(loader->jobs);
+
+	job->bin_path = bstrdup(info->bin_path);
+	job->data_path = bstrdup(info->data_path);
+}
+
+static void *module_open_thread(void *param)
 {
-	obs_module_t *module;
+	struct module_loader *loader = param;
 
-	int code = obs_open_module(&module, info->bin_path, info->data_path);
-	if (code != MODULE_SUCCESS) {
-		blog(LOG_DEBUG, "Failed to load module file '%s': %d",
-		     info->bin_path, code);
-		return;
+	os_set_thread_name("libobs: module open thread");
+
+	for (;;) {
+		long idx = os_atomic_inc_long(&loader->next_job) - 1;
+		struct module_open_job *job;
+
+		if (idx >= (long)loader->jobs.num)
+			break;
+
+		job = loader->jobs.array + idx;
+		job->mod = bzalloc(sizeof(struct obs_module));
+
+#ifdef _WIN32
+		pthread_mutex_lock(&loader->dlopen_mutex);
+#endif
+		job->code = open_module_image(job->mod, job->bin_path,
+					      job->data_path);
+#ifdef _WIN32
+		pthread_mutex_unlock(&loader->dlopen_mutex);
+#endif
+
+		if (job->code == MODULE_SUCCESS) {
+			load_module_locale(job->mod);
+		} else {
+			bfree(job->mod);
+			job->mod = NULL;
+		}
+	}
+
+	return NULL;
+}
+
+static void open_modules_parallel(struct module_loader *loader)
+{
+	pthread_t threads[MAX_MODULE_OPEN_THREADS];
+	size_t num_threads = (size_t)os_get_logical_cores();
+	size_t num_started = 0;
+
+	if (num_threads > MAX_MODULE_OPEN_THREADS)
+		num_threads = MAX_MODULE_OPEN_THREADS;
+	if (num_threads > loader->jobs.num)
+		num_threads = loader->jobs.num;
+
+	for (size_t i = 0; i < num_threads; i++) {
+		if (pthread_create(&threads[i], NULL, module_open_thread,
+				   loader) != 0)
+			break;
+		num_started++;
+	}
+
+	/* always make sure every job gets processed, even if no worker
+	 * thread could be created */
+	module_open_thread(loader);
+
+	for (size_t i = 0; i < num_started; i++)
+		pthread_join(threads[i], NULL);
+}
+
+static char *get_module_manifest_path(void)
+{
+	struct dstr path = {0};
+
+	if (!obs->module_config_path)
+		return NULL;
+
+	dstr_copy(&path, obs->module_config_path);
+	if (!dstr_is_empty(&path) && dstr_end(&path) != '/')
+		dstr_cat_ch(&path, '/');
+	dstr_cat(&path, MODULE_MANIFEST_FILE);
+	return path.array;
+}
+
+static void get_module_file_stamp(const char *path, long long *size,
+				  long long *mtime)
+{
+	struct stat st;
+
+	if (os_stat(path, &st) == 0) {
+		*size = (long long)st.st_size;
+		*mtime = (long long)st.st_mtime;
+	} else {
+		*size = -1;
+		*mtime = -1;
+	}
+}
+
+static const char *type_kind_names[] = {
+	"scene",
+	"input",
+	"filter",
+	"transition",
+	"output",
+	"encoder",
+	"service",
+};
+
+#define TYPE_KIND_COUNT (sizeof(type_kind_names) / sizeof(type_kind_names[0]))
+
+static obs_data_t *find_manifest_entry(obs_data_array_t *entries,
+				       const char *bin_path)
+{
+	size_t count = obs_data_array_count(entries);
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *entry = obs_data_array_item(entries, i);
+		if (strcmp(obs_data_get_string(entry, "path"), bin_path) == 0)
+			return entry;
+		obs_data_release(entry);
+	}
+
+	return NULL;
+}
+
+/* returns true if the module can be deferred, filling in its type IDs */
+static bool defer_module_load(struct obs_module *mod,
+			      obs_data_array_t *entries)
+{
+	obs_data_t *entry = find_manifest_entry(entries, mod->bin_path);
+	obs_data_array_t *types;
+	long long size, mtime;
+	size_t count;
+
+	if (!entry)
+		return false;
+
+	get_module_file_stamp(mod->bin_path, &size, &mtime);
+	types = obs_data_get_array(entry, "types");
+	count = obs_data_array_count(types);
+
+	if (size == -1 || obs_data_get_int(entry, "size") != size ||
+	    obs_data_get_int(entry, "mtime") != mtime || !count) {
+		obs_data_array_release(types);
+		obs_data_release(entry);
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *type = obs_data_array_item(types, i);
+		const char *kind = obs_data_get_string(type, "kind");
+		struct obs_type_id *type_id;
+		size_t k;
+
+		for (k = 0; k < TYPE_KIND_COUNT; k++) {
+			if (strcmp(kind, type_kind_names[k]) == 0)
+				break;
+		}
+
+		/* manifests written by older versions don't know the kind
+		 * of each type, which enumeration needs */
+		if (k == TYPE_KIND_COUNT) {
+			obs_data_release(type);
+			break;
+		}
+
+		type_id = da_push_back_new(mod->types);
+		copy_type_id(type_id, (enum obs_type_kind)k,
+			     obs_data_get_string(type, "id"),
+			     obs_data_get_string(type, "unversioned_id"),
+			     (uint32_t)obs_data_get_int(type, "version"));
+		obs_data_release(type);
+	}
+
+	obs_data_array_release(types);
+	obs_data_release(entry);
+
+	if (mod->types.num != count) {
+		for (size_t i = 0; i < mod->types.num; i++)
+			free_type_id(mod->types.array + i);
+		da_free(mod->types);
+		return false;
+	}
+
+	return true;
+}
+
+static void save_module_manifest(const char *path)
+{
+	obs_data_t *manifest = obs_data_create();
+	obs_data_array_t *entries = obs_data_array_create();
+
+	for (struct obs_module *mod = obs->first_module; !!mod;
+	     mod = mod->next) {
+		obs_data_t *entry;
+		obs_data_array_t *types;
+		long long size, mtime;
+
+		if (!mod->loaded && !mod->load_pending)
+			continue;
+
+		get_module_file_stamp(mod->bin_path, &size, &mtime);
+		entry = obs_data_create();
+		types = obs_data_array_create();
+
+		for (size_t i = 0; i < mod->types.num; i++) {
+			struct obs_type_id *type_id = mod->types.array + i;
+			obs_data_t *type = obs_data_create();
+
+			obs_data_set_string(type, "id", type_id->id);
+			obs_data_set_string(type, "unversioned_id",
+					    type_id->unversioned_id);
+			obs_data_set_int(type, "version", type_id->version);
+			obs_data_set_string(type, "kind",
+					    type_kind_names[type_id->kind]);
+			obs_data_array_push_back(types, type);
+			obs_data_release(type);
+		}
+
+		obs_data_set_string(entry, "path", mod->bin_path);
+		obs_data_set_int(entry, "size", size);
+		obs_data_set_int(entry, "mtime", mtime);
+		obs_data_set_array(entry, "types", types);
+		obs_data_array_push_back(entries, entry);
+
+		obs_data_array_release(types);
+		obs_data_release(entry);
 	}
 
-	obs_init_module(module);
+	obs_data_set_array(manifest, "modules", entries);
+	if (!obs_data_save_json_safe(manifest, path, "tmp", "bak"))
+		blog(LOG_WARNING, "Failed to save module manifest '%s'", path);
+
+	obs_data_array_release(entries);
+	obs_data_release(manifest);
+}
+
+/* makes the types of deferred modules visible to type enumeration in the
+ * order the modules would have registered them */
+static void add_pending_types(struct obs_module *mod)
+{
+	for (size_t i = 0; i < mod->types.num; i++) {
+		struct obs_type_id *type = mod->types.array + i;
+		obs_add_type_id(type->kind, type->id, type->unversioned_id,
+				type->version);
+	}
+}
 
-	UNUSED_PARAMETER(param);
+static void log_module_load_times(void)
+{
+	blog(LOG_INFO, "Module load times (open / locale / load):");
+
+	for (struct obs_module *mod = obs->first_module; !!mod;
+	     mod = mod->next) {
+		blog(LOG_INFO, "    %s: %.2f / %.2f / %.2f ms%s", mod->file,
+		     (double)mod->open_time_ns / 1000000.0,
+		     (double)mod->locale_time_ns / 1000000.0,
+		     (double)mod->load_time_ns / 1000000.0,
+		     mod->load_pending ? " (deferred)" : "");
+	}
 }
 
 static const char *obs_load_all_modules_name = "obs_load_all_modules";
+static const char *open_modules_name = "open_modules";
 #ifdef _WIN32
 static const char *reset_win32_symbol_paths_name = "reset_win32_symbol_paths";
 #endif
 
 void obs_load_all_modules(void)
 {
+	struct module_loader loader = {0};
+	obs_data_t *manifest = NULL;
+	obs_data_array_t *entries = NULL;
+	char *manifest_path;
+
 	profile_start(obs_load_all_modules_name);
-	obs_find_modules(load_all_callback, NULL);
+
+	obs->module_load_thread = pthread_self();
+
+	manifest_path = get_module_manifest_path();
+	if (obs->lazy_module_loading && manifest_path) {
+		manifest = obs_data_create_from_json_file_safe(manifest_path,
+							       "bak");
+		entries = obs_data_get_array(manifest, "modules");
+	}
+
+	obs_find_modules(collect_module_callback, &loader);
+
+	profile_start(open_modules_name);
+#ifdef _WIN32
+	pthread_mutex_init(&loader.dlopen_mutex, NULL);
+#endif
+	open_modules_parallel(&loader);
+#ifdef _WIN32
+	pthread_mutex_destroy(&loader.dlopen_mutex);
+#endif
+	profile_end(open_modules_name);
+
+	for (size_t i = 0; i < loader.jobs.num; i++) {
+		struct module_open_job *job = loader.jobs.array + i;
+		struct obs_module *mod = job->mod;
+
+		if (mod) {
+			blog(LOG_DEBUG, "Loading module: %s", mod->file);
+
+			mod->next = obs->first_module;
+			obs->first_module = mod;
+
+			if (entries && defer_module_load(mod, entries)) {
+				mod->load_pending = true;
+				add_pending_types(mod);
+			} else {
+				obs_init_module(mod);
+			}
+		} else {
+			blog(LOG_DEBUG, "Failed to load module file '%s': %d",
+			     job->bin_path, job->code);
+		}
+
+		bfree(job->bin_path);
+		bfree(job->data_path);
+	}
+
+	da_free(loader.jobs);
+
+	if (manifest_path)
+		save_module_manifest(manifest_path);
+
+	obs_data_array_release(entries);
+	obs_data_release(manifest);
+	bfree(manifest_path);
+
 #ifdef _WIN32
 	profile_start(reset_win32_symbol_paths_name);
 	reset_win32_symbol_paths();
 	profile_end(reset_win32_symbol_paths_name);
 #endif
 	profile_end(obs_load_all_modules_name);
+
+	log_module_load_times();
 }
 
 void obs_post_load_modules(void)
 {
 	for (obs_module_t *mod = obs->first_module; !!mod; mod = mod->next)
-		if (mod->post_load)
+		if (mod->post_load && !mod->load_pending)
 			mod->post_load();
+
+	obs->modules_post_loaded = true;
 }
 
 static inline void make_data_dir(struct dstr *parsed_data_dir,
@@ -488,6 +1058,10 @@ void free_module(struct obs_module *mod)
 		/* os_dlclose(mod->module); */
 	}
 
+	for (size_t i = 0; i < mod->types.num; i++)
+		free_type_id(mod->types.array + i);
+	da_free(mod->types);
+
 	bfree(mod->mod_name);
 	bfree(mod->bin_path);
 	bfree(mod->data_path);
@@ -561,7 +1135,7 @@ cleanup:
 		}                                                       \
                                                                         \
 		memcpy(&data, info, size_var);                          \
-		da_push_back(dest, &data);                              \
+		obs_register_type(&dest.da, sizeof(data), &data);       \
 	} while (false)
 
 #define CHECK_REQUIRED_VAL(type, info, val, func)                       \
@@ -598,6 +1172,20 @@ cleanup:
 #define service_warn(format, ...) \
 	blog(LOG_WARNING, "obs_register_service: " format, ##__VA_ARGS__)
 
+static inline enum obs_type_kind source_type_kind(enum obs_source_type type)
+{
+	switch (type) {
+	case OBS_SOURCE_TYPE_FILTER:
+		return OBS_TYPE_FILTER;
+	case OBS_SOURCE_TYPE_TRANSITION:
+		return OBS_TYPE_TRANSITION;
+	case OBS_SOURCE_TYPE_SCENE:
+		return OBS_TYPE_SCENE;
+	default:
+		return OBS_TYPE_INPUT;
+	}
+}
+
 void obs_register_source_s(const struct obs_source_info *info, size_t size)
 {
 	struct obs_source_info data = {0};
@@ -696,8 +1284,10 @@ void obs_register_source_s(const struct obs_source_info *info, size_t size)
 	}
 
 	if (array)
-		darray_push_back(sizeof(struct obs_source_info), array, &data);
-	da_push_back(obs->source_types, &data);
+		obs_register_type(array, sizeof(data), &data);
+	obs_register_type(&obs->source_types.da, sizeof(data), &data);
+	obs_add_type_id(source_type_kind(data.type), data.id,
+			data.unversioned_id, data.version);
 	return;
 
 error:
@@ -741,6 +1331,7 @@ void obs_register_output_s(const struct obs_output_info *info, size_t size)
 #undef CHECK_REQUIRED_VAL_
 
 	REGISTER_OBS_DEF(size, obs_output_info, obs->output_types, info);
+	obs_add_type_id(OBS_TYPE_OUTPUT, info->id, NULL, 0);
 	return;
 
 error:
@@ -772,6 +1363,7 @@ void obs_register_encoder_s(const struct obs_encoder_info *info, size_t size)
 #undef CHECK_REQUIRED_VAL_
 
 	REGISTER_OBS_DEF(size, obs_encoder_info, obs->encoder_types, info);
+	obs_add_type_id(OBS_TYPE_ENCODER, info->id, NULL, 0);
 	return;
 
 error:
@@ -795,6 +1387,7 @@ void obs_register_service_s(const struct obs_service_info *info, size_t size)
 #undef CHECK_REQUIRED_VAL_
 
 	REGISTER_OBS_DEF(size, obs_service_info, obs->service_types, info);
+	obs_add_type_id(OBS_TYPE_SERVICE, info->id, NULL, 0);
 	return;
 
 error:
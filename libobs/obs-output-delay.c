@@ -16,6 +16,8 @@
 ******************************************************************************/
 
 #include <inttypes.h>
+#include "util/dstr.h"
+#include "util/platform.h"
 #include "obs-internal.h"
 
 static inline bool delay_active(const struct obs_output *output)
@@ -28,6 +30,51 @@ static inline bool delay_capturing(const struct obs_output *output)
 	return os_atomic_load_bool(&output->delay_capturing);
 }
 
+#define DELAY_SPILL_SEGMENT_SIZE (64ULL * 1024ULL * 1024ULL)
+#define DELAY_SPILL_MIN_LEAD_NS 1000000000ULL
+#define DELAY_PRESERVE_POLL_NS 10000000ULL
+#define DELAY_SPILL_INTERVAL_NS 100000000ULL
+#define NO_DEADLINE UINT64_MAX
+
+static inline struct delay_data *delay_data_at(struct obs_output *output,
+					       size_t idx)
+{
+	/* entries are all the same size, so they never straddle the end of
+	 * the circlebuf's storage */
+	return circlebuf_data(&output->delay_data,
+			      idx * sizeof(struct delay_data));
+}
+
+static inline size_t delay_data_count(const struct obs_output *output)
+{
+	return output->delay_data.size / sizeof(struct delay_data);
+}
+
+static void push_delay_data(struct obs_output *output, struct delay_data *dd)
+{
+	struct obs_output_delay_stats *stats = &output->delay_stats;
+	bool was_empty;
+
+	pthread_mutex_lock(&output->delay_mutex);
+	was_empty = output->delay_data.size == 0;
+	circlebuf_push_back(&output->delay_data, dd, sizeof(*dd));
+
+	if (dd->msg == DELAY_MSG_PACKET) {
+		stats->queued_packets++;
+		stats->memory_bytes += dd->packet.size;
+
+		if (stats->queued_packets > stats->peak_queued_packets)
+			stats->peak_queued_packets = stats->queued_packets;
+		if (stats->memory_bytes > stats->peak_memory_bytes)
+			stats->peak_memory_bytes = stats->memory_bytes;
+	}
+	pthread_mutex_unlock(&output->delay_mutex);
+
+	/* otherwise the thread is already waiting on an earlier deadline */
+	if (was_empty)
+		os_event_signal(output->delay_event);
+}
+
 static inline void push_packet(struct obs_output *output,
 			       struct encoder_packet *packet, uint64_t t)
 {
@@ -37,9 +84,7 @@ static inline void push_packet(struct obs_output *output,
 	dd.ts = t;
 	obs_encoder_packet_create_instance(&dd.packet, packet);
 
-	pthread_mutex_lock(&output->delay_mutex);
-	circlebuf_push_back(&output->delay_data, &dd, sizeof(dd));
-	pthread_mutex_unlock(&output->delay_mutex);
+	push_delay_data(output, &dd);
 }
 
 static inline void process_delay_data(struct obs_output *output,
@@ -61,65 +106,418 @@ static inline void process_delay_data(struct obs_output *output,
 	}
 }
 
-void obs_output_cleanup_delay(obs_output_t *output)
+/* ------------------------------------------------------------------------- */
+/* spill store: payloads are appended to fixed size segment files, which are
+ * deleted once every packet stored in them has been read back */
+
+static struct delay_spill_segment *find_segment(struct obs_output *output,
+						uint32_t id)
 {
-	struct delay_data dd;
+	for (size_t i = 0; i < output->delay_spill_segments.num; i++) {
+		struct delay_spill_segment *seg =
+			&output->delay_spill_segments.array[i];
+		if (seg->id == id)
+			return seg;
+	}
 
-	while (output->delay_data.size) {
-		circlebuf_pop_front(&output->delay_data, &dd, sizeof(dd));
-		if (dd.msg == DELAY_MSG_PACKET) {
-			obs_encoder_packet_release(&dd.packet);
+	return NULL;
+}
+
+static void free_segment(struct delay_spill_segment *seg)
+{
+	fclose(seg->file);
+	os_unlink(seg->path);
+	bfree(seg->path);
+}
+
+static void prune_segments(struct obs_output *output)
+{
+	/* the newest segment is still being written to */
+	for (size_t i = output->delay_spill_segments.num; i > 1; i--) {
+		struct delay_spill_segment *seg =
+			&output->delay_spill_segments.array[i - 2];
+
+		if (!seg->refs) {
+			free_segment(seg);
+			da_erase(output->delay_spill_segments, i - 2);
 		}
 	}
+}
 
-	output->active_delay_ns = 0;
-	os_atomic_set_long(&output->delay_restart_refs, 0);
+static struct delay_spill_segment *
+get_write_segment(struct obs_output *output, size_t size)
+{
+	struct delay_spill_segment *seg = NULL;
+	struct dstr path = {0};
+	FILE *file;
+
+	if (output->delay_spill_segments.num)
+		seg = da_end(output->delay_spill_segments);
+	if (seg && (seg->size == 0 ||
+		    seg->size + size <= DELAY_SPILL_SEGMENT_SIZE))
+		return seg;
+
+	dstr_printf(&path, "%s/obs-delay-%p-%" PRIu32 ".bin",
+		    output->delay_spill_dir, (void *)output,
+		    output->delay_spill_next_id);
+
+	file = os_fopen(path.array, "w+b");
+	if (!file) {
+		blog(LOG_WARNING,
+		     "Output '%s': Failed to create delay spill file '%s'",
+		     output->context.name, path.array);
+		dstr_free(&path);
+		return NULL;
+	}
+
+	seg = da_push_back_new(output->delay_spill_segments);
+	seg->file = file;
+	seg->path = path.array;
+	seg->id = output->delay_spill_next_id++;
+
+	prune_segments(output);
+	return da_end(output->delay_spill_segments);
 }
 
-static inline bool pop_packet(struct obs_output *output, uint64_t t)
+static bool spill_payload(struct obs_output *output,
+			  const struct encoder_packet *packet, uint32_t *id,
+			  uint64_t *offset)
 {
-	uint64_t elapsed_time;
-	struct delay_data dd;
-	bool popped = false;
-	bool preserve;
+	struct delay_spill_segment *seg =
+		get_write_segment(output, packet->size);
+	if (!seg)
+		return false;
 
-	/* ------------------------------------------------ */
+	if (os_fseeki64(seg->file, (int64_t)seg->size, SEEK_SET) != 0 ||
+	    fwrite(packet->data, 1, packet->size, seg->file) != packet->size) {
+		blog(LOG_WARNING,
+		     "Output '%s': Failed to write to delay spill file '%s'",
+		     output->context.name, seg->path);
+		return false;
+	}
 
-	preserve = (output->delay_cur_flags & OBS_OUTPUT_DELAY_PRESERVE) != 0;
+	*id = seg->id;
+	*offset = seg->size;
+	seg->size += packet->size;
+	seg->refs++;
+	return true;
+}
 
-	pthread_mutex_lock(&output->delay_mutex);
+static bool load_spilled_payload(struct obs_output *output,
+				 struct delay_data *dd)
+{
+	struct delay_spill_segment *seg =
+		find_segment(output, dd->spill_segment);
+	size_t size = dd->packet.size;
+	bool success = false;
+	long *p_refs;
+
+	if (!seg) {
+		blog(LOG_ERROR,
+		     "Output '%s': Delay spill segment %u is missing",
+		     output->context.name, dd->spill_segment);
+		return false;
+	}
+
+	p_refs = bmalloc(size + sizeof(long));
+	*p_refs = 1;
+
+	if (os_fseeki64(seg->file, (int64_t)dd->spill_offset, SEEK_SET) == 0 &&
+	    fread(p_refs + 1, 1, size, seg->file) == size) {
+		dd->packet.data = (void *)(p_refs + 1);
+		success = true;
+	} else {
+		blog(LOG_ERROR,
+		     "Output '%s': Failed to read from delay spill file '%s'",
+		     output->context.name, seg->path);
+		bfree(p_refs);
+	}
+
+	seg->refs--;
+	prune_segments(output);
+	return success;
+}
+
+/* moves queued payloads to disk while over the memory budget, oldest first,
+ * leaving alone the ones that are about to be released anyway */
+static void spill_pending(struct obs_output *output, uint64_t t)
+{
+	struct obs_output_delay_stats *stats = &output->delay_stats;
+
+	for (;;) {
+		struct encoder_packet packet;
+		uint32_t id;
+		uint64_t offset;
+		bool spill;
+
+		pthread_mutex_lock(&output->delay_mutex);
+
+		if (output->delay_spill_cursor >= delay_data_count(output) ||
+		    stats->memory_bytes <= output->delay_spill_max_memory) {
+			pthread_mutex_unlock(&output->delay_mutex);
+			return;
+		}
+
+		struct delay_data *dd =
+			delay_data_at(output, output->delay_spill_cursor);
+		spill = dd->msg == DELAY_MSG_PACKET &&
+			dd->ts + output->active_delay_ns >
+				t + DELAY_SPILL_MIN_LEAD_NS;
+		packet = dd->packet;
+
+		pthread_mutex_unlock(&output->delay_mutex);
+
+		if (spill && !spill_payload(output, &packet, &id, &offset)) {
+			output->delay_spill_enabled = false;
+			return;
+		}
+
+		/* only this thread removes entries, so the index still refers
+		 * to the same entry even if the circlebuf was reallocated */
+		pthread_mutex_lock(&output->delay_mutex);
+		if (spill) {
+			dd = delay_data_at(output, output->delay_spill_cursor);
+			obs_encoder_packet_release(&dd->packet);
+			dd->packet = packet;
+			dd->packet.data = NULL;
+			dd->spilled = true;
+			dd->spill_segment = id;
+			dd->spill_offset = offset;
+
+			stats->memory_bytes -= packet.size;
+			stats->spilled_bytes += packet.size;
+		}
+		output->delay_spill_cursor++;
+		pthread_mutex_unlock(&output->delay_mutex);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline void update_release_stats(struct obs_output *output,
+					struct delay_data *dd, uint64_t jitter)
+{
+	struct obs_output_delay_stats *stats = &output->delay_stats;
+
+	if (dd->msg != DELAY_MSG_PACKET)
+		return;
+
+	stats->queued_packets--;
+	if (dd->spilled)
+		stats->spilled_bytes -= dd->packet.size;
+	else
+		stats->memory_bytes -= dd->packet.size;
+
+	stats->released_packets++;
+	output->delay_jitter_total_ns += jitter;
+	stats->avg_jitter_ns =
+		output->delay_jitter_total_ns / stats->released_packets;
+	if (jitter > stats->max_jitter_ns)
+		stats->max_jitter_ns = jitter;
+}
+
+/* a delay thread runs until the generation it was started with is replaced,
+ * so a thread that stopped itself and was detached can't be revived by a
+ * restart that happens before it got to exit */
+static inline bool delay_thread_current(struct obs_output *output, long gen)
+{
+	return os_atomic_load_long(&output->delay_thread_gen) == gen;
+}
+
+/* releases everything that is due and returns the time until the next
+ * deadline, gen is the calling delay thread's generation or 0 */
+static uint64_t release_due(struct obs_output *output, long gen)
+{
+	bool preserve =
+		(output->delay_cur_flags & OBS_OUTPUT_DELAY_PRESERVE) != 0;
+
+	for (;;) {
+		struct delay_data dd;
+		uint64_t elapsed_time;
+		uint64_t t;
+
+		/* releasing the stop message may have stopped this thread */
+		if (gen && !delay_thread_current(output, gen))
+			return NO_DEADLINE;
+
+		/* a lost packet would leave a hole in the stream, nothing more
+		 * is released once one couldn't be read back */
+		if (os_atomic_load_bool(&output->delay_spill_failed))
+			return NO_DEADLINE;
+
+		pthread_mutex_lock(&output->delay_mutex);
+
+		if (!output->delay_data.size) {
+			pthread_mutex_unlock(&output->delay_mutex);
+			return NO_DEADLINE;
+		}
 
-	if (output->delay_data.size) {
 		circlebuf_peek_front(&output->delay_data, &dd, sizeof(dd));
-		elapsed_time = (t - dd.ts);
+		t = os_gettime_ns();
+		elapsed_time = t > dd.ts ? t - dd.ts : 0;
 
 		if (preserve && output->reconnecting) {
 			output->active_delay_ns = elapsed_time;
+			pthread_mutex_unlock(&output->delay_mutex);
+			return DELAY_PRESERVE_POLL_NS;
+		}
+
+		if (elapsed_time <= output->active_delay_ns) {
+			pthread_mutex_unlock(&output->delay_mutex);
+			return output->active_delay_ns - elapsed_time + 1;
+		}
 
-		} else if (elapsed_time > output->active_delay_ns) {
-			circlebuf_pop_front(&output->delay_data, NULL,
-					    sizeof(dd));
-			popped = true;
+		circlebuf_pop_front(&output->delay_data, NULL, sizeof(dd));
+		if (output->delay_spill_cursor)
+			output->delay_spill_cursor--;
+		update_release_stats(output, &dd,
+				     elapsed_time - output->active_delay_ns);
+
+		pthread_mutex_unlock(&output->delay_mutex);
+
+		if (dd.spilled && !load_spilled_payload(output, &dd)) {
+			os_atomic_set_bool(&output->delay_spill_failed, true);
+			obs_output_set_last_error(
+				output, "Failed to read back a delayed packet "
+					"from disk");
+			obs_output_signal_stop(output, OBS_OUTPUT_ERROR);
+			return NO_DEADLINE;
 		}
+
+		process_delay_data(output, &dd);
 	}
+}
 
-	pthread_mutex_unlock(&output->delay_mutex);
+struct delay_thread_param {
+	struct obs_output *output;
+	long gen;
+};
 
-	/* ------------------------------------------------ */
+static void *delay_thread(void *data)
+{
+	struct delay_thread_param *param = data;
+	struct obs_output *output = param->output;
+	long gen = param->gen;
 
-	if (popped)
-		process_delay_data(output, &dd);
+	bfree(param);
+	os_set_thread_name("libobs: output delay thread");
+
+	while (delay_thread_current(output, gen)) {
+		uint64_t wait_ns = release_due(output, gen);
+
+		if (!delay_thread_current(output, gen))
+			break;
+
+		/* with a long delay the next deadline can be minutes away,
+		 * but the queue has to be spilled as it grows */
+		if (output->delay_spill_enabled) {
+			spill_pending(output, os_gettime_ns());
+			if (wait_ns > DELAY_SPILL_INTERVAL_NS)
+				wait_ns = DELAY_SPILL_INTERVAL_NS;
+		}
+
+		if (!delay_thread_current(output, gen))
+			break;
+
+		if (wait_ns == NO_DEADLINE) {
+			os_event_wait(output->delay_event);
+		} else {
+			unsigned long ms =
+				(unsigned long)((wait_ns + 999999) / 1000000);
+			os_event_timedwait(output->delay_event, ms);
+		}
+	}
+
+	return NULL;
+}
+
+void obs_output_start_delay_thread(obs_output_t *output)
+{
+	struct delay_thread_param *param;
+
+	if (output->delay_thread_active)
+		return;
+
+	output->delay_spill_enabled = output->delay_spill_dir != NULL;
+	output->delay_spill_cursor = 0;
+	output->delay_jitter_total_ns = 0;
+	os_atomic_set_bool(&output->delay_spill_failed, false);
+	memset(&output->delay_stats, 0, sizeof(output->delay_stats));
+
+	param = bmalloc(sizeof(*param));
+	param->output = output;
+	param->gen = os_atomic_inc_long(&output->delay_thread_gen);
+	if (pthread_create(&output->delay_thread, NULL, delay_thread, param) !=
+	    0) {
+		blog(LOG_ERROR, "Output '%s': Failed to create delay thread",
+		     output->context.name);
+		os_atomic_inc_long(&output->delay_thread_gen);
+		bfree(param);
+		return;
+	}
+
+	output->delay_thread_active = true;
+}
 
-	return popped;
+void obs_output_stop_delay_thread(obs_output_t *output)
+{
+	if (!output->delay_thread_active)
+		return;
+
+	os_atomic_inc_long(&output->delay_thread_gen);
+	os_event_signal(output->delay_event);
+
+	/* the thread can end up here itself through a delayed stop message */
+	if (pthread_equal(pthread_self(), output->delay_thread))
+		pthread_detach(output->delay_thread);
+	else
+		pthread_join(output->delay_thread, NULL);
+
+	output->delay_thread_active = false;
+}
+
+void obs_output_cleanup_delay(obs_output_t *output)
+{
+	struct obs_output_delay_stats *stats = &output->delay_stats;
+	struct delay_data dd;
+
+	if (stats->released_packets) {
+		blog(LOG_INFO,
+		     "Output '%s': delay released %" PRIu64 " packets, "
+		     "release jitter avg %.2f ms / max %.2f ms, "
+		     "peak queue %" PRIu64 " packets / %.1f MB in memory",
+		     output->context.name, stats->released_packets,
+		     (double)stats->avg_jitter_ns / 1000000.0,
+		     (double)stats->max_jitter_ns / 1000000.0,
+		     stats->peak_queued_packets,
+		     (double)stats->peak_memory_bytes / (1024.0 * 1024.0));
+	}
+
+	while (output->delay_data.size) {
+		circlebuf_pop_front(&output->delay_data, &dd, sizeof(dd));
+		if (dd.msg == DELAY_MSG_PACKET) {
+			obs_encoder_packet_release(&dd.packet);
+		}
+	}
+
+	for (size_t i = 0; i < output->delay_spill_segments.num; i++)
+		free_segment(&output->delay_spill_segments.array[i]);
+	da_free(output->delay_spill_segments);
+
+	output->active_delay_ns = 0;
+	output->delay_spill_cursor = 0;
+	memset(stats, 0, sizeof(*stats));
+	os_atomic_set_long(&output->delay_restart_refs, 0);
 }
 
 void process_delay(void *data, struct encoder_packet *packet)
 {
 	struct obs_output *output = data;
-	uint64_t t = os_gettime_ns();
-	push_packet(output, packet, t);
-	while (pop_packet(output, t))
-		;
+	push_packet(output, packet, os_gettime_ns());
+
+	/* without a delay thread, fall back to releasing on packet arrival */
+	if (!output->delay_thread_active)
+		release_due(output, 0);
 }
 
 void obs_output_signal_delay(obs_output_t *output, const char *signal)
@@ -148,9 +546,7 @@ bool obs_output_delay_start(obs_output_t *output)
 			return false;
 	}
 
-	pthread_mutex_lock(&output->delay_mutex);
-	circlebuf_push_back(&output->delay_data, &dd, sizeof(dd));
-	pthread_mutex_unlock(&output->delay_mutex);
+	push_delay_data(output, &dd);
 
 	os_atomic_inc_long(&output->delay_restart_refs);
 
@@ -160,6 +556,7 @@ bool obs_output_delay_start(obs_output_t *output)
 	}
 
 	if (!obs_output_begin_data_capture(output, 0)) {
+		obs_output_stop_delay_thread(output);
 		obs_output_cleanup_delay(output);
 		return false;
 	}
@@ -174,9 +571,7 @@ void obs_output_delay_stop(obs_output_t *output)
 		.ts = os_gettime_ns(),
 	};
 
-	pthread_mutex_lock(&output->delay_mutex);
-	circlebuf_push_back(&output->delay_data, &dd, sizeof(dd));
-	pthread_mutex_unlock(&output->delay_mutex);
+	push_delay_data(output, &dd);
 
 	do_output_signal(output, "stopping");
 }
@@ -212,3 +607,26 @@ uint32_t obs_output_get_active_delay(const obs_output_t *output)
 		       ? (uint32_t)(output->active_delay_ns / 1000000000ULL)
 		       : 0;
 }
+
+void obs_output_set_delay_spill(obs_output_t *output, const char *dir,
+				uint64_t max_memory)
+{
+	if (!obs_output_valid(output, "obs_output_set_delay_spill"))
+		return;
+
+	bfree(output->delay_spill_dir);
+	output->delay_spill_dir = (dir && *dir) ? bstrdup(dir) : NULL;
+	output->delay_spill_max_memory = max_memory;
+}
+
+bool obs_output_get_delay_stats(const obs_output_t *output,
+				struct obs_output_delay_stats *stats)
+{
+	if (!obs_output_valid(output, "obs_output_get_delay_stats"))
+		return false;
+
+	pthread_mutex_lock((pthread_mutex_t *)&output->delay_mutex);
+	*stats = output->delay_stats;
+	pthread_mutex_unlock((pthread_mutex_t *)&output->delay_mutex);
+	return true;
+}
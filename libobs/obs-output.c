@@ -56,7 +56,7 @@ static inline bool data_capture_ending(const struct obs_output *output)
 	return os_atomic_load_bool(&output->end_data_capture_thread_active);
 }
 
-const struct obs_output_info *find_output(const char *id)
+static const struct obs_output_info *find_output_info(const char *id)
 {
 	size_t i;
 	for (i = 0; i < obs->output_types.num; i++)
@@ -66,6 +66,23 @@ const struct obs_output_info *find_output(const char *id)
 	return NULL;
 }
 
+const struct obs_output_info *find_output(const char *id)
+{
+	const struct obs_output_info *info;
+
+	pthread_mutex_lock(&obs->types_mutex);
+	info = find_output_info(id);
+	pthread_mutex_unlock(&obs->types_mutex);
+
+	if (!info && obs_load_pending_module(id)) {
+		pthread_mutex_lock(&obs->types_mutex);
+		info = find_output_info(id);
+		pthread_mutex_unlock(&obs->types_mutex);
+	}
+
+	return info;
+}
+
 const char *obs_output_get_display_name(const char *id)
 {
 	const struct obs_output_info *info = find_output(id);
@@ -120,6 +137,8 @@ obs_output_t *obs_output_create(const char *id, const char *name,
 		goto fail;
 	if (os_event_init(&output->stopping_event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail;
+	if (os_event_init(&output->delay_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
 	if (!init_output_handlers(output, name, settings, hotkey_data))
 		goto fail;
 
@@ -197,6 +216,7 @@ void obs_output_destroy(obs_output_t *output)
 		os_event_wait(output->stopping_event);
 		if (data_capture_ending(output))
 			pthread_join(output->end_data_capture_thread, NULL);
+		obs_output_stop_delay_thread(output);
 
 		if (output->service)
 			output->service->output = NULL;
@@ -220,6 +240,7 @@ void obs_output_destroy(obs_output_t *output)
 		clear_audio_buffers(output);
 
 		os_event_destroy(output->stopping_event);
+		os_event_destroy(output->delay_event);
 		pthread_mutex_destroy(&output->pause.mutex);
 		pthread_mutex_destroy(&output->caption_mutex);
 		pthread_mutex_destroy(&output->interleaved_mutex);
@@ -227,6 +248,7 @@ void obs_output_destroy(obs_output_t *output)
 		os_event_destroy(output->reconnect_stop_event);
 		obs_context_data_free(&output->context);
 		circlebuf_free(&output->delay_data);
+		bfree(output->delay_spill_dir);
 		if (output->owns_info_id)
 			bfree((void *)output->info.id);
 		if (output->last_error_message)
@@ -1876,6 +1898,7 @@ static void hook_data_capture(struct obs_output *output, bool encoded,
 			output->delay_callback = encoded_callback;
 			encoded_callback = process_delay;
 			os_atomic_set_bool(&output->delay_active, true);
+			obs_output_start_delay_thread(output);
 
 			blog(LOG_INFO,
 			     "Output '%s': %" PRIu32 " second delay "
@@ -2221,6 +2244,7 @@ static void *end_data_capture_thread(void *data)
 	if (has_service)
 		obs_service_deactivate(output->service, false);
 
+	obs_output_stop_delay_thread(output);
 	if (output->active_delay_ns)
 		obs_output_cleanup_delay(output);
 
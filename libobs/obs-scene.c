@@ -226,6 +226,8 @@ static void scene_enum_all_sources(void *data,
 
 static inline void detach_sceneitem(struct obs_scene_item *item)
 {
+	obs_source_content_changed(item->parent->source);
+
 	if (item->prev)
 		item->prev->next = item->next;
 	else
@@ -244,6 +246,8 @@ static inline void attach_sceneitem(struct obs_scene *parent,
 	item->prev = prev;
 	item->parent = parent;
 
+	obs_source_content_changed(parent->source);
+
 	if (prev) {
 		item->next = prev->next;
 		if (prev->next)
@@ -349,6 +353,9 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 	if (os_atomic_load_long(&item->defer_update) > 0)
 		return;
 
+	if (item->parent)
+		obs_source_content_changed(item->parent->source);
+
 	width = obs_source_get_width(item->source);
 	height = obs_source_get_height(item->source);
 	cx = calc_cx(item, width);
@@ -685,6 +692,9 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 
 static void set_visibility(struct obs_scene_item *item, bool vis)
 {
+	if (item->parent)
+		obs_source_content_changed(item->parent->source);
+
 	pthread_mutex_lock(&item->actions_mutex);
 
 	da_resize(item->audio_actions, 0);
@@ -941,13 +951,21 @@ static void scene_save(void *data, obs_data_t *settings)
 static uint32_t scene_getwidth(void *data)
 {
 	obs_scene_t *scene = data;
-	return scene->custom_size ? scene->cx : obs->video.base_width;
+	struct obs_core_video_mix *mix = obs->video.main_mix;
+
+	if (scene->custom_size)
+		return scene->cx;
+	return mix ? mix->base_width : 0;
 }
 
 static uint32_t scene_getheight(void *data)
 {
 	obs_scene_t *scene = data;
-	return scene->custom_size ? scene->cy : obs->video.base_height;
+	struct obs_core_video_mix *mix = obs->video.main_mix;
+
+	if (scene->custom_size)
+		return scene->cy;
+	return mix ? mix->base_height : 0;
 }
 
 static void apply_scene_item_audio_actions(struct obs_scene_item *item,
@@ -17,7 +17,7 @@
 
 #include "obs-internal.h"
 
-const struct obs_service_info *find_service(const char *id)
+static const struct obs_service_info *find_service_info(const char *id)
 {
 	size_t i;
 	for (i = 0; i < obs->service_types.num; i++)
@@ -27,6 +27,23 @@ const struct obs_service_info *find_service(const char *id)
 	return NULL;
 }
 
+const struct obs_service_info *find_service(const char *id)
+{
+	const struct obs_service_info *info;
+
+	pthread_mutex_lock(&obs->types_mutex);
+	info = find_service_info(id);
+	pthread_mutex_unlock(&obs->types_mutex);
+
+	if (!info && obs_load_pending_module(id)) {
+		pthread_mutex_lock(&obs->types_mutex);
+		info = find_service_info(id);
+		pthread_mutex_unlock(&obs->types_mutex);
+	}
+
+	return info;
+}
+
 const char *obs_service_get_display_name(const char *id)
 {
 	const struct obs_service_info *info = find_service(id);
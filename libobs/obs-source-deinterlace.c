@@ -19,7 +19,8 @@
 
 static bool ready_deinterlace_frames(obs_source_t *source, uint64_t sys_time)
 {
-	struct obs_source_frame *next_frame = source->async_frames.array[0];
+	struct async_frame_queue *q = &source->async_frames;
+	struct obs_source_frame *next_frame = async_queue_peek(q, 0);
 	struct obs_source_frame *prev_frame = NULL;
 	struct obs_source_frame *frame = NULL;
 	uint64_t sys_offset = sys_time - source->last_sys_timestamp;
@@ -28,20 +29,20 @@ static bool ready_deinterlace_frames(obs_source_t *source, uint64_t sys_time)
 	size_t idx = 1;
 
 	if (source->async_unbuffered) {
-		while (source->async_frames.num > 2) {
-			da_erase(source->async_frames, 0);
-			remove_async_frame(source, next_frame);
-			next_frame = source->async_frames.array[0];
+		while (async_queue_count(q) > 2) {
+			async_queue_pop(q);
+			defer_async_frame_release(source, next_frame);
+			next_frame = async_queue_peek(q, 0);
 		}
 
-		if (source->async_frames.num == 2) {
+		if (async_queue_count(q) == 2) {
 			bool prev_frame = true;
 			if (source->async_unbuffered &&
 			    source->deinterlace_offset) {
 				const uint64_t timestamp =
-					source->async_frames.array[0]->timestamp;
+					async_queue_peek(q, 0)->timestamp;
 				const uint64_t after_timestamp =
-					source->async_frames.array[1]->timestamp;
+					async_queue_peek(q, 1)->timestamp;
 				const uint64_t duration =
 					after_timestamp - timestamp;
 				const uint64_t frame_end =
@@ -54,7 +55,7 @@ static bool ready_deinterlace_frames(obs_source_t *source, uint64_t sys_time)
 						timestamp - duration;
 				}
 			}
-			source->async_frames.array[0]->prev_frame = prev_frame;
+			async_queue_peek(q, 0)->prev_frame = prev_frame;
 		}
 		source->deinterlace_offset = 0;
 		source->last_frame_ts = next_frame->timestamp;
@@ -81,17 +82,17 @@ static bool ready_deinterlace_frames(obs_source_t *source, uint64_t sys_time)
 			break;
 
 		if (prev_frame) {
-			da_erase(source->async_frames, 0);
-			remove_async_frame(source, prev_frame);
+			async_queue_pop(q);
+			defer_async_frame_release(source, prev_frame);
 		}
 
-		if (source->async_frames.num <= 2) {
+		if (async_queue_count(q) <= 2) {
 			bool exit = true;
 
 			if (prev_frame) {
 				prev_frame->prev_frame = true;
 
-			} else if (!frame && source->async_frames.num == 2) {
+			} else if (!frame && async_queue_count(q) == 2) {
 				exit = false;
 			}
 
@@ -108,7 +109,7 @@ static bool ready_deinterlace_frames(obs_source_t *source, uint64_t sys_time)
 
 		prev_frame = frame;
 		frame = next_frame;
-		next_frame = source->async_frames.array[idx];
+		next_frame = async_queue_peek(q, idx);
 
 		/* more timestamp checking and compensating */
 		if ((next_frame->timestamp - frame_time) > MAX_TS_VAR) {
@@ -132,8 +133,8 @@ static inline bool first_frame(obs_source_t *s)
 	if (s->last_frame_ts)
 		return false;
 
-	if (s->async_frames.num >= 2)
-		s->async_frames.array[0]->prev_frame = true;
+	if (async_queue_count(&s->async_frames) >= 2)
+		async_queue_peek(&s->async_frames, 0)->prev_frame = true;
 	return true;
 }
 
@@ -145,9 +146,11 @@ static inline uint64_t uint64_diff(uint64_t ts1, uint64_t ts2)
 #define TWOX_TOLERANCE 1000000
 #define TS_JUMP_THRESHOLD 70000000ULL
 
-static inline void deinterlace_get_closest_frames(obs_source_t *s,
-						  uint64_t sys_time)
+void deinterlace_get_closest_frames(obs_source_t *s, uint64_t sys_time,
+				    struct obs_source_frame **prev,
+				    struct obs_source_frame **cur)
 {
+	struct async_frame_queue *q = &s->async_frames;
 	const struct video_output_info *info;
 	uint64_t half_interval;
 
@@ -166,42 +169,40 @@ static inline void deinterlace_get_closest_frames(obs_source_t *s,
 		}
 	}
 
-	if (!s->async_frames.num)
+	if (!async_queue_count(q))
 		return;
 
-	info = video_output_get_info(obs->video.video);
+	info = video_output_get_info(obs->video.main_mix->video);
 	half_interval = (uint64_t)info->fps_den * 500000000ULL /
 			(uint64_t)info->fps_num;
 
 	if (first_frame(s) || ready_deinterlace_frames(s, sys_time)) {
 		uint64_t offset;
 
-		s->prev_async_frame = NULL;
-		s->cur_async_frame = s->async_frames.array[0];
+		*prev = NULL;
+		*cur = async_queue_peek(q, 0);
 
-		da_erase(s->async_frames, 0);
+		async_queue_pop(q);
 
-		if (s->cur_async_frame->prev_frame) {
-			s->prev_async_frame = s->cur_async_frame;
-			s->cur_async_frame = s->async_frames.array[0];
+		if ((*cur)->prev_frame) {
+			*prev = *cur;
+			*cur = async_queue_peek(q, 0);
 
-			da_erase(s->async_frames, 0);
+			async_queue_pop(q);
 
-			s->deinterlace_half_duration =
-				(uint32_t)((s->cur_async_frame->timestamp -
-					    s->prev_async_frame->timestamp) /
-					   2);
+			s->deinterlace_half_duration = (uint32_t)(
+				((*cur)->timestamp - (*prev)->timestamp) / 2);
 		} else {
 			s->deinterlace_half_duration =
-				(uint32_t)((s->cur_async_frame->timestamp -
+				(uint32_t)(((*cur)->timestamp -
 					    s->deinterlace_frame_ts) /
 					   2);
 		}
 
 		if (!s->last_frame_ts)
-			s->last_frame_ts = s->cur_async_frame->timestamp;
+			s->last_frame_ts = (*cur)->timestamp;
 
-		s->deinterlace_frame_ts = s->cur_async_frame->timestamp;
+		s->deinterlace_frame_ts = (*cur)->timestamp;
 
 		offset = obs->video.video_time - s->deinterlace_frame_ts;
 
@@ -216,20 +217,6 @@ static inline void deinterlace_get_closest_frames(obs_source_t *s,
 	}
 }
 
-void deinterlace_process_last_frame(obs_source_t *s, uint64_t sys_time)
-{
-	if (s->prev_async_frame) {
-		remove_async_frame(s, s->prev_async_frame);
-		s->prev_async_frame = NULL;
-	}
-	if (s->cur_async_frame) {
-		remove_async_frame(s, s->cur_async_frame);
-		s->cur_async_frame = NULL;
-	}
-
-	deinterlace_get_closest_frames(s, sys_time);
-}
-
 void set_deinterlace_texture_size(obs_source_t *source)
 {
 	if (source->async_gpu_conversion) {
@@ -258,7 +245,7 @@ static inline struct obs_source_frame *get_prev_frame(obs_source_t *source,
 {
 	struct obs_source_frame *frame = NULL;
 
-	pthread_mutex_lock(&source->async_mutex);
+	lock_async(source, false);
 
 	*updated = source->cur_async_frame != NULL;
 	frame = source->prev_async_frame;
@@ -43,7 +43,7 @@ static inline bool deinterlacing_enabled(const struct obs_source *source)
 	return source->deinterlace_mode != OBS_DEINTERLACE_MODE_DISABLE;
 }
 
-struct obs_source_info *get_source_info(const char *id)
+static struct obs_source_info *find_source_info(const char *id)
 {
 	for (size_t i = 0; i < obs->source_types.num; i++) {
 		struct obs_source_info *info = &obs->source_types.array[i];
@@ -54,17 +54,41 @@ struct obs_source_info *get_source_info(const char *id)
 	return NULL;
 }
 
+struct obs_source_info *get_source_info(const char *id)
+{
+	struct obs_source_info *info;
+
+	pthread_mutex_lock(&obs->types_mutex);
+	info = find_source_info(id);
+	pthread_mutex_unlock(&obs->types_mutex);
+
+	if (!info && obs_load_pending_module(id)) {
+		pthread_mutex_lock(&obs->types_mutex);
+		info = find_source_info(id);
+		pthread_mutex_unlock(&obs->types_mutex);
+	}
+
+	return info;
+}
+
 struct obs_source_info *get_source_info2(const char *unversioned_id,
 					 uint32_t ver)
 {
+	struct obs_source_info *found = NULL;
+
+	pthread_mutex_lock(&obs->types_mutex);
+
 	for (size_t i = 0; i < obs->source_types.num; i++) {
 		struct obs_source_info *info = &obs->source_types.array[i];
 		if (strcmp(info->unversioned_id, unversioned_id) == 0 &&
-		    info->version == ver)
-			return info;
+		    info->version == ver) {
+			found = info;
+			break;
+		}
 	}
 
-	return NULL;
+	pthread_mutex_unlock(&obs->types_mutex);
+	return found;
 }
 
 static const char *source_signals[] = {
@@ -606,6 +630,21 @@ static inline void obs_source_frame_decref(struct obs_source_frame *frame)
 		obs_source_frame_destroy(frame);
 }
 
+/* hands borrowed frames back to their source.  must be called without the
+ * async mutex held, as the release callbacks may take the source's own locks
+ * while it is outputting video */
+static void return_borrowed_frames(struct darray *frames)
+{
+	struct async_frame *array = frames->array;
+
+	for (size_t i = 0; i < frames->num; i++) {
+		array[i].release(array[i].param);
+		bfree(array[i].frame);
+	}
+
+	darray_free(frames);
+}
+
 static bool obs_source_filter_remove_refless(obs_source_t *source,
 					     obs_source_t *filter);
 
@@ -652,8 +691,16 @@ void obs_source_destroy(struct obs_source *source)
 	obs_hotkey_unregister(source->push_to_mute_key);
 	obs_hotkey_pair_unregister(source->mute_unmute_key);
 
-	for (i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
+	for (i = 0; i < source->async_cache.num; i++) {
+		struct async_frame *af = &source->async_cache.array[i];
+
+		if (af->release)
+			da_push_back(source->async_returned, af);
+		else
+			obs_source_frame_decref(af->frame);
+	}
+
+	return_borrowed_frames(&source->async_returned.da);
 
 	gs_enter_context(obs->video.graphics);
 	if (source->async_texrender)
@@ -684,7 +731,7 @@ void obs_source_destroy(struct obs_source *source)
 	da_free(source->audio_actions);
 	da_free(source->audio_cb_list);
 	da_free(source->async_cache);
-	da_free(source->async_frames);
+	da_free(source->async_released);
 	da_free(source->filters);
 	pthread_mutex_destroy(&source->filter_mutex);
 	pthread_mutex_destroy(&source->audio_actions_mutex);
@@ -894,6 +941,7 @@ static void obs_source_deferred_update(obs_source_t *source)
 				    source->context.settings);
 		os_atomic_compare_swap_long(&source->defer_update_count, count,
 					    0);
+		obs_source_content_changed(source);
 	}
 }
 
@@ -1093,29 +1141,57 @@ static inline struct obs_source_frame *get_closest_frame(obs_source_t *source,
 bool set_async_texture_size(struct obs_source *source,
 			    const struct obs_source_frame *frame);
 
+static inline void release_deferred_frames(obs_source_t *source)
+{
+	for (size_t i = 0; i < source->async_released.num; i++)
+		remove_async_frame(source, source->async_released.array[i]);
+
+	da_resize(source->async_released, 0);
+}
+
+static void flush_async_frames(obs_source_t *source);
+
 static void async_tick(obs_source_t *source)
 {
 	uint64_t sys_time = obs->video.video_time;
+	struct obs_source_frame *prev = NULL;
+	struct obs_source_frame *cur = NULL;
 
-	pthread_mutex_lock(&source->async_mutex);
+	if (os_atomic_load_bool(&source->async_flush))
+		flush_async_frames(source);
 
-	if (deinterlacing_enabled(source)) {
-		deinterlace_process_last_frame(source, sys_time);
-	} else {
-		if (source->cur_async_frame) {
-			remove_async_frame(source, source->cur_async_frame);
-			source->cur_async_frame = NULL;
-		}
+	/* only this thread pops from the queue, and queued frames stay marked
+	 * as used until they're released below, so the frame matching can
+	 * run without holding the async mutex */
+	if (deinterlacing_enabled(source))
+		deinterlace_get_closest_frames(source, sys_time, &prev, &cur);
+	else
+		cur = get_closest_frame(source, sys_time);
 
-		source->cur_async_frame = get_closest_frame(source, sys_time);
-	}
+	DARRAY(struct async_frame) returned;
+	da_init(returned);
 
+	lock_async(source, false);
+
+	if (source->prev_async_frame)
+		remove_async_frame(source, source->prev_async_frame);
+	if (source->cur_async_frame)
+		remove_async_frame(source, source->cur_async_frame);
+	release_deferred_frames(source);
+	da_move(returned, source->async_returned);
+
+	source->prev_async_frame = prev;
+	source->cur_async_frame = cur;
 	source->last_sys_timestamp = sys_time;
 	pthread_mutex_unlock(&source->async_mutex);
 
-	if (source->cur_async_frame)
+	return_borrowed_frames(&returned.da);
+
+	if (source->cur_async_frame) {
 		source->async_update_texture =
 			set_async_texture_size(source, source->cur_async_frame);
+		obs_source_content_changed(source);
+	}
 }
 
 void obs_source_video_tick(obs_source_t *source, float seconds)
@@ -2419,6 +2495,8 @@ void obs_source_filter_add(obs_source_t *source, obs_source_t *filter)
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	obs_source_content_changed(source);
+
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "source", source);
 	calldata_set_ptr(&cd, "filter", filter);
@@ -2453,6 +2531,8 @@ static bool obs_source_filter_remove_refless(obs_source_t *source,
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	obs_source_content_changed(source);
+
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "source", source);
 	calldata_set_ptr(&cd, "filter", filter);
@@ -2580,8 +2660,10 @@ void obs_source_filter_set_order(obs_source_t *source, obs_source_t *filter,
 	success = move_filter_dir(source, filter, movement);
 	pthread_mutex_unlock(&source->filter_mutex);
 
-	if (success)
+	if (success) {
+		obs_source_content_changed(source);
 		obs_source_dosignal(source, NULL, "reorder_filters");
+	}
 }
 
 obs_data_t *obs_source_get_settings(const obs_source_t *source)
@@ -2725,15 +2807,46 @@ static inline bool async_texture_changed(struct obs_source *source,
 	       source->async_cache_height != frame->height || prev != cur;
 }
 
-static inline void free_async_cache(struct obs_source *source)
+/* the producer can't empty the queue itself, so it stops outputting frames
+ * and asks the graphics thread to do it on the next tick */
+static void flush_async_frames(obs_source_t *source)
 {
-	for (size_t i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
+	struct async_frame_queue *q = &source->async_frames;
+
+	DARRAY(struct async_frame) returned;
+	da_init(returned);
+
+	lock_async(source, false);
+
+	while (async_queue_count(q))
+		async_queue_pop(q);
+
+	for (size_t i = source->async_cache.num; i > 0; i--) {
+		struct async_frame *af = &source->async_cache.array[i - 1];
+
+		if (!af->release) {
+			obs_source_frame_decref(af->frame);
+		} else if (os_atomic_load_long(&af->frame->refs) > 1) {
+			/* still held by obs_source_get_frame, it is handed
+			 * back when the holder releases it */
+			continue;
+		} else {
+			da_push_back(returned, af);
+		}
 
-	da_resize(source->async_cache, 0);
-	da_resize(source->async_frames, 0);
+		da_erase(source->async_cache, i - 1);
+	}
+
+	da_resize(source->async_released, 0);
 	source->cur_async_frame = NULL;
 	source->prev_async_frame = NULL;
+	source->last_frame_ts = 0;
+	source->async_stats.flushes++;
+
+	os_atomic_set_bool(&source->async_flush, false);
+	pthread_mutex_unlock(&source->async_mutex);
+
+	return_borrowed_frames(&returned.da);
 }
 
 #define MAX_UNUSED_FRAME_DURATION 5
@@ -2754,30 +2867,47 @@ static void clean_cache(obs_source_t *source)
 }
 
 #define MAX_ASYNC_FRAMES 30
-//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
-static inline struct obs_source_frame *
-cache_video(struct obs_source *source, const struct obs_source_frame *frame)
-{
-	struct obs_source_frame *new_frame = NULL;
 
-	pthread_mutex_lock(&source->async_mutex);
+/* checks whether a new frame can be queued and updates the cache format,
+ * called by the producer with the async mutex held */
+static bool can_cache_video(struct obs_source *source,
+			    const struct obs_source_frame *frame)
+{
+	/* frames are dropped until the graphics thread has flushed */
+	if (os_atomic_load_bool(&source->async_flush))
+		return false;
 
-	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
-		free_async_cache(source);
-		source->last_frame_ts = 0;
-		pthread_mutex_unlock(&source->async_mutex);
-		return NULL;
+	if (async_queue_count(&source->async_frames) >= MAX_ASYNC_FRAMES) {
+		os_atomic_set_bool(&source->async_flush, true);
+		return false;
 	}
 
 	if (async_texture_changed(source, frame)) {
-		free_async_cache(source);
+		if (source->async_cache.num) {
+			os_atomic_set_bool(&source->async_flush, true);
+			return false;
+		}
+
 		source->async_cache_width = frame->width;
 		source->async_cache_height = frame->height;
 	}
 
-	const enum video_format format = frame->format;
-	source->async_cache_format = format;
+	source->async_cache_format = frame->format;
 	source->async_cache_full_range = frame->full_range;
+	return true;
+}
+//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
+static inline struct obs_source_frame *
+cache_video(struct obs_source *source, const struct obs_source_frame *frame)
+{
+	struct obs_source_frame *new_frame = NULL;
+
+	lock_async(source, true);
+
+	if (!can_cache_video(source, frame))
+		goto drop;
+
+	const enum video_format format = frame->format;
 
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *af = &source->async_cache.array[i];
@@ -2800,6 +2930,8 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 		new_af.frame = new_frame;
 		new_af.used = true;
 		new_af.unused_count = 0;
+		new_af.release = NULL;
+		new_af.param = NULL;
 		new_frame->refs = 1;
 
 		da_push_back(source->async_cache, &new_af);
@@ -2812,6 +2944,69 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 	copy_frame_data(new_frame, frame);
 
 	return new_frame;
+
+drop:
+	source->async_stats.frames_dropped++;
+	pthread_mutex_unlock(&source->async_mutex);
+	return NULL;
+}
+
+/* same as cache_video, but the frame data is used in place and the source
+ * gets it back through release once the frame is no longer used */
+static inline struct obs_source_frame *
+cache_video_borrowed(struct obs_source *source,
+		     const struct obs_source_frame *frame,
+		     void (*release)(void *param), void *param)
+{
+	struct async_frame new_af;
+
+	lock_async(source, true);
+
+	if (!can_cache_video(source, frame)) {
+		source->async_stats.frames_dropped++;
+		pthread_mutex_unlock(&source->async_mutex);
+		release(param);
+		return NULL;
+	}
+
+	clean_cache(source);
+
+	new_af.frame = bmemdup(frame, sizeof(*frame));
+	new_af.frame->refs = 2;
+	new_af.frame->prev_frame = false;
+	new_af.used = true;
+	new_af.unused_count = 0;
+	new_af.release = release;
+	new_af.param = param;
+	da_push_back(source->async_cache, &new_af);
+
+	pthread_mutex_unlock(&source->async_mutex);
+	return new_af.frame;
+}
+
+static void queue_async_frame(obs_source_t *source,
+			      struct obs_source_frame *output)
+{
+	if (os_atomic_dec_long(&output->refs) == 0) {
+		obs_source_frame_destroy(output);
+		return;
+	}
+
+	lock_async(source, true);
+
+	/* frames are copied outside the lock, so several producers can get
+	 * past can_cache_video before any of them has pushed.  the frame is
+	 * left in the cache for the flush to clean up */
+	if (async_queue_count(&source->async_frames) >= ASYNC_QUEUE_SIZE) {
+		os_atomic_set_bool(&source->async_flush, true);
+		source->async_stats.frames_dropped++;
+	} else {
+		async_queue_push(&source->async_frames, output);
+		source->async_stats.frames_output++;
+		source->async_active = true;
+	}
+
+	pthread_mutex_unlock(&source->async_mutex);
 }
 
 static void
@@ -2826,21 +3021,9 @@ obs_source_output_video_internal(obs_source_t *source,
 		return;
 	}
 
-	struct obs_source_frame *output = !!frame ? cache_video(source, frame)
-						  : NULL;
-
-	/* ------------------------------------------- */
-	pthread_mutex_lock(&source->async_mutex);
-	if (output) {
-		if (os_atomic_dec_long(&output->refs) == 0) {
-			obs_source_frame_destroy(output);
-			output = NULL;
-		} else {
-			da_push_back(source->async_frames, &output);
-			source->async_active = true;
-		}
-	}
-	pthread_mutex_unlock(&source->async_mutex);
+	struct obs_source_frame *output = cache_video(source, frame);
+	if (output)
+		queue_async_frame(source, output);
 }
 
 void obs_source_output_video(obs_source_t *source,
@@ -2858,6 +3041,29 @@ void obs_source_output_video(obs_source_t *source,
 	obs_source_output_video_internal(source, &new_frame);
 }
 
+void obs_source_output_video_borrowed(obs_source_t *source,
+				      const struct obs_source_frame *frame,
+				      void (*release)(void *param),
+				      void *param)
+{
+	if (!obs_ptr_valid(release, "obs_source_output_video_borrowed"))
+		return;
+	if (!obs_source_valid(source, "obs_source_output_video_borrowed") ||
+	    !obs_ptr_valid(frame, "obs_source_output_video_borrowed")) {
+		release(param);
+		return;
+	}
+
+	struct obs_source_frame new_frame = *frame;
+	new_frame.full_range =
+		format_is_yuv(frame->format) ? new_frame.full_range : true;
+
+	struct obs_source_frame *output =
+		cache_video_borrowed(source, &new_frame, release, param);
+	if (output)
+		queue_async_frame(source, output);
+}
+
 void obs_source_output_video2(obs_source_t *source,
 			      const struct obs_source_frame2 *frame)
 {
@@ -3299,7 +3505,12 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 		struct async_frame *f = &source->async_cache.array[i];
 
 		if (f->frame == frame) {
-			f->used = false;
+			if (f->release) {
+				da_push_back(source->async_returned, f);
+				da_erase(source->async_cache, i);
+			} else {
+				f->used = false;
+			}
 			break;
 		}
 	}
@@ -3309,17 +3520,18 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 
 static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 {
-	struct obs_source_frame *next_frame = source->async_frames.array[0];
+	struct async_frame_queue *q = &source->async_frames;
+	struct obs_source_frame *next_frame = async_queue_peek(q, 0);
 	struct obs_source_frame *frame = NULL;
 	uint64_t sys_offset = sys_time - source->last_sys_timestamp;
 	uint64_t frame_time = next_frame->timestamp;
 	uint64_t frame_offset = 0;
 
 	if (source->async_unbuffered) {
-		while (source->async_frames.num > 1) {
-			da_erase(source->async_frames, 0);
-			remove_async_frame(source, next_frame);
-			next_frame = source->async_frames.array[0];
+		while (async_queue_count(q) > 1) {
+			async_queue_pop(q);
+			defer_async_frame_release(source, next_frame);
+			next_frame = async_queue_peek(q, 0);
 		}
 
 		source->last_frame_ts = next_frame->timestamp;
@@ -3333,7 +3545,7 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 	     "number of frames: %lu",
 	     source->last_frame_ts, frame_time, sys_offset,
 	     frame_time - source->last_frame_ts,
-	     (unsigned long)source->async_frames.num);
+	     (unsigned long)async_queue_count(q));
 #endif
 
 	/* account for timestamp invalidation */
@@ -3358,7 +3570,7 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 			break;
 
 		if (frame)
-			da_erase(source->async_frames, 0);
+			async_queue_pop(q);
 
 #if DEBUG_ASYNC_FRAMES
 		blog(LOG_DEBUG,
@@ -3368,13 +3580,13 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 		     source->last_frame_ts, next_frame->timestamp);
 #endif
 
-		remove_async_frame(source, frame);
+		defer_async_frame_release(source, frame);
 
-		if (source->async_frames.num == 1)
+		if (async_queue_count(q) == 1)
 			return true;
 
 		frame = next_frame;
-		next_frame = source->async_frames.array[1];
+		next_frame = async_queue_peek(q, 1);
 
 		/* more timestamp checking and compensating */
 		if ((next_frame->timestamp - frame_time) > MAX_TS_VAR) {
@@ -3400,12 +3612,14 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 static inline struct obs_source_frame *get_closest_frame(obs_source_t *source,
 							 uint64_t sys_time)
 {
-	if (!source->async_frames.num)
+	struct async_frame_queue *q = &source->async_frames;
+
+	if (!async_queue_count(q))
 		return NULL;
 
 	if (!source->last_frame_ts || ready_async_frame(source, sys_time)) {
-		struct obs_source_frame *frame = source->async_frames.array[0];
-		da_erase(source->async_frames, 0);
+		struct obs_source_frame *frame = async_queue_peek(q, 0);
+		async_queue_pop(q);
 
 		if (!source->last_frame_ts)
 			source->last_frame_ts = frame->timestamp;
@@ -3429,7 +3643,7 @@ struct obs_source_frame *obs_source_get_frame(obs_source_t *source)
 	if (!obs_source_valid(source, "obs_source_get_frame"))
 		return NULL;
 
-	pthread_mutex_lock(&source->async_mutex);
+	lock_async(source, false);
 
 	frame = source->cur_async_frame;
 	source->cur_async_frame = NULL;
@@ -3452,17 +3666,37 @@ void obs_source_release_frame(obs_source_t *source,
 	if (!source) {
 		obs_source_frame_destroy(frame);
 	} else {
-		pthread_mutex_lock(&source->async_mutex);
+		DARRAY(struct async_frame) returned;
+		da_init(returned);
+
+		lock_async(source, false);
 
 		if (os_atomic_dec_long(&frame->refs) == 0)
 			obs_source_frame_destroy(frame);
 		else
 			remove_async_frame(source, frame);
+		da_move(returned, source->async_returned);
 
 		pthread_mutex_unlock(&source->async_mutex);
+
+		return_borrowed_frames(&returned.da);
 	}
 }
 
+bool obs_source_get_async_stats(const obs_source_t *source,
+				struct obs_source_async_stats *stats)
+{
+	if (!obs_source_valid(source, "obs_source_get_async_stats"))
+		return false;
+	if ((source->info.output_flags & OBS_SOURCE_ASYNC) == 0)
+		return false;
+
+	pthread_mutex_lock((pthread_mutex_t *)&source->async_mutex);
+	*stats = source->async_stats;
+	pthread_mutex_unlock((pthread_mutex_t *)&source->async_mutex);
+	return true;
+}
+
 const char *obs_source_get_name(const obs_source_t *source)
 {
 	return obs_source_valid(source, "obs_source_get_name")
@@ -4223,6 +4457,7 @@ void obs_source_set_enabled(obs_source_t *source, bool enabled)
 		return;
 
 	source->enabled = enabled;
+	obs_source_content_changed(source);
 
 	calldata_init_fixed(&data, stack, sizeof(stack));
 	calldata_set_ptr(&data, "source", source);
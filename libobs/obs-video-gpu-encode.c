@@ -20,7 +20,8 @@
 static void *gpu_encode_thread(void *unused)
 {
 	struct obs_core_video *video = &obs->video;
-	uint64_t interval = video_output_get_frame_time(obs->video.video);
+	video_t *main_video = video->main_mix->video;
+	uint64_t interval = video_output_get_frame_time(main_video);
 	DARRAY(obs_encoder_t *) encoders;
 	int wait_frames = NUM_ENCODE_TEXTURE_FRAMES_TO_WAIT;
 
@@ -55,7 +56,7 @@ static void *gpu_encode_thread(void *unused)
 		lock_key = tf.lock_key;
 		next_key = tf.lock_key;
 
-		video_output_inc_texture_frames(video->video);
+		video_output_inc_texture_frames(main_video);
 
 		for (size_t i = 0; i < video->gpu_encoders.num; i++) {
 			obs_encoder_t *encoder = obs_encoder_get_ref(
@@ -121,7 +122,7 @@ static void *gpu_encode_thread(void *unused)
 			circlebuf_push_front(&video->gpu_encoder_queue, &tf,
 					     sizeof(tf));
 
-			video_output_inc_texture_skipped_frames(video->video);
+			video_output_inc_texture_skipped_frames(main_video);
 		} else {
 			circlebuf_push_back(&video->gpu_encoder_avail_queue,
 					    &tf, sizeof(tf));
@@ -146,7 +147,7 @@ static void *gpu_encode_thread(void *unused)
 bool init_gpu_encoding(struct obs_core_video *video)
 {
 #ifdef _WIN32
-	struct obs_video_info *ovi = &video->ovi;
+	struct obs_video_info *ovi = &video->main_mix->ovi;
 
 	video->gpu_encode_stop = false;
 
@@ -37,8 +37,7 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	float seconds;
 
 	if (!last_time)
-		last_time = cur_time -
-			    video_output_get_frame_time(obs->video.video);
+		last_time = cur_time - obs->video.main_mix->frame_interval_ns;
 
 	delta_time = cur_time - last_time;
 	seconds = (float)((double)delta_time / 1000000000.0);
@@ -78,11 +77,32 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 }
 
 /* in obs-display.c */
-extern void render_display(struct obs_display *display);
+extern void render_display(struct obs_display *display, uint64_t ts);
+
+/* displays are only rendered if they're due.  a display that opted in with
+ * obs_display_set_skip_when_late is also skipped until the next frame when
+ * its previous render time doesn't fit before the next output frame, so
+ * that it never delays output.  the estimate decays with every skip and a
+ * render is forced after MAX_DISPLAY_SKIPS skips in a row, so that a single
+ * slow render (swap chain resize, a present blocked on vsync) can't keep a
+ * display frozen */
+#define MAX_DISPLAY_SKIPS 8
+
+static inline bool display_fits(struct obs_display *display, uint64_t deadline)
+{
+	if (!os_atomic_load_bool(&display->skip_when_late))
+		return true;
+	if (display->consecutive_skips >= MAX_DISPLAY_SKIPS)
+		return true;
+
+	return os_gettime_ns() + display->render_ns < deadline;
+}
 
-static inline void render_displays(void)
+static inline void render_displays(uint64_t interval)
 {
 	struct obs_display *display;
+	uint64_t ts = obs->video.video_time;
+	uint64_t deadline = ts + interval;
 
 	if (!obs->data.valid)
 		return;
@@ -94,7 +114,21 @@ static inline void render_displays(void)
 
 	display = obs->data.first_display;
 	while (display) {
-		render_display(display);
+		if (!render_display_needed(display, ts)) {
+			display = display->next;
+			continue;
+		}
+
+		if (display_fits(display, deadline)) {
+			render_display(display, ts);
+			display->consecutive_skips = 0;
+		} else {
+			display->skipped_frames++;
+			display->consecutive_skips++;
+			display->render_ns -= display->render_ns / 4;
+			os_atomic_set_bool(&display->redraw, true);
+		}
+
 		display = display->next;
 	}
 
@@ -112,7 +146,7 @@ static inline void set_render_size(uint32_t width, uint32_t height)
 	gs_set_viewport(0, 0, width, height);
 }
 
-static inline void unmap_last_surface(struct obs_core_video *video)
+static inline void unmap_last_surface(struct obs_core_video_mix *video)
 {
 	for (int c = 0; c < NUM_CHANNELS; ++c) {
 		if (video->mapped_surfaces[c]) {
@@ -123,7 +157,7 @@ static inline void unmap_last_surface(struct obs_core_video *video)
 }
 
 static const char *render_main_texture_name = "render_main_texture";
-static inline void render_main_texture(struct obs_core_video *video)
+static inline void render_main_texture(struct obs_core_video_mix *video)
 {
 	profile_start(render_main_texture_name);
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_MAIN_TEXTURE,
@@ -137,19 +171,22 @@ static inline void render_main_texture(struct obs_core_video *video)
 
 	set_render_size(video->base_width, video->base_height);
 
-	pthread_mutex_lock(&obs->data.draw_callbacks_mutex);
+	/* main texture draw callbacks only apply to the main mix */
+	if (video == obs->video.main_mix) {
+		pthread_mutex_lock(&obs->data.draw_callbacks_mutex);
 
-	for (size_t i = obs->data.draw_callbacks.num; i > 0; i--) {
-		struct draw_callback *callback;
-		callback = obs->data.draw_callbacks.array + (i - 1);
+		for (size_t i = obs->data.draw_callbacks.num; i > 0; i--) {
+			struct draw_callback *callback;
+			callback = obs->data.draw_callbacks.array + (i - 1);
 
-		callback->draw(callback->param, video->base_width,
-			       video->base_height);
-	}
+			callback->draw(callback->param, video->base_width,
+				       video->base_height);
+		}
 
-	pthread_mutex_unlock(&obs->data.draw_callbacks_mutex);
+		pthread_mutex_unlock(&obs->data.draw_callbacks_mutex);
+	}
 
-	obs_view_render(&obs->data.main_view);
+	obs_view_render(video->view);
 
 	video->texture_rendered = true;
 
@@ -158,17 +195,19 @@ static inline void render_main_texture(struct obs_core_video *video)
 }
 
 static inline gs_effect_t *
-get_scale_effect_internal(struct obs_core_video *video)
+get_scale_effect_internal(struct obs_core_video_mix *mix)
 {
+	struct obs_core_video *video = &obs->video;
+
 	/* if the dimension is under half the size of the original image,
 	 * bicubic/lanczos can't sample enough pixels to create an accurate
 	 * image, so use the bilinear low resolution effect instead */
-	if (video->output_width < (video->base_width / 2) &&
-	    video->output_height < (video->base_height / 2)) {
+	if (mix->output_width < (mix->base_width / 2) &&
+	    mix->output_height < (mix->base_height / 2)) {
 		return video->bilinear_lowres_effect;
 	}
 
-	switch (video->scale_type) {
+	switch (mix->scale_type) {
 	case OBS_SCALE_BILINEAR:
 		return video->default_effect;
 	case OBS_SCALE_LANCZOS:
@@ -182,24 +221,26 @@ get_scale_effect_internal(struct obs_core_video *video)
 	return video->bicubic_effect;
 }
 
-static inline bool resolution_close(struct obs_core_video *video,
+static inline bool resolution_close(struct obs_core_video_mix *mix,
 				    uint32_t width, uint32_t height)
 {
-	long width_cmp = (long)video->base_width - (long)width;
-	long height_cmp = (long)video->base_height - (long)height;
+	long width_cmp = (long)mix->base_width - (long)width;
+	long height_cmp = (long)mix->base_height - (long)height;
 
 	return labs(width_cmp) <= 16 && labs(height_cmp) <= 16;
 }
 
-static inline gs_effect_t *get_scale_effect(struct obs_core_video *video,
+static inline gs_effect_t *get_scale_effect(struct obs_core_video_mix *mix,
 					    uint32_t width, uint32_t height)
 {
-	if (resolution_close(video, width, height)) {
+	struct obs_core_video *video = &obs->video;
+
+	if (resolution_close(mix, width, height)) {
 		return video->default_effect;
 	} else {
 		/* if the scale method couldn't be loaded, use either bicubic
 		 * or bilinear by default */
-		gs_effect_t *effect = get_scale_effect_internal(video);
+		gs_effect_t *effect = get_scale_effect_internal(mix);
 		if (!effect)
 			effect = !!video->bicubic_effect
 					 ? video->bicubic_effect
@@ -209,22 +250,23 @@ static inline gs_effect_t *get_scale_effect(struct obs_core_video *video,
 }
 
 static const char *render_output_texture_name = "render_output_texture";
-static inline gs_texture_t *render_output_texture(struct obs_core_video *video)
+static inline gs_texture_t *
+render_output_texture(struct obs_core_video_mix *mix)
 {
-	gs_texture_t *texture = video->render_texture;
-	gs_texture_t *target = video->output_texture;
+	struct obs_core_video *video = &obs->video;
+	gs_texture_t *texture = mix->render_texture;
+	gs_texture_t *target = mix->output_texture;
 	uint32_t width = gs_texture_get_width(target);
 	uint32_t height = gs_texture_get_height(target);
 
-	gs_effect_t *effect = get_scale_effect(video, width, height);
+	gs_effect_t *effect = get_scale_effect(mix, width, height);
 	gs_technique_t *tech;
 
-	if (video->ovi.output_format == VIDEO_FORMAT_RGBA) {
+	if (mix->ovi.output_format == VIDEO_FORMAT_RGBA) {
 		tech = gs_effect_get_technique(effect, "DrawAlphaDivide");
 	} else {
 		if ((effect == video->default_effect) &&
-		    (width == video->base_width) &&
-		    (height == video->base_height))
+		    (width == mix->base_width) && (height == mix->base_height))
 			return texture;
 
 		tech = gs_effect_get_technique(effect, "Draw");
@@ -244,15 +286,15 @@ static inline gs_texture_t *render_output_texture(struct obs_core_video *video)
 
 	if (bres) {
 		struct vec2 base;
-		vec2_set(&base, (float)video->base_width,
-			 (float)video->base_height);
+		vec2_set(&base, (float)mix->base_width,
+			 (float)mix->base_height);
 		gs_effect_set_vec2(bres, &base);
 	}
 
 	if (bres_i) {
 		struct vec2 base_i;
-		vec2_set(&base_i, 1.0f / (float)video->base_width,
-			 1.0f / (float)video->base_height);
+		vec2_set(&base_i, 1.0f / (float)mix->base_width,
+			 1.0f / (float)mix->base_height);
 		gs_effect_set_vec2(bres_i, &base_i);
 	}
 
@@ -294,12 +336,12 @@ static void render_convert_plane(gs_effect_t *effect, gs_texture_t *target,
 }
 
 static const char *render_convert_texture_name = "render_convert_texture";
-static void render_convert_texture(struct obs_core_video *video,
+static void render_convert_texture(struct obs_core_video_mix *video,
 				   gs_texture_t *texture)
 {
 	profile_start(render_convert_texture_name);
 
-	gs_effect_t *effect = video->conversion_effect;
+	gs_effect_t *effect = obs->video.conversion_effect;
 	gs_eparam_t *color_vec0 =
 		gs_effect_get_param_by_name(effect, "color_vec0");
 	gs_eparam_t *color_vec1 =
@@ -354,7 +396,7 @@ static void render_convert_texture(struct obs_core_video *video,
 }
 
 static const char *stage_output_texture_name = "stage_output_texture";
-static inline void stage_output_texture(struct obs_core_video *video,
+static inline void stage_output_texture(struct obs_core_video_mix *video,
 					int cur_texture)
 {
 	profile_start(stage_output_texture_name);
@@ -386,6 +428,7 @@ static inline void stage_output_texture(struct obs_core_video *video,
 static inline bool queue_frame(struct obs_core_video *video, bool raw_active,
 			       struct obs_vframe_info *vframe_info)
 {
+	struct obs_core_video_mix *mix = video->main_mix;
 	bool duplicate =
 		!video->gpu_encoder_avail_queue.size ||
 		(video->gpu_encoder_queue.size && vframe_info->count > 1);
@@ -418,13 +461,13 @@ static inline bool queue_frame(struct obs_core_video *video, bool raw_active,
 	 * reason.  otherwise, it goes to the 'duplicate' case above, which
 	 * will ensure better performance. */
 	if (raw_active || vframe_info->count > 1) {
-		gs_copy_texture(tf.tex, video->convert_textures[0]);
+		gs_copy_texture(tf.tex, mix->convert_textures[0]);
 	} else {
-		gs_texture_t *tex = video->convert_textures[0];
-		gs_texture_t *tex_uv = video->convert_textures[1];
+		gs_texture_t *tex = mix->convert_textures[0];
+		gs_texture_t *tex_uv = mix->convert_textures[1];
 
-		video->convert_textures[0] = tf.tex;
-		video->convert_textures[1] = tf.tex_uv;
+		mix->convert_textures[0] = tf.tex;
+		mix->convert_textures[1] = tf.tex_uv;
 
 		tf.tex = tex;
 		tf.tex_uv = tex_uv;
@@ -457,7 +500,7 @@ static void output_gpu_encoders(struct obs_core_video *video, bool raw_active)
 {
 	profile_start(output_gpu_encoders_name);
 
-	if (!video->texture_converted)
+	if (!video->main_mix->texture_converted)
 		goto end;
 	if (!video->vframe_info_buffer_gpu.size)
 		goto end;
@@ -475,8 +518,9 @@ end:
 }
 #endif
 
-static inline void render_video(struct obs_core_video *video, bool raw_active,
-				const bool gpu_active, int cur_texture)
+static inline void render_video(struct obs_core_video_mix *video,
+				bool raw_active, const bool gpu_active,
+				int cur_texture)
 {
 	gs_begin_scene();
 
@@ -499,7 +543,7 @@ static inline void render_video(struct obs_core_video *video, bool raw_active,
 #ifdef _WIN32
 		if (gpu_active) {
 			gs_flush();
-			output_gpu_encoders(video, raw_active);
+			output_gpu_encoders(&obs->video, raw_active);
 		}
 #endif
 
@@ -513,7 +557,7 @@ static inline void render_video(struct obs_core_video *video, bool raw_active,
 	gs_end_scene();
 }
 
-static inline bool download_frame(struct obs_core_video *video,
+static inline bool download_frame(struct obs_core_video_mix *video,
 				  int prev_texture, struct video_data *frame)
 {
 	if (!video->textures_copied[prev_texture])
@@ -553,7 +597,7 @@ static const uint8_t *set_gpu_converted_plane(uint32_t width, uint32_t height,
 	return in;
 }
 
-static void set_gpu_converted_data(struct obs_core_video *video,
+static void set_gpu_converted_data(struct obs_core_video_mix *video,
 				   struct video_frame *output,
 				   const struct video_data *input,
 				   const struct video_output_info *info)
@@ -684,7 +728,7 @@ static inline void copy_rgbx_frame(struct video_frame *output,
 	}
 }
 
-static inline void output_video_data(struct obs_core_video *video,
+static inline void output_video_data(struct obs_core_video_mix *video,
 				     struct video_data *input_frame, int count)
 {
 	const struct video_output_info *info;
@@ -707,32 +751,104 @@ static inline void output_video_data(struct obs_core_video *video,
 	}
 }
 
-static inline void video_sleep(struct obs_core_video *video, bool raw_active,
-			       const bool gpu_active, uint64_t *p_time,
-			       uint64_t interval_ns)
+static inline int pacing_bucket(uint64_t latency_ns)
 {
+	uint64_t us = latency_ns / 1000;
+	int bucket = 0;
+
+	while (us && bucket < OBS_VIDEO_PACING_BUCKETS - 1) {
+		us >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+static void set_realtime(struct obs_core_video *video,
+			 struct obs_graphics_context *context, bool realtime)
+{
+	bool success = os_set_thread_realtime(realtime);
+
+	if (realtime && !success) {
+		blog(LOG_WARNING, "Could not enable real-time scheduling for "
+				  "the graphics thread, insufficient "
+				  "privileges?");
+
+		/* don't retry every frame */
+		pthread_mutex_lock(&video->pacing_mutex);
+		video->pacing_realtime = false;
+		pthread_mutex_unlock(&video->pacing_mutex);
+	} else if (success) {
+		blog(LOG_INFO, "Graphics thread real-time scheduling %s",
+		     realtime ? "enabled" : "disabled");
+	}
+
+	context->realtime_active = realtime && success;
+}
+
+static inline void video_sleep(struct obs_core_video *video,
+			       struct obs_graphics_context *context,
+			       bool raw_active, const bool gpu_active,
+			       uint64_t *p_time, uint64_t interval_ns)
+{
+	struct obs_video_pacing_stats *stats = &video->pacing_stats;
 	struct obs_vframe_info vframe_info;
 	uint64_t cur_time = *p_time;
 	uint64_t t = cur_time + interval_ns;
+	uint64_t spin_ns;
+	uint64_t wake_time;
+	bool realtime;
+	bool on_time;
 	int count;
 
-	if (os_sleepto_ns(t)) {
+	pthread_mutex_lock(&video->pacing_mutex);
+	spin_ns = video->pacing_spin_ns;
+	realtime = video->pacing_realtime;
+	pthread_mutex_unlock(&video->pacing_mutex);
+
+	if (realtime != context->realtime_active)
+		set_realtime(video, context, realtime);
+
+	on_time = os_sleepto_ns_precise(t, spin_ns);
+	wake_time = os_gettime_ns();
+
+	if (on_time) {
 		*p_time = t;
 		count = 1;
 	} else {
-		count = (int)((os_gettime_ns() - cur_time) / interval_ns);
+		count = (int)((wake_time - cur_time) / interval_ns);
 		*p_time = cur_time + interval_ns * count;
 	}
 
 	video->total_frames += count;
 	video->lagged_frames += count - 1;
 
+	pthread_mutex_lock(&video->pacing_mutex);
+	if (on_time) {
+		uint64_t latency = wake_time - t;
+
+		stats->frames++;
+		stats->total_wake_latency_ns += latency;
+		if (latency > stats->max_wake_latency_ns)
+			stats->max_wake_latency_ns = latency;
+		stats->histogram[pacing_bucket(latency)]++;
+	} else {
+		uint64_t late = wake_time - t;
+
+		stats->late_frames++;
+		stats->total_late_ns += late;
+		if (late > stats->max_late_ns)
+			stats->max_late_ns = late;
+	}
+	stats->realtime_active = context->realtime_active;
+	pthread_mutex_unlock(&video->pacing_mutex);
+
 	vframe_info.timestamp = cur_time;
 	vframe_info.count = count;
 
 	if (raw_active)
-		circlebuf_push_back(&video->vframe_info_buffer, &vframe_info,
-				    sizeof(vframe_info));
+		circlebuf_push_back(&video->main_mix->vframe_info_buffer,
+				    &vframe_info, sizeof(vframe_info));
 	if (gpu_active)
 		circlebuf_push_back(&video->vframe_info_buffer_gpu,
 				    &vframe_info, sizeof(vframe_info));
@@ -743,9 +859,9 @@ static const char *output_frame_render_video_name = "render_video";
 static const char *output_frame_download_frame_name = "download_frame";
 static const char *output_frame_gs_flush_name = "gs_flush";
 static const char *output_frame_output_video_data_name = "output_video_data";
-static inline void output_frame(bool raw_active, const bool gpu_active)
+static inline void output_frame(struct obs_core_video_mix *video,
+				bool raw_active, const bool gpu_active)
 {
-	struct obs_core_video *video = &obs->video;
 	int cur_texture = video->cur_texture;
 	int prev_texture = cur_texture == 0 ? NUM_TEXTURES - 1
 					    : cur_texture - 1;
@@ -755,7 +871,7 @@ static inline void output_frame(bool raw_active, const bool gpu_active)
 	memset(&frame, 0, sizeof(struct video_data));
 
 	profile_start(output_frame_gs_context_name);
-	gs_enter_context(video->graphics);
+	gs_enter_context(obs->video.graphics);
 
 	profile_start(output_frame_render_video_name);
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_RENDER_VIDEO,
@@ -794,22 +910,100 @@ static inline void output_frame(bool raw_active, const bool gpu_active)
 
 #define NBSP "\xC2\xA0"
 
-static void clear_base_frame_data(void)
+static void clear_base_frame_data(struct obs_core_video_mix *video)
 {
-	struct obs_core_video *video = &obs->video;
 	video->texture_rendered = false;
 	video->texture_converted = false;
 	circlebuf_free(&video->vframe_info_buffer);
 	video->cur_texture = 0;
 }
 
-static void clear_raw_frame_data(void)
+static void clear_raw_frame_data(struct obs_core_video_mix *video)
 {
-	struct obs_core_video *video = &obs->video;
 	memset(video->textures_copied, 0, sizeof(video->textures_copied));
 	circlebuf_free(&video->vframe_info_buffer);
 }
 
+/* additional mixes are rendered on the graphics tick closest to their own
+ * frame time, a mix running at a higher rate than the graphics thread
+ * outputs its frames duplicated */
+static bool mix_frame_due(struct obs_core_video_mix *mix,
+			  struct obs_vframe_info *vframe_info)
+{
+	uint64_t video_time = obs->video.video_time;
+	uint64_t limit = video_time + obs->video.video_frame_interval_ns / 2;
+
+	if (!mix->next_frame_ts)
+		mix->next_frame_ts = video_time;
+	if (mix->next_frame_ts > limit)
+		return false;
+
+	vframe_info->timestamp = mix->next_frame_ts;
+	vframe_info->count = 0;
+
+	do {
+		vframe_info->count++;
+		mix->next_frame_ts += mix->frame_interval_ns;
+	} while (mix->next_frame_ts <= limit);
+
+	return true;
+}
+
+static inline void output_mix_frame(struct obs_core_video_mix *mix,
+				    bool raw_active, const bool gpu_active)
+{
+	const bool main_mix = mix == obs->video.main_mix;
+	const bool active = raw_active || gpu_active;
+	struct obs_vframe_info vframe_info;
+
+	/* additional mixes are only rendered while something uses them */
+	if (!main_mix && !raw_active) {
+		mix->raw_was_active = false;
+		mix->was_active = false;
+		mix->next_frame_ts = 0;
+		return;
+	}
+
+	if (!main_mix && !mix_frame_due(mix, &vframe_info))
+		return;
+
+	if (!mix->was_active && active)
+		clear_base_frame_data(mix);
+	if (!mix->raw_was_active && raw_active)
+		clear_raw_frame_data(mix);
+
+	mix->raw_was_active = raw_active;
+	mix->was_active = active;
+
+	/* the main mix queues its frame info once it knows how many frames
+	 * the graphics thread lagged, in video_sleep */
+	if (!main_mix)
+		circlebuf_push_back(&mix->vframe_info_buffer, &vframe_info,
+				    sizeof(vframe_info));
+
+	output_frame(mix, raw_active, gpu_active);
+}
+
+static inline void output_frames(bool raw_active, const bool gpu_active)
+{
+	struct obs_core_video *video = &obs->video;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+
+	for (size_t i = 0; i < video->mixes.num; i++) {
+		struct obs_core_video_mix *mix = video->mixes.array[i];
+
+		if (mix == video->main_mix)
+			output_mix_frame(mix, raw_active, gpu_active);
+		else
+			output_mix_frame(
+				mix, os_atomic_load_long(&mix->raw_active) > 0,
+				false);
+	}
+
+	pthread_mutex_unlock(&video->mixes_mutex);
+}
+
 #ifdef _WIN32
 static void clear_gpu_frame_data(void)
 {
@@ -924,31 +1118,24 @@ static const char *output_frame_name = "output_frame";
 bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 {
 	/* defer loop break to clean up sources */
-	const bool stop_requested = video_output_stopped(obs->video.video);
+	struct obs_core_video_mix *main_mix = obs->video.main_mix;
+	const bool stop_requested = video_output_stopped(main_mix->video);
 
 	uint64_t frame_start = os_gettime_ns();
 	uint64_t frame_time_ns;
-	bool raw_active = obs->video.raw_active > 0;
+	bool raw_active = os_atomic_load_long(&main_mix->raw_active) > 0;
 #ifdef _WIN32
 	const bool gpu_active = obs->video.gpu_encoder_active > 0;
-	const bool active = raw_active || gpu_active;
 #else
 	const bool gpu_active = 0;
-	const bool active = raw_active;
 #endif
 
-	if (!context->was_active && active)
-		clear_base_frame_data();
-	if (!context->raw_was_active && raw_active)
-		clear_raw_frame_data();
 #ifdef _WIN32
 	if (!context->gpu_was_active && gpu_active)
 		clear_gpu_frame_data();
 
 	context->gpu_was_active = gpu_active;
 #endif
-	context->raw_was_active = raw_active;
-	context->was_active = active;
 
 	profile_start(context->video_thread_name);
 
@@ -972,11 +1159,11 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 #endif
 
 	profile_start(output_frame_name);
-	output_frame(raw_active, gpu_active);
+	output_frames(raw_active, gpu_active);
 	profile_end(output_frame_name);
 
 	profile_start(render_displays_name);
-	render_displays();
+	render_displays(context->interval);
 	profile_end(render_displays_name);
 
 	frame_time_ns = os_gettime_ns() - frame_start;
@@ -985,8 +1172,8 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 
 	profile_reenable_thread();
 
-	video_sleep(&obs->video, raw_active, gpu_active, &obs->video.video_time,
-		    context->interval);
+	video_sleep(&obs->video, context, raw_active, gpu_active,
+		    &obs->video.video_time, context->interval);
 
 	context->frame_time_total_ns += frame_time_ns;
 	context->fps_total_ns += (obs->video.video_time - context->last_time);
@@ -1017,7 +1204,8 @@ void *obs_graphics_thread(void *param)
 
 	is_graphics_thread = true;
 
-	const uint64_t interval = video_output_get_frame_time(obs->video.video);
+	const uint64_t interval =
+		video_output_get_frame_time(obs->video.main_mix->video);
 
 	obs->video.video_time = os_gettime_ns();
 	obs->video.video_frame_interval_ns = interval;
@@ -1032,7 +1220,7 @@ void *obs_graphics_thread(void *param)
 	srand((unsigned int)time(NULL));
 
 	struct obs_graphics_context context;
-	context.interval = video_output_get_frame_time(obs->video.video);
+	context.interval = interval;
 	context.frame_time_total_ns = 0;
 	context.fps_total_ns = 0;
 	context.fps_total_frames = 0;
@@ -1040,9 +1228,8 @@ void *obs_graphics_thread(void *param)
 #ifdef _WIN32
 	context.gpu_was_active = false;
 #endif
-	context.raw_was_active = false;
-	context.was_active = false;
 	context.video_thread_name = video_thread_name;
+	context.realtime_active = false;
 
 #ifdef __APPLE__
 	while (obs_graphics_thread_loop_autorelease(&context))
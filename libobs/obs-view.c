@@ -50,6 +50,8 @@ void obs_view_free(struct obs_view *view)
 	if (!view)
 		return;
 
+	obs_view_remove(view);
+
 	for (size_t i = 0; i < MAX_CHANNELS; i++) {
 		struct obs_source *source = view->channels[i];
 		if (source) {
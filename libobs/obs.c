@@ -42,10 +42,10 @@ static inline void make_video_info(struct video_output_info *vi,
 	vi->cache_size = 6;
 }
 
-static inline void calc_gpu_conversion_sizes(const struct obs_video_info *ovi)
+static inline void
+calc_gpu_conversion_sizes(struct obs_core_video_mix *video,
+			  const struct obs_video_info *ovi)
 {
-	struct obs_core_video *video = &obs->video;
-
 	video->conversion_needed = false;
 	video->conversion_techs[0] = NULL;
 	video->conversion_techs[1] = NULL;
@@ -75,11 +75,10 @@ static inline void calc_gpu_conversion_sizes(const struct obs_video_info *ovi)
 	}
 }
 
-static bool obs_init_gpu_conversion(struct obs_video_info *ovi)
+static bool obs_init_gpu_conversion(struct obs_core_video_mix *video,
+				    struct obs_video_info *ovi)
 {
-	struct obs_core_video *video = &obs->video;
-
-	calc_gpu_conversion_sizes(ovi);
+	calc_gpu_conversion_sizes(video, ovi);
 
 	video->using_nv12_tex = ovi->output_format == VIDEO_FORMAT_NV12
 					? gs_nv12_available()
@@ -154,10 +153,9 @@ static bool obs_init_gpu_conversion(struct obs_video_info *ovi)
 	return true;
 }
 
-static bool obs_init_gpu_copy_surfaces(struct obs_video_info *ovi, size_t i)
+static bool obs_init_gpu_copy_surfaces(struct obs_core_video_mix *video,
+				       struct obs_video_info *ovi, size_t i)
 {
-	struct obs_core_video *video = &obs->video;
-
 	video->copy_surfaces[i][0] = gs_stagesurface_create(
 		ovi->output_width, ovi->output_height, GS_R8);
 	if (!video->copy_surfaces[i][0])
@@ -199,10 +197,9 @@ static bool obs_init_gpu_copy_surfaces(struct obs_video_info *ovi, size_t i)
 	return true;
 }
 
-static bool obs_init_textures(struct obs_video_info *ovi)
+static bool obs_init_textures(struct obs_core_video_mix *video,
+			      struct obs_video_info *ovi)
 {
-	struct obs_core_video *video = &obs->video;
-
 	for (size_t i = 0; i < NUM_TEXTURES; i++) {
 #ifdef _WIN32
 		if (video->using_nv12_tex) {
@@ -215,7 +212,7 @@ static bool obs_init_textures(struct obs_video_info *ovi)
 		} else {
 #endif
 			if (video->gpu_conversion) {
-				if (!obs_init_gpu_copy_surfaces(ovi, i))
+				if (!obs_init_gpu_copy_surfaces(video, ovi, i))
 					return false;
 			} else {
 				video->copy_surfaces[i][0] =
@@ -360,7 +357,7 @@ static int obs_init_graphics(struct obs_video_info *ovi)
 	return success ? OBS_VIDEO_SUCCESS : OBS_VIDEO_FAIL;
 }
 
-static inline void set_video_matrix(struct obs_core_video *video,
+static inline void set_video_matrix(struct obs_core_video_mix *video,
 				    struct obs_video_info *ovi)
 {
 	struct matrix4 mat;
@@ -382,14 +379,18 @@ static inline void set_video_matrix(struct obs_core_video *video,
 	memcpy(video->color_matrix, &mat, sizeof(float) * 16);
 }
 
-static int obs_init_video(struct obs_video_info *ovi)
+struct obs_core_video_mix *obs_create_video_mix(struct obs_view *view,
+						struct obs_video_info *ovi,
+						int *error)
 {
-	struct obs_core_video *video = &obs->video;
+	struct obs_core_video_mix *video = bzalloc(sizeof(*video));
 	struct video_output_info vi;
-	pthread_mutexattr_t attr;
+	bool success;
 	int errorcode;
 
 	make_video_info(&vi, ovi);
+	video->view = view;
+	video->ovi = *ovi;
 	video->base_width = ovi->base_width;
 	video->base_height = ovi->base_height;
 	video->output_width = ovi->output_width;
@@ -404,22 +405,89 @@ static int obs_init_video(struct obs_video_info *ovi)
 	if (errorcode != VIDEO_OUTPUT_SUCCESS) {
 		if (errorcode == VIDEO_OUTPUT_INVALIDPARAM) {
 			blog(LOG_ERROR, "Invalid video parameters specified");
-			return OBS_VIDEO_INVALID_PARAM;
+			*error = OBS_VIDEO_INVALID_PARAM;
 		} else {
 			blog(LOG_ERROR, "Could not open video output");
+			*error = OBS_VIDEO_FAIL;
 		}
-		return OBS_VIDEO_FAIL;
+		bfree(video);
+		return NULL;
 	}
 
-	gs_enter_context(video->graphics);
+	video->frame_interval_ns = video_output_get_frame_time(video->video);
 
-	if (ovi->gpu_conversion && !obs_init_gpu_conversion(ovi))
-		return OBS_VIDEO_FAIL;
-	if (!obs_init_textures(ovi))
-		return OBS_VIDEO_FAIL;
+	gs_enter_context(obs->video.graphics);
+
+	success = !ovi->gpu_conversion || obs_init_gpu_conversion(video, ovi);
+	if (success)
+		success = obs_init_textures(video, ovi);
 
 	gs_leave_context();
 
+	if (!success) {
+		obs_free_video_mix(video);
+		*error = OBS_VIDEO_FAIL;
+		return NULL;
+	}
+
+	*error = OBS_VIDEO_SUCCESS;
+	return video;
+}
+
+void obs_free_video_mix(struct obs_core_video_mix *video)
+{
+	if (!video)
+		return;
+
+	video_output_close(video->video);
+
+	if (obs->video.graphics) {
+		gs_enter_context(obs->video.graphics);
+
+		for (size_t c = 0; c < NUM_CHANNELS; c++) {
+			if (video->mapped_surfaces[c])
+				gs_stagesurface_unmap(
+					video->mapped_surfaces[c]);
+		}
+
+		for (size_t i = 0; i < NUM_TEXTURES; i++) {
+			for (size_t c = 0; c < NUM_CHANNELS; c++) {
+				if (video->copy_surfaces[i][c])
+					gs_stagesurface_destroy(
+						video->copy_surfaces[i][c]);
+			}
+		}
+
+		for (size_t c = 0; c < NUM_CHANNELS; c++) {
+			if (video->convert_textures[c])
+				gs_texture_destroy(video->convert_textures[c]);
+		}
+
+		gs_texture_destroy(video->render_texture);
+		gs_texture_destroy(video->output_texture);
+
+		gs_leave_context();
+	}
+
+	circlebuf_free(&video->vframe_info_buffer);
+	bfree(video);
+}
+
+static int obs_init_video(struct obs_video_info *ovi)
+{
+	struct obs_core_video *video = &obs->video;
+	pthread_mutexattr_t attr;
+	int errorcode;
+
+	video->main_mix =
+		obs_create_video_mix(&obs->data.main_view, ovi, &errorcode);
+	if (!video->main_mix)
+		return errorcode;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	da_push_back(video->mixes, &video->main_mix);
+	pthread_mutex_unlock(&video->mixes_mutex);
+
 	if (pthread_mutexattr_init(&attr) != 0)
 		return OBS_VIDEO_FAIL;
 	if (pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0)
@@ -440,7 +508,6 @@ static int obs_init_video(struct obs_video_info *ovi)
 		return OBS_VIDEO_FAIL;
 
 	video->thread_initialized = true;
-	video->ovi = *ovi;
 	return OBS_VIDEO_SUCCESS;
 }
 
@@ -449,8 +516,8 @@ static void stop_video(void)
 	struct obs_core_video *video = &obs->video;
 	void *thread_retval;
 
-	if (video->video) {
-		video_output_stop(video->video);
+	if (video->main_mix) {
+		video_output_stop(video->main_mix->video);
 		if (video->thread_initialized) {
 			pthread_join(video->video_thread, &thread_retval);
 			video->thread_initialized = false;
@@ -462,66 +529,17 @@ static void obs_free_video(void)
 {
 	struct obs_core_video *video = &obs->video;
 
-	if (video->video) {
-		video_output_close(video->video);
-		video->video = NULL;
-
-		if (!video->graphics)
-			return;
-
-		gs_enter_context(video->graphics);
+	if (video->main_mix) {
+		/* additional mixes don't survive a video reset */
+		pthread_mutex_lock(&video->mixes_mutex);
+		for (size_t i = video->mixes.num; i > 0; i--)
+			obs_free_video_mix(video->mixes.array[i - 1]);
+		da_free(video->mixes);
+		video->main_mix = NULL;
+		pthread_mutex_unlock(&video->mixes_mutex);
 
-		for (size_t c = 0; c < NUM_CHANNELS; c++) {
-			if (video->mapped_surfaces[c]) {
-				gs_stagesurface_unmap(
-					video->mapped_surfaces[c]);
-				video->mapped_surfaces[c] = NULL;
-			}
-		}
-
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
-			for (size_t c = 0; c < NUM_CHANNELS; c++) {
-				if (video->copy_surfaces[i][c]) {
-					gs_stagesurface_destroy(
-						video->copy_surfaces[i][c]);
-					video->copy_surfaces[i][c] = NULL;
-				}
-			}
-		}
-
-		gs_texture_destroy(video->render_texture);
-
-		for (size_t c = 0; c < NUM_CHANNELS; c++) {
-			if (video->convert_textures[c]) {
-				gs_texture_destroy(video->convert_textures[c]);
-				video->convert_textures[c] = NULL;
-			}
-		}
-
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
-			for (size_t c = 0; c < NUM_CHANNELS; c++) {
-				if (video->copy_surfaces[i][c]) {
-					gs_stagesurface_destroy(
-						video->copy_surfaces[i][c]);
-					video->copy_surfaces[i][c] = NULL;
-				}
-			}
-		}
-
-		gs_texture_destroy(video->output_texture);
-		video->render_texture = NULL;
-		video->output_texture = NULL;
-
-		gs_leave_context();
-
-		circlebuf_free(&video->vframe_info_buffer);
 		circlebuf_free(&video->vframe_info_buffer_gpu);
 
-		video->texture_rendered = false;
-		memset(video->textures_copied, 0,
-		       sizeof(video->textures_copied));
-		video->texture_converted = false;
-
 		pthread_mutex_destroy(&video->gpu_encoder_mutex);
 		pthread_mutex_init_value(&video->gpu_encoder_mutex);
 		da_free(video->gpu_encoders);
@@ -531,7 +549,6 @@ static void obs_free_video(void)
 		circlebuf_free(&video->tasks);
 
 		video->gpu_encoder_active = 0;
-		video->cur_texture = 0;
 	}
 }
 
@@ -573,6 +590,7 @@ static bool obs_init_audio(struct audio_output_info *ai)
 	pthread_mutexattr_t attr;
 
 	pthread_mutex_init_value(&audio->monitoring_mutex);
+	pthread_mutex_init_value(&audio->buffering_mutex);
 
 	if (pthread_mutexattr_init(&attr) != 0)
 		return false;
@@ -580,6 +598,8 @@ static bool obs_init_audio(struct audio_output_info *ai)
 		return false;
 	if (pthread_mutex_init(&audio->monitoring_mutex, &attr) != 0)
 		return false;
+	if (pthread_mutex_init(&audio->buffering_mutex, NULL) != 0)
+		return false;
 
 	audio->user_volume = 1.0f;
 
@@ -611,6 +631,7 @@ static void obs_free_audio(void)
 	bfree(audio->monitoring_device_name);
 	bfree(audio->monitoring_device_id);
 	pthread_mutex_destroy(&audio->monitoring_mutex);
+	pthread_mutex_destroy(&audio->buffering_mutex);
 
 	memset(audio, 0, sizeof(struct obs_core_audio));
 }
@@ -845,14 +866,40 @@ const struct obs_source_info audio_line_info = {
 
 extern void log_system_info(void);
 
+static bool obs_init_core_mutexes(void)
+{
+	pthread_mutexattr_t attr;
+	bool success = false;
+
+	if (pthread_mutexattr_init(&attr) != 0)
+		return false;
+	if (pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0)
+		goto fail;
+	if (pthread_mutex_init(&obs->types_mutex, NULL) != 0)
+		goto fail;
+	if (pthread_mutex_init(&obs->video.pacing_mutex, NULL) != 0)
+		goto fail;
+	if (pthread_mutex_init(&obs->video.mixes_mutex, &attr) != 0)
+		goto fail;
+
+	success = true;
+
+fail:
+	pthread_mutexattr_destroy(&attr);
+	return success;
+}
+
 static bool obs_init(const char *locale, const char *module_config_path,
 		     profiler_name_store_t *store)
 {
 	obs = bzalloc(sizeof(struct obs_core));
 
+	pthread_mutex_init_value(&obs->types_mutex);
 	pthread_mutex_init_value(&obs->audio.monitoring_mutex);
 	pthread_mutex_init_value(&obs->video.gpu_encoder_mutex);
 	pthread_mutex_init_value(&obs->video.task_mutex);
+	pthread_mutex_init_value(&obs->video.pacing_mutex);
+	pthread_mutex_init_value(&obs->video.mixes_mutex);
 
 	obs->name_store_owned = !store;
 	obs->name_store = store ? store : profiler_name_store_create();
@@ -863,6 +910,9 @@ static bool obs_init(const char *locale, const char *module_config_path,
 
 	log_system_info();
 
+	if (!obs_init_core_mutexes())
+		return false;
+
 	if (!obs_init_data())
 		return false;
 	if (!obs_init_handlers())
@@ -1025,6 +1075,16 @@ void obs_shutdown(void)
 	da_free(obs->filter_types);
 	da_free(obs->transition_types);
 
+	for (size_t i = 0; i < obs->retired_type_arrays.num; i++)
+		bfree(obs->retired_type_arrays.array[i]);
+	da_free(obs->retired_type_arrays);
+
+	for (size_t i = 0; i < obs->known_types.num; i++) {
+		bfree(obs->known_types.array[i].id);
+		bfree(obs->known_types.array[i].unversioned_id);
+	}
+	da_free(obs->known_types);
+
 	stop_video();
 	stop_hotkeys();
 
@@ -1053,6 +1113,9 @@ void obs_shutdown(void)
 	if (obs->name_store_owned)
 		profiler_name_store_free(obs->name_store);
 
+	pthread_mutex_destroy(&obs->types_mutex);
+	pthread_mutex_destroy(&obs->video.pacing_mutex);
+	pthread_mutex_destroy(&obs->video.mixes_mutex);
 	bfree(obs->module_config_path);
 	bfree(obs->locale);
 	bfree(obs);
@@ -1117,7 +1180,7 @@ int obs_reset_video(struct obs_video_info *ovi)
 		return OBS_VIDEO_FAIL;
 
 	/* don't allow changing of video settings if active. */
-	if (obs->video.video && obs_video_active())
+	if (obs->video.main_mix && obs_video_active())
 		return OBS_VIDEO_CURRENTLY_ACTIVE;
 
 	if (!size_valid(ovi->output_width, ovi->output_height) ||
@@ -1185,9 +1248,115 @@ int obs_reset_video(struct obs_video_info *ovi)
 	return obs_init_video(ovi);
 }
 
+video_t *obs_view_add(obs_view_t *view, struct obs_video_info *ovi)
+{
+	struct obs_core_video *video = &obs->video;
+	struct obs_core_video_mix *mix;
+	int errorcode;
+
+	if (!view || !ovi || !video->main_mix)
+		return NULL;
+
+	if (!size_valid(ovi->output_width, ovi->output_height) ||
+	    !size_valid(ovi->base_width, ovi->base_height) || !ovi->fps_num ||
+	    !ovi->fps_den) {
+		blog(LOG_WARNING, "obs_view_add: invalid video parameters");
+		return NULL;
+	}
+
+	/* align to multiple-of-two and SSE alignment sizes */
+	ovi->output_width &= 0xFFFFFFFC;
+	ovi->output_height &= 0xFFFFFFFE;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	for (size_t i = 0; i < video->mixes.num; i++) {
+		if (video->mixes.array[i]->view == view) {
+			pthread_mutex_unlock(&video->mixes_mutex);
+			blog(LOG_WARNING, "obs_view_add: view already added");
+			return NULL;
+		}
+	}
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	mix = obs_create_video_mix(view, ovi, &errorcode);
+	if (!mix)
+		return NULL;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	da_push_back(video->mixes, &mix);
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	blog(LOG_INFO, "added canvas: %ux%u -> %ux%u, %u/%u fps, format %s",
+	     ovi->base_width, ovi->base_height, ovi->output_width,
+	     ovi->output_height, ovi->fps_num, ovi->fps_den,
+	     get_video_format_name(ovi->output_format));
+
+	return mix->video;
+}
+
+void obs_view_remove(obs_view_t *view)
+{
+	struct obs_core_video *video;
+	struct obs_core_video_mix *mix = NULL;
+
+	if (!view || !obs)
+		return;
+
+	video = &obs->video;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	for (size_t i = 0; i < video->mixes.num; i++) {
+		struct obs_core_video_mix *cur = video->mixes.array[i];
+
+		if (cur->view != view || cur == video->main_mix)
+			continue;
+
+		/* raw outputs/encoders still connected to the canvas would be
+		 * left with a closed video_t, so detach it from the view and
+		 * let the last of them free it in stop_raw_video */
+		if (os_atomic_load_long(&cur->raw_active) > 0) {
+			blog(LOG_WARNING, "obs_view_remove: canvas still has "
+					  "active outputs, it will be freed "
+					  "once they stop");
+			cur->view = NULL;
+		} else {
+			mix = cur;
+			da_erase(video->mixes, i);
+		}
+		break;
+	}
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	obs_free_video_mix(mix);
+}
+
+bool obs_view_get_video_info(obs_view_t *view, struct obs_video_info *ovi)
+{
+	struct obs_core_video *video = &obs->video;
+	bool found = false;
+
+	if (!view)
+		return false;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	for (size_t i = 0; i < video->mixes.num; i++) {
+		struct obs_core_video_mix *mix = video->mixes.array[i];
+
+		if (mix->view == view) {
+			*ovi = mix->ovi;
+			found = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	return found;
+}
+
 bool obs_reset_audio(const struct obs_audio_info *oai)
 {
 	struct audio_output_info ai;
+	bool adaptive_buffering = obs->audio.adaptive_buffering;
 
 	/* don't allow changing of audio settings if active. */
 	if (obs->audio.audio && audio_output_active(obs->audio.audio))
@@ -1197,6 +1366,8 @@ bool obs_reset_audio(const struct obs_audio_info *oai)
 	if (!oai)
 		return true;
 
+	obs->audio.adaptive_buffering = adaptive_buffering;
+
 	ai.name = "Audio";
 	ai.samples_per_sec = oai->samples_per_sec;
 	ai.format = AUDIO_FORMAT_FLOAT_PLANAR;
@@ -1217,10 +1388,10 @@ bool obs_get_video_info(struct obs_video_info *ovi)
 {
 	struct obs_core_video *video = &obs->video;
 
-	if (!video->graphics)
+	if (!video->graphics || !video->main_mix)
 		return false;
 
-	*ovi = video->ovi;
+	*ovi = video->main_mix->ovi;
 	return true;
 }
 
@@ -1239,96 +1410,177 @@ bool obs_get_audio_info(struct obs_audio_info *oai)
 	return true;
 }
 
-bool obs_enum_source_types(size_t idx, const char **id)
+void obs_set_adaptive_audio_buffering(bool enable)
+{
+	if (!obs)
+		return;
+
+	os_atomic_set_bool(&obs->audio.adaptive_buffering, enable);
+	blog(LOG_INFO, "Adaptive audio buffering %s",
+	     enable ? "enabled" : "disabled");
+}
+
+bool obs_adaptive_audio_buffering_enabled(void)
+{
+	return obs ? os_atomic_load_bool(&obs->audio.adaptive_buffering)
+		   : false;
+}
+
+bool obs_get_audio_buffering_info(struct obs_audio_buffering_info *info)
 {
-	if (idx >= obs->source_types.num)
+	struct obs_core_audio *audio;
+	uint32_t sample_rate;
+
+	if (!obs || !info)
+		return false;
+
+	audio = &obs->audio;
+	if (!audio->audio)
 		return false;
-	*id = obs->source_types.array[idx].id;
+
+	sample_rate = audio_output_get_sample_rate(audio->audio);
+
+	pthread_mutex_lock(&audio->buffering_mutex);
+	info->ticks = (uint32_t)audio->total_buffering_ticks;
+	info->window_peak_ticks = (uint32_t)audio->window_peak_ticks;
+	pthread_mutex_unlock(&audio->buffering_mutex);
+
+	info->ms = (uint32_t)((uint64_t)info->ticks * AUDIO_OUTPUT_FRAMES *
+			      1000 / sample_rate);
+	info->max_ticks = MAX_BUFFERING_TICKS;
+	info->adaptive = os_atomic_load_bool(&audio->adaptive_buffering);
 	return true;
 }
 
+size_t
+obs_get_audio_buffering_history(struct obs_audio_buffering_change *changes,
+				size_t count)
+{
+	struct obs_core_audio *audio;
+	size_t start;
+
+	if (!obs || !changes)
+		return 0;
+
+	audio = &obs->audio;
+	if (!audio->audio)
+		return 0;
+
+	pthread_mutex_lock(&audio->buffering_mutex);
+
+	if (count > audio->buffering_history_num)
+		count = audio->buffering_history_num;
+
+	start = audio->buffering_history_pos + OBS_AUDIO_BUFFERING_HISTORY -
+		count;
+	for (size_t i = 0; i < count; i++) {
+		size_t idx = (start + i) % OBS_AUDIO_BUFFERING_HISTORY;
+		changes[i] = audio->buffering_history[idx];
+	}
+
+	pthread_mutex_unlock(&audio->buffering_mutex);
+	return count;
+}
+
+#define TYPE_MASK(kind) (1 << OBS_TYPE_##kind)
+#define SOURCE_TYPE_MASK                                      \
+	(TYPE_MASK(SCENE) | TYPE_MASK(INPUT) | TYPE_MASK(FILTER) | \
+	 TYPE_MASK(TRANSITION))
+
+/* enumerates known_types rather than the registered type arrays, so types of
+ * modules that haven't been loaded yet are listed without loading them */
+static bool enum_types(size_t idx, uint32_t mask, const char **id,
+		       const char **unversioned_id)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&obs->types_mutex);
+
+	for (size_t i = 0; i < obs->known_types.num; i++) {
+		struct obs_type_id *type = obs->known_types.array + i;
+
+		if (((1 << type->kind) & mask) == 0)
+			continue;
+		if (idx--)
+			continue;
+
+		if (id)
+			*id = type->id;
+		if (unversioned_id)
+			*unversioned_id = type->unversioned_id;
+		found = true;
+		break;
+	}
+
+	pthread_mutex_unlock(&obs->types_mutex);
+	return found;
+}
+
+bool obs_enum_source_types(size_t idx, const char **id)
+{
+	return enum_types(idx, SOURCE_TYPE_MASK, id, NULL);
+}
+
 bool obs_enum_input_types(size_t idx, const char **id)
 {
-	if (idx >= obs->input_types.num)
-		return false;
-	*id = obs->input_types.array[idx].id;
-	return true;
+	return enum_types(idx, TYPE_MASK(INPUT), id, NULL);
 }
 
 bool obs_enum_input_types2(size_t idx, const char **id,
 			   const char **unversioned_id)
 {
-	if (idx >= obs->input_types.num)
-		return false;
-	if (id)
-		*id = obs->input_types.array[idx].id;
-	if (unversioned_id)
-		*unversioned_id = obs->input_types.array[idx].unversioned_id;
-	return true;
+	return enum_types(idx, TYPE_MASK(INPUT), id, unversioned_id);
 }
 
 const char *obs_get_latest_input_type_id(const char *unversioned_id)
 {
-	struct obs_source_info *latest = NULL;
+	const char *latest = NULL;
 	int version = -1;
 
 	if (!unversioned_id)
 		return NULL;
 
-	for (size_t i = 0; i < obs->source_types.num; i++) {
-		struct obs_source_info *info = &obs->source_types.array[i];
-		if (strcmp(info->unversioned_id, unversioned_id) == 0 &&
-		    (int)info->version > version) {
-			latest = info;
-			version = info->version;
+	pthread_mutex_lock(&obs->types_mutex);
+
+	for (size_t i = 0; i < obs->known_types.num; i++) {
+		struct obs_type_id *type = obs->known_types.array + i;
+		if (((1 << type->kind) & SOURCE_TYPE_MASK) != 0 &&
+		    strcmp(type->unversioned_id, unversioned_id) == 0 &&
+		    (int)type->version > version) {
+			latest = type->id;
+			version = type->version;
 		}
 	}
 
-	assert(!!latest);
-	if (!latest)
-		return NULL;
+	pthread_mutex_unlock(&obs->types_mutex);
 
-	return latest->id;
+	assert(!!latest);
+	return latest;
 }
 
 bool obs_enum_filter_types(size_t idx, const char **id)
 {
-	if (idx >= obs->filter_types.num)
-		return false;
-	*id = obs->filter_types.array[idx].id;
-	return true;
+	return enum_types(idx, TYPE_MASK(FILTER), id, NULL);
 }
 
 bool obs_enum_transition_types(size_t idx, const char **id)
 {
-	if (idx >= obs->transition_types.num)
-		return false;
-	*id = obs->transition_types.array[idx].id;
-	return true;
+	return enum_types(idx, TYPE_MASK(TRANSITION), id, NULL);
 }
 
 bool obs_enum_output_types(size_t idx, const char **id)
 {
-	if (idx >= obs->output_types.num)
-		return false;
-	*id = obs->output_types.array[idx].id;
-	return true;
+	return enum_types(idx, TYPE_MASK(OUTPUT), id, NULL);
 }
 
 bool obs_enum_encoder_types(size_t idx, const char **id)
 {
-	if (idx >= obs->encoder_types.num)
-		return false;
-	*id = obs->encoder_types.array[idx].id;
-	return true;
+	return enum_types(idx, TYPE_MASK(ENCODER), id, NULL);
 }
 
 bool obs_enum_service_types(size_t idx, const char **id)
 {
-	if (idx >= obs->service_types.num)
-		return false;
-	*id = obs->service_types.array[idx].id;
-	return true;
+	return enum_types(idx, TYPE_MASK(SERVICE), id, NULL);
 }
 
 void obs_enter_graphics(void)
@@ -1350,7 +1602,7 @@ audio_t *obs_get_audio(void)
 
 video_t *obs_get_video(void)
 {
-	return obs->video.video;
+	return obs->video.main_mix ? obs->video.main_mix->video : NULL;
 }
 
 /* TODO: optimize this later so it's not just O(N) string lookups */
@@ -1674,13 +1926,13 @@ static void obs_render_main_texture_internal(enum gs_blend_type src_c,
 					     enum gs_blend_type src_a,
 					     enum gs_blend_type dest_a)
 {
-	struct obs_core_video *video;
+	struct obs_core_video_mix *video;
 	gs_texture_t *tex;
 	gs_effect_t *effect;
 	gs_eparam_t *param;
 
-	video = &obs->video;
-	if (!video->texture_rendered)
+	video = obs->video.main_mix;
+	if (!video || !video->texture_rendered)
 		return;
 
 	tex = video->render_texture;
@@ -1711,10 +1963,10 @@ void obs_render_main_texture_src_color_only(void)
 
 gs_texture_t *obs_get_main_texture(void)
 {
-	struct obs_core_video *video;
+	struct obs_core_video_mix *video;
 
-	video = &obs->video;
-	if (!video->texture_rendered)
+	video = obs->video.main_mix;
+	if (!video || !video->texture_rendered)
 		return NULL;
 
 	return video->render_texture;
@@ -1873,37 +2125,249 @@ obs_source_t *obs_load_source(obs_data_t *source_data)
 	return obs_load_source_type(source_data);
 }
 
+struct source_load_entry {
+	obs_data_t *data;
+	obs_source_t *source;
+	const char *id;
+	uint64_t create_ns;
+	uint64_t load_ns;
+};
+
+struct source_load_pool {
+	struct source_load_entry *entries;
+	long count;
+	volatile long next;
+};
+
+static void create_pool_sources(struct source_load_pool *pool)
+{
+	long i;
+
+	while ((i = os_atomic_inc_long(&pool->next) - 1) < pool->count) {
+		struct source_load_entry *entry = &pool->entries[i];
+		uint64_t start = os_gettime_ns();
+
+		entry->source = obs_load_source(entry->data);
+		entry->create_ns = os_gettime_ns() - start;
+	}
+}
+
+static void *source_load_thread(void *param)
+{
+	os_set_thread_name("libobs: source loader");
+	create_pool_sources(param);
+	return NULL;
+}
+
+static inline const char *source_data_id(obs_data_t *data)
+{
+	const char *v_id = obs_data_get_string(data, "versioned_id");
+	return *v_id ? v_id : obs_data_get_string(data, "id");
+}
+
+/* looks up the types of all sources and filters on the calling thread, so
+ * that modules that are loaded lazily are loaded here rather than from the
+ * worker threads */
+static void load_source_types(struct source_load_entry *entries, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		obs_data_array_t *filters =
+			obs_data_get_array(entries[i].data, "filters");
+		size_t num_filters = obs_data_array_count(filters);
+
+		get_source_info(entries[i].id);
+
+		for (size_t j = 0; j < num_filters; j++) {
+			obs_data_t *filter = obs_data_array_item(filters, j);
+			get_source_info(source_data_id(filter));
+			obs_data_release(filter);
+		}
+
+		obs_data_array_release(filters);
+	}
+}
+
+/* sources don't reference each other until they're loaded, so they can be
+ * created in any order */
+static void create_sources_parallel(struct source_load_entry *entries,
+				    size_t count)
+{
+	struct source_load_pool pool = {entries, (long)count, 0};
+	DARRAY(pthread_t) threads;
+	size_t num_threads = (size_t)os_get_logical_cores();
+
+	/* the calling thread creates sources as well */
+	if (num_threads > count)
+		num_threads = count;
+	if (num_threads)
+		num_threads--;
+
+	da_init(threads);
+	da_reserve(threads, num_threads);
+
+	for (size_t i = 0; i < num_threads; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, source_load_thread, &pool) ==
+		    0)
+			da_push_back(threads, &thread);
+	}
+
+	create_pool_sources(&pool);
+
+	for (size_t i = 0; i < threads.num; i++)
+		pthread_join(threads.array[i], NULL);
+
+	da_free(threads);
+}
+
+struct source_type_load_time {
+	const char *id;
+	size_t count;
+	uint64_t create_ns;
+	uint64_t load_ns;
+};
+
+static int cmp_load_time(const void *a, const void *b)
+{
+	const struct source_type_load_time *ta = a;
+	const struct source_type_load_time *tb = b;
+	uint64_t total_a = ta->create_ns + ta->load_ns;
+	uint64_t total_b = tb->create_ns + tb->load_ns;
+
+	return total_a < total_b ? 1 : (total_a > total_b ? -1 : 0);
+}
+
+static void log_source_load_times(const struct source_load_entry *entries,
+				  size_t count, uint64_t create_ns,
+				  uint64_t load_ns, bool parallel)
+{
+	DARRAY(struct source_type_load_time) types;
+
+	if (!count)
+		return;
+
+	da_init(types);
+
+	for (size_t i = 0; i < count; i++) {
+		const struct source_load_entry *entry = &entries[i];
+		struct source_type_load_time *type = NULL;
+
+		for (size_t j = 0; j < types.num; j++) {
+			if (strcmp(types.array[j].id, entry->id) == 0) {
+				type = &types.array[j];
+				break;
+			}
+		}
+
+		if (!type) {
+			type = da_push_back_new(types);
+			type->id = entry->id;
+		}
+
+		type->count++;
+		type->create_ns += entry->create_ns;
+		type->load_ns += entry->load_ns;
+	}
+
+	qsort(types.array, types.num, sizeof(*types.array), cmp_load_time);
+
+	blog(LOG_INFO,
+	     "Loaded %d sources in %.1f ms (%s creation %.1f ms, "
+	     "load %.1f ms)",
+	     (int)count, (double)(create_ns + load_ns) / 1000000.0,
+	     parallel ? "parallel" : "serial", (double)create_ns / 1000000.0,
+	     (double)load_ns / 1000000.0);
+
+	for (size_t i = 0; i < types.num; i++) {
+		struct source_type_load_time *type = &types.array[i];
+
+		blog(LOG_INFO,
+		     "\t%-28s %4d source(s), create %9.2f ms, "
+		     "load %9.2f ms",
+		     type->id, (int)type->count,
+		     (double)type->create_ns / 1000000.0,
+		     (double)type->load_ns / 1000000.0);
+	}
+
+	da_free(types);
+}
+
+void obs_set_parallel_source_loading(bool enable)
+{
+	if (obs)
+		os_atomic_set_bool(&obs->data.parallel_source_loading, enable);
+}
+
+bool obs_parallel_source_loading_enabled(void)
+{
+	return obs ? os_atomic_load_bool(&obs->data.parallel_source_loading)
+		   : false;
+}
+
 void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 		      void *private_data)
 {
 	struct obs_core_data *data = &obs->data;
-	DARRAY(obs_source_t *) sources;
+	DARRAY(struct source_load_entry) entries;
+	bool parallel = obs_parallel_source_loading_enabled();
+	uint64_t create_ns;
+	uint64_t load_ns;
+	uint64_t start;
 	size_t count;
 	size_t i;
 
-	da_init(sources);
+	da_init(entries);
 
 	count = obs_data_array_count(array);
-	da_reserve(sources, count);
-
-	pthread_mutex_lock(&data->sources_mutex);
+	da_resize(entries, count);
 
 	for (i = 0; i < count; i++) {
-		obs_data_t *source_data = obs_data_array_item(array, i);
-		obs_source_t *source = obs_load_source(source_data);
+		struct source_load_entry *entry = &entries.array[i];
+
+		entry->data = obs_data_array_item(array, i);
+		entry->id = source_data_id(entry->data);
+	}
+
+	start = os_gettime_ns();
+
+	/* worker threads have to be able to add their sources to the
+	 * source list while sources are being created in parallel, so the
+	 * sources mutex is only held for the load pass in that case */
+	if (parallel) {
+		if (obs->lazy_module_loading)
+			load_source_types(entries.array, count);
+
+		/* the workers can't hand module loads to this thread while
+		 * it waits for them */
+		os_atomic_set_bool(&obs->module_load_thread_busy, true);
+		create_sources_parallel(entries.array, count);
+		os_atomic_set_bool(&obs->module_load_thread_busy, false);
+		pthread_mutex_lock(&data->sources_mutex);
+	} else {
+		pthread_mutex_lock(&data->sources_mutex);
 
-		da_push_back(sources, &source);
+		for (i = 0; i < count; i++) {
+			struct source_load_entry *entry = &entries.array[i];
+			uint64_t source_start = os_gettime_ns();
 
-		obs_data_release(source_data);
+			entry->source = obs_load_source(entry->data);
+			entry->create_ns = os_gettime_ns() - source_start;
+		}
 	}
 
-	/* tell sources that we want to load */
-	for (i = 0; i < sources.num; i++) {
-		obs_source_t *source = sources.array[i];
-		obs_data_t *source_data = obs_data_array_item(array, i);
+	create_ns = os_gettime_ns() - start;
+	start = os_gettime_ns();
+
+	/* tell sources that we want to load, in the original order so that
+	 * scenes and transitions can find the sources they refer to */
+	for (i = 0; i < count; i++) {
+		struct source_load_entry *entry = &entries.array[i];
+		obs_source_t *source = entry->source;
+		uint64_t source_start = os_gettime_ns();
+
 		if (source) {
 			if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
-				obs_transition_load(source, source_data);
+				obs_transition_load(source, entry->data);
 			obs_source_load(source);
 			for (size_t i = source->filters.num; i > 0; i--) {
 				obs_source_t *filter =
@@ -1913,15 +2377,24 @@ void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 			if (cb)
 				cb(private_data, source);
 		}
-		obs_data_release(source_data);
+
+		entry->load_ns = os_gettime_ns() - source_start;
 	}
 
-	for (i = 0; i < sources.num; i++)
-		obs_source_release(sources.array[i]);
+	load_ns = os_gettime_ns() - start;
+
+	for (i = 0; i < count; i++)
+		obs_source_release(entries.array[i].source);
 
 	pthread_mutex_unlock(&data->sources_mutex);
 
-	da_free(sources);
+	log_source_load_times(entries.array, count, create_ns, load_ns,
+			      parallel);
+
+	for (i = 0; i < count; i++)
+		obs_data_release(entries.array[i].data);
+
+	da_free(entries);
 }
 
 obs_data_t *obs_save_source(obs_source_t *source)
@@ -2337,12 +2810,74 @@ uint32_t obs_get_lagged_frames(void)
 	return obs->video.lagged_frames;
 }
 
+void obs_set_video_pacing(uint64_t spin_ns, bool realtime)
+{
+	if (!obs)
+		return;
+
+	pthread_mutex_lock(&obs->video.pacing_mutex);
+	obs->video.pacing_spin_ns = spin_ns;
+	obs->video.pacing_realtime = realtime;
+	pthread_mutex_unlock(&obs->video.pacing_mutex);
+}
+
+void obs_get_video_pacing_stats(struct obs_video_pacing_stats *stats)
+{
+	if (!obs) {
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	pthread_mutex_lock(&obs->video.pacing_mutex);
+	*stats = obs->video.pacing_stats;
+	pthread_mutex_unlock(&obs->video.pacing_mutex);
+}
+
+void obs_reset_video_pacing_stats(void)
+{
+	if (!obs)
+		return;
+
+	pthread_mutex_lock(&obs->video.pacing_mutex);
+	bool realtime_active = obs->video.pacing_stats.realtime_active;
+	memset(&obs->video.pacing_stats, 0, sizeof(obs->video.pacing_stats));
+	obs->video.pacing_stats.realtime_active = realtime_active;
+	pthread_mutex_unlock(&obs->video.pacing_mutex);
+}
+
+/* returns the canvas if it was removed while active and this was its last
+ * raw user, in which case it's up to the caller to free it */
+static struct obs_core_video_mix *add_raw_active(video_t *v, long val)
+{
+	struct obs_core_video *video = &obs->video;
+	struct obs_core_video_mix *orphan = NULL;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	for (size_t i = 0; i < video->mixes.num; i++) {
+		struct obs_core_video_mix *mix = video->mixes.array[i];
+
+		if (mix->video != v)
+			continue;
+
+		if (val > 0) {
+			os_atomic_inc_long(&mix->raw_active);
+		} else if (os_atomic_dec_long(&mix->raw_active) == 0 &&
+			   !mix->view && mix != video->main_mix) {
+			orphan = mix;
+			da_erase(video->mixes, i);
+		}
+		break;
+	}
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	return orphan;
+}
+
 void start_raw_video(video_t *v, const struct video_scale_info *conversion,
 		     void (*callback)(void *param, struct video_data *frame),
 		     void *param)
 {
-	struct obs_core_video *video = &obs->video;
-	os_atomic_inc_long(&video->raw_active);
+	add_raw_active(v, 1);
 	video_output_connect(v, conversion, callback, param);
 }
 
@@ -2350,9 +2885,8 @@ void stop_raw_video(video_t *v,
 		    void (*callback)(void *param, struct video_data *frame),
 		    void *param)
 {
-	struct obs_core_video *video = &obs->video;
-	os_atomic_dec_long(&video->raw_active);
 	video_output_disconnect(v, callback, param);
+	obs_free_video_mix(add_raw_active(v, -1));
 }
 
 void obs_add_raw_video_callback(const struct video_scale_info *conversion,
@@ -2360,16 +2894,14 @@ void obs_add_raw_video_callback(const struct video_scale_info *conversion,
 						 struct video_data *frame),
 				void *param)
 {
-	struct obs_core_video *video = &obs->video;
-	start_raw_video(video->video, conversion, callback, param);
+	start_raw_video(obs_get_video(), conversion, callback, param);
 }
 
 void obs_remove_raw_video_callback(void (*callback)(void *param,
 						    struct video_data *frame),
 				   void *param)
 {
-	struct obs_core_video *video = &obs->video;
-	stop_raw_video(video->video, callback, param);
+	stop_raw_video(obs_get_video(), callback, param);
 }
 
 void obs_apply_private_data(obs_data_t *settings)
@@ -2418,7 +2950,7 @@ bool start_gpu_encode(obs_encoder_t *encoder)
 
 	if (success) {
 		os_atomic_inc_long(&video->gpu_encoder_active);
-		video_output_inc_texture_encoders(video->video);
+		video_output_inc_texture_encoders(video->main_mix->video);
 	}
 
 	return success;
@@ -2430,7 +2962,7 @@ void stop_gpu_encode(obs_encoder_t *encoder)
 	bool call_free = false;
 
 	os_atomic_dec_long(&video->gpu_encoder_active);
-	video_output_dec_texture_encoders(video->video);
+	video_output_dec_texture_encoders(video->main_mix->video);
 
 	pthread_mutex_lock(&video->gpu_encoder_mutex);
 	da_erase_item(video->gpu_encoders, &encoder);
@@ -2454,15 +2986,22 @@ void stop_gpu_encode(obs_encoder_t *encoder)
 bool obs_video_active(void)
 {
 	struct obs_core_video *video = &obs->video;
+	bool active = os_atomic_load_long(&video->gpu_encoder_active) > 0;
 
-	return os_atomic_load_long(&video->raw_active) > 0 ||
-	       os_atomic_load_long(&video->gpu_encoder_active) > 0;
+	pthread_mutex_lock(&video->mixes_mutex);
+	for (size_t i = 0; !active && i < video->mixes.num; i++) {
+		struct obs_core_video_mix *mix = video->mixes.array[i];
+		active = os_atomic_load_long(&mix->raw_active) > 0;
+	}
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	return active;
 }
 
 bool obs_nv12_tex_active(void)
 {
-	struct obs_core_video *video = &obs->video;
-	return video->using_nv12_tex;
+	struct obs_core_video_mix *video = obs->video.main_mix;
+	return video && video->using_nv12_tex;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -259,6 +259,22 @@ struct obs_source_frame2 {
 	bool flip;
 };
 
+/**
+ * Async video queue statistics.  The producer counters are updated by the
+ * thread calling obs_source_output_video, the consumer counters by the
+ * graphics thread.  Lock waits are only counted when the async mutex was
+ * actually contended.
+ */
+struct obs_source_async_stats {
+	uint64_t frames_output;
+	uint64_t frames_dropped;
+	uint64_t flushes;
+	uint64_t producer_lock_waits;
+	uint64_t producer_lock_wait_ns;
+	uint64_t consumer_lock_waits;
+	uint64_t consumer_lock_wait_ns;
+};
+
 /** Access to the argc/argv used to start OBS. What you see is what you get. */
 struct obs_cmdline_args {
 	int argc;
@@ -389,6 +405,48 @@ EXPORT bool obs_get_video_info(struct obs_video_info *ovi);
 /** Gets the current audio settings, returns false if no audio */
 EXPORT bool obs_get_audio_info(struct obs_audio_info *oai);
 
+/**
+ * Enables adaptive audio buffering.  By default audio buffering only grows
+ * when a source delivers its audio late, and stays at its peak until audio
+ * is reset.  In adaptive mode the lateness of the audio sources is tracked
+ * over a sliding window, and buffering that wasn't needed during the whole
+ * window is given back, one tick (1024 frames) at a time.
+ */
+EXPORT void obs_set_adaptive_audio_buffering(bool enable);
+EXPORT bool obs_adaptive_audio_buffering_enabled(void);
+
+struct obs_audio_buffering_info {
+	uint32_t ticks;
+	uint32_t ms;
+	uint32_t max_ticks;
+
+	/* most ticks any source needed within the current window */
+	uint32_t window_peak_ticks;
+	bool adaptive;
+};
+
+/** Gets the current audio buffering, returns false if no audio */
+EXPORT bool obs_get_audio_buffering_info(struct obs_audio_buffering_info *info);
+
+#define OBS_AUDIO_BUFFERING_HISTORY 64
+
+struct obs_audio_buffering_change {
+	uint64_t timestamp;
+	uint32_t ticks;
+	uint32_t ms;
+	bool grew;
+};
+
+/**
+ * Copies up to 'count' of the most recent audio buffering changes, oldest
+ * first.  Only the last OBS_AUDIO_BUFFERING_HISTORY changes are kept.
+ *
+ * @return  The number of changes copied
+ */
+EXPORT size_t
+obs_get_audio_buffering_history(struct obs_audio_buffering_change *changes,
+				size_t count);
+
 /**
  * Opens a plugin module directly from a specific path.
  *
@@ -462,9 +520,27 @@ EXPORT const char *obs_get_module_data_path(obs_module_t *module);
  */
 EXPORT void obs_add_module_path(const char *bin, const char *data);
 
-/** Automatically loads all modules from module paths (convenience function) */
+/**
+ * Automatically loads all modules from module paths (convenience function).
+ *
+ * Module images are opened and their locale files parsed in parallel, then
+ * each module's obs_module_load is called in discovery order.  The time spent
+ * in each phase is logged per module.
+ */
 EXPORT void obs_load_all_modules(void);
 
+/**
+ * Enables or disables lazy module loading for obs_load_all_modules.  When
+ * enabled, modules whose registered type IDs are known from a previous run
+ * are opened, but their obs_module_load is only called the first time one of
+ * their source, output, encoder or service IDs is requested.  Deferred
+ * modules are loaded on the thread that called obs_load_all_modules, which
+ * must be the thread UI tasks run on.  Enumerating types does not load them.
+ * Modules that do more than register types in obs_module_load should not be
+ * used with this mode.
+ */
+EXPORT void obs_set_lazy_module_loading(bool enable);
+
 /** Notifies modules that all modules have been loaded.  This function should
  * be called after all modules have been loaded. */
 EXPORT void obs_post_load_modules(void);
@@ -695,6 +771,15 @@ typedef void (*obs_load_source_cb)(void *private_data, obs_source_t *source);
 EXPORT void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 			     void *private_data);
 
+/**
+ * Enables creating the sources of obs_load_sources on a pool of worker
+ * threads.  Sources are still loaded, and the callback called, on the
+ * calling thread in the order of the data array.  Only enable this if the
+ * source types in use can be created from any thread.
+ */
+EXPORT void obs_set_parallel_source_loading(bool enable);
+EXPORT bool obs_parallel_source_loading_enabled(void);
+
 /** Saves sources to a data array */
 EXPORT obs_data_array_t *obs_save_sources(void);
 
@@ -724,6 +809,30 @@ EXPORT void obs_enum_audio_monitoring_devices(obs_enum_audio_device_cb cb,
 EXPORT bool obs_set_audio_monitoring_device(const char *name, const char *id);
 EXPORT void obs_get_audio_monitoring_device(const char **name, const char **id);
 
+struct obs_audio_monitoring_stats {
+	/* monitored sources mixed into the monitoring stream */
+	uint32_t monitors;
+	uint32_t latency_target_ms;
+	uint32_t latency_ms;
+
+	uint64_t mixed_frames;
+
+	/* times the monitoring device ran out of audio */
+	uint64_t underruns;
+
+	/* times a monitored source had too little audio to be mixed */
+	uint64_t source_underruns;
+
+	/* frames discarded to stay within the latency target */
+	uint64_t dropped_frames;
+};
+
+/** Gets statistics of the mixed audio monitoring stream.  Returns false if
+ * nothing is monitored, or if the platform's monitoring does not use a mixed
+ * stream. */
+EXPORT bool
+obs_get_audio_monitoring_stats(struct obs_audio_monitoring_stats *stats);
+
 EXPORT void obs_add_tick_callback(void (*tick)(void *param, float seconds),
 				  void *param);
 EXPORT void obs_remove_tick_callback(void (*tick)(void *param, float seconds),
@@ -750,6 +859,38 @@ EXPORT uint64_t obs_get_frame_interval_ns(void);
 EXPORT uint32_t obs_get_total_frames(void);
 EXPORT uint32_t obs_get_lagged_frames(void);
 
+/**
+ * Configures how the graphics thread waits for the next frame.  The thread
+ * sleeps until the frame deadline minus 'spin_ns' and busy-waits the rest,
+ * trading CPU time for lower wake-up jitter.  With 'realtime' set, it also
+ * asks for real-time scheduling, which needs sufficient privileges (e.g.
+ * CAP_SYS_NICE or an rtprio limit on Linux); it falls back to normal
+ * scheduling with a warning if that is refused.
+ */
+EXPORT void obs_set_video_pacing(uint64_t spin_ns, bool realtime);
+
+/* bucket 0 counts wake-ups less than 1us late, bucket i (i > 0) those
+ * [2^(i-1), 2^i) us late, and the last bucket everything later than that */
+#define OBS_VIDEO_PACING_BUCKETS 16
+
+struct obs_video_pacing_stats {
+	/* frames that waited for their deadline, and how late they woke */
+	uint64_t frames;
+	uint64_t total_wake_latency_ns;
+	uint64_t max_wake_latency_ns;
+	uint64_t histogram[OBS_VIDEO_PACING_BUCKETS];
+
+	/* frames whose deadline had already passed when rendering finished */
+	uint64_t late_frames;
+	uint64_t total_late_ns;
+	uint64_t max_late_ns;
+
+	bool realtime_active;
+};
+
+EXPORT void obs_get_video_pacing_stats(struct obs_video_pacing_stats *stats);
+EXPORT void obs_reset_video_pacing_stats(void);
+
 EXPORT bool obs_nv12_tex_active(void);
 
 EXPORT void obs_apply_private_data(obs_data_t *settings);
@@ -793,6 +934,32 @@ EXPORT obs_source_t *obs_view_get_source(obs_view_t *view, uint32_t channel);
 /** Renders the sources of this view context */
 EXPORT void obs_view_render(obs_view_t *view);
 
+/**
+ * Adds a canvas rendering this view into its own video output, with its own
+ * base and output resolution, frame rate, format and GPU conversion.
+ *
+ *   Sources are shared with the main mix: they are ticked and their async
+ * frames uploaded once per frame regardless of how many canvases show them.
+ * The canvas is rendered on the graphics thread, on the frames closest to
+ * its own frame times, and only while outputs or encoders are connected to
+ * its video output.  Texture-based encoders can only use the main video.
+ *
+ *   Canvases are removed when the video is reset.  The graphics_module and
+ * adapter members of ovi are ignored, the output size is aligned the same
+ * way as in obs_reset_video.
+ *
+ * @return  The video output of the canvas, or NULL on failure or if the view
+ *          was already added
+ */
+EXPORT video_t *obs_view_add(obs_view_t *view, struct obs_video_info *ovi);
+
+/** Removes the canvas of this view, stop its outputs before calling this */
+EXPORT void obs_view_remove(obs_view_t *view);
+
+/** Gets the video settings of the canvas of this view */
+EXPORT bool obs_view_get_video_info(obs_view_t *view,
+				    struct obs_video_info *ovi);
+
 /* ------------------------------------------------------------------------- */
 /* Display context */
 
@@ -835,6 +1002,34 @@ EXPORT void obs_display_remove_draw_callback(
 EXPORT void obs_display_set_enabled(obs_display_t *display, bool enable);
 EXPORT bool obs_display_enabled(obs_display_t *display);
 
+/** Limits how often the display is rendered, 0 for the canvas frame rate */
+EXPORT void obs_display_set_max_fps(obs_display_t *display, uint32_t fps);
+
+/**
+ * Only renders the display when its content may have changed: when the
+ * source set with obs_display_set_source changed, when the display was
+ * resized or when a redraw was requested.  Without a source, the display is
+ * only rendered when a redraw is requested.
+ */
+EXPORT void obs_display_set_on_demand(obs_display_t *display, bool on_demand);
+
+/** Sets the source whose changes cause an on-demand display to render */
+EXPORT void obs_display_set_source(obs_display_t *display,
+				   obs_source_t *source);
+
+/** Renders the display on the next frame, regardless of its source */
+EXPORT void obs_display_request_redraw(obs_display_t *display);
+
+/**
+ * Skips rendering the display until the next frame when its last render
+ * time wouldn't fit before the next output frame, so that it never delays
+ * output.  Off by default.
+ */
+EXPORT void obs_display_set_skip_when_late(obs_display_t *display, bool skip);
+
+/** Returns the number of renders skipped to avoid delaying output */
+EXPORT uint64_t obs_display_get_skipped_frames(obs_display_t *display);
+
 EXPORT void obs_display_set_background_color(obs_display_t *display,
 					     uint32_t color);
 
@@ -1206,6 +1401,17 @@ EXPORT void obs_source_output_video(obs_source_t *source,
 EXPORT void obs_source_output_video2(obs_source_t *source,
 				     const struct obs_source_frame2 *frame);
 
+/**
+ * Outputs asynchronous video data without copying it.  The frame data is
+ * used in place until libobs calls release with param, which may happen on
+ * any thread, before this function returns if the frame is dropped, and after
+ * the source has been destroyed.
+ */
+EXPORT void
+obs_source_output_video_borrowed(obs_source_t *source,
+				 const struct obs_source_frame *frame,
+				 void (*release)(void *param), void *param);
+
 EXPORT void obs_source_set_async_rotation(obs_source_t *source, long rotation);
 
 /**
@@ -1249,6 +1455,10 @@ EXPORT struct obs_source_frame *obs_source_get_frame(obs_source_t *source);
 EXPORT void obs_source_release_frame(obs_source_t *source,
 				     struct obs_source_frame *frame);
 
+/** Gets the async video queue statistics of an async source */
+EXPORT bool obs_source_get_async_stats(const obs_source_t *source,
+				       struct obs_source_async_stats *stats);
+
 /**
  * Default RGB filter handler for generic effect filters.  Processes the
  * filter chain and renders them to texture if needed, then the filter is
@@ -1746,6 +1956,32 @@ EXPORT uint32_t obs_output_get_delay(const obs_output_t *output);
 /** If delay is active, gets the currently active delay value, in seconds. */
 EXPORT uint32_t obs_output_get_active_delay(const obs_output_t *output);
 
+/**
+ * Stores the payloads of delayed packets in files under 'dir' once more than
+ * 'max_memory' bytes of them are held in memory, and reads them back when
+ * they're due.  Pass NULL for 'dir' to keep everything in memory.  Like the
+ * delay value itself, this takes effect the next time delay is activated.
+ */
+EXPORT void obs_output_set_delay_spill(obs_output_t *output, const char *dir,
+				       uint64_t max_memory);
+
+struct obs_output_delay_stats {
+	uint64_t queued_packets;
+	uint64_t peak_queued_packets;
+	uint64_t memory_bytes;
+	uint64_t peak_memory_bytes;
+	uint64_t spilled_bytes;
+	uint64_t released_packets;
+
+	/* how late packets were released relative to their deadline */
+	uint64_t avg_jitter_ns;
+	uint64_t max_jitter_ns;
+};
+
+/** Gets the queue depth and release timing of the output's delay. */
+EXPORT bool obs_output_get_delay_stats(const obs_output_t *output,
+				       struct obs_output_delay_stats *stats);
+
 /** Forces the output to stop.  Usually only used with delay. */
 EXPORT void obs_output_force_stop(obs_output_t *output);
 
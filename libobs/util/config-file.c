@@ -17,6 +17,7 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <wchar.h>
+#include <ctype.h>
 #include "config-file.h"
 #include "threading.h"
 #include "platform.h"
@@ -25,6 +26,141 @@
 #include "darray.h"
 #include "lexer.h"
 #include "dstr.h"
+#include "hash.h"
+
+/* how long config_save_safe_deferred waits for further changes, and how far
+ * a stream of changes can push the save back before it is written anyway */
+#define SAVE_DELAY_NS 500000000ULL
+#define SAVE_MAX_DELAY_NS 2000000000ULL
+
+/* ------------------------------------------------------------------------- */
+/* Section/key index
+ *
+ * Sections and items stay in their darrays so that files are written back in
+ * their original order; the index maps the case-insensitive hash of a name
+ * to its position in the darray.  Only the first occurrence of a name is
+ * indexed, which matches the lookup order of the original linear scan. */
+
+struct config_index_slot {
+	uint64_t hash;
+	size_t idx; /* darray index + 1, 0 if the slot is empty */
+};
+
+struct config_index {
+	struct config_index_slot *slots;
+	size_t size; /* power of two */
+	size_t count;
+};
+
+static inline uint64_t config_hash(const char *name)
+{
+	uint64_t hash = HASH_FNV1A64_INIT;
+
+	if (!name)
+		return hash;
+
+	/* must agree with astrcmpi */
+	while (*name) {
+		hash ^= (uint8_t)(char)toupper(*(name++));
+		hash *= HASH_FNV1A64_PRIME;
+	}
+
+	return hash;
+}
+
+static inline void config_index_free(struct config_index *index)
+{
+	bfree(index->slots);
+	memset(index, 0, sizeof(*index));
+}
+
+/* config_item and config_section both start with their name */
+static inline const char *entry_name(const struct darray *array,
+				     size_t element_size, size_t idx)
+{
+	return *(char **)darray_item(element_size, array, idx);
+}
+
+static size_t config_index_find(const struct config_index *index,
+				const struct darray *array, size_t element_size,
+				const char *name, uint64_t hash)
+{
+	size_t mask = index->size - 1;
+
+	if (!index->count)
+		return DARRAY_INVALID;
+
+	for (size_t i = (size_t)hash & mask;; i = (i + 1) & mask) {
+		const struct config_index_slot *slot = index->slots + i;
+
+		if (!slot->idx)
+			return DARRAY_INVALID;
+
+		if (slot->hash == hash &&
+		    astrcmpi(entry_name(array, element_size, slot->idx - 1),
+			     name) == 0)
+			return slot->idx - 1;
+	}
+}
+
+static void config_index_insert(struct config_index *index, uint64_t hash,
+				size_t idx)
+{
+	size_t mask = index->size - 1;
+	size_t i = (size_t)hash & mask;
+
+	while (index->slots[i].idx)
+		i = (i + 1) & mask;
+
+	index->slots[i].hash = hash;
+	index->slots[i].idx = idx + 1;
+	index->count++;
+}
+
+static void config_index_add(struct config_index *index, uint64_t hash,
+			     size_t idx)
+{
+	/* keep the load factor under 3/4 */
+	if ((index->count + 1) * 4 > index->size * 3) {
+		struct config_index old = *index;
+
+		index->size = old.size ? old.size * 2 : 16;
+		index->slots = bzalloc(index->size * sizeof(*index->slots));
+		index->count = 0;
+
+		for (size_t i = 0; i < old.size; i++) {
+			if (old.slots[i].idx)
+				config_index_insert(index, old.slots[i].hash,
+						    old.slots[i].idx - 1);
+		}
+
+		bfree(old.slots);
+	}
+
+	config_index_insert(index, hash, idx);
+}
+
+/* darray_erase shifts everything after the erased entry, so the index is
+ * simply rebuilt; removing values is rare compared to looking them up */
+static void config_index_rebuild(struct config_index *index,
+				 const struct darray *array,
+				 size_t element_size)
+{
+	if (index->slots)
+		memset(index->slots, 0, index->size * sizeof(*index->slots));
+	index->count = 0;
+
+	for (size_t i = 0; i < array->num; i++) {
+		const char *name = entry_name(array, element_size, i);
+		uint64_t hash = config_hash(name);
+
+		if (config_index_find(index, array, element_size, name, hash) ==
+		    DARRAY_INVALID)
+			config_index_add(index, hash, i);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
 
 struct config_item {
 	char *name;
@@ -40,6 +176,7 @@ static inline void config_item_free(struct config_item *item)
 struct config_section {
 	char *name;
 	struct darray items; /* struct config_item */
+	struct config_index index;
 };
 
 static inline void config_section_free(struct config_section *section)
@@ -51,6 +188,7 @@ static inline void config_section_free(struct config_section *section)
 		config_item_free(items + i);
 
 	darray_free(&section->items);
+	config_index_free(&section->index);
 	bfree(section->name);
 }
 
@@ -58,7 +196,27 @@ struct config_data {
 	char *file;
 	struct darray sections; /* struct config_section */
 	struct darray defaults; /* struct config_section */
+	struct config_index section_index;
+	struct config_index default_index;
 	pthread_mutex_t mutex;
+
+	/* user value changes, and the change count last written to disk */
+	uint64_t changes;
+	uint64_t saved_changes;
+
+	/* serializes file writes; always locked before mutex */
+	pthread_mutex_t write_mutex;
+
+	/* deferred saves */
+	pthread_t save_thread;
+	os_event_t *save_event;
+	bool save_thread_active;
+	bool save_pending;
+	bool save_stop;
+	uint64_t save_requested;
+	uint64_t save_deadline;
+	char *save_temp_ext;
+	char *save_backup_ext;
 };
 
 static inline bool init_mutex(config_t *config)
@@ -68,7 +226,65 @@ static inline bool init_mutex(config_t *config)
 		return false;
 	if (pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0)
 		return false;
-	return pthread_mutex_init(&config->mutex, &attr) == 0;
+	if (pthread_mutex_init(&config->mutex, &attr) != 0)
+		return false;
+	if (pthread_mutex_init(&config->write_mutex, NULL) != 0) {
+		pthread_mutex_destroy(&config->mutex);
+		return false;
+	}
+	return true;
+}
+
+static struct config_section *
+config_find_section(const struct darray *sections,
+		    const struct config_index *index, const char *name)
+{
+	size_t idx = config_index_find(index, sections,
+				       sizeof(struct config_section), name,
+				       config_hash(name));
+
+	return idx != DARRAY_INVALID
+		       ? darray_item(sizeof(struct config_section), sections,
+				     idx)
+		       : NULL;
+}
+
+/* takes ownership of name */
+static struct config_section *config_add_section(struct darray *sections,
+						 struct config_index *index,
+						 char *name)
+{
+	struct config_section *section;
+
+	section = darray_push_back_new(sizeof(struct config_section), sections);
+	section->name = name;
+	config_index_add(index, config_hash(name), sections->num - 1);
+	return section;
+}
+
+static inline size_t config_find_section_item(const struct config_section *sec,
+					      const char *name, uint64_t hash)
+{
+	return config_index_find(&sec->index, &sec->items,
+				 sizeof(struct config_item), name, hash);
+}
+
+/* takes ownership of name and value */
+static struct config_item *config_push_item(struct config_section *sec,
+					    char *name, char *value)
+{
+	struct config_item *item;
+	uint64_t hash = config_hash(name);
+	bool duplicate = config_find_section_item(sec, name, hash) !=
+			 DARRAY_INVALID;
+
+	item = darray_push_back_new(sizeof(struct config_item), &sec->items);
+	item->name = name;
+	item->value = value;
+
+	if (!duplicate)
+		config_index_add(&sec->index, hash, sec->items.num - 1);
+	return item;
 }
 
 config_t *config_create(const char *file)
@@ -162,18 +378,16 @@ static void unescape(struct dstr *str)
 		*write = '\0';
 }
 
-static void config_add_item(struct darray *items, struct strref *name,
-			    struct strref *value)
+static void config_add_item(struct config_section *section,
+			    struct strref *name, struct strref *value)
 {
-	struct config_item item;
 	struct dstr item_value;
 	dstr_init_copy_strref(&item_value, value);
 
 	unescape(&item_value);
 
-	item.name = bstrdup_n(name->array, name->len);
-	item.value = item_value.array;
-	darray_push_back(sizeof(struct config_item), items, &item);
+	config_push_item(section, bstrdup_n(name->array, name->len),
+			 item_value.array);
 }
 
 static void config_parse_section(struct config_section *section,
@@ -212,19 +426,17 @@ static void config_parse_section(struct config_section *section,
 		strref_clear(&value);
 		config_parse_string(lex, &value, 0);
 
-		if (strref_is_empty(&value)) {
-			struct config_item item;
-			item.name = bstrdup_n(name.array, name.len);
-			item.value = bzalloc(1);
-			darray_push_back(sizeof(struct config_item),
-					 &section->items, &item);
-		} else {
-			config_add_item(&section->items, &name, &value);
-		}
+		if (strref_is_empty(&value))
+			config_push_item(section,
+					 bstrdup_n(name.array, name.len),
+					 bzalloc(1));
+		else
+			config_add_item(section, &name, &value);
 	}
 }
 
-static void parse_config_data(struct darray *sections, struct lexer *lex)
+static void parse_config_data(struct darray *sections,
+			      struct config_index *index, struct lexer *lex)
 {
 	struct strref section_name;
 	struct base_token token;
@@ -233,6 +445,7 @@ static void parse_config_data(struct darray *sections, struct lexer *lex)
 
 	while (lexer_getbasetoken(lex, &token, PARSE_WHITESPACE)) {
 		struct config_section *section;
+		char *name;
 
 		while (token.type == BASETOKEN_WHITESPACE) {
 			if (!lexer_getbasetoken(lex, &token, PARSE_WHITESPACE))
@@ -254,14 +467,20 @@ static void parse_config_data(struct darray *sections, struct lexer *lex)
 		if (!section_name.len)
 			return;
 
-		section = darray_push_back_new(sizeof(struct config_section),
-					       sections);
-		section->name = bstrdup_n(section_name.array, section_name.len);
+		/* repeated sections are merged into the first one */
+		name = bstrdup_n(section_name.array, section_name.len);
+		section = config_find_section(sections, index, name);
+		if (section)
+			bfree(name);
+		else
+			section = config_add_section(sections, index, name);
+
 		config_parse_section(section, lex);
 	}
 }
 
-static int config_parse_file(struct darray *sections, const char *file,
+static int config_parse_file(struct darray *sections,
+			     struct config_index *index, const char *file,
 			     bool always_open)
 {
 	char *file_data;
@@ -283,7 +502,7 @@ static int config_parse_file(struct darray *sections, const char *file,
 	lexer_init(&lex);
 	lexer_start_move(&lex, file_data);
 
-	parse_config_data(sections, &lex);
+	parse_config_data(sections, index, &lex);
 
 	lexer_free(&lex);
 	return CONFIG_SUCCESS;
@@ -309,7 +528,9 @@ int config_open(config_t **config, const char *file,
 
 	(*config)->file = bstrdup(file);
 
-	errorcode = config_parse_file(&(*config)->sections, file, always_open);
+	errorcode = config_parse_file(&(*config)->sections,
+				      &(*config)->section_index, file,
+				      always_open);
 
 	if (errorcode != CONFIG_SUCCESS) {
 		config_close(*config);
@@ -339,7 +560,8 @@ int config_open_string(config_t **config, const char *str)
 
 	lexer_init(&lex);
 	lexer_start(&lex, str);
-	parse_config_data(&(*config)->sections, &lex);
+	parse_config_data(&(*config)->sections, &(*config)->section_index,
+			  &lex);
 	lexer_free(&lex);
 
 	return CONFIG_SUCCESS;
@@ -350,42 +572,27 @@ int config_open_defaults(config_t *config, const char *file)
 	if (!config)
 		return CONFIG_ERROR;
 
-	return config_parse_file(&config->defaults, file, false);
+	return config_parse_file(&config->defaults, &config->default_index,
+				 file, false);
 }
 
-int config_save(config_t *config)
+static void config_serialize(const config_t *config, struct dstr *str)
 {
-	FILE *f;
-	struct dstr str, tmp;
+	struct dstr tmp;
 	size_t i, j;
-	int ret = CONFIG_ERROR;
-
-	if (!config)
-		return CONFIG_ERROR;
-	if (!config->file)
-		return CONFIG_ERROR;
 
-	dstr_init(&str);
 	dstr_init(&tmp);
 
-	pthread_mutex_lock(&config->mutex);
-
-	f = os_fopen(config->file, "wb");
-	if (!f) {
-		pthread_mutex_unlock(&config->mutex);
-		return CONFIG_FILENOTFOUND;
-	}
-
 	for (i = 0; i < config->sections.num; i++) {
 		struct config_section *section = darray_item(
 			sizeof(struct config_section), &config->sections, i);
 
 		if (i)
-			dstr_cat(&str, "\n");
+			dstr_cat(str, "\n");
 
-		dstr_cat(&str, "[");
-		dstr_cat(&str, section->name);
-		dstr_cat(&str, "]\n");
+		dstr_cat(str, "[");
+		dstr_cat(str, section->name);
+		dstr_cat(str, "]\n");
 
 		for (j = 0; j < section->items.num; j++) {
 			struct config_item *item = darray_item(
@@ -396,58 +603,52 @@ int config_save(config_t *config)
 			dstr_replace(&tmp, "\r", "\\r");
 			dstr_replace(&tmp, "\n", "\\n");
 
-			dstr_cat(&str, item->name);
-			dstr_cat(&str, "=");
-			dstr_cat(&str, tmp.array);
-			dstr_cat(&str, "\n");
+			dstr_cat(str, item->name);
+			dstr_cat(str, "=");
+			dstr_cat(str, tmp.array);
+			dstr_cat(str, "\n");
 		}
 	}
 
+	dstr_free(&tmp);
+}
+
+static int config_write_file(const char *file, const struct dstr *str)
+{
+	int ret = CONFIG_ERROR;
+	FILE *f;
+
+	f = os_fopen(file, "wb");
+	if (!f)
+		return CONFIG_FILENOTFOUND;
+
 #ifdef _WIN32
 	if (fwrite("\xEF\xBB\xBF", 3, 1, f) != 1)
 		goto cleanup;
 #endif
-	if (fwrite(str.array, str.len, 1, f) != 1)
+	if (fwrite(str->array, str->len, 1, f) != 1)
 		goto cleanup;
 
 	ret = CONFIG_SUCCESS;
 
 cleanup:
 	fclose(f);
-
-	pthread_mutex_unlock(&config->mutex);
-
-	dstr_free(&tmp);
-	dstr_free(&str);
-
 	return ret;
 }
 
-int config_save_safe(config_t *config, const char *temp_ext,
-		     const char *backup_ext)
+static int config_write_file_safe(const char *file, const struct dstr *str,
+				  const char *temp_ext, const char *backup_ext)
 {
 	struct dstr temp_file = {0};
 	struct dstr backup_file = {0};
-	char *file = config->file;
 	int ret;
 
-	if (!temp_ext || !*temp_ext) {
-		blog(LOG_ERROR, "config_save_safe: invalid "
-				"temporary extension specified");
-		return CONFIG_ERROR;
-	}
-
-	pthread_mutex_lock(&config->mutex);
-
-	dstr_copy(&temp_file, config->file);
+	dstr_copy(&temp_file, file);
 	if (*temp_ext != '.')
 		dstr_cat(&temp_file, ".");
 	dstr_cat(&temp_file, temp_ext);
 
-	config->file = temp_file.array;
-	ret = config_save(config);
-	config->file = file;
-
+	ret = config_write_file(temp_file.array, str);
 	if (ret != CONFIG_SUCCESS) {
 		blog(LOG_ERROR,
 		     "config_save_safe: failed to "
@@ -457,7 +658,7 @@ int config_save_safe(config_t *config, const char *temp_ext,
 	}
 
 	if (backup_ext && *backup_ext) {
-		dstr_copy(&backup_file, config->file);
+		dstr_copy(&backup_file, file);
 		if (*backup_ext != '.')
 			dstr_cat(&backup_file, ".");
 		dstr_cat(&backup_file, backup_ext);
@@ -467,12 +668,223 @@ int config_save_safe(config_t *config, const char *temp_ext,
 		ret = CONFIG_ERROR;
 
 cleanup:
-	pthread_mutex_unlock(&config->mutex);
 	dstr_free(&temp_file);
 	dstr_free(&backup_file);
 	return ret;
 }
 
+/* Serializes the config and writes it out.  The config mutex is only held
+ * while serializing, so other threads can keep reading and changing values
+ * while the file is written.  Any pending deferred save is superseded. */
+static int config_write(config_t *config, const char *temp_ext,
+			const char *backup_ext)
+{
+	struct dstr str;
+	uint64_t changes;
+	int ret;
+
+	dstr_init(&str);
+
+	pthread_mutex_lock(&config->write_mutex);
+	pthread_mutex_lock(&config->mutex);
+
+	config_serialize(config, &str);
+	changes = config->changes;
+	config->save_pending = false;
+
+	pthread_mutex_unlock(&config->mutex);
+
+	if (temp_ext)
+		ret = config_write_file_safe(config->file, &str, temp_ext,
+					     backup_ext);
+	else
+		ret = config_write_file(config->file, &str);
+
+	if (ret == CONFIG_SUCCESS) {
+		pthread_mutex_lock(&config->mutex);
+		config->saved_changes = changes;
+		pthread_mutex_unlock(&config->mutex);
+	}
+
+	pthread_mutex_unlock(&config->write_mutex);
+
+	dstr_free(&str);
+	return ret;
+}
+
+int config_save(config_t *config)
+{
+	if (!config)
+		return CONFIG_ERROR;
+	if (!config->file)
+		return CONFIG_ERROR;
+
+	return config_write(config, NULL, NULL);
+}
+
+static inline bool valid_temp_ext(const char *temp_ext, const char *func)
+{
+	if (!temp_ext || !*temp_ext) {
+		blog(LOG_ERROR,
+		     "%s: invalid "
+		     "temporary extension specified",
+		     func);
+		return false;
+	}
+
+	return true;
+}
+
+int config_save_safe(config_t *config, const char *temp_ext,
+		     const char *backup_ext)
+{
+	if (!valid_temp_ext(temp_ext, "config_save_safe"))
+		return CONFIG_ERROR;
+	if (!config || !config->file)
+		return CONFIG_ERROR;
+
+	return config_write(config, temp_ext, backup_ext);
+}
+
+static void config_write_deferred(config_t *config)
+{
+	struct dstr str;
+	char *temp_ext;
+	char *backup_ext;
+	uint64_t changes;
+	int ret;
+
+	dstr_init(&str);
+
+	pthread_mutex_lock(&config->write_mutex);
+	pthread_mutex_lock(&config->mutex);
+
+	if (!config->save_pending) {
+		pthread_mutex_unlock(&config->mutex);
+		pthread_mutex_unlock(&config->write_mutex);
+		return;
+	}
+
+	config_serialize(config, &str);
+	changes = config->changes;
+	temp_ext = bstrdup(config->save_temp_ext);
+	backup_ext = bstrdup(config->save_backup_ext);
+	config->save_pending = false;
+
+	pthread_mutex_unlock(&config->mutex);
+
+	ret = config_write_file_safe(config->file, &str, temp_ext, backup_ext);
+	if (ret == CONFIG_SUCCESS) {
+		pthread_mutex_lock(&config->mutex);
+		config->saved_changes = changes;
+		pthread_mutex_unlock(&config->mutex);
+	} else {
+		blog(LOG_WARNING,
+		     "config_save_safe_deferred: failed to save %s",
+		     config->file);
+	}
+
+	pthread_mutex_unlock(&config->write_mutex);
+
+	bfree(temp_ext);
+	bfree(backup_ext);
+	dstr_free(&str);
+}
+
+static void *config_save_thread(void *data)
+{
+	config_t *config = data;
+
+	os_set_thread_name("config: deferred save");
+
+	for (;;) {
+		uint64_t now = os_gettime_ns();
+		uint64_t deadline = 0;
+		bool stop;
+
+		pthread_mutex_lock(&config->mutex);
+		stop = config->save_stop;
+		if (config->save_pending)
+			deadline = config->save_deadline;
+		pthread_mutex_unlock(&config->mutex);
+
+		if (deadline && (stop || now >= deadline)) {
+			config_write_deferred(config);
+		} else if (stop) {
+			break;
+		} else if (deadline) {
+			uint64_t ms = (deadline - now + 999999) / 1000000;
+			os_event_timedwait(config->save_event,
+					   (unsigned long)ms);
+		} else {
+			os_event_wait(config->save_event);
+		}
+	}
+
+	return NULL;
+}
+
+int config_save_safe_deferred(config_t *config, const char *temp_ext,
+			      const char *backup_ext)
+{
+	uint64_t now = os_gettime_ns();
+	int ret = CONFIG_SUCCESS;
+
+	if (!valid_temp_ext(temp_ext, "config_save_safe_deferred"))
+		return CONFIG_ERROR;
+	if (!config || !config->file)
+		return CONFIG_ERROR;
+
+	pthread_mutex_lock(&config->mutex);
+
+	if (config->changes == config->saved_changes && !config->save_pending)
+		goto unlock;
+
+	if (!config->save_thread_active) {
+		if (os_event_init(&config->save_event, OS_EVENT_TYPE_AUTO) !=
+		    0) {
+			ret = CONFIG_ERROR;
+			goto unlock;
+		}
+		if (pthread_create(&config->save_thread, NULL,
+				   config_save_thread, config) != 0) {
+			os_event_destroy(config->save_event);
+			config->save_event = NULL;
+			ret = CONFIG_ERROR;
+			goto unlock;
+		}
+		config->save_thread_active = true;
+	}
+
+	if (!config->save_pending) {
+		config->save_pending = true;
+		config->save_requested = now;
+	}
+
+	config->save_deadline = now + SAVE_DELAY_NS;
+	if (config->save_deadline > config->save_requested + SAVE_MAX_DELAY_NS)
+		config->save_deadline =
+			config->save_requested + SAVE_MAX_DELAY_NS;
+
+	bfree(config->save_temp_ext);
+	bfree(config->save_backup_ext);
+	config->save_temp_ext = bstrdup(temp_ext);
+	config->save_backup_ext = bstrdup(backup_ext);
+
+	os_event_signal(config->save_event);
+
+unlock:
+	pthread_mutex_unlock(&config->mutex);
+
+	if (ret != CONFIG_SUCCESS) {
+		blog(LOG_WARNING, "config_save_safe_deferred: failed to start "
+				  "save thread, saving now");
+		ret = config_save_safe(config, temp_ext, backup_ext);
+	}
+
+	return ret;
+}
+
 void config_close(config_t *config)
 {
 	struct config_section *defaults, *sections;
@@ -481,6 +893,17 @@ void config_close(config_t *config)
 	if (!config)
 		return;
 
+	/* writes out any pending deferred save before stopping */
+	if (config->save_thread_active) {
+		pthread_mutex_lock(&config->mutex);
+		config->save_stop = true;
+		pthread_mutex_unlock(&config->mutex);
+
+		os_event_signal(config->save_event);
+		pthread_join(config->save_thread, NULL);
+		os_event_destroy(config->save_event);
+	}
+
 	defaults = config->defaults.array;
 	sections = config->sections.array;
 
@@ -491,7 +914,12 @@ void config_close(config_t *config)
 
 	darray_free(&config->defaults);
 	darray_free(&config->sections);
+	config_index_free(&config->default_index);
+	config_index_free(&config->section_index);
+	bfree(config->save_temp_ext);
+	bfree(config->save_backup_ext);
 	bfree(config->file);
+	pthread_mutex_destroy(&config->write_mutex);
 	pthread_mutex_destroy(&config->mutex);
 	bfree(config);
 }
@@ -520,70 +948,53 @@ unlock:
 	return name;
 }
 
-static const struct config_item *config_find_item(const struct darray *sections,
-						  const char *section,
-						  const char *name)
+static const struct config_item *
+config_find_item(const struct darray *sections,
+		 const struct config_index *index, const char *section,
+		 const char *name)
 {
-	size_t i, j;
-
-	for (i = 0; i < sections->num; i++) {
-		const struct config_section *sec =
-			darray_item(sizeof(struct config_section), sections, i);
+	const struct config_section *sec;
+	size_t idx;
 
-		if (astrcmpi(sec->name, section) == 0) {
-			for (j = 0; j < sec->items.num; j++) {
-				struct config_item *item =
-					darray_item(sizeof(struct config_item),
-						    &sec->items, j);
+	sec = config_find_section(sections, index, section);
+	if (!sec)
+		return NULL;
 
-				if (astrcmpi(item->name, name) == 0)
-					return item;
-			}
-		}
-	}
+	idx = config_find_section_item(sec, name, config_hash(name));
+	if (idx == DARRAY_INVALID)
+		return NULL;
 
-	return NULL;
+	return darray_item(sizeof(struct config_item), &sec->items, idx);
 }
 
 static void config_set_item(config_t *config, struct darray *sections,
-			    const char *section, const char *name, char *value)
+			    struct config_index *index, const char *section,
+			    const char *name, char *value)
 {
-	struct config_section *sec = NULL;
-	struct config_section *array = sections->array;
+	struct config_section *sec;
 	struct config_item *item;
-	size_t i, j;
+	size_t idx;
 
 	pthread_mutex_lock(&config->mutex);
 
-	for (i = 0; i < sections->num; i++) {
-		struct config_section *cur_sec = array + i;
-		struct config_item *items = cur_sec->items.array;
-
-		if (astrcmpi(cur_sec->name, section) == 0) {
-			for (j = 0; j < cur_sec->items.num; j++) {
-				item = items + j;
-
-				if (astrcmpi(item->name, name) == 0) {
-					bfree(item->value);
-					item->value = value;
-					goto unlock;
-				}
-			}
-
-			sec = cur_sec;
-			break;
+	if (sections == &config->sections)
+		config->changes++;
+
+	sec = config_find_section(sections, index, section);
+	if (sec) {
+		idx = config_find_section_item(sec, name, config_hash(name));
+		if (idx != DARRAY_INVALID) {
+			item = darray_item(sizeof(struct config_item),
+					   &sec->items, idx);
+			bfree(item->value);
+			item->value = value;
+			goto unlock;
 		}
+	} else {
+		sec = config_add_section(sections, index, bstrdup(section));
 	}
 
-	if (!sec) {
-		sec = darray_push_back_new(sizeof(struct config_section),
-					   sections);
-		sec->name = bstrdup(section);
-	}
-
-	item = darray_push_back_new(sizeof(struct config_item), &sec->items);
-	item->name = bstrdup(name);
-	item->value = value;
+	config_push_item(sec, bstrdup(name), value);
 
 unlock:
 	pthread_mutex_unlock(&config->mutex);
@@ -594,8 +1005,8 @@ void config_set_string(config_t *config, const char *section, const char *name,
 {
 	if (!value)
 		value = "";
-	config_set_item(config, &config->sections, section, name,
-			bstrdup(value));
+	config_set_item(config, &config->sections, &config->section_index,
+			section, name, bstrdup(value));
 }
 
 void config_set_int(config_t *config, const char *section, const char *name,
@@ -604,7 +1015,8 @@ void config_set_int(config_t *config, const char *section, const char *name,
 	struct dstr str;
 	dstr_init(&str);
 	dstr_printf(&str, "%" PRId64, value);
-	config_set_item(config, &config->sections, section, name, str.array);
+	config_set_item(config, &config->sections, &config->section_index,
+			section, name, str.array);
 }
 
 void config_set_uint(config_t *config, const char *section, const char *name,
@@ -613,14 +1025,16 @@ void config_set_uint(config_t *config, const char *section, const char *name,
 	struct dstr str;
 	dstr_init(&str);
 	dstr_printf(&str, "%" PRIu64, value);
-	config_set_item(config, &config->sections, section, name, str.array);
+	config_set_item(config, &config->sections, &config->section_index,
+			section, name, str.array);
 }
 
 void config_set_bool(config_t *config, const char *section, const char *name,
 		     bool value)
 {
 	char *str = bstrdup(value ? "true" : "false");
-	config_set_item(config, &config->sections, section, name, str);
+	config_set_item(config, &config->sections, &config->section_index,
+			section, name, str);
 }
 
 void config_set_double(config_t *config, const char *section, const char *name,
@@ -628,7 +1042,8 @@ void config_set_double(config_t *config, const char *section, const char *name,
 {
 	char *str = bzalloc(64);
 	os_dtostr(value, str, 64);
-	config_set_item(config, &config->sections, section, name, str);
+	config_set_item(config, &config->sections, &config->section_index,
+			section, name, str);
 }
 
 void config_set_default_string(config_t *config, const char *section,
@@ -636,8 +1051,8 @@ void config_set_default_string(config_t *config, const char *section,
 {
 	if (!value)
 		value = "";
-	config_set_item(config, &config->defaults, section, name,
-			bstrdup(value));
+	config_set_item(config, &config->defaults, &config->default_index,
+			section, name, bstrdup(value));
 }
 
 void config_set_default_int(config_t *config, const char *section,
@@ -646,7 +1061,8 @@ void config_set_default_int(config_t *config, const char *section,
 	struct dstr str;
 	dstr_init(&str);
 	dstr_printf(&str, "%" PRId64, value);
-	config_set_item(config, &config->defaults, section, name, str.array);
+	config_set_item(config, &config->defaults, &config->default_index,
+			section, name, str.array);
 }
 
 void config_set_default_uint(config_t *config, const char *section,
@@ -655,14 +1071,16 @@ void config_set_default_uint(config_t *config, const char *section,
 	struct dstr str;
 	dstr_init(&str);
 	dstr_printf(&str, "%" PRIu64, value);
-	config_set_item(config, &config->defaults, section, name, str.array);
+	config_set_item(config, &config->defaults, &config->default_index,
+			section, name, str.array);
 }
 
 void config_set_default_bool(config_t *config, const char *section,
 			     const char *name, bool value)
 {
 	char *str = bstrdup(value ? "true" : "false");
-	config_set_item(config, &config->defaults, section, name, str);
+	config_set_item(config, &config->defaults, &config->default_index,
+			section, name, str);
 }
 
 void config_set_default_double(config_t *config, const char *section,
@@ -671,7 +1089,8 @@ void config_set_default_double(config_t *config, const char *section,
 	struct dstr str;
 	dstr_init(&str);
 	dstr_printf(&str, "%g", value);
-	config_set_item(config, &config->defaults, section, name, str.array);
+	config_set_item(config, &config->defaults, &config->default_index,
+			section, name, str.array);
 }
 
 const char *config_get_string(config_t *config, const char *section,
@@ -682,9 +1101,11 @@ const char *config_get_string(config_t *config, const char *section,
 
 	pthread_mutex_lock(&config->mutex);
 
-	item = config_find_item(&config->sections, section, name);
+	item = config_find_item(&config->sections, &config->section_index,
+				section, name);
 	if (!item)
-		item = config_find_item(&config->defaults, section, name);
+		item = config_find_item(&config->defaults,
+					&config->default_index, section, name);
 	if (item)
 		value = item->value;
 
@@ -755,31 +1176,30 @@ double config_get_double(config_t *config, const char *section,
 bool config_remove_value(config_t *config, const char *section,
 			 const char *name)
 {
-	struct darray *sections = &config->sections;
+	struct config_section *sec;
+	struct config_item *item;
 	bool success = false;
+	size_t idx;
 
 	pthread_mutex_lock(&config->mutex);
 
-	for (size_t i = 0; i < sections->num; i++) {
-		struct config_section *sec =
-			darray_item(sizeof(struct config_section), sections, i);
+	sec = config_find_section(&config->sections, &config->section_index,
+				  section);
+	if (!sec)
+		goto unlock;
 
-		if (astrcmpi(sec->name, section) != 0)
-			continue;
+	idx = config_find_section_item(sec, name, config_hash(name));
+	if (idx == DARRAY_INVALID)
+		goto unlock;
 
-		for (size_t j = 0; j < sec->items.num; j++) {
-			struct config_item *item = darray_item(
-				sizeof(struct config_item), &sec->items, j);
+	item = darray_item(sizeof(struct config_item), &sec->items, idx);
+	config_item_free(item);
+	darray_erase(sizeof(struct config_item), &sec->items, idx);
+	config_index_rebuild(&sec->index, &sec->items,
+			     sizeof(struct config_item));
 
-			if (astrcmpi(item->name, name) == 0) {
-				config_item_free(item);
-				darray_erase(sizeof(struct config_item),
-					     &sec->items, j);
-				success = true;
-				goto unlock;
-			}
-		}
-	}
+	config->changes++;
+	success = true;
 
 unlock:
 	pthread_mutex_unlock(&config->mutex);
@@ -794,7 +1214,8 @@ const char *config_get_default_string(config_t *config, const char *section,
 
 	pthread_mutex_lock(&config->mutex);
 
-	item = config_find_item(&config->defaults, section, name);
+	item = config_find_item(&config->defaults, &config->default_index,
+				section, name);
 	if (item)
 		value = item->value;
 
@@ -847,7 +1268,8 @@ bool config_has_user_value(config_t *config, const char *section,
 {
 	bool success;
 	pthread_mutex_lock(&config->mutex);
-	success = config_find_item(&config->sections, section, name) != NULL;
+	success = config_find_item(&config->sections, &config->section_index,
+				   section, name) != NULL;
 	pthread_mutex_unlock(&config->mutex);
 	return success;
 }
@@ -857,7 +1279,8 @@ bool config_has_default_value(config_t *config, const char *section,
 {
 	bool success;
 	pthread_mutex_lock(&config->mutex);
-	success = config_find_item(&config->defaults, section, name) != NULL;
+	success = config_find_item(&config->defaults, &config->default_index,
+				   section, name) != NULL;
 	pthread_mutex_unlock(&config->mutex);
 	return success;
 }
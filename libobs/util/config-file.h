@@ -48,6 +48,16 @@ EXPORT int config_open_string(config_t **config, const char *str);
 EXPORT int config_save(config_t *config);
 EXPORT int config_save_safe(config_t *config, const char *temp_ext,
 			    const char *backup_ext);
+
+/*
+ * Saves like config_save_safe, but from a background thread shortly after the
+ * call.  Calls made before the save is written are merged into one write, and
+ * nothing is written if no value changed since the config was last saved.
+ * Pending saves are written before config_close returns.
+ */
+EXPORT int config_save_safe_deferred(config_t *config, const char *temp_ext,
+				     const char *backup_ext);
+
 EXPORT void config_close(config_t *config);
 
 EXPORT size_t config_num_sections(config_t *config);
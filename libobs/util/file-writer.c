@@ -0,0 +1,497 @@
+/*
+ * Copyright (c) 2021 OBS Project
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "base.h"
+#include "bmem.h"
+#include "circlebuf.h"
+#include "file-writer.h"
+#include "platform.h"
+#include "threading.h"
+
+#define WRITE_ALIGN 4096
+#define BATCH_SIZE (1024 * 1024)
+#define MIN_BATCH_SIZE (256 * 1024)
+#define FLUSH_TIMEOUT_MS 1000
+#define DEFAULT_QUEUE_SIZE (32 * 1024 * 1024)
+
+#define PREALLOC_SIZE (64LL * 1024 * 1024)
+#define SYNC_INTERVAL (8LL * 1024 * 1024)
+
+struct write_record {
+	int64_t offset; /* -1 to append */
+	size_t size;
+};
+
+struct file_writer {
+	FILE *file;
+
+	pthread_t thread;
+	bool thread_active;
+	os_event_t *data_event;
+	os_event_t *space_event;
+
+	pthread_mutex_t mutex;
+	struct circlebuf queue;
+	size_t queue_size;
+	int64_t append_pos;
+	bool closing;
+	struct file_writer_stats stats;
+
+	/* writer thread only */
+	uint8_t *batch;
+	size_t batch_len;
+	int64_t file_pos;
+	int64_t allocated;
+	int64_t synced;
+	int64_t prev_synced;
+};
+
+/* ------------------------------------------------------------------------- */
+
+static inline void set_error(struct file_writer *fw)
+{
+	pthread_mutex_lock(&fw->mutex);
+	fw->stats.error = true;
+	pthread_mutex_unlock(&fw->mutex);
+
+	/* nothing will ever be written again, don't keep anyone waiting */
+	os_event_signal(fw->space_event);
+}
+
+static inline size_t latency_bucket(uint64_t ns)
+{
+	uint64_t ms = ns / 1000000;
+	size_t bucket = 0;
+
+	while (bucket < FILE_WRITER_LATENCY_BUCKETS - 1 &&
+	       (1ULL << bucket) <= ms)
+		bucket++;
+	return bucket;
+}
+
+#ifdef __linux__
+/* the file is extended ahead of the write position without changing its
+ * size, so that the filesystem can keep it contiguous and a crash never
+ * leaves a tail of zeroes behind */
+static void preallocate(struct file_writer *fw, int64_t end)
+{
+	int fd = fileno(fw->file);
+
+	while (end > fw->allocated) {
+		if (fallocate(fd, FALLOC_FL_KEEP_SIZE, fw->allocated,
+			      PREALLOC_SIZE) != 0) {
+			/* not supported by the filesystem, stop trying */
+			fw->allocated = INT64_MAX;
+			return;
+		}
+
+		fw->allocated += PREALLOC_SIZE;
+
+		pthread_mutex_lock(&fw->mutex);
+		fw->stats.preallocated_bytes += PREALLOC_SIZE;
+		pthread_mutex_unlock(&fw->mutex);
+	}
+}
+
+/* gives back whatever was preallocated past the end of the file, otherwise
+ * every recording could keep up to PREALLOC_SIZE of unused space.  punching
+ * a hole past the end is a no-op on some filesystems (ext4), truncating to
+ * the current size isn't */
+static void release_preallocated(struct file_writer *fw)
+{
+	int fd = fileno(fw->file);
+	struct stat st;
+
+	if (fw->allocated == INT64_MAX || fstat(fd, &st) != 0 ||
+	    fw->allocated <= (int64_t)st.st_size)
+		return;
+
+	if (ftruncate(fd, st.st_size) != 0)
+		blog(LOG_WARNING,
+		     "file_writer: failed to release preallocated space: %s",
+		     strerror(errno));
+}
+
+/* starts writeback of everything written since the last sync, and waits
+ * for the range before that, which keeps the amount of dirty page cache
+ * bounded instead of having the kernel flush it all at once */
+static void sync_written(struct file_writer *fw)
+{
+	int fd = fileno(fw->file);
+
+	if (fw->file_pos - fw->synced < SYNC_INTERVAL)
+		return;
+
+	if (fw->synced > fw->prev_synced)
+		sync_file_range(fd, fw->prev_synced,
+				fw->synced - fw->prev_synced,
+				SYNC_FILE_RANGE_WAIT_BEFORE |
+					SYNC_FILE_RANGE_WRITE |
+					SYNC_FILE_RANGE_WAIT_AFTER);
+
+	sync_file_range(fd, fw->synced, fw->file_pos - fw->synced,
+			SYNC_FILE_RANGE_WRITE);
+
+	fw->prev_synced = fw->synced;
+	fw->synced = fw->file_pos;
+
+	pthread_mutex_lock(&fw->mutex);
+	fw->stats.syncs++;
+	pthread_mutex_unlock(&fw->mutex);
+}
+#else
+static inline void preallocate(struct file_writer *fw, int64_t end)
+{
+	UNUSED_PARAMETER(fw);
+	UNUSED_PARAMETER(end);
+}
+
+static inline void release_preallocated(struct file_writer *fw)
+{
+	UNUSED_PARAMETER(fw);
+}
+
+static inline void sync_written(struct file_writer *fw)
+{
+	UNUSED_PARAMETER(fw);
+}
+#endif
+
+static bool timed_write(struct file_writer *fw, const void *data, size_t size)
+{
+	uint64_t start = os_gettime_ns();
+	bool success = fwrite(data, 1, size, fw->file) == size;
+	uint64_t elapsed = os_gettime_ns() - start;
+	struct file_writer_stats *stats = &fw->stats;
+
+	pthread_mutex_lock(&fw->mutex);
+	stats->writes++;
+	stats->write_ns += elapsed;
+	stats->latency[latency_bucket(elapsed)]++;
+	if (elapsed > stats->max_write_ns)
+		stats->max_write_ns = elapsed;
+	if (success)
+		stats->bytes_written += size;
+	pthread_mutex_unlock(&fw->mutex);
+
+	if (!success) {
+		blog(LOG_ERROR, "file_writer: write failed: %s",
+		     strerror(errno));
+		set_error(fw);
+	}
+	return success;
+}
+
+/* writes the batch up to the last aligned file offset, or all of it */
+static void flush_batch(struct file_writer *fw, bool all)
+{
+	int64_t end = fw->file_pos + (int64_t)fw->batch_len;
+	size_t len;
+
+	if (!all)
+		end &= ~(int64_t)(WRITE_ALIGN - 1);
+	if (end <= fw->file_pos)
+		return;
+
+	len = (size_t)(end - fw->file_pos);
+
+	preallocate(fw, end);
+	if (!timed_write(fw, fw->batch, len))
+		return;
+
+	fw->batch_len -= len;
+	memmove(fw->batch, fw->batch + len, fw->batch_len);
+	fw->file_pos = end;
+
+	sync_written(fw);
+}
+
+static void write_at(struct file_writer *fw, int64_t offset, const void *data,
+		     size_t size)
+{
+	if (os_fseeki64(fw->file, offset, SEEK_SET) != 0) {
+		set_error(fw);
+		return;
+	}
+
+	timed_write(fw, data, size);
+	os_fseeki64(fw->file, fw->file_pos, SEEK_SET);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void *writer_thread(void *data)
+{
+	struct file_writer *fw = data;
+
+	os_set_thread_name("file-writer");
+
+	for (;;) {
+		struct write_record rec;
+		bool error;
+
+		pthread_mutex_lock(&fw->mutex);
+
+		if (!fw->queue.size) {
+			bool closing = fw->closing;
+			error = fw->stats.error;
+			pthread_mutex_unlock(&fw->mutex);
+
+			if (closing)
+				break;
+
+			/* the batch can't be written anymore, drop it instead
+			 * of retrying it over and over until closed */
+			if (error) {
+				fw->batch_len = 0;
+				os_event_wait(fw->data_event);
+				continue;
+			}
+
+			/* keep collecting small writes into one batch, but
+			 * don't hold on to data for too long either */
+			if (fw->batch_len >= MIN_BATCH_SIZE)
+				flush_batch(fw, false);
+			else if (!fw->batch_len)
+				os_event_wait(fw->data_event);
+			else if (os_event_timedwait(fw->data_event,
+						    FLUSH_TIMEOUT_MS) ==
+				 ETIMEDOUT)
+				flush_batch(fw, true);
+			continue;
+		}
+
+		error = fw->stats.error;
+		circlebuf_pop_front(&fw->queue, &rec, sizeof(rec));
+
+		if (error) {
+			circlebuf_pop_front(&fw->queue, NULL, rec.size);
+			fw->stats.queued_bytes = fw->queue.size;
+			pthread_mutex_unlock(&fw->mutex);
+			os_event_signal(fw->space_event);
+
+		} else if (rec.offset >= 0) {
+			uint8_t *buf = bmalloc(rec.size);
+
+			circlebuf_pop_front(&fw->queue, buf, rec.size);
+			fw->stats.queued_bytes = fw->queue.size;
+			pthread_mutex_unlock(&fw->mutex);
+			os_event_signal(fw->space_event);
+
+			flush_batch(fw, true);
+			write_at(fw, rec.offset, buf, rec.size);
+			bfree(buf);
+
+		} else {
+			size_t size = BATCH_SIZE - fw->batch_len;
+			if (size > rec.size)
+				size = rec.size;
+
+			circlebuf_pop_front(&fw->queue,
+					    fw->batch + fw->batch_len, size);
+			fw->batch_len += size;
+
+			/* large writes are split up over several batches */
+			if (size < rec.size) {
+				rec.size -= size;
+				circlebuf_push_front(&fw->queue, &rec,
+						     sizeof(rec));
+			}
+
+			fw->stats.queued_bytes = fw->queue.size;
+			pthread_mutex_unlock(&fw->mutex);
+			os_event_signal(fw->space_event);
+
+			if (fw->batch_len == BATCH_SIZE)
+				flush_batch(fw, false);
+		}
+	}
+
+	if (!fw->stats.error)
+		flush_batch(fw, true);
+
+	release_preallocated(fw);
+	return NULL;
+}
+
+static bool queue_write(struct file_writer *fw, int64_t offset,
+			const void *data, size_t size)
+{
+	struct write_record rec = {offset, size};
+	size_t total = sizeof(rec) + size;
+	uint64_t wait_start = 0;
+
+	pthread_mutex_lock(&fw->mutex);
+
+	/* a write larger than the whole queue still goes through once the
+	 * queue is empty */
+	while (!fw->stats.error && fw->queue.size &&
+	       fw->queue.size + total > fw->queue_size) {
+		if (!wait_start) {
+			wait_start = os_gettime_ns();
+			fw->stats.queue_waits++;
+		}
+
+		pthread_mutex_unlock(&fw->mutex);
+		os_event_wait(fw->space_event);
+		pthread_mutex_lock(&fw->mutex);
+	}
+
+	if (wait_start)
+		fw->stats.queue_wait_ns += os_gettime_ns() - wait_start;
+
+	if (fw->stats.error) {
+		pthread_mutex_unlock(&fw->mutex);
+		return false;
+	}
+
+	circlebuf_push_back(&fw->queue, &rec, sizeof(rec));
+	circlebuf_push_back(&fw->queue, data, size);
+
+	if (offset < 0)
+		fw->append_pos += (int64_t)size;
+
+	fw->stats.queued_bytes = fw->queue.size;
+	if (fw->queue.size > fw->stats.peak_queued_bytes)
+		fw->stats.peak_queued_bytes = fw->queue.size;
+
+	pthread_mutex_unlock(&fw->mutex);
+
+	os_event_signal(fw->data_event);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void file_writer_free(struct file_writer *fw)
+{
+	if (fw->file)
+		fclose(fw->file);
+
+	os_event_destroy(fw->data_event);
+	os_event_destroy(fw->space_event);
+	pthread_mutex_destroy(&fw->mutex);
+	circlebuf_free(&fw->queue);
+	bfree(fw->batch);
+	bfree(fw);
+}
+
+file_writer_t *file_writer_create(const char *path, size_t queue_size)
+{
+	struct file_writer *fw = bzalloc(sizeof(*fw));
+
+	pthread_mutex_init_value(&fw->mutex);
+
+	fw->queue_size = queue_size ? queue_size : DEFAULT_QUEUE_SIZE;
+	fw->batch = bmalloc(BATCH_SIZE);
+
+	if (pthread_mutex_init(&fw->mutex, NULL) != 0)
+		goto fail;
+	if (os_event_init(&fw->data_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+	if (os_event_init(&fw->space_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+
+	fw->file = os_fopen(path, "wb");
+	if (!fw->file)
+		goto fail;
+
+	/* everything is batched here already */
+	setvbuf(fw->file, NULL, _IONBF, 0);
+
+	if (pthread_create(&fw->thread, NULL, writer_thread, fw) != 0)
+		goto fail;
+
+	fw->thread_active = true;
+	return fw;
+
+fail:
+	file_writer_free(fw);
+	return NULL;
+}
+
+bool file_writer_close(file_writer_t *fw, struct file_writer_stats *stats)
+{
+	bool success;
+
+	if (!fw)
+		return false;
+
+	if (fw->thread_active) {
+		pthread_mutex_lock(&fw->mutex);
+		fw->closing = true;
+		pthread_mutex_unlock(&fw->mutex);
+
+		os_event_signal(fw->data_event);
+		pthread_join(fw->thread, NULL);
+	}
+
+	if (stats)
+		*stats = fw->stats;
+
+	success = !fw->stats.error;
+	if (fclose(fw->file) != 0)
+		success = false;
+	fw->file = NULL;
+
+	file_writer_free(fw);
+	return success;
+}
+
+bool file_writer_write(file_writer_t *fw, const void *data, size_t size)
+{
+	return fw && queue_write(fw, -1, data, size);
+}
+
+bool file_writer_write_at(file_writer_t *fw, int64_t offset, const void *data,
+			  size_t size)
+{
+	return fw && offset >= 0 && queue_write(fw, offset, data, size);
+}
+
+int64_t file_writer_get_pos(file_writer_t *fw)
+{
+	int64_t pos;
+
+	if (!fw)
+		return 0;
+
+	pthread_mutex_lock(&fw->mutex);
+	pos = fw->append_pos;
+	pthread_mutex_unlock(&fw->mutex);
+	return pos;
+}
+
+void file_writer_get_stats(file_writer_t *fw, struct file_writer_stats *stats)
+{
+	if (!fw)
+		return;
+
+	pthread_mutex_lock(&fw->mutex);
+	*stats = fw->stats;
+	pthread_mutex_unlock(&fw->mutex);
+}
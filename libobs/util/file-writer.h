@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2021 OBS Project
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+
+/*
+ * Asynchronous file writer
+ *
+ *   Queues writes and performs them on a dedicated thread, so that outputs
+ * writing to files never block their packet callbacks on disk I/O.  Data is
+ * written in large batches aligned to the file offset, the file is
+ * preallocated ahead of the write position and written data is handed off
+ * to the kernel for writeback at regular intervals where supported.
+ *
+ *   The queue is bounded; a write only blocks if the disk falls behind by
+ * more than the queue size.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct file_writer;
+typedef struct file_writer file_writer_t;
+
+#define FILE_WRITER_LATENCY_BUCKETS 16
+
+struct file_writer_stats {
+	uint64_t bytes_written;
+	uint64_t writes;
+	uint64_t write_ns;
+	uint64_t max_write_ns;
+
+	/* writes by duration, bucket n counts writes below 2^n ms */
+	uint64_t latency[FILE_WRITER_LATENCY_BUCKETS];
+
+	size_t queued_bytes;
+	size_t peak_queued_bytes;
+	uint64_t queue_waits;
+	uint64_t queue_wait_ns;
+
+	uint64_t preallocated_bytes;
+	uint64_t syncs;
+	bool error;
+};
+
+EXPORT file_writer_t *file_writer_create(const char *path, size_t queue_size);
+
+/** Flushes all queued data, stops the writer thread and closes the file.
+ * The final statistics are stored in stats if it is not NULL.  Returns false
+ * if any write failed. */
+EXPORT bool file_writer_close(file_writer_t *fw,
+			      struct file_writer_stats *stats);
+
+EXPORT bool file_writer_write(file_writer_t *fw, const void *data,
+			      size_t size);
+
+/** Queues a write at a fixed position, such as a header that is updated
+ * once the file is complete.  It is performed after everything queued
+ * before it, and does not change the append position. */
+EXPORT bool file_writer_write_at(file_writer_t *fw, int64_t offset,
+				 const void *data, size_t size);
+
+/** Returns the size the file will have once everything queued is written */
+EXPORT int64_t file_writer_get_pos(file_writer_t *fw);
+
+EXPORT void file_writer_get_stats(file_writer_t *fw,
+				  struct file_writer_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
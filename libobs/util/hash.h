@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2021 OBS Project
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+
+/*
+ * 64-bit FNV-1a hashing.  Not cryptographic; used for hash table buckets
+ * and content keys where a fast, stable hash is needed.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HASH_FNV1A64_INIT 0xcbf29ce484222325ULL
+#define HASH_FNV1A64_PRIME 0x100000001b3ULL
+
+static inline uint64_t hash_fnv1a64_update(uint64_t hash, const void *data,
+					   size_t size)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= HASH_FNV1A64_PRIME;
+	}
+
+	return hash;
+}
+
+static inline uint64_t hash_fnv1a64(const void *data, size_t size)
+{
+	return hash_fnv1a64_update(HASH_FNV1A64_INIT, data, size);
+}
+
+static inline uint64_t hash_fnv1a64_str(const char *str)
+{
+	uint64_t hash = HASH_FNV1A64_INIT;
+
+	if (!str)
+		return hash;
+
+	while (*str) {
+		hash ^= (uint8_t)*(str++);
+		hash *= HASH_FNV1A64_PRIME;
+	}
+
+	return hash;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -14,7 +14,10 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <unistd.h>
 #include <sys/wait.h>
 
 #include "bmem.h"
@@ -23,6 +26,7 @@
 struct os_process_pipe {
 	bool read_pipe;
 	FILE *file;
+	pid_t pid; /* 0 if created with popen */
 };
 
 os_process_pipe_t *os_process_pipe_create(const char *cmd_line,
@@ -47,12 +51,98 @@ os_process_pipe_t *os_process_pipe_create(const char *cmd_line,
 	return out;
 }
 
+/* only async-signal-safe calls between fork and exec */
+static void exec_child(const char *cmd_line, int pipe_fd, int std_fd,
+		       const int *fds, size_t num_fds)
+{
+	if (pipe_fd == std_fd) {
+		fcntl(std_fd, F_SETFD, 0);
+	} else if (dup2(pipe_fd, std_fd) == -1) {
+		_exit(127);
+	}
+
+	for (size_t i = 0; i < num_fds; i++)
+		fcntl(fds[i], F_SETFD, 0);
+
+	execl("/bin/sh", "sh", "-c", cmd_line, (char *)NULL);
+	_exit(127);
+}
+
+os_process_pipe_t *os_process_pipe_create_inherit(const char *cmd_line,
+						  const char *type,
+						  const int *fds,
+						  size_t num_fds)
+{
+	struct os_process_pipe proc = {0};
+	struct os_process_pipe *out;
+	int pipe_fds[2];
+	int child_fd;
+	int parent_fd;
+
+	if (!cmd_line || !type) {
+		return NULL;
+	}
+	if (!num_fds) {
+		return os_process_pipe_create(cmd_line, type);
+	}
+
+	proc.read_pipe = *type == 'r';
+
+	if (pipe(pipe_fds) != 0) {
+		return NULL;
+	}
+
+	/* the parent end must not leak into other children either, the child
+	 * end is dup'ed onto stdin/stdout without the flag */
+	fcntl(pipe_fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(pipe_fds[1], F_SETFD, FD_CLOEXEC);
+
+	child_fd = proc.read_pipe ? pipe_fds[1] : pipe_fds[0];
+	parent_fd = proc.read_pipe ? pipe_fds[0] : pipe_fds[1];
+
+	proc.pid = fork();
+	if (proc.pid == 0) {
+		exec_child(cmd_line, child_fd,
+			   proc.read_pipe ? STDOUT_FILENO : STDIN_FILENO, fds,
+			   num_fds);
+	}
+
+	close(child_fd);
+
+	if (proc.pid == -1) {
+		close(parent_fd);
+		return NULL;
+	}
+
+	proc.file = fdopen(parent_fd, proc.read_pipe ? "r" : "w");
+	if (!proc.file) {
+		close(parent_fd);
+		while (waitpid(proc.pid, NULL, 0) == -1 && errno == EINTR)
+			;
+		return NULL;
+	}
+
+	out = bmalloc(sizeof(proc));
+	*out = proc;
+	return out;
+}
+
 int os_process_pipe_destroy(os_process_pipe_t *pp)
 {
 	int ret = 0;
 
 	if (pp) {
-		int status = pclose(pp->file);
+		int status = 0;
+
+		if (pp->pid) {
+			fclose(pp->file);
+			while (waitpid(pp->pid, &status, 0) == -1 &&
+			       errno == EINTR)
+				;
+		} else {
+			status = pclose(pp->file);
+		}
+
 		if (WIFEXITED(status))
 			ret = (int)(char)WEXITSTATUS(status);
 		bfree(pp);
@@ -140,6 +140,19 @@ error:
 	return NULL;
 }
 
+os_process_pipe_t *os_process_pipe_create_inherit(const char *cmd_line,
+						  const char *type,
+						  const int *fds,
+						  size_t num_fds)
+{
+	UNUSED_PARAMETER(fds);
+
+	if (num_fds)
+		return NULL;
+
+	return os_process_pipe_create(cmd_line, type);
+}
+
 int os_process_pipe_destroy(os_process_pipe_t *pp)
 {
 	int ret = 0;
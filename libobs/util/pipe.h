@@ -23,6 +23,14 @@ typedef struct os_process_pipe os_process_pipe_t;
 
 EXPORT os_process_pipe_t *os_process_pipe_create(const char *cmd_line,
 						 const char *type);
+/* like os_process_pipe_create, but the child process also inherits the given
+ * file descriptors.  They can (and should) be close-on-exec: the flag is only
+ * cleared in the child, so no other process spawned at the same time gets
+ * them.  Not supported on windows unless num_fds is 0. */
+EXPORT os_process_pipe_t *os_process_pipe_create_inherit(const char *cmd_line,
+							 const char *type,
+							 const int *fds,
+							 size_t num_fds);
 EXPORT int os_process_pipe_destroy(os_process_pipe_t *pp);
 
 EXPORT size_t os_process_pipe_read(os_process_pipe_t *pp, uint8_t *data,
@@ -146,11 +146,25 @@ void os_cpu_usage_info_destroy(os_cpu_usage_info_t *info)
 
 #endif
 
-bool os_sleepto_ns(uint64_t time_target)
+#if defined(__linux__) || defined(__FreeBSD__)
+/* os_gettime_ns() is CLOCK_MONOTONIC here, so deadlines can be handed to the
+ * kernel as-is instead of being turned into relative sleeps */
+static void sleep_until_ns(uint64_t time_target)
+{
+	struct timespec req;
+	req.tv_sec = time_target / 1000000000;
+	req.tv_nsec = time_target % 1000000000;
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &req, NULL) ==
+	       EINTR)
+		;
+}
+#else
+static void sleep_until_ns(uint64_t time_target)
 {
 	uint64_t current = os_gettime_ns();
-	if (time_target < current)
-		return false;
+	if (time_target <= current)
+		return;
 
 	time_target -= current;
 
@@ -164,6 +178,29 @@ bool os_sleepto_ns(uint64_t time_target)
 		req = remain;
 		memset(&remain, 0, sizeof(remain));
 	}
+}
+#endif
+
+bool os_sleepto_ns(uint64_t time_target)
+{
+	if (time_target < os_gettime_ns())
+		return false;
+
+	sleep_until_ns(time_target);
+	return true;
+}
+
+bool os_sleepto_ns_precise(uint64_t time_target, uint64_t spin_ns)
+{
+	uint64_t current = os_gettime_ns();
+	if (time_target < current)
+		return false;
+
+	if (time_target - current > spin_ns)
+		sleep_until_ns(time_target - spin_ns);
+
+	while (os_gettime_ns() < time_target)
+		;
 
 	return true;
 }
@@ -215,6 +215,30 @@ bool os_sleepto_ns(uint64_t time_target)
 	}
 }
 
+bool os_sleepto_ns_precise(uint64_t time_target, uint64_t spin_ns)
+{
+	uint64_t t = os_gettime_ns();
+	uint32_t milliseconds;
+
+	if (t >= time_target)
+		return false;
+
+	/* Sleep() can overshoot by a full scheduler tick, so only sleep in
+	 * whole milliseconds up to the spin window */
+	if (time_target - t > spin_ns) {
+		uint64_t sleep_ns = time_target - t - spin_ns;
+
+		milliseconds = (uint32_t)(sleep_ns / 1000000);
+		if (milliseconds > 1)
+			Sleep(milliseconds - 1);
+	}
+
+	while (os_gettime_ns() < time_target)
+		YieldProcessor();
+
+	return true;
+}
+
 void os_sleep_ms(uint32_t duration)
 {
 	/* windows 8+ appears to have decreased sleep precision */
@@ -102,6 +102,13 @@ EXPORT void os_end_high_performance(os_performance_token_t *);
  * Returns false if already at or past target time.
  */
 EXPORT bool os_sleepto_ns(uint64_t time_target);
+
+/**
+ * Sleeps until an absolute os_gettime_ns() deadline, then busy-waits the
+ * last 'spin_ns' nanoseconds of it to avoid scheduler wake-up slack.
+ * Returns false if the deadline had already passed.
+ */
+EXPORT bool os_sleepto_ns_precise(uint64_t time_target, uint64_t spin_ns);
 EXPORT void os_sleep_ms(uint32_t duration);
 
 EXPORT uint64_t os_gettime_ns(void);
@@ -271,3 +271,22 @@ void os_set_thread_name(const char *name)
 	}
 #endif
 }
+
+bool os_set_thread_realtime(bool enable)
+{
+#if defined(__linux__)
+	struct sched_param param = {0};
+	int policy = SCHED_OTHER;
+
+	if (enable) {
+		/* just above the default, so it can't starve audio servers or
+		 * other real-time threads configured by the system */
+		param.sched_priority = sched_get_priority_min(SCHED_FIFO) + 1;
+		policy = SCHED_FIFO;
+	}
+
+	return pthread_setschedparam(pthread_self(), policy, &param) == 0;
+#else
+	return !enable;
+#endif
+}
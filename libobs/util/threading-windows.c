@@ -211,3 +211,10 @@ void os_set_thread_name(const char *name)
 	}
 	FreeLibrary(k32);
 }
+
+bool os_set_thread_realtime(bool enable)
+{
+	int priority = enable ? THREAD_PRIORITY_TIME_CRITICAL
+			      : THREAD_PRIORITY_NORMAL;
+	return !!SetThreadPriority(GetCurrentThread(), priority);
+}
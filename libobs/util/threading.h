@@ -78,6 +78,13 @@ EXPORT int os_sem_wait(os_sem_t *sem);
 
 EXPORT void os_set_thread_name(const char *name);
 
+/**
+ * Raises the calling thread to a real-time scheduling class (SCHED_FIFO on
+ * Linux, time critical priority on Windows), or restores normal scheduling.
+ * Returns false if the system refused, usually for lack of privileges.
+ */
+EXPORT bool os_set_thread_realtime(bool enable);
+
 #ifdef _MSC_VER
 #define THREAD_LOCAL __declspec(thread)
 #else
@@ -18,13 +18,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <xcb/damage.h>
 #include <xcb/randr.h>
 #include <xcb/shm.h>
 #include <xcb/xfixes.h>
 #include <xcb/xinerama.h>
 
 #include <obs-module.h>
+#include <util/darray.h>
 #include <util/dstr.h>
+#include <util/platform.h>
 #include "xcursor-xcb.h"
 #include "xhelpers.h"
 
@@ -32,6 +35,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define blog(level, msg, ...) blog(level, "xshm-input: " msg, ##__VA_ARGS__)
 
+/* above this many damaged rectangles the bounding box is fetched instead */
+#define XSHM_MAX_DAMAGE_RECTS 16
+
+#define XSHM_STATS_INTERVAL_NS 1000000000ULL
+
 struct xshm_data {
 	obs_source_t *source;
 
@@ -49,6 +57,21 @@ struct xshm_data {
 
 	gs_texture_t *texture;
 
+	xcb_damage_damage_t damage;
+	xcb_xfixes_region_t damage_region;
+	uint8_t damage_event;
+	bool damaged;
+	bool full_frame;
+	DARRAY(xcb_rectangle_t) damage_rects;
+
+	uint64_t stats_ts;
+	uint64_t stats_damaged;
+	uint64_t stats_area;
+	uint32_t stats_frames;
+	uint32_t stats_skipped;
+	uint64_t total_damaged;
+	uint64_t total_area;
+
 	int_fast32_t cut_top;
 	int_fast32_t cut_left;
 	int_fast32_t cut_right;
@@ -201,6 +224,22 @@ static void xshm_capture_stop(struct xshm_data *data)
 
 	obs_leave_graphics();
 
+	if (data->total_area) {
+		blog(LOG_INFO, "Damaged area: %.2f%% of captured pixels",
+		     100.0 * data->total_damaged / data->total_area);
+	}
+	data->total_damaged = 0;
+	data->total_area = 0;
+	data->stats_ts = 0;
+
+	if (data->xcb && data->damage_region)
+		xcb_xfixes_destroy_region(data->xcb, data->damage_region);
+	if (data->xcb && data->damage)
+		xcb_damage_destroy(data->xcb, data->damage);
+	data->damage_region = 0;
+	data->damage = 0;
+	da_free(data->damage_rects);
+
 	if (data->xshm) {
 		xshm_xcb_detach(data->xshm);
 		data->xshm = NULL;
@@ -217,6 +256,43 @@ static void xshm_capture_stop(struct xshm_data *data)
 	}
 }
 
+/**
+ * Start tracking damage on the root window
+ *
+ * Without the Damage extension every frame is captured in full.
+ */
+static void xshm_damage_init(struct xshm_data *data)
+{
+	const xcb_query_extension_reply_t *ext;
+	xcb_damage_query_version_cookie_t ver_c;
+	xcb_damage_query_version_reply_t *ver_r;
+
+	ext = xcb_get_extension_data(data->xcb, &xcb_damage_id);
+	if (!ext || !ext->present) {
+		blog(LOG_INFO, "Missing Damage extension !");
+		return;
+	}
+
+	ver_c = xcb_damage_query_version_unchecked(data->xcb,
+						   XCB_DAMAGE_MAJOR_VERSION,
+						   XCB_DAMAGE_MINOR_VERSION);
+	ver_r = xcb_damage_query_version_reply(data->xcb, ver_c, NULL);
+	if (!ver_r) {
+		blog(LOG_WARNING, "Failed to query Damage version");
+		return;
+	}
+	free(ver_r);
+
+	data->damage_event = ext->first_event + XCB_DAMAGE_NOTIFY;
+	data->damage = xcb_generate_id(data->xcb);
+	data->damage_region = xcb_generate_id(data->xcb);
+
+	xcb_damage_create(data->xcb, data->damage, data->xcb_screen->root,
+			  XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+	xcb_xfixes_create_region(data->xcb, data->damage_region, 0, NULL);
+	xcb_flush(data->xcb);
+}
+
 /**
  * Start the capture
  */
@@ -252,6 +328,10 @@ static void xshm_capture_start(struct xshm_data *data)
 	data->cursor = xcb_xcursor_init(data->xcb);
 	xcb_xcursor_offset(data->cursor, data->adj_x_org, data->adj_y_org);
 
+	/* needs the XFixes version negotiated by the cursor for its region */
+	xshm_damage_init(data);
+	data->full_frame = true;
+
 	obs_enter_graphics();
 
 	xshm_resize_texture(data);
@@ -467,8 +547,242 @@ static void *xshm_create(obs_data_t *settings, obs_source_t *source)
 	return data;
 }
 
+/**
+ * Drain pending events and check for damage notifications
+ */
+static void xshm_poll_events(struct xshm_data *data)
+{
+	xcb_generic_event_t *ev;
+
+	while ((ev = xcb_poll_for_event(data->xcb))) {
+		if ((ev->response_type & ~0x80) == data->damage_event)
+			data->damaged = true;
+		free(ev);
+	}
+}
+
+/**
+ * Clip rectangles in root window coordinates to the capture area
+ *
+ * The clipped rectangles are relative to the capture area and replace the
+ * current damage. Too many of them or too large an area are coalesced into
+ * their bounding box, which is cheaper to fetch in a single request.
+ */
+static void xshm_clip_damage(struct xshm_data *data,
+			     const xcb_rectangle_t *rects, int count)
+{
+	int_fast32_t min_x = data->adj_width, min_y = data->adj_height;
+	int_fast32_t max_x = 0, max_y = 0;
+	uint64_t area = 0;
+
+	da_resize(data->damage_rects, 0);
+
+	for (int i = 0; i < count; ++i) {
+		int_fast32_t x1 = rects[i].x - data->adj_x_org;
+		int_fast32_t y1 = rects[i].y - data->adj_y_org;
+		int_fast32_t x2 = x1 + rects[i].width;
+		int_fast32_t y2 = y1 + rects[i].height;
+
+		if (x1 < 0)
+			x1 = 0;
+		if (y1 < 0)
+			y1 = 0;
+		if (x2 > data->adj_width)
+			x2 = data->adj_width;
+		if (y2 > data->adj_height)
+			y2 = data->adj_height;
+		if (x2 <= x1 || y2 <= y1)
+			continue;
+
+		xcb_rectangle_t *rect = da_push_back_new(data->damage_rects);
+		rect->x = (int16_t)x1;
+		rect->y = (int16_t)y1;
+		rect->width = (uint16_t)(x2 - x1);
+		rect->height = (uint16_t)(y2 - y1);
+		area += (uint64_t)rect->width * rect->height;
+
+		if (x1 < min_x)
+			min_x = x1;
+		if (y1 < min_y)
+			min_y = y1;
+		if (x2 > max_x)
+			max_x = x2;
+		if (y2 > max_y)
+			max_y = y2;
+	}
+
+	if (data->damage_rects.num > XSHM_MAX_DAMAGE_RECTS ||
+	    area * 4 > (uint64_t)data->adj_width * data->adj_height * 3) {
+		xcb_rectangle_t bounds = {(int16_t)min_x, (int16_t)min_y,
+					  (uint16_t)(max_x - min_x),
+					  (uint16_t)(max_y - min_y)};
+
+		da_resize(data->damage_rects, 1);
+		data->damage_rects.array[0] = bounds;
+	}
+}
+
+/**
+ * Collect the rectangles of the capture area that have to be fetched
+ *
+ * The whole area is returned when the damage is not tracked, could not be
+ * fetched or the texture still has to be filled, and nothing when the screen
+ * did not change since the last frame.
+ */
+static void xshm_fetch_damage(struct xshm_data *data)
+{
+	xcb_rectangle_t full = {0, 0, (uint16_t)data->adj_width,
+				(uint16_t)data->adj_height};
+	xcb_xfixes_fetch_region_cookie_t reg_c;
+	xcb_xfixes_fetch_region_reply_t *reg_r;
+
+	if (!data->damage)
+		goto full_frame;
+
+	xshm_poll_events(data);
+
+	if (!data->damaged && !data->full_frame) {
+		da_resize(data->damage_rects, 0);
+		return;
+	}
+
+	data->damaged = false;
+
+	/* moves the accumulated damage into the region and resets it, any
+	 * damage after this will be notified again */
+	xcb_damage_subtract(data->xcb, data->damage, XCB_NONE,
+			    data->damage_region);
+	reg_c = xcb_xfixes_fetch_region_unchecked(data->xcb,
+						  data->damage_region);
+	reg_r = xcb_xfixes_fetch_region_reply(data->xcb, reg_c, NULL);
+	if (!reg_r)
+		goto full_frame;
+
+	xshm_clip_damage(data, xcb_xfixes_fetch_region_rectangles(reg_r),
+			 xcb_xfixes_fetch_region_rectangles_length(reg_r));
+	free(reg_r);
+
+	if (!data->full_frame)
+		return;
+
+full_frame:
+	da_resize(data->damage_rects, 1);
+	data->damage_rects.array[0] = full;
+}
+
+/**
+ * Fetch the damaged rectangles into the shared memory segment
+ *
+ * The rectangles are packed one after another with their own width as
+ * stride, since they do not overlap they always fit into the segment.
+ */
+static bool xshm_get_damaged_image(struct xshm_data *data)
+{
+	xcb_shm_get_image_cookie_t img_c[XSHM_MAX_DAMAGE_RECTS];
+	xcb_shm_get_image_reply_t *img_r;
+	uint32_t offset = 0;
+	bool success = true;
+
+	for (size_t i = 0; i < data->damage_rects.num; ++i) {
+		const xcb_rectangle_t *rect = data->damage_rects.array + i;
+
+		img_c[i] = xcb_shm_get_image_unchecked(
+			data->xcb, data->xcb_screen->root,
+			data->adj_x_org + rect->x, data->adj_y_org + rect->y,
+			rect->width, rect->height, ~0,
+			XCB_IMAGE_FORMAT_Z_PIXMAP, data->xshm->seg, offset);
+		offset += (uint32_t)rect->width * rect->height * 4;
+	}
+
+	for (size_t i = 0; i < data->damage_rects.num; ++i) {
+		img_r = xcb_shm_get_image_reply(data->xcb, img_c[i], NULL);
+		if (!img_r)
+			success = false;
+		free(img_r);
+	}
+
+	return success;
+}
+
+/**
+ * Copy the damaged rectangles into the texture
+ *
+ * Only the damaged rows are written to the mapped texture, the unpack
+ * buffer of the texture keeps the rest of the previous frame.
+ *
+ * @note requires to be called within the obs graphics context
+ */
+static bool xshm_upload_damaged_image(struct xshm_data *data)
+{
+	const uint8_t *src = (const uint8_t *)data->xshm->data;
+	uint8_t *ptr;
+	uint32_t linesize;
+
+	if (!gs_texture_map(data->texture, &ptr, &linesize))
+		return false;
+
+	for (size_t i = 0; i < data->damage_rects.num; ++i) {
+		const xcb_rectangle_t *rect = data->damage_rects.array + i;
+		const size_t row = (size_t)rect->width * 4;
+		uint8_t *dst = ptr + (size_t)rect->y * linesize + rect->x * 4;
+
+		if (rect->x == 0 && row == linesize) {
+			memcpy(dst, src, row * rect->height);
+			src += row * rect->height;
+			continue;
+		}
+
+		for (uint16_t y = 0; y < rect->height; ++y) {
+			memcpy(dst, src, row);
+			dst += linesize;
+			src += row;
+		}
+	}
+
+	gs_texture_unmap(data->texture);
+	return true;
+}
+
+/**
+ * Account the damaged area and log its fraction once per interval
+ */
+static void xshm_update_stats(struct xshm_data *data, uint64_t damaged)
+{
+	const uint64_t area = (uint64_t)data->adj_width * data->adj_height;
+	const uint64_t ts = os_gettime_ns();
+
+	data->stats_damaged += damaged;
+	data->stats_area += area;
+	data->stats_frames++;
+	if (!damaged)
+		data->stats_skipped++;
+
+	data->total_damaged += damaged;
+	data->total_area += area;
+
+	if (!data->stats_ts)
+		data->stats_ts = ts;
+	if (ts - data->stats_ts < XSHM_STATS_INTERVAL_NS)
+		return;
+
+	blog(LOG_DEBUG,
+	     "Damaged area: %.2f%%, %" PRIu32 " of %" PRIu32
+	     " frames unchanged",
+	     100.0 * data->stats_damaged / data->stats_area,
+	     data->stats_skipped, data->stats_frames);
+
+	data->stats_ts = ts;
+	data->stats_damaged = 0;
+	data->stats_area = 0;
+	data->stats_frames = 0;
+	data->stats_skipped = 0;
+}
+
 /**
  * Prepare the capture data
+ *
+ * Only the parts of the screen that were damaged since the last frame are
+ * fetched and uploaded, unchanged frames only update the cursor.
  */
 static void xshm_video_tick(void *vptr, float seconds)
 {
@@ -480,34 +794,39 @@ static void xshm_video_tick(void *vptr, float seconds)
 	if (!obs_source_showing(data->source))
 		return;
 
-	xcb_shm_get_image_cookie_t img_c;
-	xcb_shm_get_image_reply_t *img_r;
 	xcb_xfixes_get_cursor_image_cookie_t cur_c;
 	xcb_xfixes_get_cursor_image_reply_t *cur_r;
+	uint64_t damaged = 0;
+	bool captured = false;
 
-	img_c = xcb_shm_get_image_unchecked(data->xcb, data->xcb_screen->root,
-					    data->adj_x_org, data->adj_y_org,
-					    data->adj_width, data->adj_height,
-					    ~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
-					    data->xshm->seg, 0);
 	cur_c = xcb_xfixes_get_cursor_image_unchecked(data->xcb);
 
-	img_r = xcb_shm_get_image_reply(data->xcb, img_c, NULL);
-	cur_r = xcb_xfixes_get_cursor_image_reply(data->xcb, cur_c, NULL);
+	xshm_fetch_damage(data);
+	if (data->damage_rects.num)
+		captured = xshm_get_damaged_image(data);
 
-	if (!img_r)
-		goto exit;
+	cur_r = xcb_xfixes_get_cursor_image_reply(data->xcb, cur_c, NULL);
 
 	obs_enter_graphics();
 
-	gs_texture_set_image(data->texture, (void *)data->xshm->data,
-			     data->adj_width * 4, false);
+	/* the damage was consumed, so refetch everything after a failure */
+	if (captured && xshm_upload_damaged_image(data))
+		data->full_frame = false;
+	else if (data->damage_rects.num)
+		data->full_frame = true;
 	xcb_xcursor_update(data->cursor, cur_r);
 
 	obs_leave_graphics();
 
-exit:
-	free(img_r);
+	if (captured) {
+		for (size_t i = 0; i < data->damage_rects.num; ++i) {
+			const xcb_rectangle_t *rect =
+				data->damage_rects.array + i;
+			damaged += (uint64_t)rect->width * rect->height;
+		}
+	}
+	xshm_update_stats(data, damaged);
+
 	free(cur_r);
 }
 
@@ -61,13 +61,14 @@ int_fast32_t v4l2_stop_capture(int_fast32_t dev)
 	return 0;
 }
 
-int_fast32_t v4l2_create_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf)
+int_fast32_t v4l2_create_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf,
+			      uint_fast32_t count)
 {
 	struct v4l2_requestbuffers req;
 	struct v4l2_buffer map;
 
 	memset(&req, 0, sizeof(req));
-	req.count = 4;
+	req.count = count;
 	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 	req.memory = V4L2_MEMORY_MMAP;
 
@@ -190,6 +191,28 @@ int_fast32_t v4l2_set_format(int_fast32_t dev, int *resolution,
 	return 0;
 }
 
+int_fast32_t v4l2_get_format_flags(int_fast32_t dev, int pixelformat,
+				   uint32_t *flags)
+{
+	struct v4l2_fmtdesc fmt;
+
+	if (!dev || !flags)
+		return -1;
+
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+	while (v4l2_ioctl(dev, VIDIOC_ENUM_FMT, &fmt) == 0) {
+		if (fmt.pixelformat == (uint32_t)pixelformat) {
+			*flags = fmt.flags;
+			return 0;
+		}
+		fmt.index++;
+	}
+
+	return -1;
+}
+
 int_fast32_t v4l2_set_framerate(int_fast32_t dev, int *framerate)
 {
 	bool set = false;
@@ -84,6 +84,18 @@ static inline enum video_format v4l2_to_obs_video_format(uint_fast32_t format)
 	}
 }
 
+/**
+ * Check if a v4l2 pixel format is compressed and has to be decoded
+ *
+ * @param format v4l2 format id
+ *
+ * @return true for motion jpeg and jpeg
+ */
+static inline bool v4l2_format_is_mjpeg(uint_fast32_t format)
+{
+	return format == V4L2_PIX_FMT_MJPEG || format == V4L2_PIX_FMT_JPEG;
+}
+
 /**
  * Fixed framesizes for devices that don't support enumerating discrete values.
  *
@@ -187,14 +199,17 @@ int_fast32_t v4l2_stop_capture(int_fast32_t dev);
 /**
  * Create memory mapping for buffers
  *
- * This tries to map at least 2, preferably 4, buffers to application memory.
+ * This tries to map at least 2, preferably count, buffers to application
+ * memory.
  *
  * @param dev handle for the v4l2 device
  * @param buf buffer data
+ * @param count number of buffers to request
  *
  * @return negative on failure
  */
-int_fast32_t v4l2_create_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf);
+int_fast32_t v4l2_create_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf,
+			      uint_fast32_t count);
 
 /**
  * Destroy the memory mapping for buffers
@@ -244,6 +259,18 @@ int_fast32_t v4l2_get_input_caps(int_fast32_t dev, int input, uint32_t *caps);
 int_fast32_t v4l2_set_format(int_fast32_t dev, int *resolution,
 			     int *pixelformat, int *bytesperline);
 
+/**
+ * Get the flags of a pixelformat.
+ *
+ * @param dev handle for the v4l2 device
+ * @param pixelformat the pixelformat to look up
+ * @param flags set to the V4L2_FMT_FLAG_* flags of the format on success
+ *
+ * @return negative on failure
+ */
+int_fast32_t v4l2_get_format_flags(int_fast32_t dev, int pixelformat,
+				   uint32_t *flags);
+
 /**
  * Set the framerate on the device.
  *
@@ -31,12 +31,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <util/threading.h>
 #include <util/bmem.h>
+#include <util/circlebuf.h>
 #include <util/dstr.h>
 #include <util/platform.h>
 #include <obs-module.h>
 
 #include "v4l2-controls.h"
 #include "v4l2-helpers.h"
+#include "v4l2-mjpeg.h"
 
 #if HAVE_UDEV
 #include "v4l2-udev.h"
@@ -62,6 +64,84 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define blog(level, msg, ...) blog(level, "v4l2-input: " msg, ##__VA_ARGS__)
 
+/* buffers to request when frames are handed to libobs or the decode thread
+ * without a copy, and when every frame is copied right away */
+#define V4L2_BUFFERS_ASYNC 8
+#define V4L2_BUFFERS_COPY 4
+
+/* buffers that have to stay queued on the device, below that frames are
+ * copied instead of being handed to libobs */
+#define V4L2_MIN_QUEUED_BUFFERS 2
+
+/* compressed frames waiting for the decode thread, older ones are dropped */
+#define V4L2_MAX_DECODE_QUEUE 2
+
+#define V4L2_STATS_INTERVAL_NS 10000000000ULL
+
+/**
+ * Capture statistics
+ */
+struct v4l2_stats {
+	/** frames dequeued from the device */
+	uint64_t frames;
+	/** frames copied because too many buffers were held by libobs */
+	uint64_t copied;
+	/** compressed frames dropped because the decoder fell behind */
+	uint64_t dropped;
+	/** sum and maximum of the buffers not queued on the device */
+	uint64_t held_sum;
+	long held_max;
+	/** sum and maximum of the decode queue depth */
+	uint64_t depth_sum;
+	long depth_max;
+	/** capture to release latency of frames handed to libobs */
+	uint64_t latency_sum;
+	uint64_t latency_max;
+	uint64_t latency_count;
+};
+
+/**
+ * Mapped buffers of a capture
+ *
+ * Frames handed to libobs without a copy hold a reference, so the mapping
+ * stays valid until libobs released the last of them, even if the capture
+ * was stopped or the source destroyed in the meantime.
+ */
+struct v4l2_buffer_pool {
+	volatile long refs;
+	/** protects dev and the statistics */
+	pthread_mutex_t mutex;
+	/** device to queue returned buffers on, -1 once the capture stopped */
+	int_fast32_t dev;
+	/** the mapped buffers */
+	struct v4l2_buffer_data buffers;
+	/** buffers dequeued and not queued again yet */
+	volatile long held;
+	struct v4l2_stats stats;
+};
+
+/**
+ * A frame handed to libobs
+ */
+struct v4l2_frame_ref {
+	struct v4l2_buffer_pool *pool;
+	/** the buffer the frame data points to, if not decoded */
+	struct v4l2_buffer buf;
+	/** the decoded frame, if any */
+	AVFrame *decoded;
+	/** capture time of the frame */
+	uint64_t capture_ts;
+};
+
+/**
+ * A compressed frame waiting for the decode thread
+ */
+struct v4l2_decode_item {
+	struct v4l2_buffer buf;
+	uint64_t timestamp;
+	uint64_t capture_ts;
+};
+
 /**
  * Data structure for the v4l2 source
  */
@@ -87,7 +167,16 @@ struct v4l2_data {
 	int width;
 	int height;
 	int linesize;
-	struct v4l2_buffer_data buffers;
+	bool zero_copy;
+	struct v4l2_buffer_pool *pool;
+
+	/* decode thread for compressed formats */
+	bool decode;
+	pthread_t decode_thread;
+	pthread_mutex_t decode_mutex;
+	os_sem_t *decode_sem;
+	struct circlebuf decode_queue;
+	struct v4l2_mjpeg_decoder mjpeg;
 };
 
 /* forward declarations */
@@ -146,8 +235,338 @@ static void v4l2_prep_obs_frame(struct v4l2_data *data,
 	}
 }
 
+static void v4l2_stats_merge(struct v4l2_stats *dst,
+			     const struct v4l2_stats *src)
+{
+	dst->frames += src->frames;
+	dst->copied += src->copied;
+	dst->dropped += src->dropped;
+	dst->held_sum += src->held_sum;
+	dst->depth_sum += src->depth_sum;
+	dst->latency_sum += src->latency_sum;
+	dst->latency_count += src->latency_count;
+	if (src->held_max > dst->held_max)
+		dst->held_max = src->held_max;
+	if (src->depth_max > dst->depth_max)
+		dst->depth_max = src->depth_max;
+	if (src->latency_max > dst->latency_max)
+		dst->latency_max = src->latency_max;
+}
+
+static void v4l2_stats_log(int level, const struct v4l2_stats *stats)
+{
+	if (!stats->frames)
+		return;
+
+	const double frames = (double)stats->frames;
+	const double latency =
+		stats->latency_count
+			? (double)stats->latency_sum / stats->latency_count
+			: 0.0;
+
+	blog(level,
+	     "%" PRIu64 " frames, %" PRIu64 " copied, %" PRIu64
+	     " dropped by the decoder, held buffers %.2f (max %ld), "
+	     "decode queue %.2f (max %ld), capture to release latency "
+	     "%.2f ms (max %.2f ms)",
+	     stats->frames, stats->copied, stats->dropped,
+	     stats->held_sum / frames, stats->held_max,
+	     stats->depth_sum / frames, stats->depth_max, latency / 1000000.0,
+	     stats->latency_max / 1000000.0);
+}
+
+/**
+ * Map the buffers of the device
+ */
+static struct v4l2_buffer_pool *v4l2_pool_create(int_fast32_t dev,
+						 uint_fast32_t count)
+{
+	struct v4l2_buffer_pool *pool = bzalloc(sizeof(*pool));
+
+	if (v4l2_create_mmap(dev, &pool->buffers, count) < 0) {
+		v4l2_destroy_mmap(&pool->buffers);
+		bfree(pool);
+		return NULL;
+	}
+
+	pthread_mutex_init(&pool->mutex, NULL);
+	pool->refs = 1;
+	pool->dev = dev;
+	return pool;
+}
+
+static inline void v4l2_pool_addref(struct v4l2_buffer_pool *pool)
+{
+	os_atomic_inc_long(&pool->refs);
+}
+
+static void v4l2_pool_release(struct v4l2_buffer_pool *pool)
+{
+	if (os_atomic_dec_long(&pool->refs) != 0)
+		return;
+
+	v4l2_destroy_mmap(&pool->buffers);
+	pthread_mutex_destroy(&pool->mutex);
+	bfree(pool);
+}
+
+/**
+ * Queue a buffer on the device again
+ *
+ * Buffers returned after the capture stopped are only accounted.
+ */
+static void v4l2_pool_queue_buffer(struct v4l2_buffer_pool *pool,
+				   struct v4l2_buffer *buf)
+{
+	pthread_mutex_lock(&pool->mutex);
+	if (pool->dev != -1 && v4l2_ioctl(pool->dev, VIDIOC_QBUF, buf) < 0)
+		blog(LOG_DEBUG, "failed to enqueue buffer");
+	pthread_mutex_unlock(&pool->mutex);
+
+	os_atomic_dec_long(&pool->held);
+}
+
+/**
+ * Called by libobs once it no longer uses a frame
+ */
+static void v4l2_frame_release(void *param)
+{
+	struct v4l2_frame_ref *ref = param;
+	struct v4l2_buffer_pool *pool = ref->pool;
+	const uint64_t latency = os_gettime_ns() - ref->capture_ts;
+
+	if (ref->decoded)
+		av_frame_free(&ref->decoded);
+	else
+		v4l2_pool_queue_buffer(pool, &ref->buf);
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->stats.latency_sum += latency;
+	pool->stats.latency_count++;
+	if (latency > pool->stats.latency_max)
+		pool->stats.latency_max = latency;
+	pthread_mutex_unlock(&pool->mutex);
+
+	v4l2_pool_release(pool);
+	bfree(ref);
+}
+
+/**
+ * Get the capture time of a buffer on the os_gettime_ns clock
+ */
+static uint64_t v4l2_capture_time(const struct v4l2_buffer *buf)
+{
+	if ((buf->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) ==
+	    V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+		return timeval2ns(buf->timestamp);
+
+	return os_gettime_ns();
+}
+
+/**
+ * Decode a compressed frame and hand it to libobs
+ */
+static void v4l2_decode_frame(struct v4l2_data *data,
+			      struct v4l2_decode_item *item)
+{
+	struct v4l2_buffer_pool *pool = data->pool;
+	struct obs_source_frame out;
+	struct v4l2_frame_ref *ref;
+	enum video_range_type range;
+	AVFrame *frame;
+	int_fast32_t ret;
+
+	ret = v4l2_decode_mjpeg(&data->mjpeg,
+				pool->buffers.info[item->buf.index].start,
+				item->buf.bytesused);
+
+	/* the decoder works on a copy, so the buffer can be queued now */
+	v4l2_pool_queue_buffer(pool, &item->buf);
+
+	if (ret < 0) {
+		blog(LOG_DEBUG, "failed to decode frame");
+		return;
+	}
+
+	frame = data->mjpeg.frame;
+
+	memset(&out, 0, sizeof(out));
+	out.format = v4l2_mjpeg_video_format(frame->format);
+	if (out.format == VIDEO_FORMAT_NONE) {
+		blog(LOG_DEBUG, "unsupported decoded format %d", frame->format);
+		return;
+	}
+
+	/* jpeg is full range unless the user says otherwise */
+	range = (data->color_range == VIDEO_RANGE_DEFAULT) ? VIDEO_RANGE_FULL
+							   : data->color_range;
+
+	out.width = frame->width;
+	out.height = frame->height;
+	out.timestamp = item->timestamp;
+	out.full_range = range == VIDEO_RANGE_FULL;
+	video_format_get_parameters(VIDEO_CS_601, range, out.color_matrix,
+				    out.color_range_min, out.color_range_max);
+
+	ref = bzalloc(sizeof(*ref));
+	ref->decoded = av_frame_clone(frame);
+	if (!ref->decoded) {
+		bfree(ref);
+		return;
+	}
+	ref->pool = pool;
+	ref->capture_ts = item->capture_ts;
+	v4l2_pool_addref(pool);
+
+	for (uint_fast32_t i = 0; i < MAX_AV_PLANES && i < AV_NUM_DATA_POINTERS;
+	     ++i) {
+		out.data[i] = ref->decoded->data[i];
+		out.linesize[i] = ref->decoded->linesize[i];
+	}
+
+	obs_source_output_video_borrowed(data->source, &out, v4l2_frame_release,
+					 ref);
+}
+
+/*
+ * Worker thread to decode compressed video data
+ */
+static void *v4l2_decode_thread(void *vptr)
+{
+	V4L2_DATA(vptr);
+	struct v4l2_decode_item item;
+	bool pending;
+
+	os_set_thread_name("v4l2: decode");
+
+	while (os_sem_wait(data->decode_sem) == 0) {
+		if (os_event_try(data->event) != EAGAIN)
+			break;
+
+		pthread_mutex_lock(&data->decode_mutex);
+		pending = data->decode_queue.size != 0;
+		if (pending)
+			circlebuf_pop_front(&data->decode_queue, &item,
+					    sizeof(item));
+		pthread_mutex_unlock(&data->decode_mutex);
+
+		if (pending)
+			v4l2_decode_frame(data, &item);
+	}
+
+	return NULL;
+}
+
+/**
+ * Pass a compressed frame to the decode thread
+ *
+ * If the decoder fell behind the oldest waiting frame is dropped, so the
+ * latency does not build up.
+ */
+static void v4l2_queue_decode(struct v4l2_data *data,
+			      const struct v4l2_decode_item *item,
+			      struct v4l2_stats *stats)
+{
+	struct v4l2_decode_item dropped;
+	bool drop = false;
+	long depth;
+
+	pthread_mutex_lock(&data->decode_mutex);
+	if (data->decode_queue.size >= V4L2_MAX_DECODE_QUEUE * sizeof(*item)) {
+		circlebuf_pop_front(&data->decode_queue, &dropped,
+				    sizeof(dropped));
+		drop = true;
+	}
+	circlebuf_push_back(&data->decode_queue, item, sizeof(*item));
+	depth = (long)(data->decode_queue.size / sizeof(*item));
+	pthread_mutex_unlock(&data->decode_mutex);
+
+	if (drop) {
+		v4l2_pool_queue_buffer(data->pool, &dropped.buf);
+		stats->dropped++;
+	} else {
+		os_sem_post(data->decode_sem);
+	}
+
+	stats->depth_sum += depth;
+	if (depth > stats->depth_max)
+		stats->depth_max = depth;
+}
+
+/**
+ * Hand a frame to libobs, which queues the buffer again once it is done
+ */
+static void v4l2_output_borrowed(struct v4l2_data *data,
+				 struct obs_source_frame *out,
+				 const struct v4l2_buffer *buf,
+				 uint64_t capture_ts)
+{
+	struct v4l2_frame_ref *ref = bzalloc(sizeof(*ref));
+
+	ref->pool = data->pool;
+	ref->buf = *buf;
+	ref->capture_ts = capture_ts;
+	v4l2_pool_addref(data->pool);
+
+	obs_source_output_video_borrowed(data->source, out, v4l2_frame_release,
+					 ref);
+}
+
+static bool v4l2_decode_start(struct v4l2_data *data)
+{
+	if (v4l2_init_mjpeg(&data->mjpeg) < 0)
+		return false;
+
+	pthread_mutex_init(&data->decode_mutex, NULL);
+	if (os_sem_init(&data->decode_sem, 0) != 0)
+		goto fail;
+	if (pthread_create(&data->decode_thread, NULL, v4l2_decode_thread,
+			   data) != 0)
+		goto fail;
+
+	data->decode = true;
+	return true;
+
+fail:
+	os_sem_destroy(data->decode_sem);
+	data->decode_sem = NULL;
+	pthread_mutex_destroy(&data->decode_mutex);
+	v4l2_destroy_mjpeg(&data->mjpeg);
+	return false;
+}
+
+/**
+ * Stop the decode thread, needs the capture thread to be stopped already
+ */
+static void v4l2_decode_stop(struct v4l2_data *data)
+{
+	struct v4l2_decode_item item;
+
+	if (!data->decode)
+		return;
+
+	os_sem_post(data->decode_sem);
+	pthread_join(data->decode_thread, NULL);
+
+	while (data->decode_queue.size) {
+		circlebuf_pop_front(&data->decode_queue, &item, sizeof(item));
+		v4l2_pool_queue_buffer(data->pool, &item.buf);
+	}
+
+	circlebuf_free(&data->decode_queue);
+	os_sem_destroy(data->decode_sem);
+	data->decode_sem = NULL;
+	pthread_mutex_destroy(&data->decode_mutex);
+	v4l2_destroy_mjpeg(&data->mjpeg);
+	data->decode = false;
+}
+
 /*
  * Worker thread to get video data
+ *
+ * Compressed frames are passed on to the decode thread, uncompressed frames
+ * are handed to libobs without a copy as long as enough buffers are left
+ * queued on the device.
  */
 static void *v4l2_thread(void *vptr)
 {
@@ -157,16 +576,25 @@ static void *v4l2_thread(void *vptr)
 	uint8_t *start;
 	uint64_t frames;
 	uint64_t first_ts;
+	uint64_t capture_ts;
+	uint64_t stats_ts;
+	long held;
 	struct timeval tv;
 	struct v4l2_buffer buf;
 	struct obs_source_frame out;
 	size_t plane_offsets[MAX_AV_PLANES];
+	struct v4l2_buffer_pool *pool = data->pool;
+	struct v4l2_stats stats = {0};
+	struct v4l2_stats total = {0};
+
+	os_set_thread_name("v4l2: capture");
 
-	if (v4l2_start_capture(data->dev, &data->buffers) < 0)
+	if (v4l2_start_capture(data->dev, &pool->buffers) < 0)
 		goto exit;
 
 	frames = 0;
 	first_ts = 0;
+	stats_ts = os_gettime_ns();
 	v4l2_prep_obs_frame(data, &out, plane_offsets);
 
 	while (os_event_try(data->event) == EAGAIN) {
@@ -196,26 +624,72 @@ static void *v4l2_thread(void *vptr)
 			break;
 		}
 
+		held = os_atomic_inc_long(&pool->held);
+		capture_ts = v4l2_capture_time(&buf);
+
 		out.timestamp = timeval2ns(buf.timestamp);
 		if (!frames)
 			first_ts = out.timestamp;
 		out.timestamp -= first_ts;
 
-		start = (uint8_t *)data->buffers.info[buf.index].start;
-		for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i)
-			out.data[i] = start + plane_offsets[i];
-		obs_source_output_video(data->source, &out);
+		stats.frames++;
+		stats.held_sum += held;
+		if (held > stats.held_max)
+			stats.held_max = held;
 
-		if (v4l2_ioctl(data->dev, VIDIOC_QBUF, &buf) < 0) {
-			blog(LOG_DEBUG, "failed to enqueue buffer");
-			break;
+		if (data->decode) {
+			struct v4l2_decode_item item = {buf, out.timestamp,
+							capture_ts};
+			v4l2_queue_decode(data, &item, &stats);
+		} else {
+			start = (uint8_t *)pool->buffers.info[buf.index].start;
+			for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i)
+				out.data[i] = start + plane_offsets[i];
+
+			if (data->zero_copy &&
+			    (long)pool->buffers.count - held >=
+				    V4L2_MIN_QUEUED_BUFFERS) {
+				v4l2_output_borrowed(data, &out, &buf,
+						     capture_ts);
+			} else {
+				obs_source_output_video(data->source, &out);
+				stats.copied++;
+
+				os_atomic_dec_long(&pool->held);
+				if (v4l2_ioctl(data->dev, VIDIOC_QBUF, &buf) <
+				    0) {
+					blog(LOG_DEBUG,
+					     "failed to enqueue buffer");
+					break;
+				}
+			}
 		}
 
 		frames++;
+
+		if (capture_ts - stats_ts >= V4L2_STATS_INTERVAL_NS) {
+			pthread_mutex_lock(&pool->mutex);
+			v4l2_stats_merge(&stats, &pool->stats);
+			memset(&pool->stats, 0, sizeof(pool->stats));
+			pthread_mutex_unlock(&pool->mutex);
+
+			v4l2_stats_log(LOG_DEBUG, &stats);
+			v4l2_stats_merge(&total, &stats);
+			memset(&stats, 0, sizeof(stats));
+			stats_ts = capture_ts;
+		}
 	}
 
 	blog(LOG_INFO, "Stopped capture after %" PRIu64 " frames", frames);
 
+	pthread_mutex_lock(&pool->mutex);
+	v4l2_stats_merge(&stats, &pool->stats);
+	memset(&pool->stats, 0, sizeof(pool->stats));
+	pthread_mutex_unlock(&pool->mutex);
+
+	v4l2_stats_merge(&total, &stats);
+	v4l2_stats_log(LOG_INFO, &total);
+
 exit:
 	v4l2_stop_capture(data->dev);
 	return NULL;
@@ -398,7 +872,8 @@ static void v4l2_format_list(int dev, obs_property_t *prop)
 			dstr_cat(&buffer, " (Emulated)");
 
 		if (v4l2_to_obs_video_format(fmt.pixelformat) !=
-		    VIDEO_FORMAT_NONE) {
+			    VIDEO_FORMAT_NONE ||
+		    v4l2_format_is_mjpeg(fmt.pixelformat)) {
 			obs_property_list_add_int(prop, buffer.array,
 						  fmt.pixelformat);
 			blog(LOG_INFO, "Pixelformat: %s (available)",
@@ -820,11 +1295,30 @@ static void v4l2_terminate(struct v4l2_data *data)
 	if (data->thread) {
 		os_event_signal(data->event);
 		pthread_join(data->thread, NULL);
-		os_event_destroy(data->event);
 		data->thread = 0;
 	}
 
-	v4l2_destroy_mmap(&data->buffers);
+	/* frames still held by libobs keep the mapping alive, but must not
+	 * queue their buffers on a closed device */
+	if (data->pool) {
+		pthread_mutex_lock(&data->pool->mutex);
+		data->pool->dev = -1;
+		pthread_mutex_unlock(&data->pool->mutex);
+	}
+
+	if (data->event)
+		os_event_signal(data->event);
+	v4l2_decode_stop(data);
+
+	if (data->event) {
+		os_event_destroy(data->event);
+		data->event = NULL;
+	}
+
+	if (data->pool) {
+		v4l2_pool_release(data->pool);
+		data->pool = NULL;
+	}
 
 	if (data->dev != -1) {
 		v4l2_close(data->dev);
@@ -914,7 +1408,8 @@ static void v4l2_init(struct v4l2_data *data)
 		blog(LOG_ERROR, "Unable to set format");
 		goto fail;
 	}
-	if (v4l2_to_obs_video_format(data->pixfmt) == VIDEO_FORMAT_NONE) {
+	if (v4l2_to_obs_video_format(data->pixfmt) == VIDEO_FORMAT_NONE &&
+	    !v4l2_format_is_mjpeg(data->pixfmt)) {
 		blog(LOG_ERROR, "Selected video format not supported");
 		goto fail;
 	}
@@ -931,15 +1426,37 @@ static void v4l2_init(struct v4l2_data *data)
 	v4l2_unpack_tuple(&fps_num, &fps_denom, data->framerate);
 	blog(LOG_INFO, "Framerate: %.2f fps", (float)fps_denom / fps_num);
 
+	/* frames can only be handed to libobs as they are if the buffers are
+	 * mapped from the device, emulated formats are converted by libv4l2
+	 * into buffers that are freed with the device */
+	uint32_t format_flags = 0;
+	data->zero_copy =
+		!v4l2_format_is_mjpeg(data->pixfmt) &&
+		v4l2_get_format_flags(data->dev, data->pixfmt,
+				      &format_flags) == 0 &&
+		!(format_flags & V4L2_FMT_FLAG_EMULATED);
+
 	/* map buffers */
-	if (v4l2_create_mmap(data->dev, &data->buffers) < 0) {
+	data->pool = v4l2_pool_create(data->dev,
+				      (data->zero_copy ||
+				       v4l2_format_is_mjpeg(data->pixfmt))
+					      ? V4L2_BUFFERS_ASYNC
+					      : V4L2_BUFFERS_COPY);
+	if (!data->pool) {
 		blog(LOG_ERROR, "Failed to map buffers");
 		goto fail;
 	}
+	blog(LOG_INFO, "Buffers: %" PRIuFAST32 "%s",
+	     data->pool->buffers.count,
+	     data->zero_copy ? " (zero copy)" : "");
 
 	/* start the capture thread */
 	if (os_event_init(&data->event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail;
+	if (v4l2_format_is_mjpeg(data->pixfmt) && !v4l2_decode_start(data)) {
+		blog(LOG_ERROR, "Unable to start the decoder");
+		goto fail;
+	}
 	if (pthread_create(&data->thread, NULL, v4l2_thread, data) != 0)
 		goto fail;
 	return;
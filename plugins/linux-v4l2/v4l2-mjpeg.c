@@ -0,0 +1,120 @@
+/*
+Copyright (C) 2021 by the OBS Project
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <util/bmem.h>
+
+#include "v4l2-mjpeg.h"
+
+#define blog(level, msg, ...) blog(level, "v4l2-mjpeg: " msg, ##__VA_ARGS__)
+
+#ifndef AV_INPUT_BUFFER_PADDING_SIZE
+#define AV_INPUT_BUFFER_PADDING_SIZE FF_INPUT_BUFFER_PADDING_SIZE
+#endif
+
+int_fast32_t v4l2_init_mjpeg(struct v4l2_mjpeg_decoder *decoder)
+{
+	AVCodec *codec;
+
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+	avcodec_register_all();
+#endif
+	memset(decoder, 0, sizeof(*decoder));
+
+	codec = avcodec_find_decoder(AV_CODEC_ID_MJPEG);
+	if (!codec) {
+		blog(LOG_ERROR, "failed to find the MJPEG decoder");
+		return -1;
+	}
+
+	decoder->context = avcodec_alloc_context3(codec);
+	decoder->frame = av_frame_alloc();
+	if (!decoder->context || !decoder->frame)
+		goto fail;
+
+	/* every camera already decodes on a thread of its own, frame
+	 * threading would only add latency */
+	decoder->context->thread_count = 1;
+
+	if (avcodec_open2(decoder->context, codec, NULL) < 0) {
+		blog(LOG_ERROR, "failed to open the MJPEG decoder");
+		goto fail;
+	}
+
+	return 0;
+fail:
+	v4l2_destroy_mjpeg(decoder);
+	return -1;
+}
+
+void v4l2_destroy_mjpeg(struct v4l2_mjpeg_decoder *decoder)
+{
+	if (decoder->frame)
+		av_frame_free(&decoder->frame);
+
+	if (decoder->context)
+		avcodec_free_context(&decoder->context);
+
+	bfree(decoder->packet_buffer);
+	memset(decoder, 0, sizeof(*decoder));
+}
+
+int_fast32_t v4l2_decode_mjpeg(struct v4l2_mjpeg_decoder *decoder,
+			       const uint8_t *data, size_t length)
+{
+	AVPacket packet;
+	size_t size = length + AV_INPUT_BUFFER_PADDING_SIZE;
+
+	/* the decoder may read past the end of the data, which the mapped
+	 * buffer does not allow for */
+	if (decoder->packet_size < size) {
+		decoder->packet_buffer = brealloc(decoder->packet_buffer, size);
+		decoder->packet_size = size;
+	}
+	memcpy(decoder->packet_buffer, data, length);
+	memset(decoder->packet_buffer + length, 0,
+	       AV_INPUT_BUFFER_PADDING_SIZE);
+
+	av_init_packet(&packet);
+	packet.data = decoder->packet_buffer;
+	packet.size = (int)length;
+
+	if (avcodec_send_packet(decoder->context, &packet) < 0)
+		return -1;
+	if (avcodec_receive_frame(decoder->context, decoder->frame) < 0)
+		return -1;
+
+	return 0;
+}
+
+enum video_format v4l2_mjpeg_video_format(int format)
+{
+	switch (format) {
+	case AV_PIX_FMT_YUVJ420P:
+	case AV_PIX_FMT_YUV420P:
+		return VIDEO_FORMAT_I420;
+	case AV_PIX_FMT_YUVJ422P:
+	case AV_PIX_FMT_YUV422P:
+		return VIDEO_FORMAT_I422;
+	case AV_PIX_FMT_YUVJ444P:
+	case AV_PIX_FMT_YUV444P:
+		return VIDEO_FORMAT_I444;
+	case AV_PIX_FMT_GRAY8:
+		return VIDEO_FORMAT_Y800;
+	default:
+		return VIDEO_FORMAT_NONE;
+	}
+}
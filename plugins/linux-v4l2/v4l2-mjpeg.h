@@ -0,0 +1,85 @@
+/*
+Copyright (C) 2021 by the OBS Project
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <libavcodec/avcodec.h>
+
+#include <obs-module.h>
+#include <media-io/video-io.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Data structure for the mjpeg decoder
+ */
+struct v4l2_mjpeg_decoder {
+	/** decoder context */
+	AVCodecContext *context;
+	/** the last decoded frame */
+	AVFrame *frame;
+	/** padded copy of the compressed data */
+	uint8_t *packet_buffer;
+	/** size of the packet buffer */
+	size_t packet_size;
+};
+
+/**
+ * Initialize the mjpeg decoder
+ *
+ * @param decoder the decoder structure
+ *
+ * @return negative on failure
+ */
+int_fast32_t v4l2_init_mjpeg(struct v4l2_mjpeg_decoder *decoder);
+
+/**
+ * Free the decoder and the last decoded frame
+ *
+ * @param decoder the decoder structure
+ */
+void v4l2_destroy_mjpeg(struct v4l2_mjpeg_decoder *decoder);
+
+/**
+ * Decode a compressed frame
+ *
+ * On success the decoded frame is available in decoder->frame until the next
+ * call.
+ *
+ * @param decoder the decoder structure
+ * @param data start of the compressed frame
+ * @param length length of the compressed frame
+ *
+ * @return negative on failure
+ */
+int_fast32_t v4l2_decode_mjpeg(struct v4l2_mjpeg_decoder *decoder,
+			       const uint8_t *data, size_t length);
+
+/**
+ * Convert the pixel format of a decoded frame to obs video format
+ *
+ * @param format the AVPixelFormat of the decoded frame
+ *
+ * @return obs video_format id
+ */
+enum video_format v4l2_mjpeg_video_format(int format);
+
+#ifdef __cplusplus
+}
+#endif
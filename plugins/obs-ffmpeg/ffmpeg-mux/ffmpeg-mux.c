@@ -22,11 +22,19 @@
 
 #endif
 
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include "ffmpeg-mux.h"
 
 #include <util/dstr.h>
+#include <util/threading.h>
 #include <libavformat/avformat.h>
 
 #define ANSI_COLOR_RED "\x1b[0;91m"
@@ -112,6 +120,18 @@ struct audio_info {
 	AVCodecContext *ctx;
 };
 
+#if defined(__linux__)
+struct mux_ring {
+	struct ffm_ring_header *header;
+	uint8_t *data;
+	size_t capacity;
+	int data_fd;
+	int space_fd;
+	long next_pos;
+	bool hup;
+};
+#endif
+
 struct ffmpeg_mux {
 	AVFormatContext *output;
 	AVStream *video_stream;
@@ -124,8 +144,192 @@ struct ffmpeg_mux {
 	int num_audio_streams;
 	bool initialized;
 	char error[4096];
+#if defined(__linux__)
+	struct mux_ring ring;
+#endif
 };
 
+static size_t safe_read(void *vdata, size_t size)
+{
+	uint8_t *data = vdata;
+	size_t total = size;
+
+	while (size > 0) {
+		size_t in_size = fread(data, 1, size, stdin);
+		if (in_size == 0)
+			return 0;
+
+		size -= in_size;
+		data += in_size;
+	}
+
+	return total;
+}
+
+/* ------------------------------------------------------------------------- */
+
+#if defined(__linux__)
+static bool ring_open(struct mux_ring *ring, const char *arg)
+{
+	unsigned long long capacity;
+	int mem_fd;
+
+	if (sscanf(arg, "%d,%llu,%d,%d", &mem_fd, &capacity, &ring->data_fd,
+		   &ring->space_fd) != 4) {
+		fprintf(stderr, "Invalid ring argument: '%s'\n", arg);
+		return false;
+	}
+
+	ring->capacity = (size_t)capacity;
+	ring->header = mmap(NULL, FFM_RING_HEADER_SIZE + ring->capacity,
+			    PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd, 0);
+	close(mem_fd);
+
+	if (ring->header == MAP_FAILED) {
+		ring->header = NULL;
+		fprintf(stderr, "Failed to map packet ring: %s\n",
+			strerror(errno));
+		return false;
+	}
+
+	if (ring->header->magic != FFM_RING_MAGIC ||
+	    ring->header->version != FFM_RING_VERSION ||
+	    ring->header->capacity != ring->capacity) {
+		fprintf(stderr, "Packet ring header mismatch\n");
+		return false;
+	}
+
+	ring->data = ffm_ring_data(ring->header);
+	return true;
+}
+
+static void ring_free(struct mux_ring *ring)
+{
+	if (ring->header) {
+		munmap(ring->header, FFM_RING_HEADER_SIZE + ring->capacity);
+		close(ring->data_fd);
+		close(ring->space_fd);
+		ring->header = NULL;
+	}
+}
+
+static void ring_wait_for_data(struct mux_ring *ring, long seen_w)
+{
+	struct ffm_ring_header *header = ring->header;
+	struct pollfd fds[2] = {{ring->data_fd, POLLIN, 0},
+				{STDIN_FILENO, POLLIN, 0}};
+
+	os_atomic_set_bool(&header->reader_waiting, true);
+
+	/* the writer may have published before it could see the flag */
+	if (os_atomic_load_long(&header->write_pos) == seen_w &&
+	    !os_atomic_load_bool(&header->closed)) {
+		while (poll(fds, 2, -1) == -1 && errno == EINTR)
+			;
+
+		if (fds[0].revents & POLLIN) {
+			uint64_t val;
+			ssize_t ret = read(ring->data_fd, &val, sizeof(val));
+			(void)ret;
+		}
+
+		/* nothing is written to stdin while the ring is in use, so any
+		 * event on it means the parent closed it or went away */
+		if (fds[1].revents)
+			ring->hup = true;
+	}
+
+	os_atomic_set_bool(&header->reader_waiting, false);
+}
+
+static struct ffm_ring_record *ring_peek(struct mux_ring *ring)
+{
+	struct ffm_ring_header *header = ring->header;
+	long r = header->read_pos;
+
+	for (;;) {
+		long w = os_atomic_load_long(&header->write_pos);
+
+		if (r == w) {
+			if (os_atomic_load_bool(&header->closed) || ring->hup) {
+				if (os_atomic_load_long(&header->write_pos) ==
+				    r)
+					return NULL;
+				continue;
+			}
+
+			ring_wait_for_data(ring, w);
+			continue;
+		}
+
+		struct ffm_ring_record *record =
+			(struct ffm_ring_record *)(ring->data + r);
+		if (record->size == 0) {
+			r = 0;
+			record = (struct ffm_ring_record *)ring->data;
+		}
+
+		ring->next_pos = r + (long)record->size;
+		if (ring->next_pos == (long)ring->capacity)
+			ring->next_pos = 0;
+		return record;
+	}
+}
+
+static void ring_release(struct mux_ring *ring)
+{
+	struct ffm_ring_header *header = ring->header;
+
+	os_atomic_set_long(&header->read_pos, ring->next_pos);
+	if (os_atomic_load_bool(&header->writer_waiting)) {
+		uint64_t val = 1;
+		ssize_t ret = write(ring->space_fd, &val, sizeof(val));
+		(void)ret;
+	}
+}
+
+static bool ring_next(struct mux_ring *ring, struct resize_buf *rb,
+		      struct ffm_packet_info *info, uint8_t **data)
+{
+	struct ffm_ring_record *record = ring_peek(ring);
+	if (!record)
+		return false;
+
+	*info = record->info;
+
+	/* whole packets are handed to the muxer straight from the ring */
+	if (record->offset == 0 && record->length == info->size) {
+		*data = (uint8_t *)(record + 1);
+		return true;
+	}
+
+	/* split packets are reassembled, releasing each part as it's copied */
+	resize_buf_resize(rb, info->size);
+
+	for (;;) {
+		if (record->offset + record->length > info->size)
+			return false;
+
+		memcpy(rb->buf + record->offset, record + 1, record->length);
+
+		bool last = record->offset + record->length == info->size;
+		ring_release(ring);
+		if (last)
+			break;
+
+		record = ring_peek(ring);
+		if (!record)
+			return false;
+	}
+
+	*data = rb->buf;
+	return true;
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+
 static void header_free(struct header *header)
 {
 	free(header->data);
@@ -182,6 +386,10 @@ static void ffmpeg_mux_free(struct ffmpeg_mux *ffm)
 
 	dstr_free(&ffm->params.printable_file);
 
+#if defined(__linux__)
+	ring_free(&ffm->ring);
+#endif
+
 	memset(ffm, 0, sizeof(*ffm));
 }
 
@@ -515,40 +723,48 @@ static void ffmpeg_mux_header(struct ffmpeg_mux *ffm, uint8_t *data,
 	}
 }
 
-static size_t safe_read(void *vdata, size_t size)
+static bool read_packet(struct ffmpeg_mux *ffm, struct resize_buf *rb,
+			struct ffm_packet_info *info, uint8_t **data)
 {
-	uint8_t *data = vdata;
-	size_t total = size;
+#if defined(__linux__)
+	if (ffm->ring.header)
+		return ring_next(&ffm->ring, rb, info, data);
+#endif
 
-	while (size > 0) {
-		size_t in_size = fread(data, 1, size, stdin);
-		if (in_size == 0)
-			return 0;
+	if (safe_read(info, sizeof(*info)) != sizeof(*info))
+		return false;
 
-		size -= in_size;
-		data += in_size;
-	}
+	resize_buf_resize(rb, info->size);
+	if (safe_read(rb->buf, info->size) != info->size)
+		return false;
 
-	return total;
+	*data = rb->buf;
+	return true;
+}
+
+static inline void release_packet(struct ffmpeg_mux *ffm)
+{
+#if defined(__linux__)
+	if (ffm->ring.header)
+		ring_release(&ffm->ring);
+#else
+	(void)ffm;
+#endif
 }
 
 static bool ffmpeg_mux_get_header(struct ffmpeg_mux *ffm)
 {
 	struct ffm_packet_info info = {0};
+	struct resize_buf rb = {0};
+	uint8_t *data;
 
-	bool success = safe_read(&info, sizeof(info)) == sizeof(info);
+	bool success = read_packet(ffm, &rb, &info, &data);
 	if (success) {
-		uint8_t *data = malloc(info.size);
-
-		if (safe_read(data, info.size) == info.size) {
-			ffmpeg_mux_header(ffm, data, &info);
-		} else {
-			success = false;
-		}
-
-		free(data);
+		ffmpeg_mux_header(ffm, data, &info);
+		release_packet(ffm);
 	}
 
+	resize_buf_free(&rb);
 	return success;
 }
 
@@ -690,6 +906,16 @@ static int ffmpeg_mux_init_internal(struct ffmpeg_mux *ffm, int argc,
 {
 	argc--;
 	argv++;
+
+#if defined(__linux__)
+	if (argc && strncmp(argv[0], "--ring=", 7) == 0) {
+		if (!ring_open(&ffm->ring, argv[0] + 7))
+			return FFM_ERROR;
+		argc--;
+		argv++;
+	}
+#endif
+
 	if (!init_params(&argc, &argv, &ffm->params, &ffm->audio))
 		return FFM_ERROR;
 
@@ -816,6 +1042,7 @@ int main(int argc, char *argv[])
 	struct ffm_packet_info info = {0};
 	struct ffmpeg_mux ffm = {0};
 	struct resize_buf rb = {0};
+	uint8_t *data;
 	bool fail = false;
 	int ret;
 
@@ -847,14 +1074,9 @@ int main(int argc, char *argv[])
 		return ret;
 	}
 
-	while (!fail && safe_read(&info, sizeof(info)) == sizeof(info)) {
-		resize_buf_resize(&rb, info.size);
-
-		if (safe_read(rb.buf, info.size) == info.size) {
-			fail = !ffmpeg_mux_packet(&ffm, rb.buf, &info);
-		} else {
-			fail = true;
-		}
+	while (!fail && read_packet(&ffm, &rb, &info, &data)) {
+		fail = !ffmpeg_mux_packet(&ffm, data, &info);
+		release_packet(&ffm);
 	}
 
 	ffmpeg_mux_free(&ffm);
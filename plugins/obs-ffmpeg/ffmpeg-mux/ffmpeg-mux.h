@@ -17,6 +17,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 enum ffm_packet_type {
@@ -36,3 +37,60 @@ struct ffm_packet_info {
 	enum ffm_packet_type type;
 	bool keyframe;
 };
+
+/* ------------------------------------------------------------------------- */
+/* shared memory packet ring (linux only)
+ *
+ * When the helper is started with "--ring=<mem fd>,<size>,<data fd>,<space
+ * fd>" as its first argument, packets are delivered through a single
+ * producer/single consumer ring in an inherited memfd instead of stdin.
+ * The two eventfds wake the reader when data is published and the writer
+ * when space is released; each side only signals when the other side has
+ * flagged itself as waiting.  stdin stays open for the lifetime of the
+ * helper so either side can still detect the other going away.  Packets too
+ * large to sit in the ring comfortably are split across several records. */
+
+#define FFM_RING_MAGIC 0x474E4952 /* "RING" */
+#define FFM_RING_VERSION 1
+#define FFM_RING_HEADER_SIZE 128
+#define FFM_RING_ALIGN 8
+
+struct ffm_ring_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t capacity;
+
+	/* offsets into the data area, which starts FFM_RING_HEADER_SIZE bytes
+	 * after the header.  write_pos is only stored by the writer and
+	 * read_pos only by the reader; write_pos == read_pos means empty. */
+	volatile long write_pos;
+	volatile long read_pos;
+
+	volatile bool closed;
+	volatile bool reader_waiting;
+	volatile bool writer_waiting;
+};
+
+struct ffm_ring_record {
+	/* total record size including this header, aligned to FFM_RING_ALIGN.
+	 * a size of 0 marks the end of the data area: continue at offset 0 */
+	uint32_t size;
+
+	/* the part of the packet payload carried by this record */
+	uint32_t offset;
+	uint32_t length;
+	uint32_t reserved;
+
+	struct ffm_packet_info info;
+};
+
+static inline uint8_t *ffm_ring_data(struct ffm_ring_header *header)
+{
+	return (uint8_t *)header + FFM_RING_HEADER_SIZE;
+}
+
+static inline size_t ffm_ring_record_size(uint32_t payload_size)
+{
+	size_t size = sizeof(struct ffm_ring_record) + payload_size;
+	return (size + FFM_RING_ALIGN - 1) & ~(size_t)(FFM_RING_ALIGN - 1);
+}
@@ -33,7 +33,8 @@ void ffmpeg_hls_mux_destroy(void *data)
 		da_free(stream->mux_packets);
 		circlebuf_free(&stream->packets);
 
-		os_process_pipe_destroy(stream->pipe);
+		stop_pipe(stream);
+		pthread_mutex_destroy(&stream->ring_stats_mutex);
 		dstr_free(&stream->path);
 		dstr_free(&stream->printable_path);
 		dstr_free(&stream->stream_key);
@@ -46,11 +47,14 @@ void *ffmpeg_hls_mux_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct ffmpeg_muxer *stream = bzalloc(sizeof(*stream));
 	pthread_mutex_init_value(&stream->write_mutex);
+	pthread_mutex_init_value(&stream->ring_stats_mutex);
 	stream->output = output;
 
 	/* init mutex, semaphore and event */
 	if (pthread_mutex_init(&stream->write_mutex, NULL) != 0)
 		goto fail;
+	if (pthread_mutex_init(&stream->ring_stats_mutex, NULL) != 0)
+		goto fail;
 	if (os_event_init(&stream->stop_event, OS_EVENT_TYPE_AUTO) != 0)
 		goto fail;
 	if (os_sem_init(&stream->write_sem, 0) != 0)
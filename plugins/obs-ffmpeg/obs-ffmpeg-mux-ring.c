@@ -0,0 +1,356 @@
+/******************************************************************************
+    Copyright (C) 2021 by the OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#define _GNU_SOURCE
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <util/bmem.h>
+#include <util/base.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include "obs-ffmpeg-mux-ring.h"
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#define do_log(level, format, ...) \
+	blog(level, "[ffmpeg muxer ring] " format, ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+
+struct ffmpeg_mux_ring {
+	struct ffm_ring_header *header;
+	uint8_t *data;
+	size_t capacity;
+	size_t map_size;
+
+	int mem_fd;
+	int data_fd;
+	int space_fd;
+
+	/* the helper inherits the write end and never touches it, so the read
+	 * end hangs up once the helper exits, even if it crashed */
+	int lifeline[2];
+	uint64_t last_lifeline_check;
+
+	struct ffmpeg_mux_ring_stats *stats;
+	pthread_mutex_t *stats_mutex;
+};
+
+static inline void close_fd(int *fd)
+{
+	if (*fd != -1) {
+		close(*fd);
+		*fd = -1;
+	}
+}
+
+static int create_memfd(void)
+{
+#ifdef SYS_memfd_create
+	return (int)syscall(SYS_memfd_create, "obs-ffmpeg-mux-ring",
+			    MFD_CLOEXEC);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+struct ffmpeg_mux_ring *
+ffmpeg_mux_ring_create(size_t capacity, struct ffmpeg_mux_ring_stats *stats,
+		       pthread_mutex_t *stats_mutex)
+{
+	struct ffmpeg_mux_ring *ring = bzalloc(sizeof(*ring));
+
+	capacity &= ~(size_t)(FFM_RING_ALIGN - 1);
+
+	ring->capacity = capacity;
+	ring->map_size = FFM_RING_HEADER_SIZE + capacity;
+	ring->stats = stats;
+	ring->stats_mutex = stats_mutex;
+	ring->data_fd = -1;
+	ring->space_fd = -1;
+	ring->lifeline[0] = -1;
+	ring->lifeline[1] = -1;
+
+	/* all of these are close-on-exec, only the helper inherits them */
+	ring->mem_fd = create_memfd();
+	if (ring->mem_fd == -1) {
+		warn("memfd_create failed: %s", strerror(errno));
+		goto fail;
+	}
+	if (ftruncate(ring->mem_fd, (off_t)ring->map_size) != 0) {
+		warn("ftruncate failed: %s", strerror(errno));
+		goto fail;
+	}
+
+	ring->header = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE,
+			    MAP_SHARED, ring->mem_fd, 0);
+	if (ring->header == MAP_FAILED) {
+		ring->header = NULL;
+		warn("mmap failed: %s", strerror(errno));
+		goto fail;
+	}
+
+	ring->data_fd = eventfd(0, EFD_CLOEXEC);
+	ring->space_fd = eventfd(0, EFD_CLOEXEC);
+	if (ring->data_fd == -1 || ring->space_fd == -1) {
+		warn("eventfd failed: %s", strerror(errno));
+		goto fail;
+	}
+
+	if (pipe2(ring->lifeline, O_CLOEXEC) != 0) {
+		warn("pipe2 failed: %s", strerror(errno));
+		goto fail;
+	}
+
+	ring->header->magic = FFM_RING_MAGIC;
+	ring->header->version = FFM_RING_VERSION;
+	ring->header->capacity = capacity;
+	ring->data = ffm_ring_data(ring->header);
+
+	pthread_mutex_lock(stats_mutex);
+	memset(stats, 0, sizeof(*stats));
+	stats->capacity = capacity;
+	pthread_mutex_unlock(stats_mutex);
+	return ring;
+
+fail:
+	ffmpeg_mux_ring_destroy(ring);
+	return NULL;
+}
+
+void ffmpeg_mux_ring_destroy(struct ffmpeg_mux_ring *ring)
+{
+	if (!ring)
+		return;
+
+	if (ring->header)
+		munmap(ring->header, ring->map_size);
+
+	close_fd(&ring->mem_fd);
+	close_fd(&ring->data_fd);
+	close_fd(&ring->space_fd);
+	close_fd(&ring->lifeline[0]);
+	close_fd(&ring->lifeline[1]);
+	bfree(ring);
+}
+
+void ffmpeg_mux_ring_add_arg(struct ffmpeg_mux_ring *ring, struct dstr *cmd)
+{
+	dstr_catf(cmd, "--ring=%d,%llu,%d,%d ", ring->mem_fd,
+		  (unsigned long long)ring->capacity, ring->data_fd,
+		  ring->space_fd);
+}
+
+void ffmpeg_mux_ring_get_fds(struct ffmpeg_mux_ring *ring,
+			     int fds[FFMPEG_MUX_RING_FDS])
+{
+	fds[0] = ring->mem_fd;
+	fds[1] = ring->data_fd;
+	fds[2] = ring->space_fd;
+	fds[3] = ring->lifeline[1];
+}
+
+void ffmpeg_mux_ring_started(struct ffmpeg_mux_ring *ring)
+{
+	/* the mapping stays valid without the descriptor, and the lifeline
+	 * can only hang up once our own copy of the write end is gone */
+	close_fd(&ring->mem_fd);
+	close_fd(&ring->lifeline[1]);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline void signal_fd(int fd)
+{
+	uint64_t val = 1;
+	ssize_t ret = write(fd, &val, sizeof(val));
+	UNUSED_PARAMETER(ret);
+}
+
+static inline size_t ring_used(struct ffmpeg_mux_ring *ring, long w, long r)
+{
+	return (size_t)(w >= r ? w - r : (long)ring->capacity - r + w);
+}
+
+/* finds a contiguous span of 'size' bytes at the write position, writing a
+ * wrap marker if the span has to start over at the beginning of the ring.
+ * one byte is always left free so that a full ring never looks empty. */
+static bool ring_reserve(struct ffmpeg_mux_ring *ring, size_t size, long r,
+			 long *pos)
+{
+	long w = ring->header->write_pos;
+	long cap = (long)ring->capacity;
+	long s = (long)size;
+
+	if (w >= r) {
+		if (w + s < cap || (w + s == cap && r != 0)) {
+			*pos = w;
+			return true;
+		}
+		if (s < r) {
+			struct ffm_ring_record *marker =
+				(struct ffm_ring_record *)(ring->data + w);
+			marker->size = 0;
+			*pos = 0;
+			return true;
+		}
+	} else if (w + s < r) {
+		*pos = w;
+		return true;
+	}
+
+	return false;
+}
+
+/* a full ring notices a dead helper through wait_for_space, but a helper
+ * that died early would otherwise only be noticed once the ring fills up */
+#define LIFELINE_CHECK_INTERVAL_NS 250000000ULL
+
+static bool helper_alive(struct ffmpeg_mux_ring *ring)
+{
+	struct pollfd fd = {ring->lifeline[0], POLLIN, 0};
+	uint64_t now = os_gettime_ns();
+
+	if (now - ring->last_lifeline_check < LIFELINE_CHECK_INTERVAL_NS)
+		return true;
+
+	ring->last_lifeline_check = now;
+	return poll(&fd, 1, 0) == 0;
+}
+
+static bool wait_for_space(struct ffmpeg_mux_ring *ring, long seen_r)
+{
+	struct ffm_ring_header *header = ring->header;
+	struct pollfd fds[2] = {{ring->space_fd, POLLIN, 0},
+				{ring->lifeline[0], POLLIN, 0}};
+	uint64_t start = os_gettime_ns();
+	bool alive = true;
+
+	os_atomic_set_bool(&header->writer_waiting, true);
+
+	/* the reader may have released space before it could see the flag */
+	if (os_atomic_load_long(&header->read_pos) == seen_r) {
+		while (poll(fds, 2, -1) == -1 && errno == EINTR)
+			;
+
+		if (fds[0].revents & POLLIN) {
+			uint64_t val;
+			ssize_t ret = read(ring->space_fd, &val, sizeof(val));
+			UNUSED_PARAMETER(ret);
+		} else if (fds[1].revents) {
+			alive = false;
+		}
+	}
+
+	os_atomic_set_bool(&header->writer_waiting, false);
+
+	pthread_mutex_lock(ring->stats_mutex);
+	ring->stats->waits++;
+	ring->stats->wait_ns += os_gettime_ns() - start;
+	pthread_mutex_unlock(ring->stats_mutex);
+	return alive;
+}
+
+static bool write_record(struct ffmpeg_mux_ring *ring,
+			 const struct ffm_packet_info *info,
+			 const uint8_t *data, uint32_t offset, uint32_t length)
+{
+	struct ffm_ring_header *header = ring->header;
+	struct ffmpeg_mux_ring_stats *stats = ring->stats;
+	struct ffm_ring_record *record;
+	size_t size = ffm_ring_record_size(length);
+	long r, w, pos;
+
+	for (;;) {
+		r = os_atomic_load_long(&header->read_pos);
+		if (ring_reserve(ring, size, r, &pos))
+			break;
+		if (!wait_for_space(ring, r))
+			return false;
+	}
+
+	record = (struct ffm_ring_record *)(ring->data + pos);
+	record->size = (uint32_t)size;
+	record->offset = offset;
+	record->length = length;
+	record->info = *info;
+	memcpy(record + 1, data + offset, length);
+
+	w = pos + (long)size;
+	if (w == (long)ring->capacity)
+		w = 0;
+
+	os_atomic_set_long(&header->write_pos, w);
+	if (os_atomic_load_bool(&header->reader_waiting))
+		signal_fd(ring->data_fd);
+
+	r = os_atomic_load_long(&header->read_pos);
+
+	pthread_mutex_lock(ring->stats_mutex);
+	stats->used = ring_used(ring, w, r);
+	if (stats->used > stats->peak_used)
+		stats->peak_used = stats->used;
+	pthread_mutex_unlock(ring->stats_mutex);
+	return true;
+}
+
+bool ffmpeg_mux_ring_write(struct ffmpeg_mux_ring *ring,
+			   const struct ffm_packet_info *info,
+			   const uint8_t *data)
+{
+	/* keeps any single record small enough to always fit eventually */
+	const uint32_t max_length =
+		(uint32_t)(ring->capacity / 4 - sizeof(struct ffm_ring_record));
+	uint32_t offset = 0;
+
+	if (!helper_alive(ring))
+		return false;
+
+	do {
+		uint32_t length = info->size - offset;
+		if (length > max_length)
+			length = max_length;
+
+		if (!write_record(ring, info, data, offset, length))
+			return false;
+
+		offset += length;
+	} while (offset < info->size);
+
+	pthread_mutex_lock(ring->stats_mutex);
+	ring->stats->packets++;
+	if (info->size > max_length)
+		ring->stats->split_packets++;
+	pthread_mutex_unlock(ring->stats_mutex);
+	return true;
+}
+
+void ffmpeg_mux_ring_close(struct ffmpeg_mux_ring *ring)
+{
+	os_atomic_set_bool(&ring->header->closed, true);
+	signal_fd(ring->data_fd);
+}
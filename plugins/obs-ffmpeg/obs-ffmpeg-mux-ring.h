@@ -0,0 +1,65 @@
+/******************************************************************************
+    Copyright (C) 2021 by the OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <util/dstr.h>
+#include <util/threading.h>
+
+#include "ffmpeg-mux/ffmpeg-mux.h"
+
+struct ffmpeg_mux_ring_stats {
+	uint64_t capacity;
+	uint64_t used;
+	uint64_t peak_used;
+	uint64_t packets;
+	uint64_t split_packets;
+	uint64_t waits;
+	uint64_t wait_ns;
+};
+
+#if defined(__linux__)
+#define FFMPEG_MUX_RING_SUPPORTED 1
+
+struct ffmpeg_mux_ring;
+
+/* the ring updates stats with stats_mutex held, readers must hold it too */
+extern struct ffmpeg_mux_ring *
+ffmpeg_mux_ring_create(size_t capacity, struct ffmpeg_mux_ring_stats *stats,
+		       pthread_mutex_t *stats_mutex);
+extern void ffmpeg_mux_ring_destroy(struct ffmpeg_mux_ring *ring);
+
+#define FFMPEG_MUX_RING_FDS 4
+
+/* appends the helper argument that hands it the ring, gets the descriptors
+ * the helper has to inherit (they are close-on-exec everywhere else), and
+ * after the helper has been spawned, drops the descriptors that only the
+ * helper should hold */
+extern void ffmpeg_mux_ring_add_arg(struct ffmpeg_mux_ring *ring,
+				    struct dstr *cmd);
+extern void ffmpeg_mux_ring_get_fds(struct ffmpeg_mux_ring *ring,
+				    int fds[FFMPEG_MUX_RING_FDS]);
+extern void ffmpeg_mux_ring_started(struct ffmpeg_mux_ring *ring);
+
+/* blocks while the ring is full; returns false if the helper went away */
+extern bool ffmpeg_mux_ring_write(struct ffmpeg_mux_ring *ring,
+				  const struct ffm_packet_info *info,
+				  const uint8_t *data);
+
+/* tells the helper no more packets follow */
+extern void ffmpeg_mux_ring_close(struct ffmpeg_mux_ring *ring);
+#endif
@@ -69,22 +69,61 @@ static void ffmpeg_mux_destroy(void *data)
 	da_free(stream->mux_packets);
 	circlebuf_free(&stream->packets);
 
-	os_process_pipe_destroy(stream->pipe);
+	stop_pipe(stream);
 	dstr_free(&stream->path);
 	dstr_free(&stream->printable_path);
 	dstr_free(&stream->stream_key);
 	dstr_free(&stream->muxer_settings);
+	pthread_mutex_destroy(&stream->ring_stats_mutex);
 	bfree(stream);
 }
 
+static void get_ring_stats(struct ffmpeg_muxer *stream,
+			   struct ffmpeg_mux_ring_stats *stats)
+{
+	pthread_mutex_lock(&stream->ring_stats_mutex);
+	*stats = stream->ring_stats;
+	pthread_mutex_unlock(&stream->ring_stats_mutex);
+}
+
+static void get_ring_stats_proc(void *data, calldata_t *cd)
+{
+	struct ffmpeg_muxer *stream = data;
+	struct ffmpeg_mux_ring_stats stats;
+
+	get_ring_stats(stream, &stats);
+
+	calldata_set_int(cd, "capacity", (long long)stats.capacity);
+	calldata_set_int(cd, "used", (long long)stats.used);
+	calldata_set_int(cd, "peak_used", (long long)stats.peak_used);
+	calldata_set_int(cd, "waits", (long long)stats.waits);
+	calldata_set_int(cd, "wait_ms", (long long)(stats.wait_ns / 1000000));
+}
+
+static void add_ring_stats_proc(struct ffmpeg_muxer *stream)
+{
+	proc_handler_t *ph = obs_output_get_proc_handler(stream->output);
+	proc_handler_add(ph,
+			 "void get_ring_stats(out int capacity, out int used, "
+			 "out int peak_used, out int waits, out int wait_ms)",
+			 get_ring_stats_proc, stream);
+}
+
 static void *ffmpeg_mux_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct ffmpeg_muxer *stream = bzalloc(sizeof(*stream));
 	stream->output = output;
 
+	if (pthread_mutex_init(&stream->ring_stats_mutex, NULL) != 0) {
+		bfree(stream);
+		return NULL;
+	}
+
 	if (obs_output_get_flags(output) & OBS_OUTPUT_SERVICE)
 		stream->is_network = true;
 
+	add_ring_stats_proc(stream);
+
 	UNUSED_PARAMETER(settings);
 	return stream;
 }
@@ -251,7 +290,14 @@ static void build_command_line(struct ffmpeg_muxer *stream, struct dstr *cmd,
 
 	dstr_init_move_array(cmd, os_get_executable_path_ptr(FFMPEG_MUX));
 	dstr_insert_ch(cmd, 0, '\"');
-	dstr_cat(cmd, "\" \"");
+	dstr_cat(cmd, "\" ");
+
+#ifdef FFMPEG_MUX_RING_SUPPORTED
+	if (stream->ring)
+		ffmpeg_mux_ring_add_arg(stream->ring, cmd);
+#endif
+
+	dstr_cat(cmd, "\"");
 
 	dstr_copy(&stream->path, path);
 	dstr_replace(&stream->path, "\"", "\"\"");
@@ -274,12 +320,104 @@ static void build_command_line(struct ffmpeg_muxer *stream, struct dstr *cmd,
 	add_muxer_params(cmd, stream);
 }
 
+#ifdef FFMPEG_MUX_RING_SUPPORTED
+static void create_ring(struct ffmpeg_muxer *stream)
+{
+	obs_data_t *settings = obs_output_get_settings(stream->output);
+	long long size_mb = obs_data_get_int(settings, "ring_size_mb");
+	obs_data_release(settings);
+
+	/* the ring is opt-in, packets go through the pipe unless a size is
+	 * set */
+	if (size_mb <= 0)
+		return;
+
+	stream->ring = ffmpeg_mux_ring_create((size_t)size_mb * 1024 * 1024,
+					      &stream->ring_stats,
+					      &stream->ring_stats_mutex);
+	if (!stream->ring)
+		warn("Failed to create shared memory ring, "
+		     "falling back to pipe");
+}
+
+static void log_ring_stats(struct ffmpeg_muxer *stream)
+{
+	struct ffmpeg_mux_ring_stats stats;
+
+	get_ring_stats(stream, &stats);
+
+	info("Shared memory ring: peak %.1f of %.1f MB used, "
+	     "%llu packets (%llu split), writer waited %llu times "
+	     "(%.1f ms total)",
+	     (double)stats.peak_used / (1024.0 * 1024.0),
+	     (double)stats.capacity / (1024.0 * 1024.0),
+	     (unsigned long long)stats.packets,
+	     (unsigned long long)stats.split_packets,
+	     (unsigned long long)stats.waits,
+	     (double)stats.wait_ns / 1000000.0);
+}
+#endif
+
 void start_pipe(struct ffmpeg_muxer *stream, const char *path)
 {
 	struct dstr cmd;
+
+#ifdef FFMPEG_MUX_RING_SUPPORTED
+	create_ring(stream);
+#endif
+
 	build_command_line(stream, &cmd, path);
-	stream->pipe = os_process_pipe_create(cmd.array, "w");
+
+#ifdef FFMPEG_MUX_RING_SUPPORTED
+	if (stream->ring) {
+		int fds[FFMPEG_MUX_RING_FDS];
+
+		ffmpeg_mux_ring_get_fds(stream->ring, fds);
+		stream->pipe = os_process_pipe_create_inherit(
+			cmd.array, "w", fds, FFMPEG_MUX_RING_FDS);
+	} else
+#endif
+		stream->pipe = os_process_pipe_create(cmd.array, "w");
+
 	dstr_free(&cmd);
+
+#ifdef FFMPEG_MUX_RING_SUPPORTED
+	if (stream->ring) {
+		if (stream->pipe) {
+			ffmpeg_mux_ring_started(stream->ring);
+		} else {
+			ffmpeg_mux_ring_destroy(stream->ring);
+			stream->ring = NULL;
+		}
+	}
+#endif
+}
+
+int stop_pipe(struct ffmpeg_muxer *stream)
+{
+	int ret;
+
+#ifdef FFMPEG_MUX_RING_SUPPORTED
+	if (stream->ring)
+		ffmpeg_mux_ring_close(stream->ring);
+#endif
+
+	ret = os_process_pipe_destroy(stream->pipe);
+	stream->pipe = NULL;
+
+#ifdef FFMPEG_MUX_RING_SUPPORTED
+	if (stream->ring) {
+		log_ring_stats(stream);
+		ffmpeg_mux_ring_destroy(stream->ring);
+		stream->ring = NULL;
+
+		pthread_mutex_lock(&stream->ring_stats_mutex);
+		stream->ring_stats.used = 0;
+		pthread_mutex_unlock(&stream->ring_stats_mutex);
+	}
+#endif
+
+	return ret;
 }
 
 static void set_file_not_readable_error(struct ffmpeg_muxer *stream,
@@ -375,8 +513,7 @@ int deactivate(struct ffmpeg_muxer *stream, int code)
 	}
 
 	if (active(stream)) {
-		ret = os_process_pipe_destroy(stream->pipe);
-		stream->pipe = NULL;
+		ret = stop_pipe(stream);
 
 		os_atomic_set_bool(&stream->active, false);
 		os_atomic_set_bool(&stream->sent_headers, false);
@@ -469,6 +606,19 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 							: FFM_PACKET_AUDIO,
 				       .keyframe = packet->keyframe};
 
+#ifdef FFMPEG_MUX_RING_SUPPORTED
+	if (stream->ring) {
+		if (!ffmpeg_mux_ring_write(stream->ring, &info, packet->data)) {
+			warn("ffmpeg_mux_ring_write failed");
+			signal_failure(stream);
+			return false;
+		}
+
+		stream->total_bytes += packet->size;
+		return true;
+	}
+#endif
+
 	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info,
 				    sizeof(info));
 	if (ret != sizeof(info)) {
@@ -679,6 +829,11 @@ static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 	struct ffmpeg_muxer *stream = bzalloc(sizeof(*stream));
 	stream->output = output;
 
+	if (pthread_mutex_init(&stream->ring_stats_mutex, NULL) != 0) {
+		bfree(stream);
+		return NULL;
+	}
+
 	stream->hotkey =
 		obs_hotkey_register_output(output, "ReplayBuffer.Save",
 					   obs_module_text("ReplayBuffer.Save"),
@@ -692,6 +847,7 @@ static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 	signal_handler_t *sh = obs_output_get_signal_handler(output);
 	signal_handler_add(sh, "void saved()");
 
+	add_ring_stats_proc(stream);
 	return stream;
 }
 
@@ -843,8 +999,7 @@ static void *replay_buffer_mux_thread(void *data)
 	info("Wrote replay buffer to '%s'", stream->path.array);
 
 error:
-	os_process_pipe_destroy(stream->pipe);
-	stream->pipe = NULL;
+	stop_pipe(stream);
 	da_free(stream->mux_packets);
 	os_atomic_set_bool(&stream->muxing, false);
 	return NULL;
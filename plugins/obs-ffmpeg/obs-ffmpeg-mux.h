@@ -10,6 +10,8 @@
 #include <util/platform.h>
 #include <util/threading.h>
 
+#include "obs-ffmpeg-mux-ring.h"
+
 struct ffmpeg_muxer {
 	obs_output_t *output;
 	os_process_pipe_t *pipe;
@@ -51,11 +53,17 @@ struct ffmpeg_muxer {
 	int64_t last_dts_usec;
 
 	bool is_network;
+
+	/* shared memory transport, NULL when packets go through the pipe */
+	struct ffmpeg_mux_ring *ring;
+	struct ffmpeg_mux_ring_stats ring_stats;
+	pthread_mutex_t ring_stats_mutex;
 };
 
 bool stopping(struct ffmpeg_muxer *stream);
 bool active(struct ffmpeg_muxer *stream);
 void start_pipe(struct ffmpeg_muxer *stream, const char *path);
+int stop_pipe(struct ffmpeg_muxer *stream);
 bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet);
 bool send_headers(struct ffmpeg_muxer *stream);
 int deactivate(struct ffmpeg_muxer *stream, int code);
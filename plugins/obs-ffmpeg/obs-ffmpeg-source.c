@@ -50,6 +50,7 @@ struct ffmpeg_source {
 	char *input_format;
 	int buffering_mb;
 	int speed_percent;
+	int loop_cache_mb;
 	bool is_looping;
 	bool is_local_file;
 	bool is_hw_decoding;
@@ -89,6 +90,7 @@ static bool is_local_file_modified(obs_properties_t *props,
 	obs_property_t *buffering = obs_properties_get(props, "buffering_mb");
 	obs_property_t *seekable = obs_properties_get(props, "seekable");
 	obs_property_t *speed = obs_properties_get(props, "speed_percent");
+	obs_property_t *loop_cache = obs_properties_get(props, "loop_cache_mb");
 	obs_property_t *reconnect_delay_sec =
 		obs_properties_get(props, "reconnect_delay_sec");
 	obs_property_set_visible(input, !enabled);
@@ -97,6 +99,7 @@ static bool is_local_file_modified(obs_properties_t *props,
 	obs_property_set_visible(local_file, enabled);
 	obs_property_set_visible(looping, enabled);
 	obs_property_set_visible(speed, enabled);
+	obs_property_set_visible(loop_cache, enabled);
 	obs_property_set_visible(seekable, !enabled);
 	obs_property_set_visible(reconnect_delay_sec, !enabled);
 
@@ -112,6 +115,7 @@ static void ffmpeg_source_defaults(obs_data_t *settings)
 	obs_data_set_default_int(settings, "reconnect_delay_sec", 10);
 	obs_data_set_default_int(settings, "buffering_mb", 2);
 	obs_data_set_default_int(settings, "speed_percent", 100);
+	obs_data_set_default_int(settings, "loop_cache_mb", 0);
 }
 
 static const char *media_filter =
@@ -206,6 +210,13 @@ static obs_properties_t *ffmpeg_source_getproperties(void *data)
 					     1, 200, 1);
 	obs_property_int_set_suffix(prop, "%");
 
+	prop = obs_properties_add_int(props, "loop_cache_mb",
+				      obs_module_text("LoopCacheMB"), 0, 16384,
+				      64);
+	obs_property_int_set_suffix(prop, " MB");
+	obs_property_set_long_description(
+		prop, obs_module_text("LoopCacheMB.ToolTip"));
+
 	prop = obs_properties_add_list(props, "color_range",
 				       obs_module_text("ColorRange"),
 				       OBS_COMBO_TYPE_LIST,
@@ -230,6 +241,7 @@ static void dump_source_info(struct ffmpeg_source *s, const char *input,
 		"\tinput:                   %s\n"
 		"\tinput_format:            %s\n"
 		"\tspeed:                   %d\n"
+		"\tloop_cache_mb:           %d\n"
 		"\tis_looping:              %s\n"
 		"\tis_hw_decoding:          %s\n"
 		"\tis_clear_on_media_end:   %s\n"
@@ -237,6 +249,7 @@ static void dump_source_info(struct ffmpeg_source *s, const char *input,
 		"\tclose_when_inactive:     %s",
 		input ? input : "(null)",
 		input_format ? input_format : "(null)", s->speed_percent,
+		s->loop_cache_mb,
 		s->is_looping ? "yes" : "no", s->is_hw_decoding ? "yes" : "no",
 		s->is_clear_on_media_end ? "yes" : "no",
 		s->restart_on_activate ? "yes" : "no",
@@ -305,6 +318,7 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 			.format = s->input_format,
 			.buffering = s->buffering_mb * 1024 * 1024,
 			.speed = s->speed_percent,
+			.loop_cache_mb = s->is_local_file ? s->loop_cache_mb : 0,
 			.force_range = s->range,
 			.hardware_decoding = s->is_hw_decoding,
 			.is_local_file = s->is_local_file || s->seekable,
@@ -431,6 +445,7 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
 							   "color_range");
 	s->buffering_mb = (int)obs_data_get_int(settings, "buffering_mb");
 	s->speed_percent = (int)obs_data_get_int(settings, "speed_percent");
+	s->loop_cache_mb = (int)obs_data_get_int(settings, "loop_cache_mb");
 	s->is_local_file = is_local_file;
 	s->seekable = obs_data_get_bool(settings, "seekable");
 
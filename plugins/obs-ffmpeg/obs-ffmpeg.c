@@ -4,6 +4,8 @@
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 
+#include <media-playback/decode.h>
+
 #include "obs-ffmpeg-config.h"
 
 #ifdef _WIN32
@@ -226,6 +228,19 @@ extern void obs_ffmpeg_load_logging(void);
 extern void obs_ffmpeg_unload_logging(void);
 #endif
 
+/* threads shared by the software video decoders of all media sources,
+ * 0 for one per logical core */
+static void set_decode_threads_proc(void *data, calldata_t *cd)
+{
+	int threads = (int)calldata_int(cd, "threads");
+
+	mp_decode_set_thread_budget(threads);
+	blog(LOG_INFO, "Media source decode threads: %d",
+	     mp_decode_get_thread_budget());
+
+	UNUSED_PARAMETER(data);
+}
+
 bool obs_module_load(void)
 {
 	obs_register_source(&ffmpeg_source);
@@ -259,6 +274,10 @@ bool obs_module_load(void)
 #endif
 #endif
 
+	proc_handler_t *ph = obs_get_proc_handler();
+	proc_handler_add(ph, "void ffmpeg_set_decode_threads(int threads)",
+			 set_decode_threads_proc, NULL);
+
 #if ENABLE_FFMPEG_LOGGING
 	obs_ffmpeg_load_logging();
 #endif
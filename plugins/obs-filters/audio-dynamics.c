@@ -0,0 +1,396 @@
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <util/sse-intrin.h>
+
+#include "audio-dynamics.h"
+
+/* 20 * log10(2): converts log2 of an amplitude to dB */
+#define DB_PER_LOG2 6.0205999f
+
+/* ------------------------------------------------------------------------- */
+/* log2/exp2 approximations
+ *
+ * log2: exponent plus a degree 6 polynomial of the mantissa over [1, 2),
+ * max error 2.1e-6 (1.3e-5 dB).  exp2: degree 5 polynomial of the fraction
+ * over [0, 1) scaled by the integer power, max relative error 1.2e-7
+ * (1.1e-6 dB), and exactly 1 at 0.  Both are least-squares fits weighted
+ * towards minimax. */
+
+static inline __m128 log2_ps(__m128 x)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	__m128i bits = _mm_castps_si128(_mm_max_ps(x, _mm_set1_ps(FLT_MIN)));
+	__m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23),
+				  _mm_set1_epi32(127));
+	__m128i man = _mm_or_si128(_mm_and_si128(bits,
+						 _mm_set1_epi32(0x007fffff)),
+				   _mm_set1_epi32(0x3f800000));
+	__m128 t = _mm_sub_ps(_mm_castsi128_ps(man), one);
+	__m128 p;
+
+	p = _mm_set1_ps(-0.0264558568f);
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(0.123446797f));
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.279532996f));
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(0.458268241f));
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.718281358f));
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(1.4425531f));
+	p = _mm_mul_ps(p, t);
+
+	return _mm_add_ps(_mm_cvtepi32_ps(e), p);
+}
+
+/* y must be <= 0 */
+static inline __m128 exp2_ps(__m128 y)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	__m128 n, f, p;
+	__m128i scale;
+
+	y = _mm_max_ps(y, _mm_set1_ps(-126.0f));
+
+	/* floor(y); truncation rounds negative values up */
+	n = _mm_cvtepi32_ps(_mm_cvttps_epi32(y));
+	n = _mm_sub_ps(n, _mm_and_ps(_mm_cmpgt_ps(n, y), one));
+	f = _mm_sub_ps(y, n);
+
+	p = _mm_set1_ps(0.00188529859f);
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.00897337513f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.0558359306f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.240152806f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.693152472f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), one);
+
+	scale = _mm_slli_epi32(
+		_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23);
+	return _mm_mul_ps(p, _mm_castsi128_ps(scale));
+}
+
+static inline __m128 abs_ps(__m128 x)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+}
+
+static inline __m128 detect_ps(__m128 x, enum dynamics_detector detector)
+{
+	switch (detector) {
+	case DYNAMICS_DETECT_PEAK:
+		return abs_ps(x);
+	case DYNAMICS_DETECT_RMS:
+		return _mm_mul_ps(x, x);
+	case DYNAMICS_DETECT_NONE:
+		break;
+	}
+
+	return x;
+}
+
+static inline float detect(float x, enum dynamics_detector detector)
+{
+	switch (detector) {
+	case DYNAMICS_DETECT_PEAK:
+		return fabsf(x);
+	case DYNAMICS_DETECT_RMS:
+		return x * x;
+	case DYNAMICS_DETECT_NONE:
+		break;
+	}
+
+	return x;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Followers
+ *
+ * The follower is recursive in time, so four channels are run side by side
+ * instead: four samples of four channels are loaded and transposed so that
+ * each vector holds one instant of all four channels, the follower steps
+ * through the four instants, and the results are transposed back. */
+
+static inline __m128 follow_step(__m128 y, __m128 x, __m128 attack,
+				 __m128 release)
+{
+	__m128 rising = _mm_cmpgt_ps(x, y);
+	__m128 coef = _mm_or_ps(_mm_and_ps(rising, attack),
+				_mm_andnot_ps(rising, release));
+
+	return _mm_add_ps(x, _mm_mul_ps(coef, _mm_sub_ps(y, x)));
+}
+
+struct follow_group {
+	const float *in[4];
+	float *out[4];
+	float *state[4];
+	size_t count;
+};
+
+static void follow_group(struct follow_group *group, float *max_out,
+			 bool init_max, size_t frames, float attack,
+			 float release, enum dynamics_detector detector)
+{
+	const __m128 attack_v = _mm_set1_ps(attack);
+	const __m128 release_v = _mm_set1_ps(release);
+	float lanes[4];
+	size_t i = 0;
+
+	/* unused lanes repeat the first channel, which leaves the maximum
+	 * unchanged and writes the same values twice in the vector loop.  The
+	 * scalar tail and the state only cover the used lanes, since with
+	 * out == in a repeated lane would read back what lane 0 just wrote. */
+	for (size_t c = group->count; c < 4; c++) {
+		group->in[c] = group->in[0];
+		group->out[c] = group->out[0];
+		group->state[c] = group->state[0];
+	}
+
+	for (size_t c = 0; c < 4; c++)
+		lanes[c] = *group->state[c];
+
+	__m128 y = _mm_loadu_ps(lanes);
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 x0 = detect_ps(_mm_loadu_ps(group->in[0] + i), detector);
+		__m128 x1 = detect_ps(_mm_loadu_ps(group->in[1] + i), detector);
+		__m128 x2 = detect_ps(_mm_loadu_ps(group->in[2] + i), detector);
+		__m128 x3 = detect_ps(_mm_loadu_ps(group->in[3] + i), detector);
+
+		_MM_TRANSPOSE4_PS(x0, x1, x2, x3);
+
+		x0 = y = follow_step(y, x0, attack_v, release_v);
+		x1 = y = follow_step(y, x1, attack_v, release_v);
+		x2 = y = follow_step(y, x2, attack_v, release_v);
+		x3 = y = follow_step(y, x3, attack_v, release_v);
+
+		_MM_TRANSPOSE4_PS(x0, x1, x2, x3);
+
+		if (group->out[0]) {
+			_mm_storeu_ps(group->out[0] + i, x0);
+			_mm_storeu_ps(group->out[1] + i, x1);
+			_mm_storeu_ps(group->out[2] + i, x2);
+			_mm_storeu_ps(group->out[3] + i, x3);
+		}
+
+		if (max_out) {
+			__m128 m = _mm_max_ps(_mm_max_ps(x0, x1),
+					      _mm_max_ps(x2, x3));
+			if (!init_max)
+				m = _mm_max_ps(m, _mm_loadu_ps(max_out + i));
+			_mm_storeu_ps(max_out + i, m);
+		}
+	}
+
+	_mm_storeu_ps(lanes, y);
+
+	for (; i < frames; i++) {
+		float m = 0.0f;
+
+		for (size_t c = 0; c < group->count; c++) {
+			float x = detect(group->in[c][i], detector);
+			float coef = x > lanes[c] ? attack : release;
+
+			lanes[c] = x + coef * (lanes[c] - x);
+			if (group->out[c])
+				group->out[c][i] = lanes[c];
+			if (c == 0 || lanes[c] > m)
+				m = lanes[c];
+		}
+
+		if (max_out)
+			max_out[i] = init_max ? m : fmaxf(max_out[i], m);
+	}
+
+	for (size_t c = 0; c < group->count; c++)
+		*group->state[c] = lanes[c];
+}
+
+void dynamics_follow(float **out, float *max_out, float *const *in,
+		     size_t channels, size_t frames, float *state, float attack,
+		     float release, enum dynamics_detector detector)
+{
+	struct follow_group group;
+	bool init_max = true;
+
+	group.count = 0;
+
+	for (size_t c = 0; c < channels; c++) {
+		if (!in[c])
+			continue;
+
+		group.in[group.count] = in[c];
+		group.out[group.count] = out ? out[c] : NULL;
+		group.state[group.count] = state + c;
+
+		if (++group.count == 4) {
+			follow_group(&group, max_out, init_max, frames, attack,
+				     release, detector);
+			group.count = 0;
+			init_max = false;
+		}
+	}
+
+	if (group.count) {
+		follow_group(&group, max_out, init_max, frames, attack,
+			     release, detector);
+		init_max = false;
+	}
+
+	if (max_out && init_max)
+		memset(max_out, 0, frames * sizeof(float));
+}
+
+/* ------------------------------------------------------------------------- */
+/* Gain computers
+ *
+ * These work on four samples at a time; a partial block at the end goes
+ * through a small zero-padded buffer.  Blocks entirely on one side of the
+ * threshold skip the log2/exp2 evaluation. */
+
+struct compressor_params {
+	__m128 threshold;      /* linear */
+	__m128 threshold_log2; /* log2 of the linear threshold */
+	__m128 slope;
+	__m128 output_gain;
+};
+
+static inline __m128 compressor_block(__m128 env,
+				      const struct compressor_params *p)
+{
+	__m128 over = _mm_cmpgt_ps(env, p->threshold);
+	__m128 exponent;
+
+	if (!_mm_movemask_ps(over))
+		return p->output_gain;
+
+	exponent = _mm_sub_ps(p->threshold_log2, log2_ps(env));
+	exponent = _mm_mul_ps(p->slope, exponent);
+	exponent = _mm_min_ps(exponent, _mm_setzero_ps());
+	return _mm_mul_ps(exp2_ps(exponent), p->output_gain);
+}
+
+void dynamics_compressor_gain(float *gain, const float *env, size_t frames,
+			      float threshold_db, float slope,
+			      float output_gain)
+{
+	struct compressor_params p;
+	size_t i = 0;
+
+	p.threshold = _mm_set1_ps(powf(10.0f, threshold_db / 20.0f));
+	p.threshold_log2 = _mm_set1_ps(threshold_db / DB_PER_LOG2);
+	p.slope = _mm_set1_ps(slope);
+	p.output_gain = _mm_set1_ps(output_gain);
+
+	for (; i + 4 <= frames; i += 4)
+		_mm_storeu_ps(gain + i,
+			      compressor_block(_mm_loadu_ps(env + i), &p));
+
+	if (i < frames) {
+		float tail[4] = {0};
+		memcpy(tail, env + i, (frames - i) * sizeof(float));
+		_mm_storeu_ps(tail, compressor_block(_mm_loadu_ps(tail), &p));
+		memcpy(gain + i, tail, (frames - i) * sizeof(float));
+	}
+}
+
+struct expander_params {
+	__m128 threshold; /* linear, or squared for the mean square */
+	__m128 threshold_db;
+	__m128 db_per_log2;
+	__m128 slope;
+	__m128 min_gain_db;
+};
+
+static inline __m128 expander_block(__m128 env,
+				    const struct expander_params *p)
+{
+	__m128 under, env_db, gain_db;
+
+	env = abs_ps(env);
+	under = _mm_cmplt_ps(env, p->threshold);
+
+	if (!_mm_movemask_ps(under))
+		return _mm_setzero_ps();
+
+	env_db = _mm_mul_ps(log2_ps(env), p->db_per_log2);
+	gain_db = _mm_mul_ps(p->slope, _mm_sub_ps(p->threshold_db, env_db));
+	gain_db = _mm_min_ps(gain_db, _mm_setzero_ps());
+	return _mm_max_ps(gain_db, p->min_gain_db);
+}
+
+void dynamics_expander_gain_db(float *gain_db, const float *env, size_t frames,
+			       enum dynamics_detector detector,
+			       float threshold_db, float slope,
+			       float min_gain_db)
+{
+	struct expander_params p;
+	bool rms = detector == DYNAMICS_DETECT_RMS;
+	float threshold = powf(10.0f, threshold_db / 20.0f);
+	size_t i = 0;
+
+	p.threshold = _mm_set1_ps(rms ? threshold * threshold : threshold);
+	p.threshold_db = _mm_set1_ps(threshold_db);
+	p.db_per_log2 = _mm_set1_ps(rms ? DB_PER_LOG2 * 0.5f : DB_PER_LOG2);
+	p.slope = _mm_set1_ps(slope);
+	p.min_gain_db = _mm_set1_ps(min_gain_db);
+
+	for (; i + 4 <= frames; i += 4)
+		_mm_storeu_ps(gain_db + i,
+			      expander_block(_mm_loadu_ps(env + i), &p));
+
+	if (i < frames) {
+		float tail[4] = {0};
+		memcpy(tail, env + i, (frames - i) * sizeof(float));
+		_mm_storeu_ps(tail, expander_block(_mm_loadu_ps(tail), &p));
+		memcpy(gain_db + i, tail, (frames - i) * sizeof(float));
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+void dynamics_apply_gain(float *samples, const float *gain, size_t frames)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= frames; i += 4)
+		_mm_storeu_ps(samples + i,
+			      _mm_mul_ps(_mm_loadu_ps(samples + i),
+					 _mm_loadu_ps(gain + i)));
+	for (; i < frames; i++)
+		samples[i] *= gain[i];
+}
+
+static inline __m128 gain_db_block(__m128 gain_db, __m128 output_gain)
+{
+	__m128 exponent;
+
+	gain_db = _mm_min_ps(gain_db, _mm_setzero_ps());
+	if (!_mm_movemask_ps(_mm_cmplt_ps(gain_db, _mm_setzero_ps())))
+		return output_gain;
+
+	exponent = _mm_mul_ps(gain_db, _mm_set1_ps(1.0f / DB_PER_LOG2));
+	return _mm_mul_ps(exp2_ps(exponent), output_gain);
+}
+
+void dynamics_apply_gain_db(float *samples, const float *gain_db,
+			    size_t frames, float output_gain)
+{
+	const __m128 output_gain_v = _mm_set1_ps(output_gain);
+	size_t i = 0;
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 gain = gain_db_block(_mm_loadu_ps(gain_db + i),
+					    output_gain_v);
+		_mm_storeu_ps(samples + i,
+			      _mm_mul_ps(_mm_loadu_ps(samples + i), gain));
+	}
+
+	if (i < frames) {
+		float tail[4] = {0};
+		memcpy(tail, gain_db + i, (frames - i) * sizeof(float));
+		_mm_storeu_ps(tail,
+			      gain_db_block(_mm_loadu_ps(tail), output_gain_v));
+		for (size_t j = 0; i < frames; i++, j++)
+			samples[i] *= tail[j];
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Shared processing for the compressor, expander and limiter filters.
+ *
+ * The attack/release followers run four channels at a time, and the gain
+ * computers run four samples at a time using polynomial log2/exp2
+ * approximations instead of log10f/powf per sample.  Computed gains stay
+ * within DYNAMICS_MAX_ERROR_DB of the exact values (about 0.00002 dB for
+ * slopes up to 1, and 0.0003 dB at the expander's steepest 20:1 ratio).
+ */
+
+#define DYNAMICS_MAX_ERROR_DB 0.001f
+
+enum dynamics_detector {
+	DYNAMICS_DETECT_PEAK, /* |x| */
+	DYNAMICS_DETECT_RMS,  /* x * x, the mean square */
+	DYNAMICS_DETECT_NONE, /* x as is */
+};
+
+/*
+ * Runs each channel through an attack/release follower:
+ *
+ *   y = x + coef * (y - x), with coef = attack if x > y, else release
+ *
+ * starting from state[c], which is left holding the last value of the
+ * channel.  The result is written per channel to out (can be the same as in)
+ * and/or as the maximum across the channels to max_out; either can be NULL.
+ * Channels that are NULL in the input are skipped, all others need an output
+ * buffer if out is used.
+ */
+extern void dynamics_follow(float **out, float *max_out, float *const *in,
+			    size_t channels, size_t frames, float *state,
+			    float attack, float release,
+			    enum dynamics_detector detector);
+
+/*
+ * Compressor/limiter gain curve, as a linear gain per sample:
+ *
+ *   output_gain * db_to_mul(min(0, slope * (threshold_db - mul_to_db(env))))
+ */
+extern void dynamics_compressor_gain(float *gain, const float *env,
+				     size_t frames, float threshold_db,
+				     float slope, float output_gain);
+
+/*
+ * Expander gain curve, in dB per sample:
+ *
+ *   clamp(slope * (threshold_db - env_db), min_gain_db, 0)
+ *
+ * env_db is taken from the amplitude for DYNAMICS_DETECT_PEAK and from the
+ * mean square for DYNAMICS_DETECT_RMS.
+ */
+extern void dynamics_expander_gain_db(float *gain_db, const float *env,
+				      size_t frames,
+				      enum dynamics_detector detector,
+				      float threshold_db, float slope,
+				      float min_gain_db);
+
+/* samples *= gain */
+extern void dynamics_apply_gain(float *samples, const float *gain,
+				size_t frames);
+
+/* samples *= output_gain * db_to_mul(min(0, gain_db)) */
+extern void dynamics_apply_gain_db(float *samples, const float *gain_db,
+				   size_t frames, float output_gain);
+
+#ifdef __cplusplus
+}
+#endif
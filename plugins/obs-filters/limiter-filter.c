@@ -6,6 +6,8 @@
 #include <media-io/audio-math.h>
 #include <util/platform.h>
 
+#include "audio-dynamics.h"
+
 /* -------------------------------------------------------- */
 
 #define do_log(level, format, ...)             \
@@ -129,45 +131,32 @@ static void limiter_destroy(void *data)
 static void analyze_envelope(struct limiter_data *cd, float **samples,
 			     const uint32_t num_samples)
 {
+	float state[MAX_AUDIO_CHANNELS];
+
 	if (cd->envelope_buf_len < num_samples) {
 		resize_env_buffer(cd, num_samples);
 	}
 
-	const float attack_gain = cd->attack_gain;
-	const float release_gain = cd->release_gain;
-
-	memset(cd->envelope_buf, 0, num_samples * sizeof(cd->envelope_buf[0]));
-	for (size_t chan = 0; chan < cd->num_channels; ++chan) {
-		if (!samples[chan])
-			continue;
-
-		float *envelope_buf = cd->envelope_buf;
-		float env = cd->envelope;
-		for (uint32_t i = 0; i < num_samples; ++i) {
-			const float env_in = fabsf(samples[chan][i]);
-			if (env < env_in) {
-				env = env_in + attack_gain * (env - env_in);
-			} else {
-				env = env_in + release_gain * (env - env_in);
-			}
-			envelope_buf[i] = fmaxf(envelope_buf[i], env);
-		}
-	}
+	for (size_t chan = 0; chan < cd->num_channels; ++chan)
+		state[chan] = cd->envelope;
+
+	dynamics_follow(NULL, cd->envelope_buf, samples, cd->num_channels,
+			num_samples, state, cd->attack_gain, cd->release_gain,
+			DYNAMICS_DETECT_PEAK);
 	cd->envelope = cd->envelope_buf[num_samples - 1];
 }
 
 static inline void process_compression(const struct limiter_data *cd,
 				       float **samples, uint32_t num_samples)
 {
-	for (size_t i = 0; i < num_samples; ++i) {
-		const float env_db = mul_to_db(cd->envelope_buf[i]);
-		float gain = cd->slope * (cd->threshold - env_db);
-		gain = db_to_mul(fminf(0, gain));
-
-		for (size_t c = 0; c < cd->num_channels; ++c) {
-			if (samples[c]) {
-				samples[c][i] *= gain * cd->output_gain;
-			}
+	float *gain = cd->envelope_buf;
+
+	dynamics_compressor_gain(gain, cd->envelope_buf, num_samples,
+				 cd->threshold, cd->slope, cd->output_gain);
+
+	for (size_t c = 0; c < cd->num_channels; ++c) {
+		if (samples[c]) {
+			dynamics_apply_gain(samples[c], gain, num_samples);
 		}
 	}
 }
@@ -42,20 +42,16 @@ static inline double encoder_bitrate(obs_encoder_t *encoder)
 	return bitrate;
 }
 
-#define FLV_INFO_SIZE_OFFSET 42
-
-void write_file_info(FILE *file, int64_t duration_ms, int64_t size)
+size_t flv_file_info(uint8_t *buf, size_t size, int64_t duration_ms,
+		     int64_t file_size)
 {
-	char buf[64];
-	char *enc = buf;
-	char *end = enc + sizeof(buf);
-
-	fseek(file, FLV_INFO_SIZE_OFFSET, SEEK_SET);
+	char *enc = (char *)buf;
+	char *end = enc + size;
 
 	enc_num_val(&enc, end, "duration", (double)duration_ms / 1000.0);
-	enc_num_val(&enc, end, "fileSize", (double)size);
+	enc_num_val(&enc, end, "fileSize", (double)file_size);
 
-	fwrite(buf, 1, enc - buf, file);
+	return enc - (char *)buf;
 }
 
 static void build_flv_meta_data(obs_output_t *context, uint8_t **output,
@@ -26,7 +26,12 @@ static int32_t get_ms_time(struct encoder_packet *packet, int64_t val)
 	return (int32_t)(val * MILLISECOND_DEN / packet->timebase_den);
 }
 
-extern void write_file_info(FILE *file, int64_t duration_ms, int64_t size);
+#define FLV_INFO_SIZE_OFFSET 42
+
+/* encodes the duration and file size values of the meta data, to be written
+ * at FLV_INFO_SIZE_OFFSET once the file is complete */
+extern size_t flv_file_info(uint8_t *buf, size_t size, int64_t duration_ms,
+			    int64_t file_size);
 
 extern void flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size,
 			  bool write_header);
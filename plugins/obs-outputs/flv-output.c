@@ -21,6 +21,7 @@
 #include <util/platform.h>
 #include <util/dstr.h>
 #include <util/threading.h>
+#include <util/file-writer.h>
 #include <inttypes.h>
 #include "flv-mux.h"
 
@@ -34,7 +35,7 @@
 struct flv_output {
 	obs_output_t *output;
 	struct dstr path;
-	FILE *file;
+	file_writer_t *file;
 	volatile bool active;
 	volatile bool stopping;
 	uint64_t stop_ts;
@@ -95,7 +96,8 @@ static int write_packet(struct flv_output *stream,
 
 	flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset, &data,
 		       &size, is_header);
-	fwrite(data, 1, size, stream->file);
+	if (!file_writer_write(stream->file, data, size))
+		ret = -1;
 	bfree(data);
 
 	return ret;
@@ -107,7 +109,7 @@ static void write_meta_data(struct flv_output *stream)
 	size_t meta_data_size;
 
 	flv_meta_data(stream->output, &meta_data, &meta_data_size, true);
-	fwrite(meta_data, 1, meta_data_size, stream->file);
+	file_writer_write(stream->file, meta_data, meta_data_size);
 	bfree(meta_data);
 }
 
@@ -167,7 +169,7 @@ static bool flv_output_start(void *data)
 	dstr_copy(&stream->path, path);
 	obs_data_release(settings);
 
-	stream->file = os_fopen(stream->path.array, "wb");
+	stream->file = file_writer_create(stream->path.array, 0);
 	if (!stream->file) {
 		warn("Unable to open FLV file '%s'", stream->path.array);
 		return false;
@@ -193,10 +195,30 @@ static void flv_output_actual_stop(struct flv_output *stream, int code)
 	os_atomic_set_bool(&stream->active, false);
 
 	if (stream->file) {
-		write_file_info(stream->file, stream->last_packet_ts,
-				os_ftelli64(stream->file));
-
-		fclose(stream->file);
+		struct file_writer_stats stats;
+		uint8_t buf[64];
+		size_t size;
+
+		size = flv_file_info(buf, sizeof(buf), stream->last_packet_ts,
+				     file_writer_get_pos(stream->file));
+		file_writer_write_at(stream->file, FLV_INFO_SIZE_OFFSET, buf,
+				     size);
+
+		if (!file_writer_close(stream->file, &stats))
+			warn("Failed to write FLV file '%s'",
+			     stream->path.array);
+		stream->file = NULL;
+
+		info("Wrote %" PRIu64 " bytes in %" PRIu64 " writes, "
+		     "avg write %.2f ms, max write %.2f ms, "
+		     "peak queue %zu bytes, waited for queue %" PRIu64
+		     " times",
+		     stats.bytes_written, stats.writes,
+		     stats.writes ? (double)stats.write_ns /
+					    (double)stats.writes / 1000000.0
+				  : 0.0,
+		     (double)stats.max_write_ns / 1000000.0,
+		     stats.peak_queued_bytes, stats.queue_waits);
 	}
 	if (code) {
 		obs_output_signal_stop(stream->output, code);
@@ -211,6 +233,7 @@ static void flv_output_data(void *data, struct encoder_packet *packet)
 {
 	struct flv_output *stream = data;
 	struct encoder_packet parsed_packet;
+	int ret;
 
 	pthread_mutex_lock(&stream->mutex);
 
@@ -242,10 +265,15 @@ static void flv_output_data(void *data, struct encoder_packet *packet)
 		}
 
 		obs_parse_avc_packet(&parsed_packet, packet);
-		write_packet(stream, &parsed_packet, false);
+		ret = write_packet(stream, &parsed_packet, false);
 		obs_encoder_packet_release(&parsed_packet);
 	} else {
-		write_packet(stream, packet, false);
+		ret = write_packet(stream, packet, false);
+	}
+
+	if (ret < 0) {
+		warn("Failed to write to FLV file '%s'", stream->path.array);
+		flv_output_actual_stop(stream, OBS_OUTPUT_ERROR);
 	}
 
 unlock:
@@ -0,0 +1,515 @@
+#ifdef __linux__
+#include "rtmp-stream.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <linux/sockios.h>
+#include <netinet/tcp.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+static void fatal_sock_shutdown(struct rtmp_stream *stream)
+{
+	close(stream->rtmp.m_sb.sb_socket);
+	stream->rtmp.m_sb.sb_socket = -1;
+	stream->write_buf_len = 0;
+	os_event_signal(stream->buffer_space_available_event);
+}
+
+void socket_thread_linux_wake(struct rtmp_stream *stream)
+{
+	uint64_t val = 1;
+	ssize_t ret = write(stream->socket_wake_fd, &val, sizeof(val));
+	UNUSED_PARAMETER(ret);
+}
+
+static void socket_thread_linux_drain_wake(struct rtmp_stream *stream)
+{
+	uint64_t val;
+	ssize_t ret = read(stream->socket_wake_fd, &val, sizeof(val));
+	UNUSED_PARAMETER(ret);
+}
+
+static bool socket_event(struct rtmp_stream *stream, uint32_t events,
+			 bool *can_write, uint64_t last_send_time)
+{
+	int fd = stream->rtmp.m_sb.sb_socket;
+
+	if (events & EPOLLOUT)
+		*can_write = true;
+
+	if (events & EPOLLIN) {
+		char discard[16384];
+
+		/* edge triggered, so everything has to be read now */
+		for (;;) {
+			ssize_t ret = recv(fd, discard, sizeof(discard),
+					   MSG_DONTWAIT);
+			if (ret > 0)
+				continue;
+			if (ret == -1 && (errno == EAGAIN || errno == EINTR))
+				break;
+			if (ret == 0) {
+				events |= EPOLLRDHUP;
+				break;
+			}
+
+			blog(LOG_ERROR,
+			     "socket_thread_linux: Socket error, recv() "
+			     "returned %d, errno %d",
+			     (int)ret, errno);
+			stream->rtmp.last_error_code = errno;
+			fatal_sock_shutdown(stream);
+			return false;
+		}
+	}
+
+	if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+		int err_code = 0;
+		socklen_t size = sizeof(err_code);
+
+		getsockopt(fd, SOL_SOCKET, SO_ERROR, &err_code, &size);
+
+		if (last_send_time) {
+			uint32_t diff =
+				(os_gettime_ns() / 1000000) - last_send_time;
+
+			blog(LOG_ERROR,
+			     "socket_thread_linux: Received hangup, %u ms "
+			     "since last send (buffer: %d / %d)",
+			     diff, (int)stream->write_buf_len,
+			     (int)stream->write_buf_size);
+		}
+
+		if (os_event_try(stream->stop_event) != EAGAIN)
+			blog(LOG_ERROR,
+			     "socket_thread_linux: Aborting due to hangup "
+			     "during shutdown, %d bytes lost, error %d",
+			     (int)stream->write_buf_len, err_code);
+		else
+			blog(LOG_ERROR,
+			     "socket_thread_linux: Aborting due to hangup, "
+			     "error %d",
+			     err_code);
+
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return false;
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+#define TCP_INFO_INTERVAL_MS 250
+
+bool rtmp_get_tcp_stats(int fd, struct rtmp_tcp_stats *stats)
+{
+	struct tcp_info ti;
+	socklen_t size = sizeof(ti);
+	int queued = 0;
+	int notsent = 0;
+	int sndbuf = 0;
+
+	if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &ti, &size) != 0)
+		return false;
+
+	ioctl(fd, SIOCOUTQ, &queued);
+	ioctl(fd, SIOCOUTQNSD, &notsent);
+
+	size = sizeof(sndbuf);
+	getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, &size);
+
+	stats->sample_ts = os_gettime_ns();
+	stats->rtt_us = ti.tcpi_rtt;
+	stats->rttvar_us = ti.tcpi_rttvar;
+	stats->snd_cwnd = ti.tcpi_snd_cwnd;
+	stats->snd_mss = ti.tcpi_snd_mss;
+	stats->unacked = ti.tcpi_unacked;
+	stats->total_retrans = ti.tcpi_total_retrans;
+	stats->queued_bytes = queued;
+	stats->notsent_bytes = notsent;
+	stats->sndbuf = sndbuf;
+	stats->samples++;
+	return true;
+}
+
+/* Linux has no ideal send backlog notification like Windows does, so the
+ * congestion window from TCP_INFO is used to estimate how much data should
+ * be allowed to queue up in the kernel.  The send buffer is normally
+ * autotuned to about twice the congestion window, so this only ever steps
+ * in if autotuning falls short (setting it turns autotuning off). */
+static void sample_tcp_info(struct rtmp_stream *stream)
+{
+	struct rtmp_tcp_stats *stats = &stream->tcp_stats;
+
+	if (!rtmp_get_tcp_stats(stream->rtmp.m_sb.sb_socket, stats))
+		return;
+
+	os_atomic_set_long(&stream->notsent_bytes, stats->notsent_bytes);
+
+	if (!stream->disable_send_window_optimization) {
+		uint64_t ideal =
+			(uint64_t)stats->snd_cwnd * stats->snd_mss * 2;
+
+		if (ideal > INT_MAX)
+			ideal = INT_MAX;
+
+		if (adjust_sndbuf_size(stream, (int)ideal))
+			blog(LOG_INFO,
+			     "socket_thread_linux: Increasing send buffer to "
+			     "%d (cwnd %u, rtt %u us, buffer: %d / %d)",
+			     (int)ideal, stats->snd_cwnd, stats->rtt_us,
+			     (int)stream->write_buf_len,
+			     (int)stream->write_buf_size);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* The bandwidth estimator runs on the send thread and looks at the kernel
+ * side of the connection rather than at our own packet queue, so that it
+ * notices a bottleneck as soon as the round trip time starts to grow,
+ * well before enough data has backed up for frames to be dropped.
+ *
+ * Bytes the peer has acknowledged are everything handed to the kernel minus
+ * what is still in the socket's send queue; while the connection has a
+ * backlog, the rate at which that grows is the rate the path delivers. */
+
+#define BWE_INTERVAL_NS 100000000ULL
+#define BWE_MIN_QUEUE_DELAY_US 50000
+#define BWE_MAX_QUEUE_DELAY_US 200000
+
+void rtmp_bwe_reset(struct rtmp_bwe *bwe)
+{
+	memset(bwe, 0, sizeof(*bwe));
+}
+
+/* windowed minimum: restarting from the current rtt once the window ends
+ * would pick up an already inflated rtt under sustained congestion and hide
+ * the queue delay, so the minimum of the per second minimums is used */
+static uint32_t update_min_rtt(struct rtmp_bwe *bwe, uint64_t now,
+			       uint32_t rtt_us)
+{
+	uint64_t sec = now / 1000000000ULL;
+	size_t cur = (size_t)(sec % RTMP_BWE_MIN_RTT_SECONDS);
+	uint32_t min_rtt = rtt_us;
+
+	if (bwe->min_rtt_sec[cur] != sec || !bwe->min_rtt_bucket_us[cur] ||
+	    rtt_us < bwe->min_rtt_bucket_us[cur]) {
+		bwe->min_rtt_sec[cur] = sec;
+		bwe->min_rtt_bucket_us[cur] = rtt_us;
+	}
+
+	for (size_t i = 0; i < RTMP_BWE_MIN_RTT_SECONDS; i++) {
+		uint32_t bucket = bwe->min_rtt_bucket_us[i];
+
+		if (bucket && bucket < min_rtt &&
+		    sec - bwe->min_rtt_sec[i] < RTMP_BWE_MIN_RTT_SECONDS)
+			min_rtt = bucket;
+	}
+
+	return min_rtt;
+}
+
+void rtmp_bwe_sample(struct rtmp_stream *stream)
+{
+	struct rtmp_bwe *bwe = &stream->bwe;
+	struct rtmp_tcp_stats tcp;
+	uint64_t now = os_gettime_ns();
+	uint64_t written, acked;
+	uint32_t queue_delay_us = 0;
+	uint32_t retrans;
+	uint64_t window;
+	long cwnd_kbps;
+	bool backlogged;
+	bool congested;
+
+	if (now - bwe->sample_ts < BWE_INTERVAL_NS)
+		return;
+	if (!rtmp_get_tcp_stats(stream->rtmp.m_sb.sb_socket, &tcp))
+		return;
+	if (!tcp.rtt_us)
+		return;
+
+	written = stream->total_bytes_sent;
+	if (stream->new_socket_loop) {
+		pthread_mutex_lock(&stream->write_buf_mutex);
+		written -= stream->write_buf_len;
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+	}
+	acked = written > (uint64_t)tcp.queued_bytes
+			? written - (uint64_t)tcp.queued_bytes
+			: 0;
+
+	/* with less queued than a window's worth, the stream is limited by
+	 * the encoder rather than by the path, and the delivery rate says
+	 * nothing about the available bandwidth */
+	window = (uint64_t)tcp.snd_cwnd * tcp.snd_mss;
+	backlogged = (uint64_t)tcp.queued_bytes >= window;
+
+	if (bwe->sample_ts && backlogged && acked > bwe->acked_bytes) {
+		long kbps = (long)((acked - bwe->acked_bytes) * 8000000ULL /
+				   (now - bwe->sample_ts));
+
+		bwe->delivered_kbps =
+			bwe->delivered_kbps
+				? (bwe->delivered_kbps * 3 + kbps) / 4
+				: kbps;
+	} else if (!backlogged) {
+		bwe->delivered_kbps = 0;
+	}
+
+	bwe->min_rtt_us = update_min_rtt(bwe, now, tcp.rtt_us);
+
+	if (tcp.rtt_us > bwe->min_rtt_us)
+		queue_delay_us = tcp.rtt_us - bwe->min_rtt_us;
+
+	retrans = bwe->sample_ts ? tcp.total_retrans - bwe->tcp.total_retrans
+				 : 0;
+	cwnd_kbps = (long)(window * 8000 / tcp.rtt_us);
+
+	congested = (backlogged && retrans > 0) ||
+		    (queue_delay_us > BWE_MIN_QUEUE_DELAY_US &&
+		     queue_delay_us > bwe->min_rtt_us);
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	bwe->est_kbps = bwe->delivered_kbps && bwe->delivered_kbps < cwnd_kbps
+				? bwe->delivered_kbps
+				: cwnd_kbps;
+	bwe->congested = congested;
+	bwe->congestion = queue_delay_us >= BWE_MAX_QUEUE_DELAY_US
+				  ? 1.0f
+				  : (float)queue_delay_us /
+					    (float)BWE_MAX_QUEUE_DELAY_US;
+	pthread_mutex_unlock(&stream->dbr_mutex);
+
+	bwe->sample_ts = now;
+	bwe->acked_bytes = acked;
+	bwe->tcp = tcp;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline bool would_block(struct rtmp_stream *stream, int ret)
+{
+#if defined(CRYPTO) && !defined(NO_SSL) && defined(USE_MBEDTLS)
+	if (stream->rtmp.m_sb.sb_ssl)
+		return ret == MBEDTLS_ERR_SSL_WANT_WRITE ||
+		       ret == MBEDTLS_ERR_SSL_WANT_READ;
+#else
+	UNUSED_PARAMETER(stream);
+#endif
+	return ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+enum data_ret { RET_BREAK, RET_FATAL, RET_CONTINUE };
+
+static enum data_ret write_data(struct rtmp_stream *stream, bool *can_write,
+				uint64_t *last_send_time,
+				size_t latency_packet_size, int delay_time)
+{
+	bool exit_loop = false;
+	size_t send_len;
+	int ret;
+
+	pthread_mutex_lock(&stream->write_buf_mutex);
+
+	if (!stream->write_buf_len) {
+		/* the buffer can be emptied in a previous loop cycle, the
+		 * wake event only says that data arrived at some point */
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		return RET_BREAK;
+	}
+
+	send_len = stream->write_buf_len;
+	if (stream->low_latency_mode && send_len > latency_packet_size)
+		send_len = latency_packet_size;
+
+	ret = RTMPSockBuf_Send(&stream->rtmp.m_sb,
+			       (const char *)stream->write_buf, (int)send_len);
+
+	if (ret > 0) {
+		if (stream->write_buf_len - ret)
+			memmove(stream->write_buf, stream->write_buf + ret,
+				stream->write_buf_len - ret);
+		stream->write_buf_len -= ret;
+
+		*last_send_time = os_gettime_ns() / 1000000;
+
+		os_event_signal(stream->buffer_space_available_event);
+
+	} else if (would_block(stream, ret)) {
+		*can_write = false;
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		return RET_BREAK;
+
+	} else {
+		/* connection closed, or connection was aborted / socket
+		 * closed / etc, that's a fatal error. */
+		int err_code = ret == 0 ? 0 : errno;
+
+		blog(LOG_ERROR,
+		     "socket_thread_linux: Socket error, send() returned %d, "
+		     "errno %d",
+		     ret, err_code);
+
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return RET_FATAL;
+	}
+
+	/* finish writing for now */
+	if (stream->write_buf_len <= 1000)
+		exit_loop = true;
+
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+
+	if (delay_time)
+		os_sleep_ms(delay_time);
+
+	return exit_loop ? RET_BREAK : RET_CONTINUE;
+}
+
+#define LATENCY_FACTOR 20
+
+static inline int next_sample_timeout(uint64_t next_sample)
+{
+	uint64_t now = os_gettime_ns();
+	return now >= next_sample ? 0 : (int)((next_sample - now) / 1000000);
+}
+
+static inline void socket_thread_linux_internal(struct rtmp_stream *stream)
+{
+	int fd = stream->rtmp.m_sb.sb_socket;
+	struct epoll_event events[2];
+	struct epoll_event ev = {0};
+	bool can_write = false;
+
+	int delay_time;
+	size_t latency_packet_size;
+	uint64_t last_send_time = 0;
+	uint64_t next_sample = 0;
+	int epfd;
+
+	os_set_thread_name("rtmp-stream: socket_thread_linux");
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd == -1) {
+		blog(LOG_ERROR, "socket_thread_linux: epoll_create1 failed, "
+				"errno %d",
+		     errno);
+		fatal_sock_shutdown(stream);
+		return;
+	}
+
+	/* edge triggered, EPOLLOUT works like FD_WRITE on Windows: it only
+	 * fires again once a send has hit EAGAIN */
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	ev.data.fd = fd;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+		blog(LOG_ERROR, "socket_thread_linux: Failed to add socket, "
+				"errno %d",
+		     errno);
+		fatal_sock_shutdown(stream);
+		goto exit;
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.fd = stream->socket_wake_fd;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, stream->socket_wake_fd, &ev);
+
+	if (stream->low_latency_mode) {
+		delay_time = 1000 / LATENCY_FACTOR;
+		latency_packet_size =
+			stream->write_buf_size / (LATENCY_FACTOR - 2);
+	} else {
+		latency_packet_size = stream->write_buf_size;
+		delay_time = 0;
+	}
+
+	if (stream->disable_send_window_optimization)
+		blog(LOG_INFO, "socket_thread_linux: Send window "
+			       "optimization disabled by user.");
+
+	for (;;) {
+		int count;
+
+		if (os_event_try(stream->send_thread_signaled_exit) != EAGAIN) {
+			pthread_mutex_lock(&stream->write_buf_mutex);
+			if (stream->write_buf_len == 0) {
+				pthread_mutex_unlock(&stream->write_buf_mutex);
+				os_event_reset(
+					stream->send_thread_signaled_exit);
+				break;
+			}
+
+			pthread_mutex_unlock(&stream->write_buf_mutex);
+		}
+
+		count = epoll_wait(epfd, events, 2,
+				   next_sample_timeout(next_sample));
+		if (count == -1) {
+			if (errno == EINTR)
+				continue;
+
+			blog(LOG_ERROR, "socket_thread_linux: Aborting due "
+					"to epoll_wait failure, errno %d",
+			     errno);
+			fatal_sock_shutdown(stream);
+			goto exit;
+		}
+
+		for (int i = 0; i < count; i++) {
+			if (events[i].data.fd == stream->socket_wake_fd) {
+				socket_thread_linux_drain_wake(stream);
+
+			} else if (!socket_event(stream, events[i].events,
+						 &can_write, last_send_time)) {
+				goto exit;
+			}
+		}
+
+		if (os_gettime_ns() >= next_sample) {
+			sample_tcp_info(stream);
+			next_sample = os_gettime_ns() +
+				      TCP_INFO_INTERVAL_MS * 1000000ULL;
+		}
+
+		if (can_write) {
+			for (;;) {
+				enum data_ret ret = write_data(
+					stream, &can_write, &last_send_time,
+					latency_packet_size, delay_time);
+
+				switch (ret) {
+				case RET_BREAK:
+					goto exit_write_loop;
+				case RET_FATAL:
+					goto exit;
+				case RET_CONTINUE:;
+				}
+			}
+		}
+	exit_write_loop:;
+	}
+
+	blog(LOG_INFO,
+	     "socket_thread_linux: Normal exit (rtt %u us, retransmits %u, "
+	     "send buffer %d)",
+	     stream->tcp_stats.rtt_us, stream->tcp_stats.total_retrans,
+	     stream->tcp_stats.sndbuf);
+
+exit:
+	close(epfd);
+}
+
+void *socket_thread_linux(void *data)
+{
+	struct rtmp_stream *stream = data;
+	socket_thread_linux_internal(stream);
+	return NULL;
+}
+#endif
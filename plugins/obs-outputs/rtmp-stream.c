@@ -17,6 +17,10 @@
 
 #include "rtmp-stream.h"
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
 #ifndef SEC_TO_NSEC
 #define SEC_TO_NSEC 1000000000ULL
 #endif
@@ -134,6 +138,11 @@ static void rtmp_stream_destroy(void *data)
 	os_event_destroy(stream->send_thread_signaled_exit);
 	pthread_mutex_destroy(&stream->write_buf_mutex);
 
+#ifdef __linux__
+	if (stream->socket_wake_fd != -1)
+		close(stream->socket_wake_fd);
+#endif
+
 	if (stream->write_buf)
 		bfree(stream->write_buf);
 	bfree(stream);
@@ -144,6 +153,9 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 	struct rtmp_stream *stream = bzalloc(sizeof(struct rtmp_stream));
 	stream->output = output;
 	pthread_mutex_init_value(&stream->packets_mutex);
+#ifdef __linux__
+	stream->socket_wake_fd = -1;
+#endif
 
 	RTMP_LogSetCallback(log_rtmp);
 	RTMP_Init(&stream->rtmp);
@@ -184,6 +196,13 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 		warn("Failed to initialize socket exit event");
 		goto fail;
 	}
+#ifdef __linux__
+	stream->socket_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (stream->socket_wake_fd == -1) {
+		warn("Failed to initialize socket wake descriptor");
+		goto fail;
+	}
+#endif
 
 	UNUSED_PARAMETER(settings);
 	return stream;
@@ -363,6 +382,15 @@ static void droptest_cap_data_rate(struct rtmp_stream *stream, size_t size)
 }
 #endif
 
+static inline void signal_socket_thread(struct rtmp_stream *stream)
+{
+	os_event_signal(stream->buffer_has_data_event);
+#ifdef __linux__
+	/* the linux loop sleeps in epoll, which can't wait on an os_event */
+	socket_thread_linux_wake(stream);
+#endif
+}
+
 static int socket_queue_data(RTMPSockBuf *sb, const char *data, int len,
 			     void *arg)
 {
@@ -393,7 +421,7 @@ retry_send:
 
 	pthread_mutex_unlock(&stream->write_buf_mutex);
 
-	os_event_signal(stream->buffer_has_data_event);
+	signal_socket_thread(stream);
 
 	return len;
 }
@@ -617,6 +645,10 @@ static void *send_thread(void *data)
 			dbr_add_frame(stream, &dbr_frame);
 			pthread_mutex_unlock(&stream->dbr_mutex);
 		}
+
+#ifdef __linux__
+		rtmp_bwe_sample(stream);
+#endif
 	}
 
 	bool encode_error = os_atomic_load_bool(&stream->encode_error);
@@ -631,7 +663,7 @@ static void *send_thread(void *data)
 
 	if (stream->new_socket_loop) {
 		os_event_signal(stream->send_thread_signaled_exit);
-		os_event_signal(stream->buffer_has_data_event);
+		signal_socket_thread(stream);
 		pthread_join(stream->socket_thread, NULL);
 		stream->socket_thread_active = false;
 		stream->rtmp.m_bCustomSend = false;
@@ -759,7 +791,7 @@ static inline bool reset_semaphore(struct rtmp_stream *stream)
 
 #define MIN_SENDBUF_SIZE 65535
 
-static void adjust_sndbuf_size(struct rtmp_stream *stream, int new_size)
+bool adjust_sndbuf_size(struct rtmp_stream *stream, int new_size)
 {
 	int cur_sendbuf_size = new_size;
 	socklen_t int_size = sizeof(int);
@@ -771,7 +803,10 @@ static void adjust_sndbuf_size(struct rtmp_stream *stream, int new_size)
 		cur_sendbuf_size = new_size;
 		setsockopt(stream->rtmp.m_sb.sb_socket, SOL_SOCKET, SO_SNDBUF,
 			   (const char *)&cur_sendbuf_size, int_size);
+		return true;
 	}
+
+	return false;
 }
 
 static int init_send(struct rtmp_stream *stream)
@@ -861,6 +896,11 @@ static int init_send(struct rtmp_stream *stream)
 #ifdef _WIN32
 		ret = pthread_create(&stream->socket_thread, NULL,
 				     socket_thread_windows, stream);
+#elif defined(__linux__)
+		memset(&stream->tcp_stats, 0, sizeof(stream->tcp_stats));
+		os_atomic_set_long(&stream->notsent_bytes, 0);
+		ret = pthread_create(&stream->socket_thread, NULL,
+				     socket_thread_linux, stream);
 #else
 		warn("New socket loop not supported on this platform");
 		return OBS_OUTPUT_ERROR;
@@ -1080,6 +1120,9 @@ static bool init_connect(struct rtmp_stream *stream)
 	stream->dbr_inc_bitrate = stream->dbr_orig_bitrate / 10;
 	stream->dbr_inc_timeout = 0;
 	stream->dbr_enabled = obs_data_get_bool(settings, OPT_DYN_BITRATE);
+#ifdef __linux__
+	rtmp_bwe_reset(&stream->bwe);
+#endif
 
 	caps = obs_encoder_get_caps(venc);
 	if ((caps & OBS_ENCODER_CAP_DYN_BITRATE) == 0) {
@@ -1294,6 +1337,39 @@ static bool dbr_bitrate_lowered(struct rtmp_stream *stream)
 	return true;
 }
 
+#ifdef __linux__
+/* give the encoder time to act on a change before judging it again */
+#define DBR_BWE_HOLD_NS (2ULL * SEC_TO_NSEC)
+
+static bool dbr_bwe_bitrate_lowered(struct rtmp_stream *stream)
+{
+	struct rtmp_bwe *bwe = &stream->bwe;
+	uint64_t t = os_gettime_ns();
+	long est_bitrate;
+
+	if (!bwe->congested || !bwe->est_kbps)
+		return false;
+	if (t - bwe->last_lowered_ts < DBR_BWE_HOLD_NS)
+		return false;
+
+	est_bitrate = (bwe->est_kbps - stream->audio_bitrate) / 100 * 100;
+	if (est_bitrate < 50)
+		est_bitrate = 50;
+	if (est_bitrate >= stream->dbr_cur_bitrate)
+		return false;
+
+	bwe->last_lowered_ts = t;
+	stream->dbr_prev_bitrate = 0;
+	stream->dbr_cur_bitrate = est_bitrate;
+	stream->dbr_inc_timeout = t + DBR_INC_TIMER;
+	info("bitrate decreased to: %ld (estimated bandwidth: %ld kbps, "
+	     "rtt: %u ms, min rtt: %u ms)",
+	     stream->dbr_cur_bitrate, bwe->est_kbps, bwe->tcp.rtt_us / 1000,
+	     bwe->min_rtt_us / 1000);
+	return true;
+}
+#endif
+
 static void dbr_set_bitrate(struct rtmp_stream *stream)
 {
 	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
@@ -1333,6 +1409,22 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 					 : stream->drop_threshold_usec;
 
 	if (!pframes && stream->dbr_enabled) {
+#ifdef __linux__
+		/* the estimator sees the path filling up before any packets
+		 * back up here, so it gets to lower the bitrate first */
+		bool bitrate_changed;
+
+		pthread_mutex_lock(&stream->dbr_mutex);
+		bitrate_changed = dbr_bwe_bitrate_lowered(stream);
+		if (stream->bwe.congested && stream->dbr_inc_timeout)
+			stream->dbr_inc_timeout = os_gettime_ns() +
+						  DBR_INC_TIMER;
+		pthread_mutex_unlock(&stream->dbr_mutex);
+
+		if (bitrate_changed)
+			dbr_set_bitrate(stream);
+#endif
+
 		if (stream->dbr_inc_timeout) {
 			uint64_t t = os_gettime_ns();
 
@@ -1515,12 +1607,37 @@ static int rtmp_stream_dropped_frames(void *data)
 static float rtmp_stream_congestion(void *data)
 {
 	struct rtmp_stream *stream = data;
+	float congestion;
 
-	if (stream->new_socket_loop)
-		return (float)stream->write_buf_len /
-		       (float)stream->write_buf_size;
-	else
-		return stream->min_priority > 0 ? 1.0f : stream->congestion;
+#ifdef __linux__
+	/* queueing delay on the path, as seen by the bandwidth estimator */
+	float path_congestion;
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	path_congestion = stream->bwe.congestion;
+	pthread_mutex_unlock(&stream->dbr_mutex);
+#else
+	float path_congestion = 0.0f;
+#endif
+
+	if (stream->new_socket_loop) {
+		size_t pending = stream->write_buf_len;
+
+#ifdef __linux__
+		/* data sitting unsent in the kernel is just as backed up */
+		long notsent = os_atomic_load_long(&stream->notsent_bytes);
+		if (notsent > 0)
+			pending += (size_t)notsent;
+#endif
+		congestion = (float)pending / (float)stream->write_buf_size;
+		if (congestion > 1.0f)
+			congestion = 1.0f;
+	} else {
+		congestion = stream->min_priority > 0 ? 1.0f
+						       : stream->congestion;
+	}
+
+	return congestion > path_congestion ? congestion : path_congestion;
 }
 
 static int rtmp_stream_connect_time(void *data)
@@ -53,6 +53,43 @@ struct dbr_frame {
 	size_t size;
 };
 
+#ifdef __linux__
+/* sampled from TCP_INFO by the linux socket loop */
+struct rtmp_tcp_stats {
+	uint64_t sample_ts;
+	uint32_t rtt_us;
+	uint32_t rttvar_us;
+	uint32_t snd_cwnd;
+	uint32_t snd_mss;
+	uint32_t unacked;
+	uint32_t total_retrans;
+	int queued_bytes;
+	int notsent_bytes;
+	int sndbuf;
+	uint64_t samples;
+};
+
+/* minimum rtt over the last RTMP_BWE_MIN_RTT_SECONDS, kept as one minimum
+ * per second */
+#define RTMP_BWE_MIN_RTT_SECONDS 10
+
+struct rtmp_bwe {
+	uint64_t sample_ts;
+	uint64_t acked_bytes;
+	uint64_t min_rtt_sec[RTMP_BWE_MIN_RTT_SECONDS];
+	uint32_t min_rtt_bucket_us[RTMP_BWE_MIN_RTT_SECONDS];
+	uint32_t min_rtt_us;
+	long delivered_kbps;
+	struct rtmp_tcp_stats tcp;
+
+	/* protected by dbr_mutex */
+	long est_kbps;
+	bool congested;
+	float congestion;
+	uint64_t last_lowered_ts;
+};
+#endif
+
 struct rtmp_stream {
 	obs_output_t *output;
 
@@ -128,8 +165,25 @@ struct rtmp_stream {
 	os_event_t *buffer_has_data_event;
 	os_event_t *socket_available_event;
 	os_event_t *send_thread_signaled_exit;
+
+#ifdef __linux__
+	int socket_wake_fd;
+	struct rtmp_tcp_stats tcp_stats;
+	struct rtmp_bwe bwe;
+
+	/* tcp_stats.notsent_bytes, for reading outside of the socket thread */
+	volatile long notsent_bytes;
+#endif
 };
 
+bool adjust_sndbuf_size(struct rtmp_stream *stream, int new_size);
+
 #ifdef _WIN32
 void *socket_thread_windows(void *data);
+#elif defined(__linux__)
+void *socket_thread_linux(void *data);
+void socket_thread_linux_wake(struct rtmp_stream *stream);
+bool rtmp_get_tcp_stats(int fd, struct rtmp_tcp_stats *stats);
+void rtmp_bwe_reset(struct rtmp_bwe *bwe);
+void rtmp_bwe_sample(struct rtmp_stream *stream);
 #endif
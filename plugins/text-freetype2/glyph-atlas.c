@@ -0,0 +1,422 @@
+/******************************************************************************
+Copyright (C) 2021 by the OBS Project
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-module.h>
+#include <util/threading.h>
+#include <util/darray.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include "text-freetype2.h"
+#include "glyph-atlas.h"
+
+extern uint32_t texbuf_w, texbuf_h;
+
+struct atlas_shelf {
+	uint32_t y;
+	uint32_t height;
+	uint32_t x;
+	uint64_t last_used;
+	DARRAY(FT_UInt) glyphs;
+};
+
+struct glyph_atlas {
+	char *path;
+	FT_Long face_index;
+	uint16_t size;
+	bool antialiasing;
+	long refs;
+
+	pthread_mutex_t mutex;
+	FT_Face face;
+	uint32_t line_height;
+
+	struct glyph_info *glyphs[num_cache_slots];
+	DARRAY(struct atlas_shelf) shelves;
+	uint32_t next_shelf_y;
+	uint64_t use_counter;
+	bool out_of_space_logged;
+
+	uint8_t *texbuf;
+	gs_texture_t *tex;
+	bool dirty;
+	volatile long generation;
+};
+
+static pthread_mutex_t atlas_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct glyph_atlas *) atlas_list;
+
+/* ------------------------------------------------------------------------- */
+
+static inline FT_Render_Mode atlas_render_mode(struct glyph_atlas *atlas)
+{
+	return atlas->antialiasing ? FT_RENDER_MODE_NORMAL
+				   : FT_RENDER_MODE_MONO;
+}
+
+static inline uint8_t get_pixel_value(const unsigned char *buf_row,
+				      FT_Render_Mode render_mode,
+				      const uint32_t x)
+{
+	if (render_mode == FT_RENDER_MODE_NORMAL) {
+		return buf_row[x];
+	}
+
+	const uint32_t byte_index = x / 8;
+	const uint8_t bit_index = x % 8;
+	const bool pixel_set = (buf_row[byte_index] >> (7 - bit_index)) & 1;
+	return pixel_set ? 255 : 0;
+}
+
+static void rasterize(struct glyph_atlas *atlas, FT_GlyphSlot slot,
+		      const FT_Render_Mode render_mode, const uint32_t dx,
+		      const uint32_t dy)
+{
+	/**
+	 * The pitch's absolute value is the number of bytes taken by one bitmap
+	 * row, including padding.
+	 *
+	 * Source: https://www.freetype.org/freetype2/docs/reference/ft2-basic_types.html
+	 */
+	const int pitch = abs(slot->bitmap.pitch);
+
+	for (uint32_t y = 0; y < slot->bitmap.rows; y++) {
+		const uint32_t row_start = y * pitch;
+		const uint32_t row = (dy + y) * texbuf_w;
+
+		for (uint32_t x = 0; x < slot->bitmap.width; x++) {
+			const uint32_t row_pixel_position = dx + x;
+			const uint8_t pixel_value =
+				get_pixel_value(&slot->bitmap.buffer[row_start],
+						render_mode, x);
+			atlas->texbuf[row_pixel_position + row] = pixel_value;
+		}
+	}
+}
+
+static struct glyph_info *init_glyph(FT_GlyphSlot slot, const uint32_t dx,
+				     const uint32_t dy, const uint32_t g_w,
+				     const uint32_t g_h, const uint32_t shelf)
+{
+	struct glyph_info *glyph = bzalloc(sizeof(struct glyph_info));
+	glyph->u = (float)dx / (float)texbuf_w;
+	glyph->u2 = (float)(dx + g_w) / (float)texbuf_w;
+	glyph->v = (float)dy / (float)texbuf_h;
+	glyph->v2 = (float)(dy + g_h) / (float)texbuf_h;
+	glyph->w = g_w;
+	glyph->h = g_h;
+	glyph->yoff = slot->bitmap_top;
+	glyph->xoff = slot->bitmap_left;
+	glyph->xadv = slot->advance.x >> 6;
+	glyph->shelf = shelf;
+
+	return glyph;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void evict_shelf(struct glyph_atlas *atlas, struct atlas_shelf *shelf)
+{
+	for (size_t i = 0; i < shelf->glyphs.num; i++) {
+		FT_UInt glyph_index = shelf->glyphs.array[i];
+		bfree(atlas->glyphs[glyph_index]);
+		atlas->glyphs[glyph_index] = NULL;
+	}
+
+	for (uint32_t y = 0; y < shelf->height; y++)
+		memset(atlas->texbuf + (shelf->y + y) * texbuf_w, 0, texbuf_w);
+
+	da_resize(shelf->glyphs, 0);
+	shelf->x = 0;
+	atlas->dirty = true;
+	os_atomic_inc_long(&atlas->generation);
+}
+
+/* finds room for a g_w x g_h glyph: best fitting shelf with space left, then
+ * a new shelf, then the least recently used shelf that was not touched by
+ * the current caching pass */
+static struct atlas_shelf *find_shelf(struct glyph_atlas *atlas, uint32_t g_w,
+				      uint32_t g_h)
+{
+	struct atlas_shelf *best = NULL;
+	struct atlas_shelf *lru = NULL;
+
+	for (size_t i = 0; i < atlas->shelves.num; i++) {
+		struct atlas_shelf *shelf = atlas->shelves.array + i;
+
+		if (shelf->height < g_h)
+			continue;
+
+		if (shelf->x + g_w < texbuf_w &&
+		    (!best || shelf->height < best->height))
+			best = shelf;
+
+		if (shelf->last_used != atlas->use_counter &&
+		    (!lru || shelf->last_used < lru->last_used))
+			lru = shelf;
+	}
+
+	if (best)
+		return best;
+
+	uint32_t height = g_h > atlas->line_height ? g_h : atlas->line_height;
+	if (atlas->next_shelf_y + height < texbuf_h) {
+		struct atlas_shelf *shelf = da_push_back_new(atlas->shelves);
+		shelf->y = atlas->next_shelf_y;
+		shelf->height = height;
+		atlas->next_shelf_y += height + 1;
+		return shelf;
+	}
+
+	if (lru && g_w < texbuf_w) {
+		evict_shelf(atlas, lru);
+		return lru;
+	}
+
+	return NULL;
+}
+
+static void cache_glyph(struct glyph_atlas *atlas, FT_UInt glyph_index)
+{
+	const FT_Render_Mode render_mode = atlas_render_mode(atlas);
+	const FT_Int32 load_mode = render_mode == FT_RENDER_MODE_MONO
+					   ? FT_LOAD_TARGET_MONO
+					   : FT_LOAD_DEFAULT;
+	FT_GlyphSlot slot = atlas->face->glyph;
+	struct atlas_shelf *shelf;
+
+	FT_Load_Glyph(atlas->face, glyph_index, load_mode);
+	FT_Render_Glyph(slot, render_mode);
+
+	const uint32_t g_w = slot->bitmap.width;
+	const uint32_t g_h = slot->bitmap.rows;
+
+	shelf = find_shelf(atlas, g_w, g_h);
+	if (!shelf) {
+		if (!atlas->out_of_space_logged) {
+			blog(LOG_WARNING,
+			     "Out of space trying to render glyphs");
+			atlas->out_of_space_logged = true;
+		}
+		return;
+	}
+
+	atlas->glyphs[glyph_index] =
+		init_glyph(slot, shelf->x, shelf->y, g_w, g_h,
+			   (uint32_t)(shelf - atlas->shelves.array));
+	rasterize(atlas, slot, render_mode, shelf->x, shelf->y);
+	da_push_back(shelf->glyphs, &glyph_index);
+
+	shelf->x += g_w + 1;
+	shelf->last_used = atlas->use_counter;
+	atlas->dirty = true;
+}
+
+static void upload_atlas(struct glyph_atlas *atlas)
+{
+	obs_enter_graphics();
+
+	if (!atlas->tex)
+		atlas->tex = gs_texture_create(texbuf_w, texbuf_h, GS_A8, 1,
+					       NULL, GS_DYNAMIC);
+	if (atlas->tex)
+		gs_texture_set_image(atlas->tex, atlas->texbuf, texbuf_w,
+				     false);
+
+	obs_leave_graphics();
+
+	atlas->dirty = false;
+}
+
+uint32_t glyph_atlas_cache(struct glyph_atlas *atlas, const wchar_t *text)
+{
+	uint32_t max_h = 0;
+
+	if (!atlas || !text)
+		return 0;
+
+	atlas->use_counter++;
+
+	for (const wchar_t *ch = text; *ch; ch++) {
+		const FT_UInt glyph_index = FT_Get_Char_Index(atlas->face, *ch);
+		struct glyph_info *glyph;
+
+		if (glyph_index >= num_cache_slots)
+			continue;
+
+		glyph = atlas->glyphs[glyph_index];
+		if (!glyph) {
+			cache_glyph(atlas, glyph_index);
+			glyph = atlas->glyphs[glyph_index];
+			if (!glyph)
+				continue;
+		}
+
+		atlas->shelves.array[glyph->shelf].last_used =
+			atlas->use_counter;
+		if ((uint32_t)glyph->h > max_h)
+			max_h = glyph->h;
+	}
+
+	if (atlas->dirty)
+		upload_atlas(atlas);
+
+	return max_h;
+}
+
+const struct glyph_info *glyph_atlas_find(struct glyph_atlas *atlas,
+					  wchar_t ch)
+{
+	FT_UInt glyph_index = FT_Get_Char_Index(atlas->face, ch);
+	return glyph_index < num_cache_slots ? atlas->glyphs[glyph_index]
+					     : NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline bool atlas_matches(const struct glyph_atlas *atlas,
+				 const char *path, FT_Long face_index,
+				 uint16_t size, bool antialiasing)
+{
+	return atlas->face_index == face_index && atlas->size == size &&
+	       atlas->antialiasing == antialiasing &&
+	       strcmp(atlas->path, path) == 0;
+}
+
+static void atlas_destroy(struct glyph_atlas *atlas)
+{
+	for (uint32_t i = 0; i < num_cache_slots; i++)
+		bfree(atlas->glyphs[i]);
+	for (size_t i = 0; i < atlas->shelves.num; i++)
+		da_free(atlas->shelves.array[i].glyphs);
+	da_free(atlas->shelves);
+
+	if (atlas->tex) {
+		obs_enter_graphics();
+		gs_texture_destroy(atlas->tex);
+		obs_leave_graphics();
+	}
+
+	if (atlas->face)
+		FT_Done_Face(atlas->face);
+
+	pthread_mutex_destroy(&atlas->mutex);
+	bfree(atlas->texbuf);
+	bfree(atlas->path);
+	bfree(atlas);
+}
+
+static struct glyph_atlas *atlas_create(const char *path, FT_Long face_index,
+					uint16_t size, bool antialiasing)
+{
+	struct glyph_atlas *atlas = bzalloc(sizeof(struct glyph_atlas));
+
+	atlas->path = bstrdup(path);
+	atlas->face_index = face_index;
+	atlas->size = size;
+	atlas->antialiasing = antialiasing;
+	atlas->refs = 1;
+
+	if (pthread_mutex_init(&atlas->mutex, NULL) != 0) {
+		bfree(atlas->path);
+		bfree(atlas);
+		return NULL;
+	}
+
+	if (FT_New_Face(ft2_lib, path, face_index, &atlas->face) != 0) {
+		atlas->face = NULL;
+		atlas_destroy(atlas);
+		return NULL;
+	}
+
+	FT_Set_Pixel_Sizes(atlas->face, 0, size);
+	FT_Select_Charmap(atlas->face, FT_ENCODING_UNICODE);
+
+	atlas->line_height = (uint32_t)(atlas->face->size->metrics.height >> 6);
+	atlas->texbuf = bzalloc((size_t)texbuf_w * (size_t)texbuf_h);
+	return atlas;
+}
+
+struct glyph_atlas *glyph_atlas_acquire(const char *path, FT_Long face_index,
+					uint16_t size, bool antialiasing)
+{
+	struct glyph_atlas *atlas = NULL;
+
+	if (!path || !ft2_lib)
+		return NULL;
+
+	pthread_mutex_lock(&atlas_list_mutex);
+
+	for (size_t i = 0; i < atlas_list.num; i++) {
+		struct glyph_atlas *cur = atlas_list.array[i];
+		if (atlas_matches(cur, path, face_index, size, antialiasing)) {
+			atlas = cur;
+			atlas->refs++;
+			break;
+		}
+	}
+
+	if (!atlas) {
+		atlas = atlas_create(path, face_index, size, antialiasing);
+		if (atlas)
+			da_push_back(atlas_list, &atlas);
+	}
+
+	pthread_mutex_unlock(&atlas_list_mutex);
+	return atlas;
+}
+
+void glyph_atlas_release(struct glyph_atlas *atlas)
+{
+	if (!atlas)
+		return;
+
+	pthread_mutex_lock(&atlas_list_mutex);
+
+	if (--atlas->refs == 0) {
+		da_erase_item(atlas_list, &atlas);
+		if (!atlas_list.num)
+			da_free(atlas_list);
+		atlas_destroy(atlas);
+	}
+
+	pthread_mutex_unlock(&atlas_list_mutex);
+}
+
+void glyph_atlas_lock(struct glyph_atlas *atlas)
+{
+	pthread_mutex_lock(&atlas->mutex);
+}
+
+bool glyph_atlas_trylock(struct glyph_atlas *atlas)
+{
+	return pthread_mutex_trylock(&atlas->mutex) == 0;
+}
+
+void glyph_atlas_unlock(struct glyph_atlas *atlas)
+{
+	pthread_mutex_unlock(&atlas->mutex);
+}
+
+gs_texture_t *glyph_atlas_texture(struct glyph_atlas *atlas)
+{
+	return atlas ? atlas->tex : NULL;
+}
+
+long glyph_atlas_generation(struct glyph_atlas *atlas)
+{
+	return atlas ? os_atomic_load_long(&atlas->generation) : 0;
+}
@@ -0,0 +1,59 @@
+/******************************************************************************
+Copyright (C) 2021 by the OBS Project
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs-module.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+/*
+ * Process-wide glyph atlases shared between text sources.  An atlas is keyed
+ * by font file, face index, pixel size and render mode, and is reference
+ * counted.  Glyphs are rasterized into it on demand, packed into shelves;
+ * when it runs out of space the least recently used shelf is evicted and the
+ * atlas generation is bumped so that sources can rebuild their vertex
+ * buffers.
+ *
+ * Everything except glyph_atlas_texture and glyph_atlas_generation must be
+ * called with the atlas locked.  The atlas lock is always taken before the
+ * graphics context, never the other way around; code that already is in the
+ * graphics context has to use glyph_atlas_trylock.
+ */
+
+struct glyph_info;
+struct glyph_atlas;
+
+extern struct glyph_atlas *glyph_atlas_acquire(const char *path,
+					       FT_Long face_index,
+					       uint16_t size,
+					       bool antialiasing);
+extern void glyph_atlas_release(struct glyph_atlas *atlas);
+
+extern void glyph_atlas_lock(struct glyph_atlas *atlas);
+extern bool glyph_atlas_trylock(struct glyph_atlas *atlas);
+extern void glyph_atlas_unlock(struct glyph_atlas *atlas);
+
+/* rasterizes any glyphs of the text not already in the atlas, uploads the
+ * atlas if it changed, and returns the tallest glyph height of the text */
+extern uint32_t glyph_atlas_cache(struct glyph_atlas *atlas,
+				  const wchar_t *text);
+extern const struct glyph_info *glyph_atlas_find(struct glyph_atlas *atlas,
+						 wchar_t ch);
+
+extern gs_texture_t *glyph_atlas_texture(struct glyph_atlas *atlas);
+extern long glyph_atlas_generation(struct glyph_atlas *atlas);
@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "text-freetype2.h"
 #include "obs-convenience.h"
 #include "find-font.h"
+#include "glyph-atlas.h"
 
 FT_Library ft2_lib;
 
@@ -191,17 +192,8 @@ static void ft2_source_destroy(void *data)
 {
 	struct ft2_source *srcdata = data;
 
-	if (srcdata->font_face != NULL) {
-		FT_Done_Face(srcdata->font_face);
-		srcdata->font_face = NULL;
-	}
-
-	for (uint32_t i = 0; i < num_cache_slots; i++) {
-		if (srcdata->cacheglyphs[i] != NULL) {
-			bfree(srcdata->cacheglyphs[i]);
-			srcdata->cacheglyphs[i] = NULL;
-		}
-	}
+	glyph_atlas_release(srcdata->atlas);
+	srcdata->atlas = NULL;
 
 	if (srcdata->font_name != NULL)
 		bfree(srcdata->font_name);
@@ -209,8 +201,6 @@ static void ft2_source_destroy(void *data)
 		bfree(srcdata->font_style);
 	if (srcdata->text != NULL)
 		bfree(srcdata->text);
-	if (srcdata->texbuf != NULL)
-		bfree(srcdata->texbuf);
 	if (srcdata->colorbuf != NULL)
 		bfree(srcdata->colorbuf);
 	if (srcdata->text_file != NULL)
@@ -218,10 +208,6 @@ static void ft2_source_destroy(void *data)
 
 	obs_enter_graphics();
 
-	if (srcdata->tex != NULL) {
-		gs_texture_destroy(srcdata->tex);
-		srcdata->tex = NULL;
-	}
 	if (srcdata->vbuf != NULL) {
 		gs_vertexbuffer_destroy(srcdata->vbuf);
 		srcdata->vbuf = NULL;
@@ -236,13 +222,34 @@ static void ft2_source_destroy(void *data)
 	bfree(srcdata);
 }
 
+/* another source evicted glyphs this one draws with since its vertex buffer
+ * was built.  the graphics context is already held here, so the atlas can
+ * only be tried: if another source is busy with it, the atlas texture may
+ * already have changed, and nothing is drawn until the next frame */
+static bool rebuild_stale_vertex_buffer(struct ft2_source *srcdata)
+{
+	if (!srcdata->atlas || srcdata->atlas_generation ==
+				       glyph_atlas_generation(srcdata->atlas))
+		return true;
+	if (!glyph_atlas_trylock(srcdata->atlas))
+		return false;
+
+	set_up_vertex_buffer_locked(srcdata);
+	glyph_atlas_unlock(srcdata->atlas);
+	return true;
+}
+
 static void ft2_source_render(void *data, gs_effect_t *effect)
 {
 	struct ft2_source *srcdata = data;
 	if (srcdata == NULL)
 		return;
 
-	if (srcdata->tex == NULL || srcdata->vbuf == NULL)
+	if (!rebuild_stale_vertex_buffer(srcdata))
+		return;
+
+	gs_texture_t *tex = glyph_atlas_texture(srcdata->atlas);
+	if (tex == NULL || srcdata->vbuf == NULL)
 		return;
 	if (srcdata->text == NULL || *srcdata->text == 0)
 		return;
@@ -253,7 +260,7 @@ static void ft2_source_render(void *data, gs_effect_t *effect)
 	if (srcdata->drop_shadow)
 		draw_drop_shadow(srcdata);
 
-	draw_uv_vbuffer(srcdata->vbuf, srcdata->tex, srcdata->draw_effect,
+	draw_uv_vbuffer(srcdata->vbuf, tex, srcdata->draw_effect,
 			(uint32_t)wcslen(srcdata->text) * 6);
 
 	UNUSED_PARAMETER(effect);
@@ -264,6 +271,12 @@ static void ft2_video_tick(void *data, float seconds)
 	struct ft2_source *srcdata = data;
 	if (srcdata == NULL)
 		return;
+
+	/* another source evicted glyphs this one was drawing with */
+	if (srcdata->atlas && srcdata->atlas_generation !=
+				      glyph_atlas_generation(srcdata->atlas))
+		set_up_vertex_buffer(srcdata);
+
 	if (!srcdata->from_file || !srcdata->text_file)
 		return;
 
@@ -277,7 +290,6 @@ static void ft2_video_tick(void *data, float seconds)
 			else
 				load_text_from_file(srcdata,
 						    srcdata->text_file);
-			cache_glyphs(srcdata, srcdata->text);
 			set_up_vertex_buffer(srcdata);
 			srcdata->update_file = false;
 		}
@@ -300,12 +312,14 @@ static bool init_font(struct ft2_source *srcdata)
 	if (!path)
 		return false;
 
-	if (srcdata->font_face != NULL) {
-		FT_Done_Face(srcdata->font_face);
-		srcdata->font_face = NULL;
-	}
+	/* acquire before releasing so a shared atlas isn't torn down and
+	 * rebuilt when only unrelated settings changed */
+	struct glyph_atlas *old_atlas = srcdata->atlas;
+	srcdata->atlas = glyph_atlas_acquire(path, index, srcdata->font_size,
+					     srcdata->antialiasing);
+	glyph_atlas_release(old_atlas);
 
-	return FT_New_Face(ft2_lib, path, index, &srcdata->font_face) == 0;
+	return srcdata->atlas != NULL;
 }
 
 static void ft2_source_update(void *data, obs_data_t *settings)
@@ -376,8 +390,6 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	if (ft2_lib == NULL)
 		goto error;
 
-	const size_t texbuf_size = (size_t)texbuf_w * (size_t)texbuf_h;
-
 	if (srcdata->draw_effect == NULL) {
 		char *effect_file = NULL;
 		char *error_string = NULL;
@@ -403,17 +415,16 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	const bool aa_changed = srcdata->antialiasing != new_aa_setting;
 	if (aa_changed) {
 		srcdata->antialiasing = new_aa_setting;
-		if (srcdata->texbuf != NULL) {
-			memset(srcdata->texbuf, 0, texbuf_size);
-		}
-		cache_standard_glyphs(srcdata);
+		vbuf_needs_update = true;
 	}
 
 	srcdata->file_load_failed = false;
 	srcdata->from_file = from_file;
 
 	if (srcdata->font_name != NULL) {
-		if (strcmp(font_name, srcdata->font_name) == 0 &&
+		/* atlases are per render mode, so an antialiasing change
+		 * needs a different atlas */
+		if (!aa_changed && strcmp(font_name, srcdata->font_name) == 0 &&
 		    strcmp(font_style, srcdata->font_style) == 0 &&
 		    font_flags == srcdata->font_flags &&
 		    font_size == srcdata->font_size)
@@ -432,23 +443,13 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	srcdata->font_size = font_size;
 	srcdata->font_flags = font_flags;
 
-	if (!init_font(srcdata) || srcdata->font_face == NULL) {
+	if (!init_font(srcdata)) {
 		blog(LOG_WARNING, "FT2-text: Failed to load font %s",
 		     srcdata->font_name);
 		goto error;
-	} else {
-		FT_Set_Pixel_Sizes(srcdata->font_face, 0, srcdata->font_size);
-		FT_Select_Charmap(srcdata->font_face, FT_ENCODING_UNICODE);
 	}
 
-	if (srcdata->texbuf != NULL) {
-		bfree(srcdata->texbuf);
-		srcdata->texbuf = NULL;
-	}
-	srcdata->texbuf = bzalloc(texbuf_size);
-
-	if (srcdata->font_face)
-		cache_standard_glyphs(srcdata);
+	cache_standard_glyphs(srcdata);
 
 skip_font_load:
 	if (from_file) {
@@ -494,10 +495,8 @@ skip_font_load:
 		os_utf8_to_wcs_ptr(tmp, strlen(tmp), &srcdata->text);
 	}
 
-	if (srcdata->font_face) {
-		cache_glyphs(srcdata, srcdata->text);
+	if (srcdata->atlas)
 		set_up_vertex_buffer(srcdata);
-	}
 
 error:
 	obs_data_release(font_obj);
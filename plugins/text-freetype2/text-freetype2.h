@@ -21,12 +21,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <ft2build.h>
 
 #define num_cache_slots 65535
-#define src_glyph srcdata->cacheglyphs[glyph_index]
+
+struct glyph_atlas;
 
 struct glyph_info {
 	float u, v, u2, v2;
 	int32_t w, h, xoff, yoff;
 	int32_t xadv;
+	uint32_t shelf;
 };
 
 struct ft2_source {
@@ -46,19 +48,14 @@ struct ft2_source {
 
 	uint32_t cx, cy, max_h, custom_width;
 	uint32_t outline_width;
-	uint32_t texbuf_x, texbuf_y;
 	uint32_t color[2];
 	uint32_t *colorbuf;
 
 	int32_t cur_scroll, scroll_speed;
 
-	gs_texture_t *tex;
-
-	struct glyph_info *cacheglyphs[num_cache_slots];
-
-	FT_Face font_face;
+	struct glyph_atlas *atlas;
+	long atlas_generation;
 
-	uint8_t *texbuf;
 	gs_vertbuffer_t *vbuf;
 
 	gs_effect_t *draw_effect;
@@ -98,4 +95,5 @@ void cache_standard_glyphs(struct ft2_source *srcdata);
 void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs);
 
 void set_up_vertex_buffer(struct ft2_source *srcdata);
+void set_up_vertex_buffer_locked(struct ft2_source *srcdata);
 void fill_vertex_buffer(struct ft2_source *srcdata);
@@ -0,0 +1,234 @@
+/******************************************************************************
+    Copyright (C) 2021 by the OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ * Drives an async video source at a high frame rate against the regular
+ * 60 fps render loop, reporting how often the capture side and the graphics
+ * thread had to wait on each other for the async mutex.
+ *
+ * usage: async-frame-bench [seconds] [input fps] [width] [height]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define DEFAULT_SECONDS 10
+#define DEFAULT_FPS 240
+#define DEFAULT_WIDTH 1280
+#define DEFAULT_HEIGHT 720
+
+struct bench_producer {
+	obs_source_t *source;
+	uint32_t width;
+	uint32_t height;
+	uint64_t interval;
+	uint64_t end_time;
+
+	uint64_t frames;
+	uint64_t output_ns;
+	uint64_t max_output_ns;
+};
+
+static const char *bench_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Async Frame Benchmark Source";
+}
+
+static void *bench_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	return source;
+}
+
+static void bench_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static struct obs_source_info bench_source = {
+	.id = "async_frame_bench",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_ASYNC_VIDEO,
+	.get_name = bench_getname,
+	.create = bench_create,
+	.destroy = bench_destroy,
+};
+
+static bool init_obs(void)
+{
+	struct obs_video_info ovi = {0};
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return false;
+
+	ovi.adapter = 0;
+	ovi.base_width = 1920;
+	ovi.base_height = 1080;
+	ovi.fps_num = 60;
+	ovi.fps_den = 1;
+	ovi.graphics_module = DL_OPENGL;
+	ovi.output_format = VIDEO_FORMAT_NV12;
+	ovi.output_width = 1920;
+	ovi.output_height = 1080;
+
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS)
+		return false;
+
+	obs_register_source(&bench_source);
+	return true;
+}
+
+static void *producer_thread(void *data)
+{
+	struct bench_producer *p = data;
+	size_t size = (size_t)p->width * p->height * 4;
+	uint8_t *pixels = bmalloc(size);
+	uint64_t cur_time = os_gettime_ns();
+
+	struct obs_source_frame frame = {
+		.data = {[0] = pixels},
+		.linesize = {[0] = p->width * 4},
+		.width = p->width,
+		.height = p->height,
+		.format = VIDEO_FORMAT_BGRX,
+	};
+
+	os_set_thread_name("async-frame-bench: producer");
+
+	while (cur_time < p->end_time) {
+		uint64_t start, elapsed;
+
+		memset(pixels, (int)(p->frames & 0xFF), size);
+		frame.timestamp = cur_time;
+
+		start = os_gettime_ns();
+		obs_source_output_video(p->source, &frame);
+		elapsed = os_gettime_ns() - start;
+
+		p->frames++;
+		p->output_ns += elapsed;
+		if (elapsed > p->max_output_ns)
+			p->max_output_ns = elapsed;
+
+		os_sleepto_ns(cur_time += p->interval);
+	}
+
+	bfree(pixels);
+	return NULL;
+}
+
+static inline double to_ms(uint64_t ns)
+{
+	return (double)ns / 1000000.0;
+}
+
+static inline double per(uint64_t total, uint64_t count)
+{
+	return count ? (double)total / (double)count : 0.0;
+}
+
+int main(int argc, char *argv[])
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : DEFAULT_SECONDS;
+	int fps = argc > 2 ? atoi(argv[2]) : DEFAULT_FPS;
+	int width = argc > 3 ? atoi(argv[3]) : DEFAULT_WIDTH;
+	int height = argc > 4 ? atoi(argv[4]) : DEFAULT_HEIGHT;
+	struct obs_source_async_stats stats = {0};
+	struct bench_producer producer = {0};
+	uint32_t rendered_start;
+	pthread_t thread;
+	int ret = 0;
+
+	if (seconds <= 0 || fps <= 0 || width <= 0 || height <= 0) {
+		fprintf(stderr,
+			"usage: %s [seconds] [input fps] [width] [height]\n",
+			argv[0]);
+		return 1;
+	}
+
+	if (!init_obs()) {
+		fprintf(stderr, "Couldn't initialize OBS\n");
+		obs_shutdown();
+		return 1;
+	}
+
+	producer.source = obs_source_create_private("async_frame_bench",
+						    "async frame bench", NULL);
+	if (!producer.source) {
+		fprintf(stderr, "Couldn't create async_frame_bench\n");
+		ret = 1;
+		goto cleanup;
+	}
+
+	/* the source has to be on an output channel to be rendered */
+	obs_set_output_source(0, producer.source);
+
+	producer.width = (uint32_t)width;
+	producer.height = (uint32_t)height;
+	producer.interval = 1000000000ULL / (uint64_t)fps;
+	producer.end_time = os_gettime_ns() + (uint64_t)seconds * 1000000000ULL;
+
+	rendered_start = obs_get_total_frames();
+
+	if (pthread_create(&thread, NULL, producer_thread, &producer) != 0) {
+		fprintf(stderr, "Couldn't create producer thread\n");
+		ret = 1;
+		goto cleanup;
+	}
+	pthread_join(thread, NULL);
+
+	obs_source_get_async_stats(producer.source, &stats);
+
+	printf("input:                  %dx%d @ %d fps for %d s\n", width,
+	       height, fps, seconds);
+	printf("frames produced:        %llu\n",
+	       (unsigned long long)producer.frames);
+	printf("frames queued:          %llu\n",
+	       (unsigned long long)stats.frames_output);
+	printf("frames dropped:         %llu\n",
+	       (unsigned long long)stats.frames_dropped);
+	printf("queue flushes:          %llu\n",
+	       (unsigned long long)stats.flushes);
+	printf("frames rendered:        %u\n",
+	       obs_get_total_frames() - rendered_start);
+	printf("output call average:    %.3f us\n",
+	       per(producer.output_ns, producer.frames) / 1000.0);
+	printf("output call max:        %.3f ms\n",
+	       to_ms(producer.max_output_ns));
+	printf("producer lock waits:    %llu (%.3f ms total, %.3f us avg)\n",
+	       (unsigned long long)stats.producer_lock_waits,
+	       to_ms(stats.producer_lock_wait_ns),
+	       per(stats.producer_lock_wait_ns, stats.producer_lock_waits) /
+		       1000.0);
+	printf("consumer lock waits:    %llu (%.3f ms total, %.3f us avg)\n",
+	       (unsigned long long)stats.consumer_lock_waits,
+	       to_ms(stats.consumer_lock_wait_ns),
+	       per(stats.consumer_lock_wait_ns, stats.consumer_lock_waits) /
+		       1000.0);
+
+cleanup:
+	obs_set_output_source(0, NULL);
+	obs_source_release(producer.source);
+	obs_shutdown();
+	return ret;
+}
@@ -0,0 +1,167 @@
+/******************************************************************************
+    Copyright (C) 2021 by the OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ * Measures config_t lookups and saves on a config shaped like a profile's
+ * basic.ini: a number of sections with a number of keys each, plus defaults
+ * for every key.  Reports the cost of setting, getting (user values and
+ * values that fall back to defaults) and of saving after every change, once
+ * with config_save_safe and once with config_save_safe_deferred.
+ *
+ * usage: config-bench [sections] [keys] [lookups] [saves]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/config-file.h>
+#include <util/platform.h>
+#include <util/bmem.h>
+#include <util/dstr.h>
+
+#define DEFAULT_SECTIONS 24
+#define DEFAULT_KEYS 40
+#define DEFAULT_LOOKUPS 2000000
+#define DEFAULT_SAVES 200
+
+#define BENCH_FILE "config-bench.ini"
+
+static char **make_names(const char *prefix, int count)
+{
+	char **names = bzalloc(count * sizeof(char *));
+	struct dstr str = {0};
+
+	for (int i = 0; i < count; i++) {
+		dstr_printf(&str, "%s%d", prefix, i);
+		names[i] = bstrdup(str.array);
+	}
+
+	dstr_free(&str);
+	return names;
+}
+
+static void free_names(char **names, int count)
+{
+	for (int i = 0; i < count; i++)
+		bfree(names[i]);
+	bfree(names);
+}
+
+static double ns_per(uint64_t start, uint64_t count)
+{
+	return (double)(os_gettime_ns() - start) / (double)count;
+}
+
+int main(int argc, char *argv[])
+{
+	int sections = DEFAULT_SECTIONS;
+	int keys = DEFAULT_KEYS;
+	int lookups = DEFAULT_LOOKUPS;
+	int saves = DEFAULT_SAVES;
+	char **section_names;
+	char **key_names;
+	config_t *config;
+	uint64_t start;
+	int64_t sum = 0;
+
+	if (argc > 1)
+		sections = atoi(argv[1]);
+	if (argc > 2)
+		keys = atoi(argv[2]);
+	if (argc > 3)
+		lookups = atoi(argv[3]);
+	if (argc > 4)
+		saves = atoi(argv[4]);
+	if (sections <= 0 || keys <= 0 || lookups <= 0 || saves <= 0) {
+		fprintf(stderr,
+			"usage: %s [sections] [keys] [lookups] [saves]\n",
+			argv[0]);
+		return 1;
+	}
+
+	section_names = make_names("Section", sections);
+	key_names = make_names("Key", keys);
+
+	config = config_create(BENCH_FILE);
+	if (!config) {
+		fprintf(stderr, "failed to create %s\n", BENCH_FILE);
+		return 1;
+	}
+
+	/* ------------------------------------ */
+	/* set                                  */
+
+	start = os_gettime_ns();
+	for (int s = 0; s < sections; s++) {
+		for (int k = 0; k < keys; k++) {
+			config_set_default_int(config, section_names[s],
+					       key_names[k], k);
+			/* only half of the keys have user values */
+			if (k & 1)
+				config_set_int(config, section_names[s],
+					       key_names[k], s * keys + k);
+		}
+	}
+	double set_ns = ns_per(start, (uint64_t)sections * keys * 3 / 2);
+
+	/* ------------------------------------ */
+	/* get                                  */
+
+	start = os_gettime_ns();
+	for (int i = 0; i < lookups; i++) {
+		int s = (int)(((unsigned)i * 2654435761u) % (unsigned)sections);
+		int k = (int)(((unsigned)i * 40503u) % (unsigned)keys);
+
+		sum += config_get_int(config, section_names[s], key_names[k]);
+	}
+	double get_ns = ns_per(start, lookups);
+
+	/* ------------------------------------ */
+	/* save                                 */
+
+	start = os_gettime_ns();
+	for (int i = 0; i < saves; i++) {
+		config_set_int(config, "Section0", "Key1", i);
+		config_save_safe(config, "tmp", NULL);
+	}
+	double save_ns = ns_per(start, saves);
+
+	start = os_gettime_ns();
+	for (int i = 0; i < saves; i++) {
+		config_set_int(config, "Section0", "Key1", i);
+		config_save_safe_deferred(config, "tmp", NULL);
+	}
+	double deferred_ns = ns_per(start, saves);
+
+	start = os_gettime_ns();
+	config_close(config);
+	double close_ms = (double)(os_gettime_ns() - start) / 1000000.0;
+
+	os_unlink(BENCH_FILE);
+	free_names(section_names, sections);
+	free_names(key_names, keys);
+
+	printf("sections:                %d\n", sections);
+	printf("keys per section:        %d\n", keys);
+	printf("set:                     %.1f ns/call\n", set_ns);
+	printf("get:                     %.1f ns/call (checksum %lld)\n",
+	       get_ns, (long long)sum);
+	printf("config_save_safe:        %.1f us/call\n", save_ns / 1000.0);
+	printf("  deferred:              %.1f us/call\n", deferred_ns / 1000.0);
+	printf("  close (pending write): %.3f ms\n", close_ms);
+	return 0;
+}
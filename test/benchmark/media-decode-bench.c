@@ -0,0 +1,165 @@
+/******************************************************************************
+    Copyright (C) 2021 by the OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ * Plays a number of media files concurrently through media-playback (looping,
+ * in real time) and reports per-instance delivered frame rate and decode
+ * statistics, followed by the profiler output.  Meant to be run with a set of
+ * 1080p H.264 files, e.g.:
+ *
+ *   media-decode-bench -n 16 -d 30 clip1.mp4 clip2.mp4
+ *
+ * usage: media-decode-bench [-n instances] [-d seconds] [-t thread budget]
+ *                           file [file ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+#include <media-playback/media.h>
+
+#define DEFAULT_INSTANCES 16
+#define DEFAULT_SECONDS 20
+
+struct bench_instance {
+	mp_media_t media;
+	bool valid;
+	volatile long frames;
+};
+
+static void video_frame(void *opaque, struct obs_source_frame *frame)
+{
+	struct bench_instance *inst = opaque;
+	os_atomic_inc_long(&inst->frames);
+	UNUSED_PARAMETER(frame);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-n instances] [-d seconds] [-t thread budget] "
+		"file [file ...]\n",
+		name);
+}
+
+static void print_stats(int idx, const char *path,
+			struct bench_instance *inst, int seconds)
+{
+	struct mp_decode_stats stats;
+	long frames = os_atomic_load_long(&inst->frames);
+
+	mp_media_get_decode_stats(&inst->media, false, &stats);
+
+	printf("%3d  %8.2f  %8.3f  %8.3f  %5u  %3d %-5s  %s\n", idx,
+	       (double)frames / (double)seconds,
+	       stats.frames ? (double)stats.total_decode_ns /
+				      (double)stats.frames / 1000000.0
+			    : 0.0,
+	       (double)stats.max_decode_ns / 1000000.0,
+	       stats.max_queue_depth, stats.thread_count,
+	       stats.frame_threading ? "frame" : "slice", path);
+}
+
+int main(int argc, char *argv[])
+{
+	int instances = DEFAULT_INSTANCES;
+	int seconds = DEFAULT_SECONDS;
+	int budget = 0;
+	int first_file;
+	int num_files;
+	struct bench_instance *insts;
+	profiler_snapshot_t *snap;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			instances = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+			seconds = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			budget = atoi(argv[++i]);
+		else
+			break;
+	}
+
+	first_file = i;
+	num_files = argc - first_file;
+
+	if (!num_files || instances <= 0 || seconds <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	profiler_start();
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		fprintf(stderr, "Couldn't initialize OBS\n");
+		return 1;
+	}
+
+	mp_decode_set_thread_budget(budget);
+
+	insts = bzalloc(sizeof(struct bench_instance) * instances);
+
+	for (i = 0; i < instances; i++) {
+		struct mp_media_info info = {
+			.opaque = &insts[i],
+			.v_cb = video_frame,
+			.path = argv[first_file + i % num_files],
+			.speed = 100,
+			.is_local_file = true,
+		};
+
+		insts[i].valid = mp_media_init(&insts[i].media, &info);
+		if (insts[i].valid)
+			mp_media_play(&insts[i].media, true, false);
+		else
+			fprintf(stderr, "Failed to open '%s'\n", info.path);
+	}
+
+	os_sleep_ms((uint32_t)seconds * 1000);
+
+	printf("thread budget: %d, instances: %d, duration: %d s\n\n",
+	       mp_decode_get_thread_budget(), instances, seconds);
+	printf("  #       fps   avg(ms)   max(ms)  queue  threads    file\n");
+
+	for (i = 0; i < instances; i++) {
+		if (insts[i].valid)
+			print_stats(i, argv[first_file + i % num_files],
+				    &insts[i], seconds);
+	}
+	printf("\n");
+
+	for (i = 0; i < instances; i++) {
+		if (insts[i].valid)
+			mp_media_free(&insts[i].media);
+	}
+	bfree(insts);
+
+	snap = profile_snapshot_create();
+	profiler_print(snap);
+	profile_snapshot_free(snap);
+
+	obs_shutdown();
+	profiler_stop();
+	profiler_free();
+	return 0;
+}
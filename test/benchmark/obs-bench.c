@@ -0,0 +1,378 @@
+/******************************************************************************
+    Copyright (C) 2021 by the OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ * Runs the whole libobs pipeline without a frontend: a scene of synthetic
+ * test sources (with filters) is rendered, mixed and encoded into the null
+ * output for a fixed time.  The profiler timings and frame counters are
+ * written to stdout as JSON so results can be compared between commits;
+ * log messages go to stderr.
+ *
+ * The test-input and obs-outputs modules must be loadable, and a graphics
+ * context is still required (a virtual X server with a software OpenGL
+ * driver is enough).
+ *
+ * usage: obs-bench [seconds] [sources] [filters per source]
+ *                  [video encoder] [audio encoder]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+
+#define DEFAULT_SECONDS 10
+#define DEFAULT_SOURCES 8
+#define DEFAULT_FILTERS 1
+#define DEFAULT_VIDEO_ENCODER "obs_x264"
+#define DEFAULT_AUDIO_ENCODER "ffmpeg_aac"
+
+#define BENCH_WIDTH 1920
+#define BENCH_HEIGHT 1080
+#define BENCH_FPS 60
+
+#define VIDEO_ENCODER_NAME "bench video"
+#define AUDIO_ENCODER_NAME "bench audio"
+
+/* sources are picked round robin, only the video ones get filters */
+static const struct {
+	const char *id;
+	bool video;
+} bench_sources[] = {
+	{"random", true},
+	{"test_sinewave", false},
+	{"sync_video", true},
+	{"sync_audio", false},
+};
+
+#define NUM_BENCH_SOURCES (sizeof(bench_sources) / sizeof(bench_sources[0]))
+
+/* ------------------------------------------------------------------------- */
+/* profiler results                                                          */
+
+struct bench_timing {
+	const char *key;
+	const char *name;
+
+	profiler_time_entries_t times;
+	uint64_t count;
+	uint64_t total_us;
+	uint64_t max_us;
+};
+
+static void add_entry_times(struct bench_timing *timing,
+			    profiler_snapshot_entry_t *entry)
+{
+	profiler_time_entries_t *times = profiler_snapshot_entry_times(entry);
+
+	for (size_t i = 0; i < times->num; i++) {
+		profiler_time_entry_t *t = &times->array[i];
+
+		da_push_back(timing->times, t);
+		timing->count += t->count;
+		timing->total_us += t->time_delta * t->count;
+	}
+
+	if (profiler_snapshot_entry_max_time(entry) > timing->max_us)
+		timing->max_us = profiler_snapshot_entry_max_time(entry);
+}
+
+struct timing_search {
+	struct bench_timing *timings;
+	size_t num;
+};
+
+static bool find_timings(void *data, profiler_snapshot_entry_t *entry)
+{
+	struct timing_search *search = data;
+	const char *name = profiler_snapshot_entry_name(entry);
+
+	for (size_t i = 0; i < search->num; i++) {
+		if (strcmp(search->timings[i].name, name) == 0)
+			add_entry_times(&search->timings[i], entry);
+	}
+
+	profiler_snapshot_enumerate_children(entry, find_timings, data);
+	return true;
+}
+
+static int cmp_time_entry(const void *a, const void *b)
+{
+	const profiler_time_entry_t *ta = a;
+	const profiler_time_entry_t *tb = b;
+
+	if (ta->time_delta == tb->time_delta)
+		return 0;
+	return ta->time_delta < tb->time_delta ? -1 : 1;
+}
+
+static double timing_percentile(struct bench_timing *timing, double pct)
+{
+	uint64_t target = (uint64_t)((double)timing->count * pct / 100.0);
+	uint64_t seen = 0;
+
+	for (size_t i = 0; i < timing->times.num; i++) {
+		seen += timing->times.array[i].count;
+		if (seen > target)
+			return (double)timing->times.array[i].time_delta /
+			       1000.0;
+	}
+
+	return (double)timing->max_us / 1000.0;
+}
+
+static void print_timing(struct bench_timing *timing, bool last)
+{
+	qsort(timing->times.array, timing->times.num,
+	      sizeof(profiler_time_entry_t), cmp_time_entry);
+
+	printf("\t\t\"%s\": {\"count\": %llu, \"avg_ms\": %.4f, "
+	       "\"p50_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f}%s\n",
+	       timing->key, (unsigned long long)timing->count,
+	       timing->count ? (double)timing->total_us /
+				       (double)timing->count / 1000.0
+			     : 0.0,
+	       timing_percentile(timing, 50.0),
+	       timing_percentile(timing, 99.0),
+	       (double)timing->max_us / 1000.0, last ? "" : ",");
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void bench_log_handler(int log_level, const char *format, va_list args,
+			      void *param)
+{
+	if (log_level <= LOG_WARNING) {
+		vfprintf(stderr, format, args);
+		fputc('\n', stderr);
+	}
+
+	UNUSED_PARAMETER(param);
+}
+
+static bool init_obs(void)
+{
+	struct obs_video_info ovi = {0};
+	struct obs_audio_info oai = {0};
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return false;
+
+	ovi.adapter = 0;
+	ovi.base_width = BENCH_WIDTH;
+	ovi.base_height = BENCH_HEIGHT;
+	ovi.fps_num = BENCH_FPS;
+	ovi.fps_den = 1;
+	ovi.graphics_module = DL_OPENGL;
+	ovi.output_format = VIDEO_FORMAT_NV12;
+	ovi.output_width = BENCH_WIDTH;
+	ovi.output_height = BENCH_HEIGHT;
+
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS)
+		return false;
+
+	oai.samples_per_sec = 48000;
+	oai.speakers = SPEAKERS_STEREO;
+
+	if (!obs_reset_audio(&oai))
+		return false;
+
+	obs_load_all_modules();
+	obs_post_load_modules();
+	return true;
+}
+
+static bool build_scene(obs_scene_t *scene, int sources, int filters)
+{
+	for (int i = 0; i < sources; i++) {
+		size_t type = (size_t)i % NUM_BENCH_SOURCES;
+		char name[64];
+		obs_source_t *source;
+
+		snprintf(name, sizeof(name), "%s %d", bench_sources[type].id,
+			 i);
+		source = obs_source_create(bench_sources[type].id, name, NULL,
+					   NULL);
+		if (!source) {
+			fprintf(stderr, "Couldn't create source '%s'\n",
+				bench_sources[type].id);
+			return false;
+		}
+
+		obs_scene_add(scene, source);
+
+		for (int j = 0; bench_sources[type].video && j < filters; j++) {
+			obs_source_t *filter;
+
+			snprintf(name, sizeof(name), "filter %d.%d", i, j);
+			filter = obs_source_create("test_filter", name, NULL,
+						   NULL);
+			if (!filter) {
+				fprintf(stderr, "Couldn't create filter\n");
+				obs_source_release(source);
+				return false;
+			}
+
+			obs_source_filter_add(source, filter);
+			obs_source_release(filter);
+		}
+
+		obs_source_release(source);
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : DEFAULT_SECONDS;
+	int sources = argc > 2 ? atoi(argv[2]) : DEFAULT_SOURCES;
+	int filters = argc > 3 ? atoi(argv[3]) : DEFAULT_FILTERS;
+	const char *venc_id = argc > 4 ? argv[4] : DEFAULT_VIDEO_ENCODER;
+	const char *aenc_id = argc > 5 ? argv[5] : DEFAULT_AUDIO_ENCODER;
+	struct bench_timing timings[] = {
+		{"tick", "tick_sources"},
+		{"render", "render_video"},
+		{"output_frame", "output_frame"},
+		{"audio_render", "render_audio"},
+		{"audio_mix", "mix_audio"},
+		{"video_encode", "encode(" VIDEO_ENCODER_NAME ")"},
+		{"audio_encode", "encode(" AUDIO_ENCODER_NAME ")"},
+	};
+	struct timing_search search = {timings,
+				       sizeof(timings) / sizeof(timings[0])};
+	obs_scene_t *scene = NULL;
+	obs_encoder_t *venc = NULL;
+	obs_encoder_t *aenc = NULL;
+	obs_output_t *output = NULL;
+	profiler_snapshot_t *snap;
+	video_t *video;
+	uint32_t total_start, lagged_start, output_start, skipped_start;
+	uint64_t start, elapsed;
+	int ret = 0;
+
+	if (seconds <= 0 || sources <= 0 || filters < 0) {
+		fprintf(stderr,
+			"usage: %s [seconds] [sources] [filters per source] "
+			"[video encoder] [audio encoder]\n",
+			argv[0]);
+		return 1;
+	}
+
+	base_set_log_handler(bench_log_handler, NULL);
+
+	/* threads only profile if the profiler runs before they start */
+	profiler_start();
+
+	if (!init_obs()) {
+		fprintf(stderr, "Couldn't initialize OBS\n");
+		ret = 1;
+		goto cleanup;
+	}
+
+	scene = obs_scene_create("obs-bench");
+	if (!build_scene(scene, sources, filters)) {
+		ret = 1;
+		goto cleanup;
+	}
+
+	venc = obs_video_encoder_create(venc_id, VIDEO_ENCODER_NAME, NULL,
+					NULL);
+	aenc = obs_audio_encoder_create(aenc_id, AUDIO_ENCODER_NAME, NULL, 0,
+					NULL);
+	output = obs_output_create("null_output", "obs-bench", NULL, NULL);
+	if (!venc || !aenc || !output) {
+		fprintf(stderr, "Couldn't create the encoders (%s, %s) or "
+				"the null output\n",
+			venc_id, aenc_id);
+		ret = 1;
+		goto cleanup;
+	}
+
+	obs_encoder_set_video(venc, obs_get_video());
+	obs_encoder_set_audio(aenc, obs_get_audio());
+	obs_output_set_video_encoder(output, venc);
+	obs_output_set_audio_encoder(output, aenc, 0);
+
+	obs_set_output_source(0, obs_scene_get_source(scene));
+
+	if (!obs_output_start(output)) {
+		fprintf(stderr, "Couldn't start the null output: %s\n",
+			obs_output_get_last_error(output));
+		ret = 1;
+		goto cleanup;
+	}
+
+	video = obs_get_video();
+	total_start = obs_get_total_frames();
+	lagged_start = obs_get_lagged_frames();
+	output_start = video_output_get_total_frames(video);
+	skipped_start = video_output_get_skipped_frames(video);
+	start = os_gettime_ns();
+
+	os_sleep_ms((uint32_t)seconds * 1000);
+
+	elapsed = os_gettime_ns() - start;
+
+	printf("{\n");
+	printf("\t\"config\": {\"seconds\": %d, \"sources\": %d, "
+	       "\"filters_per_source\": %d, \"video_encoder\": \"%s\", "
+	       "\"audio_encoder\": \"%s\", \"width\": %d, \"height\": %d, "
+	       "\"fps\": %d},\n",
+	       seconds, sources, filters, venc_id, aenc_id, BENCH_WIDTH,
+	       BENCH_HEIGHT, BENCH_FPS);
+	printf("\t\"elapsed_ms\": %.1f,\n", (double)elapsed / 1000000.0);
+	printf("\t\"frames\": {\"rendered\": %u, \"lagged\": %u, "
+	       "\"output\": %u, \"skipped\": %u, \"encoded\": %d, "
+	       "\"dropped\": %d},\n",
+	       obs_get_total_frames() - total_start,
+	       obs_get_lagged_frames() - lagged_start,
+	       video_output_get_total_frames(video) - output_start,
+	       video_output_get_skipped_frames(video) - skipped_start,
+	       obs_output_get_total_frames(output),
+	       obs_output_get_frames_dropped(output));
+
+	obs_output_stop(output);
+
+	snap = profile_snapshot_create();
+	profiler_snapshot_enumerate_roots(snap, find_timings, &search);
+
+	printf("\t\"timings\": {\n");
+	for (size_t i = 0; i < search.num; i++)
+		print_timing(&timings[i], i == search.num - 1);
+	printf("\t}\n");
+	printf("}\n");
+
+	profile_snapshot_free(snap);
+	for (size_t i = 0; i < search.num; i++)
+		da_free(timings[i].times);
+
+cleanup:
+	obs_set_output_source(0, NULL);
+	obs_output_release(output);
+	obs_encoder_release(venc);
+	obs_encoder_release(aenc);
+	obs_scene_release(scene);
+	obs_shutdown();
+	profiler_stop();
+	profiler_free();
+	return ret;
+}
@@ -0,0 +1,802 @@
+/******************************************************************************
+    Copyright (C) 2021 by the OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ * Streams synthetic H.264/AAC packets through the regular rtmp_output to a
+ * minimal RTMP server running in-process on the loopback interface, so the
+ * send loops can be compared without a real server or network.  The server
+ * can be limited to a receive rate to put the output under congestion.
+ *
+ * For a more realistic bottleneck, shape the loopback interface instead and
+ * enable dynamic bitrate, e.g.:
+ *
+ *   tc qdisc add dev lo root netem delay 20ms rate 4mbit
+ *   rtmp-loopback-bench 60 6000 0 1 0 1
+ *   tc qdisc del dev lo root
+ *
+ * usage: rtmp-loopback-bench [seconds] [video kbps] [sink kbps]
+ *                            [new socket loop] [low latency]
+ *                            [dynamic bitrate]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define close closesocket
+#define SHUT_RDWR SD_BOTH
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#define DEFAULT_SECONDS 10
+#define DEFAULT_VIDEO_KBPS 6000
+#define AUDIO_KBPS 160
+
+/* ------------------------------------------------------------------------- */
+/* loopback RTMP server                                                      */
+
+#define SINK_SIG_SIZE 1536
+#define SINK_MAX_CSID 64
+#define SINK_MAX_CHUNK_SIZE 32768
+
+struct sink_chunk_stream {
+	uint32_t msg_len;
+	uint8_t msg_type;
+	bool ext_ts;
+	DARRAY(uint8_t) body;
+};
+
+struct rtmp_sink {
+	int listen_fd;
+	int fd;
+	int port;
+	long kbps;
+	pthread_t thread;
+	volatile bool stop;
+
+	uint32_t chunk_size;
+	struct sink_chunk_stream streams[SINK_MAX_CSID];
+
+	uint64_t start_time;
+	uint64_t bytes;
+	uint64_t messages;
+	bool publishing;
+};
+
+static inline uint32_t be24(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+}
+
+static inline uint32_t be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | be24(p + 1);
+}
+
+static bool read_full(int fd, uint8_t *data, size_t size)
+{
+	while (size) {
+		int ret = recv(fd, (char *)data, (int)size, 0);
+		if (ret <= 0)
+			return false;
+		data += ret;
+		size -= ret;
+	}
+	return true;
+}
+
+static bool write_full(int fd, const uint8_t *data, size_t size)
+{
+	while (size) {
+		int ret = send(fd, (const char *)data, (int)size, 0);
+		if (ret <= 0)
+			return false;
+		data += ret;
+		size -= ret;
+	}
+	return true;
+}
+
+/* plain handshake: a zero version in S1 tells librtmp not to use the
+ * digest handshake, so C1 simply gets echoed back as S2 */
+static bool sink_handshake(struct rtmp_sink *sink)
+{
+	uint8_t c0c1[SINK_SIG_SIZE + 1];
+	uint8_t reply[SINK_SIG_SIZE * 2 + 1] = {0x03};
+	uint8_t c2[SINK_SIG_SIZE];
+
+	if (!read_full(sink->fd, c0c1, sizeof(c0c1)))
+		return false;
+
+	memcpy(reply + 1 + SINK_SIG_SIZE, c0c1 + 1, SINK_SIG_SIZE);
+	if (!write_full(sink->fd, reply, sizeof(reply)))
+		return false;
+
+	return read_full(sink->fd, c2, sizeof(c2));
+}
+
+static inline uint8_t *put_amf_number(uint8_t *p, double val)
+{
+	uint64_t bits;
+
+	memcpy(&bits, &val, sizeof(bits));
+	*p++ = 0x00;
+	for (int i = 7; i >= 0; i--)
+		*p++ = (uint8_t)(bits >> (i * 8));
+	return p;
+}
+
+/* answers every command with a plain _result, which is all librtmp needs
+ * to get from connect through createStream to publish */
+static bool sink_send_result(struct rtmp_sink *sink, double txn)
+{
+	static const char name[] = "_result";
+	uint8_t msg[12 + 64] = {0x03};
+	uint8_t *p = msg + 12;
+	size_t body_size;
+
+	*p++ = 0x02;
+	*p++ = 0;
+	*p++ = sizeof(name) - 1;
+	memcpy(p, name, sizeof(name) - 1);
+	p += sizeof(name) - 1;
+	p = put_amf_number(p, txn);
+	*p++ = 0x05;
+	p = put_amf_number(p, 1.0);
+
+	body_size = p - (msg + 12);
+	msg[4] = (uint8_t)(body_size >> 16);
+	msg[5] = (uint8_t)(body_size >> 8);
+	msg[6] = (uint8_t)body_size;
+	msg[7] = 20;
+
+	return write_full(sink->fd, msg, p - msg);
+}
+
+static bool sink_command(struct rtmp_sink *sink, const uint8_t *body,
+			 size_t size)
+{
+	const uint8_t *p;
+	size_t name_len;
+	uint64_t bits = 0;
+	double txn;
+
+	if (size < 3 || body[0] != 0x02)
+		return true;
+
+	name_len = ((size_t)body[1] << 8) | body[2];
+	if (size < 3 + name_len + 9)
+		return true;
+
+	p = body + 3 + name_len;
+	if (*p++ != 0x00)
+		return true;
+
+	for (int i = 0; i < 8; i++)
+		bits = (bits << 8) | p[i];
+	memcpy(&txn, &bits, sizeof(txn));
+
+	if (name_len == 7 && memcmp(body + 3, "publish", 7) == 0)
+		sink->publishing = true;
+
+	return txn == 0.0 || sink_send_result(sink, txn);
+}
+
+static bool sink_message(struct rtmp_sink *sink, struct sink_chunk_stream *cs)
+{
+	sink->messages++;
+
+	if (cs->msg_type == 1 && cs->body.num >= 4) {
+		sink->chunk_size = be32(cs->body.array) & 0x7FFFFFFF;
+		if (!sink->chunk_size || sink->chunk_size > SINK_MAX_CHUNK_SIZE)
+			return false;
+
+	} else if (cs->msg_type == 20) {
+		return sink_command(sink, cs->body.array, cs->body.num);
+	}
+
+	return true;
+}
+
+/* returns the number of bytes used for one chunk, 0 if the chunk isn't
+ * complete yet, or -1 if the stream can't be parsed */
+static int sink_parse_chunk(struct rtmp_sink *sink, const uint8_t *data,
+			    size_t size)
+{
+	static const size_t header_sizes[] = {11, 7, 3, 0};
+	const uint8_t *p = data;
+	const uint8_t *end = data + size;
+	struct sink_chunk_stream *cs;
+	uint32_t msg_len;
+	uint8_t msg_type;
+	bool ext_ts;
+	size_t chunk;
+	int fmt, csid;
+
+	if (p == end)
+		return 0;
+
+	fmt = *p >> 6;
+	csid = *p++ & 0x3F;
+
+	if (csid < 2) {
+		int extra = csid + 1;
+
+		if (end - p < extra)
+			return 0;
+		csid = 64 + p[0] + (extra == 2 ? p[1] * 256 : 0);
+		p += extra;
+	}
+	if (csid >= SINK_MAX_CSID)
+		return -1;
+
+	if ((size_t)(end - p) < header_sizes[fmt])
+		return 0;
+
+	cs = &sink->streams[csid];
+	msg_len = cs->msg_len;
+	msg_type = cs->msg_type;
+	ext_ts = cs->ext_ts;
+
+	if (fmt <= 2)
+		ext_ts = be24(p) == 0xFFFFFF;
+	if (fmt <= 1) {
+		msg_len = be24(p + 3);
+		msg_type = p[6];
+	}
+	p += header_sizes[fmt];
+
+	if (ext_ts) {
+		if (end - p < 4)
+			return 0;
+		p += 4;
+	}
+
+	chunk = msg_len - cs->body.num;
+	if (chunk > sink->chunk_size)
+		chunk = sink->chunk_size;
+	if ((size_t)(end - p) < chunk)
+		return 0;
+
+	cs->msg_len = msg_len;
+	cs->msg_type = msg_type;
+	cs->ext_ts = ext_ts;
+
+	da_push_back_array(cs->body, p, chunk);
+	p += chunk;
+
+	if (cs->body.num == msg_len) {
+		if (!sink_message(sink, cs))
+			return -1;
+		da_resize(cs->body, 0);
+	}
+
+	return (int)(p - data);
+}
+
+static void *sink_thread(void *data)
+{
+	struct rtmp_sink *sink = data;
+	uint8_t buf[SINK_MAX_CHUNK_SIZE * 2];
+	size_t len = 0;
+
+	os_set_thread_name("rtmp-loopback-bench: sink");
+
+	sink->fd = (int)accept(sink->listen_fd, NULL, NULL);
+	if (sink->fd == -1 || !sink_handshake(sink))
+		return NULL;
+
+	sink->start_time = os_gettime_ns();
+
+	while (!sink->stop) {
+		size_t max_read = sizeof(buf) - len;
+		size_t pos = 0;
+		int ret;
+
+		/* small reads keep the rate limit from being too bursty */
+		if (sink->kbps && max_read > 16384)
+			max_read = 16384;
+
+		ret = recv(sink->fd, (char *)buf + len, (int)max_read, 0);
+		if (ret <= 0)
+			break;
+
+		len += ret;
+		sink->bytes += ret;
+
+		for (;;) {
+			int used = sink_parse_chunk(sink, buf + pos, len - pos);
+			if (used < 0)
+				goto exit;
+			if (!used)
+				break;
+			pos += used;
+		}
+
+		memmove(buf, buf + pos, len - pos);
+		len -= pos;
+
+		if (sink->kbps)
+			os_sleepto_ns(sink->start_time +
+				      sink->bytes * 8000000ULL / sink->kbps);
+	}
+
+exit:
+	close(sink->fd);
+	sink->fd = -1;
+	return NULL;
+}
+
+static bool sink_start(struct rtmp_sink *sink, long kbps)
+{
+	struct sockaddr_in addr = {0};
+	socklen_t addr_len = sizeof(addr);
+
+	sink->kbps = kbps;
+	sink->chunk_size = 128;
+	sink->fd = -1;
+
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	sink->listen_fd = (int)socket(AF_INET, SOCK_STREAM, 0);
+	if (sink->listen_fd == -1)
+		return false;
+
+	if (bind(sink->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(sink->listen_fd, 1) != 0 ||
+	    getsockname(sink->listen_fd, (struct sockaddr *)&addr,
+			&addr_len) != 0) {
+		close(sink->listen_fd);
+		return false;
+	}
+
+	sink->port = ntohs(addr.sin_port);
+	return pthread_create(&sink->thread, NULL, sink_thread, sink) == 0;
+}
+
+static void sink_stop(struct rtmp_sink *sink)
+{
+	sink->stop = true;
+
+	/* unblocks both accept() and recv() */
+	shutdown(sink->listen_fd, SHUT_RDWR);
+	if (sink->fd != -1)
+		shutdown(sink->fd, SHUT_RDWR);
+
+	pthread_join(sink->thread, NULL);
+	close(sink->listen_fd);
+
+	for (size_t i = 0; i < SINK_MAX_CSID; i++)
+		da_free(sink->streams[i].body);
+}
+
+/* ------------------------------------------------------------------------- */
+/* synthetic encoders and service                                            */
+
+struct bench_encoder {
+	DARRAY(uint8_t) packet;
+	size_t packet_size;
+	uint64_t keyint;
+	uint64_t frames;
+	uint8_t fill;
+};
+
+static const uint8_t bench_avc_header[] = {
+	0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0xC0, 0x1F, 0xDA, 0x01, 0x40,
+	0x16, 0xEC, 0x04, 0x40, 0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C,
+	0x80};
+static const uint8_t bench_aac_header[] = {0x11, 0x90};
+
+static const char *bench_h264_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Loopback Benchmark H.264";
+}
+
+static const char *bench_aac_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Loopback Benchmark AAC";
+}
+
+static bool bench_h264_update(void *data, obs_data_t *settings)
+{
+	struct bench_encoder *enc = data;
+	struct obs_video_info ovi;
+	uint64_t kbps = (uint64_t)obs_data_get_int(settings, "bitrate");
+
+	obs_get_video_info(&ovi);
+	enc->packet_size = (size_t)(kbps * 125 * ovi.fps_den / ovi.fps_num);
+	enc->keyint = 2 * ovi.fps_num / ovi.fps_den;
+	return true;
+}
+
+static void *bench_h264_create(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	struct bench_encoder *enc = bzalloc(sizeof(*enc));
+
+	enc->fill = 0xAA;
+	bench_h264_update(enc, settings);
+
+	UNUSED_PARAMETER(encoder);
+	return enc;
+}
+
+static void *bench_aac_create(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	struct bench_encoder *enc = bzalloc(sizeof(*enc));
+	uint64_t kbps = (uint64_t)obs_data_get_int(settings, "bitrate");
+
+	enc->packet_size = (size_t)(kbps * 125 * 1024 / 48000);
+	enc->fill = 0x21;
+
+	UNUSED_PARAMETER(encoder);
+	return enc;
+}
+
+static void bench_encoder_destroy(void *data)
+{
+	struct bench_encoder *enc = data;
+	da_free(enc->packet);
+	bfree(enc);
+}
+
+static bool bench_encode(void *data, struct encoder_frame *frame,
+			 struct encoder_packet *packet, bool *received_packet)
+{
+	struct bench_encoder *enc = data;
+	size_t pos;
+
+	da_resize(enc->packet, 0);
+
+	if (enc->keyint) {
+		static const uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
+		uint8_t nal;
+
+		packet->keyframe = enc->frames % enc->keyint == 0;
+		nal = packet->keyframe ? 0x65 : 0x41;
+
+		da_push_back_array(enc->packet, start_code, 4);
+		da_push_back(enc->packet, &nal);
+	}
+
+	pos = enc->packet.num;
+	da_resize(enc->packet,
+		  enc->packet_size > pos ? enc->packet_size : pos + 1);
+	memset(enc->packet.array + pos, enc->fill, enc->packet.num - pos);
+
+	packet->data = enc->packet.array;
+	packet->size = enc->packet.num;
+	packet->pts = frame->pts;
+	packet->dts = frame->pts;
+	*received_packet = true;
+
+	enc->frames++;
+	return true;
+}
+
+static size_t bench_aac_frame_size(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return 1024;
+}
+
+static bool bench_h264_extra_data(void *data, uint8_t **extra_data,
+				  size_t *size)
+{
+	UNUSED_PARAMETER(data);
+	*extra_data = (uint8_t *)bench_avc_header;
+	*size = sizeof(bench_avc_header);
+	return true;
+}
+
+static bool bench_aac_extra_data(void *data, uint8_t **extra_data,
+				 size_t *size)
+{
+	UNUSED_PARAMETER(data);
+	*extra_data = (uint8_t *)bench_aac_header;
+	*size = sizeof(bench_aac_header);
+	return true;
+}
+
+static struct obs_encoder_info bench_h264 = {
+	.id = "rtmp_loopback_bench_h264",
+	.type = OBS_ENCODER_VIDEO,
+	.codec = "h264",
+	.get_name = bench_h264_name,
+	.create = bench_h264_create,
+	.destroy = bench_encoder_destroy,
+	.encode = bench_encode,
+	.update = bench_h264_update,
+	.get_extra_data = bench_h264_extra_data,
+	.caps = OBS_ENCODER_CAP_DYN_BITRATE,
+};
+
+static struct obs_encoder_info bench_aac = {
+	.id = "rtmp_loopback_bench_aac",
+	.type = OBS_ENCODER_AUDIO,
+	.codec = "aac",
+	.get_name = bench_aac_name,
+	.create = bench_aac_create,
+	.destroy = bench_encoder_destroy,
+	.encode = bench_encode,
+	.get_frame_size = bench_aac_frame_size,
+	.get_extra_data = bench_aac_extra_data,
+};
+
+static char bench_url[64];
+
+static const char *bench_service_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Loopback Benchmark Service";
+}
+
+static void *bench_service_create(obs_data_t *settings, obs_service_t *service)
+{
+	UNUSED_PARAMETER(settings);
+	return service;
+}
+
+static void bench_service_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static const char *bench_service_url(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return bench_url;
+}
+
+static const char *bench_service_key(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return "bench";
+}
+
+static struct obs_service_info bench_service = {
+	.id = "rtmp_loopback_bench_service",
+	.get_name = bench_service_name,
+	.create = bench_service_create,
+	.destroy = bench_service_destroy,
+	.get_url = bench_service_url,
+	.get_key = bench_service_key,
+};
+
+/* ------------------------------------------------------------------------- */
+
+static bool init_obs(void)
+{
+	struct obs_video_info ovi = {0};
+	struct obs_audio_info oai = {0};
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return false;
+
+	ovi.adapter = 0;
+	ovi.base_width = 1920;
+	ovi.base_height = 1080;
+	ovi.fps_num = 60;
+	ovi.fps_den = 1;
+	ovi.graphics_module = DL_OPENGL;
+	ovi.output_format = VIDEO_FORMAT_NV12;
+	ovi.output_width = 1920;
+	ovi.output_height = 1080;
+
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS)
+		return false;
+
+	oai.samples_per_sec = 48000;
+	oai.speakers = SPEAKERS_STEREO;
+
+	if (!obs_reset_audio(&oai))
+		return false;
+
+	obs_register_encoder(&bench_h264);
+	obs_register_encoder(&bench_aac);
+	obs_register_service(&bench_service);
+
+	obs_load_all_modules();
+	obs_post_load_modules();
+	return true;
+}
+
+static obs_encoder_t *create_encoder(const char *id, bool audio, long kbps)
+{
+	obs_data_t *settings = obs_data_create();
+	obs_encoder_t *encoder;
+
+	obs_data_set_int(settings, "bitrate", kbps);
+
+	if (audio) {
+		encoder = obs_audio_encoder_create(id, id, settings, 0, NULL);
+		obs_encoder_set_audio(encoder, obs_get_audio());
+	} else {
+		encoder = obs_video_encoder_create(id, id, settings, NULL);
+		obs_encoder_set_video(encoder, obs_get_video());
+	}
+
+	obs_data_release(settings);
+	return encoder;
+}
+
+static bool wait_for_active(obs_output_t *output, bool active, int timeout_ms)
+{
+	uint64_t end = os_gettime_ns() + (uint64_t)timeout_ms * 1000000ULL;
+
+	while (obs_output_active(output) != active) {
+		if (os_gettime_ns() >= end)
+			return false;
+		os_sleep_ms(10);
+	}
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : DEFAULT_SECONDS;
+	long video_kbps = argc > 2 ? atol(argv[2]) : DEFAULT_VIDEO_KBPS;
+	long sink_kbps = argc > 3 ? atol(argv[3]) : 0;
+	bool new_socket_loop = argc > 4 ? atoi(argv[4]) != 0 : true;
+	bool low_latency = argc > 5 ? atoi(argv[5]) != 0 : false;
+	bool dyn_bitrate = argc > 6 ? atoi(argv[6]) != 0 : false;
+	struct rtmp_sink sink = {0};
+	obs_encoder_t *venc = NULL;
+	obs_encoder_t *aenc = NULL;
+	obs_service_t *service = NULL;
+	obs_output_t *output = NULL;
+	obs_data_t *settings;
+	double congestion_sum = 0.0;
+	float congestion_max = 0.0f;
+	long bitrate_min = video_kbps;
+	long bitrate = video_kbps;
+	int samples = 0;
+	uint64_t start, end, elapsed;
+	uint64_t sink_bytes;
+	int ret = 0;
+
+	if (seconds <= 0 || video_kbps <= 0 || sink_kbps < 0) {
+		fprintf(stderr,
+			"usage: %s [seconds] [video kbps] [sink kbps] "
+			"[new socket loop] [low latency] [dynamic bitrate]\n",
+			argv[0]);
+		return 1;
+	}
+
+#ifdef _WIN32
+	WSADATA wsa;
+	WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+
+	if (!init_obs()) {
+		fprintf(stderr, "Couldn't initialize OBS\n");
+		obs_shutdown();
+		return 1;
+	}
+
+	if (!sink_start(&sink, sink_kbps)) {
+		fprintf(stderr, "Couldn't start the loopback server\n");
+		obs_shutdown();
+		return 1;
+	}
+
+	snprintf(bench_url, sizeof(bench_url), "rtmp://127.0.0.1:%d/live",
+		 sink.port);
+
+	venc = create_encoder("rtmp_loopback_bench_h264", false, video_kbps);
+	aenc = create_encoder("rtmp_loopback_bench_aac", true, AUDIO_KBPS);
+	service = obs_service_create("rtmp_loopback_bench_service", "bench",
+				     NULL, NULL);
+
+	settings = obs_data_create();
+	obs_data_set_bool(settings, "new_socket_loop_enabled", new_socket_loop);
+	obs_data_set_bool(settings, "low_latency_mode_enabled", low_latency);
+	obs_data_set_bool(settings, "dyn_bitrate", dyn_bitrate);
+	output = obs_output_create("rtmp_output", "bench", settings, NULL);
+	obs_data_release(settings);
+
+	if (!venc || !aenc || !service || !output) {
+		fprintf(stderr, "Couldn't create the rtmp output, encoders "
+				"or service\n");
+		ret = 1;
+		goto cleanup;
+	}
+
+	obs_output_set_video_encoder(output, venc);
+	obs_output_set_audio_encoder(output, aenc, 0);
+	obs_output_set_service(output, service);
+
+	if (!obs_output_start(output) || !wait_for_active(output, true, 5000)) {
+		fprintf(stderr, "Couldn't start streaming: %s\n",
+			obs_output_get_last_error(output));
+		ret = 1;
+		goto cleanup;
+	}
+
+	start = os_gettime_ns();
+	end = start + (uint64_t)seconds * 1000000000ULL;
+
+	while (os_gettime_ns() < end && obs_output_active(output)) {
+		float congestion = obs_output_get_congestion(output);
+
+		congestion_sum += congestion;
+		if (congestion > congestion_max)
+			congestion_max = congestion;
+		samples++;
+
+		settings = obs_encoder_get_settings(venc);
+		bitrate = (long)obs_data_get_int(settings, "bitrate");
+		if (bitrate < bitrate_min)
+			bitrate_min = bitrate;
+		obs_data_release(settings);
+
+		os_sleep_ms(100);
+	}
+
+	elapsed = os_gettime_ns() - start;
+	sink_bytes = sink.bytes;
+
+	printf("send loop:              %s%s\n",
+	       new_socket_loop ? "new" : "legacy",
+	       low_latency ? " (low latency)" : "");
+	printf("video bitrate:          %ld kbps\n", video_kbps);
+	if (dyn_bitrate)
+		printf("dynamic bitrate:        %ld kbps min, %ld kbps final\n",
+		       bitrate_min, bitrate);
+	printf("sink limit:             %ld kbps\n", sink_kbps);
+	printf("connect time:           %d ms\n",
+	       obs_output_get_connect_time_ms(output));
+	printf("bytes sent:             %llu\n",
+	       (unsigned long long)obs_output_get_total_bytes(output));
+	printf("bytes received:         %llu (%.1f kbps)\n",
+	       (unsigned long long)sink_bytes,
+	       (double)sink_bytes * 8000000.0 / (double)elapsed);
+	printf("messages received:      %llu%s\n",
+	       (unsigned long long)sink.messages,
+	       sink.publishing ? "" : " (never published)");
+	printf("frames:                 %d total, %d dropped\n",
+	       obs_output_get_total_frames(output),
+	       obs_output_get_frames_dropped(output));
+	printf("congestion:             %.3f avg, %.3f max\n",
+	       samples ? congestion_sum / samples : 0.0, congestion_max);
+
+	obs_output_stop(output);
+	wait_for_active(output, false, 5000);
+
+cleanup:
+	obs_output_release(output);
+	obs_service_release(service);
+	obs_encoder_release(venc);
+	obs_encoder_release(aenc);
+	sink_stop(&sink);
+	obs_shutdown();
+	return ret;
+}
@@ -0,0 +1,214 @@
+/******************************************************************************
+    Copyright (C) 2021 by the OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ * Measures how the sources list scales with the number of scene items, on the
+ * offscreen Qt platform.  The list is a QListView with one row widget per
+ * shown row, once with a widget for every row and once with widgets only for
+ * the rows in view, kept by the same VisibleRowWidgets that SourceTree uses.
+ * The time to switch to a scene and to scroll through it is reported for both.
+ *
+ * usage: source-list-bench [rows] [scenes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include <QApplication>
+#include <QAbstractListModel>
+#include <QElapsedTimer>
+#include <QHBoxLayout>
+#include <QCheckBox>
+#include <QLabel>
+#include <QListView>
+#include <QScrollBar>
+
+#include "visible-row-widgets.hpp"
+
+#define DEFAULT_ROWS 1000
+#define DEFAULT_SCENES 10
+
+class BenchModel : public QAbstractListModel {
+public:
+	int rows = 0;
+
+	inline void SetRows(int count)
+	{
+		beginResetModel();
+		rows = count;
+		endResetModel();
+	}
+
+	int rowCount(const QModelIndex &parent) const override
+	{
+		return parent.isValid() ? 0 : rows;
+	}
+
+	QVariant data(const QModelIndex &, int) const override
+	{
+		return QVariant();
+	}
+};
+
+/* same layout as SourceTreeItem: icon, name, visibility and lock */
+static QWidget *CreateRowWidget(int row)
+{
+	QWidget *widget = new QWidget();
+	QHBoxLayout *layout = new QHBoxLayout();
+	QLabel *icon = new QLabel();
+	QLabel *label = new QLabel(QString("Source %1").arg(row));
+	QCheckBox *vis = new QCheckBox();
+	QCheckBox *lock = new QCheckBox();
+
+	icon->setFixedSize(16, 16);
+	vis->setFixedSize(16, 16);
+	lock->setFixedSize(16, 16);
+	label->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
+
+	layout->setContentsMargins(0, 0, 0, 0);
+	layout->addSpacing(3);
+	layout->addWidget(icon);
+	layout->addSpacing(2);
+	layout->addWidget(label);
+	layout->addWidget(vis);
+	layout->addSpacing(1);
+	layout->addWidget(lock);
+	widget->setLayout(layout);
+	return widget;
+}
+
+class BenchList : public QListView {
+	VisibleRowWidgets widgetRows;
+
+	void UpdateVisibleWidgets()
+	{
+		if (!lazy)
+			return;
+
+		auto keep = [](QWidget *) { return false; };
+		auto create = [this](int row) {
+			widgetRows.Set(this, row, CreateRowWidget(row));
+		};
+
+		widgetRows.Update(this, keep, create);
+	}
+
+protected:
+	void scrollContentsBy(int dx, int dy) override
+	{
+		QListView::scrollContentsBy(dx, dy);
+		UpdateVisibleWidgets();
+	}
+
+	void updateGeometries() override
+	{
+		QListView::updateGeometries();
+		UpdateVisibleWidgets();
+	}
+
+public:
+	bool lazy;
+
+	inline BenchList(bool lazy_) : lazy(lazy_)
+	{
+		setUniformItemSizes(lazy);
+		resize(300, 400);
+	}
+
+	void SceneChanged(BenchModel *model, int rows)
+	{
+		widgetRows.Clear(this);
+		model->SetRows(rows);
+
+		if (!lazy) {
+			for (int i = 0; i < rows; i++)
+				setIndexWidget(model->index(i, 0),
+					       CreateRowWidget(i));
+		}
+	}
+};
+
+struct bench_result {
+	double switch_ms;
+	double scroll_ms;
+	int scroll_steps;
+};
+
+static bench_result run(bool lazy, int rows, int scenes)
+{
+	BenchModel model;
+	BenchList list(lazy);
+	QElapsedTimer timer;
+	bench_result result = {};
+
+	list.setModel(&model);
+	list.show();
+	QApplication::processEvents();
+
+	timer.start();
+	for (int i = 0; i < scenes; i++) {
+		/* alternate between an empty and a full scene */
+		list.SceneChanged(&model, 0);
+		QApplication::processEvents();
+		list.SceneChanged(&model, rows);
+		QApplication::processEvents();
+	}
+	result.switch_ms = (double)timer.nsecsElapsed() / 1000000.0 / scenes;
+
+	QScrollBar *bar = list.verticalScrollBar();
+	int step = std::max(bar->pageStep(), 1);
+
+	timer.start();
+	for (int pos = 0; pos <= bar->maximum(); pos += step) {
+		bar->setValue(pos);
+		QApplication::processEvents();
+		result.scroll_steps++;
+	}
+	result.scroll_ms = (double)timer.nsecsElapsed() / 1000000.0;
+	return result;
+}
+
+int main(int argc, char *argv[])
+{
+	int rows = DEFAULT_ROWS;
+	int scenes = DEFAULT_SCENES;
+
+	if (argc > 1)
+		rows = atoi(argv[1]);
+	if (argc > 2)
+		scenes = atoi(argv[2]);
+	if (rows <= 0 || scenes <= 0) {
+		fprintf(stderr, "usage: %s [rows] [scenes]\n", argv[0]);
+		return 1;
+	}
+
+	qputenv("QT_QPA_PLATFORM", "offscreen");
+	QApplication app(argc, argv);
+
+	bench_result eager = run(false, rows, scenes);
+	bench_result lazy = run(true, rows, scenes);
+
+	printf("rows:                      %d\n", rows);
+	printf("scene switch (all rows):   %.3f ms\n", eager.switch_ms);
+	printf("scene switch (visible):    %.3f ms\n", lazy.switch_ms);
+	printf("scroll (all rows):         %.3f ms (%d pages)\n",
+	       eager.scroll_ms, eager.scroll_steps);
+	printf("scroll (visible):          %.3f ms (%d pages)\n",
+	       lazy.scroll_ms, lazy.scroll_steps);
+	return 0;
+}
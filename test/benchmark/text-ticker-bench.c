@@ -0,0 +1,155 @@
+/******************************************************************************
+    Copyright (C) 2021 by the OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ * Creates a number of FreeType2 text sources sharing one font and repeatedly
+ * updates their text the way a news ticker would, reporting how long the
+ * creation and the updates take.
+ *
+ * usage: text-ticker-bench [tickers] [updates] [font face]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <obs.h>
+#include <util/platform.h>
+#include <util/dstr.h>
+
+#define DEFAULT_TICKERS 100
+#define DEFAULT_UPDATES 100
+
+static bool init_obs(void)
+{
+	struct obs_video_info ovi = {0};
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return false;
+
+	ovi.adapter = 0;
+	ovi.base_width = 1920;
+	ovi.base_height = 1080;
+	ovi.fps_num = 60;
+	ovi.fps_den = 1;
+	ovi.graphics_module = DL_OPENGL;
+	ovi.output_format = VIDEO_FORMAT_NV12;
+	ovi.output_width = 1920;
+	ovi.output_height = 1080;
+
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS)
+		return false;
+
+	obs_load_all_modules();
+	obs_post_load_modules();
+	return true;
+}
+
+static obs_data_t *ticker_settings(const char *face, const char *text)
+{
+	obs_data_t *settings = obs_data_create();
+	obs_data_t *font = obs_data_create();
+
+	obs_data_set_string(font, "face", face);
+	obs_data_set_int(font, "size", 48);
+	obs_data_set_obj(settings, "font", font);
+	obs_data_set_string(settings, "text", text);
+
+	obs_data_release(font);
+	return settings;
+}
+
+static void update_ticker(obs_source_t *source, int ticker, int update)
+{
+	obs_data_t *settings = obs_data_create();
+	struct dstr text = {0};
+
+	dstr_printf(&text, "Ticker %d: headline number %d, markets %+d.%02d%%",
+		    ticker, update, (update * 7 + ticker) % 10 - 5,
+		    (update * 13) % 100);
+	obs_data_set_string(settings, "text", text.array);
+	obs_source_update(source, settings);
+
+	obs_data_release(settings);
+	dstr_free(&text);
+}
+
+int main(int argc, char *argv[])
+{
+	int tickers = argc > 1 ? atoi(argv[1]) : DEFAULT_TICKERS;
+	int updates = argc > 2 ? atoi(argv[2]) : DEFAULT_UPDATES;
+	const char *face = argc > 3 ? argv[3] : "Sans Serif";
+	obs_source_t **sources;
+	uint64_t start, create_ns, update_ns;
+	int ret = 0;
+
+	if (tickers <= 0 || updates <= 0) {
+		fprintf(stderr, "usage: %s [tickers] [updates] [font face]\n",
+			argv[0]);
+		return 1;
+	}
+
+	if (!init_obs()) {
+		fprintf(stderr, "Couldn't initialize OBS\n");
+		obs_shutdown();
+		return 1;
+	}
+
+	sources = bzalloc(sizeof(obs_source_t *) * tickers);
+
+	start = os_gettime_ns();
+	for (int i = 0; i < tickers; i++) {
+		struct dstr name = {0};
+		obs_data_t *settings = ticker_settings(face, "Breaking news");
+
+		dstr_printf(&name, "ticker %d", i);
+		sources[i] = obs_source_create_private("text_ft2_source",
+						       name.array, settings);
+		obs_data_release(settings);
+		dstr_free(&name);
+
+		if (!sources[i]) {
+			fprintf(stderr, "Couldn't create text_ft2_source\n");
+			ret = 1;
+			goto cleanup;
+		}
+	}
+	create_ns = os_gettime_ns() - start;
+
+	start = os_gettime_ns();
+	for (int u = 0; u < updates; u++) {
+		for (int i = 0; i < tickers; i++)
+			update_ticker(sources[i], i, u);
+	}
+	update_ns = os_gettime_ns() - start;
+
+	printf("tickers:           %d\n", tickers);
+	printf("updates/ticker:    %d\n", updates);
+	printf("create total:      %.3f ms\n", (double)create_ns / 1000000.0);
+	printf("create per ticker: %.3f ms\n",
+	       (double)create_ns / 1000000.0 / (double)tickers);
+	printf("update total:      %.3f ms\n", (double)update_ns / 1000000.0);
+	printf("update average:    %.3f us\n",
+	       (double)update_ns / 1000.0 / ((double)tickers * updates));
+
+cleanup:
+	for (int i = 0; i < tickers; i++)
+		obs_source_release(sources[i]);
+	bfree(sources);
+
+	obs_shutdown();
+	return ret;
+}
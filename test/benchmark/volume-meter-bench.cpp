@@ -0,0 +1,379 @@
+/******************************************************************************
+    Copyright (C) 2021 by the OBS Project
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ * Measures the UI thread time spent on the audio mixer meters, on the
+ * offscreen Qt platform.  Every meter has a libobs volume meter attached to
+ * an audio line source, and a thread feeds a sine to some of them in real
+ * time.  Once per display tick the levels are taken from libobs, once with
+ * obs_volmeter_get_levels for each meter and once with a single
+ * obs_volmeters_get_levels call, and the meters whose bars moved are
+ * repainted (with a cached background, like UI/volume-control.cpp).
+ *
+ * usage: volume-meter-bench [meters] [ticks] [active meters]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QPainter>
+#include <QPixmap>
+#include <QVBoxLayout>
+#include <QWidget>
+
+#include <obs.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define DEFAULT_METERS 32
+#define DEFAULT_TICKS 600
+#define DEFAULT_ACTIVE 4
+#define CHANNELS 2
+
+#define SAMPLE_RATE 48000
+#define BLOCK_FRAMES 480
+#define TICK_NS 16666667ULL
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+#define MINIMUM_LEVEL -60.0
+#define WARNING_LEVEL -20.0
+#define ERROR_LEVEL -9.0
+
+static const QColor bgNominal(0x26, 0x7f, 0x26);
+static const QColor bgWarning(0x7f, 0x7f, 0x26);
+static const QColor bgError(0x7f, 0x26, 0x26);
+static const QColor fgNominal(0x4c, 0xff, 0x4c);
+static const QColor fgWarning(0xff, 0xff, 0x4c);
+static const QColor fgError(0xff, 0x4c, 0x4c);
+
+class BenchMeter : public QWidget {
+	QPixmap background;
+	int paintedPeak[CHANNELS] = {-2, -2};
+
+	inline int position(int length, double level) const
+	{
+		if (!(level > MINIMUM_LEVEL))
+			return -1;
+		return int(length - level * (length / MINIMUM_LEVEL));
+	}
+
+	void paintBars(QPainter &painter, int y, int length, int peak,
+		       bool lit)
+	{
+		int warning = position(length, WARNING_LEVEL);
+		int error = position(length, ERROR_LEVEL);
+
+		if (!lit) {
+			painter.fillRect(5, y, warning, 3, bgNominal);
+			painter.fillRect(5 + warning, y, error - warning, 3,
+					 bgWarning);
+			painter.fillRect(5 + error, y, length - error, 3,
+					 bgError);
+			return;
+		}
+
+		if (peak < 0)
+			return;
+
+		painter.fillRect(5, y, std::min(peak, warning), 3, fgNominal);
+		if (peak > warning)
+			painter.fillRect(5 + warning, y,
+					 std::min(peak, error) - warning, 3,
+					 fgWarning);
+		if (peak > error)
+			painter.fillRect(5 + error, y, peak - error, 3,
+					 fgError);
+	}
+
+	void paintTicks(QPainter &painter, int length)
+	{
+		painter.setPen(Qt::white);
+		for (int i = 0; i >= MINIMUM_LEVEL; i -= 5) {
+			int x = 5 + position(length, i);
+			painter.drawLine(x, height() - 9, x, height() - 7);
+			painter.drawText(x - 5, height(), QString::number(i));
+		}
+	}
+
+public:
+	obs_source_t *source;
+	obs_volmeter_t *volmeter;
+	double peak[CHANNELS] = {-INFINITY, -INFINITY};
+
+	inline BenchMeter(obs_source_t *source_) : source(source_)
+	{
+		setAttribute(Qt::WA_OpaquePaintEvent, true);
+		setMinimumSize(130, CHANNELS * 4 + 8);
+
+		volmeter = obs_volmeter_create(OBS_FADER_LOG);
+		obs_volmeter_attach_source(volmeter, source);
+	}
+
+	inline ~BenchMeter() { obs_volmeter_destroy(volmeter); }
+
+	/* keeps the previous levels if there were no new ones */
+	void SetLevels(uint64_t ts, const float levels[MAX_AUDIO_CHANNELS])
+	{
+		if (!ts)
+			return;
+		for (int i = 0; i < CHANNELS; i++)
+			peak[i] = levels[i];
+	}
+
+	bool Dirty() const
+	{
+		int length = width() - 5;
+		for (int i = 0; i < CHANNELS; i++) {
+			if (position(length, peak[i]) != paintedPeak[i])
+				return true;
+		}
+		return false;
+	}
+
+protected:
+	void paintEvent(QPaintEvent *) override
+	{
+		int length = width() - 5;
+		QPainter painter(this);
+
+		if (background.size() != size()) {
+			background = QPixmap(size());
+			QPainter bgPainter(&background);
+			bgPainter.fillRect(rect(), palette().window().color());
+			paintTicks(bgPainter, length);
+			for (int i = 0; i < CHANNELS; i++)
+				paintBars(bgPainter, i * 4, length, 0, false);
+		}
+		painter.drawPixmap(0, 0, background);
+
+		for (int i = 0; i < CHANNELS; i++) {
+			paintedPeak[i] = position(length, peak[i]);
+			paintBars(painter, i * 4, length, paintedPeak[i], true);
+		}
+	}
+};
+
+struct feeder {
+	pthread_t thread;
+	std::vector<obs_source_t *> sources;
+	volatile bool stop;
+};
+
+static void *feeder_thread(void *data)
+{
+	feeder *f = (feeder *)data;
+	std::vector<float> samples(BLOCK_FRAMES);
+	uint64_t interval = 1000000000ULL * BLOCK_FRAMES / SAMPLE_RATE;
+	uint64_t cur_time = os_gettime_ns();
+	uint64_t frame = 0;
+
+	os_set_thread_name("volume-meter-bench: feeder");
+
+	while (!os_atomic_load_bool(&f->stop)) {
+		for (int i = 0; i < BLOCK_FRAMES; i++, frame++) {
+			double t = (double)frame / SAMPLE_RATE;
+			double gain = 0.5 + 0.45 * sin(t * 3.0);
+			samples[i] = (float)(gain * sin(t * 440.0 * 2 * M_PI));
+		}
+
+		struct obs_source_audio audio = {};
+		for (int c = 0; c < CHANNELS; c++)
+			audio.data[c] = (const uint8_t *)samples.data();
+		audio.frames = BLOCK_FRAMES;
+		audio.speakers = SPEAKERS_STEREO;
+		audio.format = AUDIO_FORMAT_FLOAT_PLANAR;
+		audio.samples_per_sec = SAMPLE_RATE;
+		audio.timestamp = cur_time;
+
+		for (obs_source_t *source : f->sources)
+			obs_source_output_audio(source, &audio);
+
+		os_sleepto_ns(cur_time += interval);
+	}
+
+	return NULL;
+}
+
+struct bench_result {
+	double poll_ms;
+	double tick_ms;
+	int repaints;
+};
+
+static void poll_each(const QList<BenchMeter *> &list)
+{
+	float magnitude[MAX_AUDIO_CHANNELS];
+	float peak[MAX_AUDIO_CHANNELS];
+	float input_peak[MAX_AUDIO_CHANNELS];
+
+	for (BenchMeter *meter : list) {
+		uint64_t ts = obs_volmeter_get_levels(meter->volmeter,
+						      magnitude, peak,
+						      input_peak);
+		meter->SetLevels(ts, peak);
+	}
+}
+
+static void poll_all(const QList<BenchMeter *> &list,
+		     std::vector<obs_volmeter_levels> &levels)
+{
+	levels.resize(list.count());
+	for (int i = 0; i < list.count(); i++)
+		levels[i].volmeter = list[i]->volmeter;
+
+	obs_volmeters_get_levels(levels.data(), levels.size());
+
+	for (int i = 0; i < list.count(); i++)
+		list[i]->SetLevels(levels[i].ts, levels[i].peak);
+}
+
+static bench_result run(bool batched, const QList<BenchMeter *> &list,
+			int ticks)
+{
+	std::vector<obs_volmeter_levels> levels;
+	bench_result result = {};
+	QElapsedTimer timer;
+	uint64_t poll_ns = 0;
+	uint64_t tick_ns = 0;
+	uint64_t cur_time = os_gettime_ns();
+
+	for (int tick = 0; tick < ticks; tick++) {
+		os_sleepto_ns(cur_time += TICK_NS);
+
+		timer.start();
+		if (batched)
+			poll_all(list, levels);
+		else
+			poll_each(list);
+		poll_ns += timer.nsecsElapsed();
+
+		for (BenchMeter *meter : list) {
+			if (meter->Dirty()) {
+				meter->update();
+				result.repaints++;
+			}
+		}
+
+		QApplication::processEvents();
+		tick_ns += timer.nsecsElapsed();
+	}
+
+	result.poll_ms = (double)poll_ns / 1000000.0 / ticks;
+	result.tick_ms = (double)tick_ns / 1000000.0 / ticks;
+	return result;
+}
+
+static bool init_obs(void)
+{
+	struct obs_audio_info oai = {};
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return false;
+
+	oai.samples_per_sec = SAMPLE_RATE;
+	oai.speakers = SPEAKERS_STEREO;
+	return obs_reset_audio(&oai);
+}
+
+int main(int argc, char *argv[])
+{
+	int meters = DEFAULT_METERS;
+	int ticks = DEFAULT_TICKS;
+	int active = DEFAULT_ACTIVE;
+
+	if (argc > 1)
+		meters = atoi(argv[1]);
+	if (argc > 2)
+		ticks = atoi(argv[2]);
+	if (argc > 3)
+		active = atoi(argv[3]);
+	if (meters <= 0 || ticks <= 0 || active < 0) {
+		fprintf(stderr, "usage: %s [meters] [ticks] [active meters]\n",
+			argv[0]);
+		return 1;
+	}
+
+	qputenv("QT_QPA_PLATFORM", "offscreen");
+	QApplication app(argc, argv);
+
+	if (!init_obs()) {
+		fprintf(stderr, "failed to initialize libobs\n");
+		obs_shutdown();
+		return 1;
+	}
+
+	bench_result each;
+	bench_result all;
+	feeder f = {};
+
+	{
+		QWidget window;
+		QVBoxLayout *layout = new QVBoxLayout(&window);
+		QList<BenchMeter *> list;
+
+		for (int i = 0; i < meters; i++) {
+			QString name = QString("meter %1").arg(i);
+			obs_source_t *source = obs_source_create_private(
+				"audio_line", name.toUtf8().constData(), NULL);
+			BenchMeter *meter = new BenchMeter(source);
+
+			layout->addWidget(meter);
+			list.append(meter);
+			if (i < active)
+				f.sources.push_back(source);
+		}
+
+		window.resize(300, meters * 20);
+		window.show();
+		QApplication::processEvents();
+
+		pthread_create(&f.thread, NULL, feeder_thread, &f);
+
+		each = run(false, list, ticks);
+		all = run(true, list, ticks);
+
+		os_atomic_set_bool(&f.stop, true);
+		pthread_join(f.thread, NULL);
+
+		for (BenchMeter *meter : list) {
+			obs_source_t *source = meter->source;
+			delete meter;
+			obs_source_release(source);
+		}
+	}
+
+	obs_shutdown();
+
+	printf("meters:                 %d (%d with audio)\n", meters,
+	       std::min(active, meters));
+	printf("ticks:                  %d\n", ticks);
+	printf("poll each meter:        %.3f ms/tick poll, %.3f ms/tick "
+	       "total (%d repaints)\n",
+	       each.poll_ms, each.tick_ms, each.repaints);
+	printf("poll all meters:        %.3f ms/tick poll, %.3f ms/tick "
+	       "total (%d repaints)\n",
+	       all.poll_ms, all.tick_ms, all.repaints);
+	return 0;
+}